@@ -25,6 +25,7 @@
 #include <iostream>
 #include <string>
 
+#include "core/data_storage.h"
 #include "command.h"
 
 class ListPeerCommand : public Command {
@@ -34,16 +35,22 @@ public:
 protected:
     void execute() override {
         auto storage = node->getStorage();
-        auto peerIds = storage->getAllPeers();
+
+        // a page at a time, the storage may hold far more than fits in memory
+        size_t total = 0;
+        ScanCursor cursor {};
         std::cout << "----------------------------------------------" << std::endl;
-        if (!peerIds.empty()) {
-            for (const auto& id : peerIds)
+        while (!cursor.done) {
+            for (const auto& id : storage->scanPeerIds(cursor, Constants::STORAGE_SCAN_PAGE)) {
                 std::cout << id.toString() << std::endl;
+                total++;
+            }
+        }
 
-            std::cout << "Total " << peerIds.size() << " peers." << std::endl;
-        } else {
+        if (total > 0)
+            std::cout << "Total " << total << " peers." << std::endl;
+        else
             std::cout << "No peer exists." << std::endl;
-        }
         std::cout << "----------------------------------------------" << std::endl;
     };
 };
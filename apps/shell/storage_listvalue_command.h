@@ -25,6 +25,7 @@
 #include <iostream>
 #include <string>
 
+#include "core/data_storage.h"
 #include "command.h"
 
 class ListValueCommand : public Command {
@@ -34,17 +35,22 @@ public:
 protected:
     void execute() override {
         auto storage = node->getStorage();
-        auto valueIds = storage->getAllValues();
 
+        // a page at a time, the storage may hold far more than fits in memory
+        size_t total = 0;
+        ScanCursor cursor {};
         std::cout << "----------------------------------------------" << std::endl;
-        if (!valueIds.empty()) {
-            for (const auto& id : valueIds)
+        while (!cursor.done) {
+            for (const auto& id : storage->scanValueIds(cursor, Constants::STORAGE_SCAN_PAGE)) {
                 std::cout << id.toString() << std::endl;
+                total++;
+            }
+        }
 
-            std::cout << "Total " << valueIds.size() << " values." << std::endl;
-        } else {
+        if (total > 0)
+            std::cout << "Total " << total << " values." << std::endl;
+        else
             std::cout << "No Value exists." << std::endl;
-        }
         std::cout << "----------------------------------------------" << std::endl;
     };
 };
@@ -34,6 +34,10 @@
 #include <carrier/configuration.h>
 #include <carrier/default_configuration.h>
 #include <carrier/lookup_option.h>
+#include <carrier/lookup_stats.h>
+#include <carrier/announce_stats.h>
+#include <carrier/storage_stats.h>
+#include <carrier/lookup_handle.h>
 #include <carrier/node_info.h>
 #include <carrier/peer_info.h>
 #include <carrier/value.h>
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+#include "def.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The progress of the scheduled announces: the persistent re-announces and
+ * the bulk storeValues and announcePeers.
+ */
+struct CARRIER_PUBLIC AnnounceStats {
+    uint64_t pending {0};     /* number of the queued announces not started yet */
+    uint64_t inFlight {0};    /* number of the announces in progress */
+    uint64_t completed {0};   /* number of the completed announces */
+    uint64_t seeded {0};      /* number of the lookups seeded with the result of a nearby target */
+    uint64_t lag {0};         /* milliseconds the oldest pending announce is behind its schedule */
+    uint64_t maxLag {0};      /* the max lag since the node started */
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
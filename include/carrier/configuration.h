@@ -50,6 +50,107 @@ public:
     virtual std::vector<Sp<NodeInfo>>& getBootstrapNodes() = 0;
 
     virtual std::map<std::string, std::any>& getAddons() = 0;
+
+    /**
+     * The capacity of the non-home buckets in the routing table. A high-capacity
+     * node can keep more contacts in the far buckets to shorten the lookup paths.
+     * 0 (default) keeps the standard bucket size for all the buckets.
+     */
+    virtual int getWideBucketSize() {
+        return 0;
+    }
+
+    /**
+     * The upper limit of the routing table maintenance pings per second.
+     * 0 (default) means unlimited.
+     */
+    virtual int getMaintenancePingRate() {
+        return 0;
+    }
+
+    /**
+     * The bounds of the adaptive request concurrency (alpha) of the lookups.
+     * A lookup starts with the minimum and widens up to the maximum when the
+     * requests stall or time out. 0 (default) uses the built-in bounds.
+     */
+    virtual int getMinLookupConcurrency() {
+        return 0;
+    }
+
+    virtual int getMaxLookupConcurrency() {
+        return 0;
+    }
+
+    /**
+     * The memory budget in bytes of the lookup result cache, which keeps the
+     * recent findNode, findValue and findPeer results, found or not, for the
+     * repeated lookups of the same ids. 0 (default) disables the cache.
+     */
+    virtual int getLookupCacheSize() {
+        return 0;
+    }
+
+    /**
+     * The lifetime in milliseconds of the cached results that found something
+     * (positive) and that found nothing (negative). 0 (default) uses the
+     * built-in lifetimes.
+     */
+    virtual int getLookupCachePositiveTTL() {
+        return 0;
+    }
+
+    virtual int getLookupCacheNegativeTTL() {
+        return 0;
+    }
+
+    /**
+     * The memory in bytes the SQLite data storage may memory-map, and use for
+     * its page cache. 0 (default) uses the built-in sizes.
+     */
+    virtual int getStorageMmapSize() {
+        return 0;
+    }
+
+    virtual int getStorageCacheSize() {
+        return 0;
+    }
+
+    /**
+     * The memory budget in bytes of the in-memory data storage. A positive
+     * budget keeps the values and peers in memory only, instead of the SQLite
+     * database under the storage path, they are lost when the node stops.
+     * 0 (default) uses the SQLite storage.
+     */
+    virtual int getMemoryStorageSize() {
+        return 0;
+    }
+
+    /**
+     * Keeps the values and peers in an append-only log under the storage path
+     * instead of the SQLite database. false (default) uses the SQLite storage.
+     */
+    virtual bool useLogStorage() {
+        return false;
+    }
+
+    /**
+     * The bytes of the values and peers the other nodes may store on this
+     * node: in total, for each origin node and for each IP prefix of the
+     * origins. The stores over the origin or prefix quota are rejected, over
+     * the budget the least recently stored records are evicted. 0 (default)
+     * uses the built-in limits.
+     */
+    virtual int getStorageBudget() {
+        return 0;
+    }
+
+    virtual int getStorageOriginQuota() {
+        return 0;
+    }
+
+    virtual int getStoragePrefixQuota() {
+        return 0;
+    }
 };
 
 } // namespace carrier
@@ -69,6 +69,62 @@ public:
         return addons;
     }
 
+    int getWideBucketSize() override {
+        return wideBucketSize;
+    }
+
+    int getMaintenancePingRate() override {
+        return maintenancePingRate;
+    }
+
+    int getMinLookupConcurrency() override {
+        return minLookupConcurrency;
+    }
+
+    int getMaxLookupConcurrency() override {
+        return maxLookupConcurrency;
+    }
+
+    int getLookupCacheSize() override {
+        return lookupCacheSize;
+    }
+
+    int getLookupCachePositiveTTL() override {
+        return lookupCachePositiveTTL;
+    }
+
+    int getLookupCacheNegativeTTL() override {
+        return lookupCacheNegativeTTL;
+    }
+
+    int getStorageMmapSize() override {
+        return storageMmapSize;
+    }
+
+    int getStorageCacheSize() override {
+        return storageCacheSize;
+    }
+
+    int getMemoryStorageSize() override {
+        return memoryStorageSize;
+    }
+
+    bool useLogStorage() override {
+        return logStorage;
+    }
+
+    int getStorageBudget() override {
+        return storageBudget;
+    }
+
+    int getStorageOriginQuota() override {
+        return storageOriginQuota;
+    }
+
+    int getStoragePrefixQuota() override {
+        return storagePrefixQuota;
+    }
+
     class CARRIER_PUBLIC Builder {
     public:
         Builder() {
@@ -125,6 +181,69 @@ public:
             bootstrapNodes.emplace_back(node);
         }
 
+        void setWideBucketSize(int size) {
+            if (size < 0)
+                throw std::invalid_argument("Invalid wide bucket size: " + std::to_string(size));
+
+            this->wideBucketSize = size;
+        }
+
+        void setMaintenancePingRate(int rate) {
+            if (rate < 0)
+                throw std::invalid_argument("Invalid maintenance ping rate: " + std::to_string(rate));
+
+            this->maintenancePingRate = rate;
+        }
+
+        void setLookupConcurrency(int min, int max) {
+            if (min < 0 || max < 0 || (min > 0 && max > 0 && min > max))
+                throw std::invalid_argument("Invalid lookup concurrency: " +
+                        std::to_string(min) + " - " + std::to_string(max));
+
+            this->minLookupConcurrency = min;
+            this->maxLookupConcurrency = max;
+        }
+
+        void setLookupCache(int size, int positiveTTL = 0, int negativeTTL = 0) {
+            if (size < 0 || positiveTTL < 0 || negativeTTL < 0)
+                throw std::invalid_argument("Invalid lookup cache: " + std::to_string(size) +
+                        ", ttl " + std::to_string(positiveTTL) + "/" + std::to_string(negativeTTL));
+
+            this->lookupCacheSize = size;
+            this->lookupCachePositiveTTL = positiveTTL;
+            this->lookupCacheNegativeTTL = negativeTTL;
+        }
+
+        void setStorageMemory(int mmapSize, int cacheSize) {
+            if (mmapSize < 0 || cacheSize < 0)
+                throw std::invalid_argument("Invalid storage memory: mmap " + std::to_string(mmapSize) +
+                        ", cache " + std::to_string(cacheSize));
+
+            this->storageMmapSize = mmapSize;
+            this->storageCacheSize = cacheSize;
+        }
+
+        void setMemoryStorage(int size) {
+            if (size < 0)
+                throw std::invalid_argument("Invalid memory storage size: " + std::to_string(size));
+
+            this->memoryStorageSize = size;
+        }
+
+        void setLogStorage(bool enabled) {
+            this->logStorage = enabled;
+        }
+
+        void setStorageQuota(int budget, int originQuota, int prefixQuota) {
+            if (budget < 0 || originQuota < 0 || prefixQuota < 0)
+                throw std::invalid_argument("Invalid storage quota: budget " + std::to_string(budget) +
+                        ", origin " + std::to_string(originQuota) + ", prefix " + std::to_string(prefixQuota));
+
+            this->storageBudget = budget;
+            this->storageOriginQuota = originQuota;
+            this->storagePrefixQuota = prefixQuota;
+        }
+
         void load(const std::string& path);
         void reset();
 
@@ -139,6 +258,20 @@ public:
         std::string storagePath {};
         std::vector<Sp<NodeInfo>> bootstrapNodes {};
         std::map<std::string, std::any> addons {};
+        int wideBucketSize {0};
+        int maintenancePingRate {0};
+        int minLookupConcurrency {0};
+        int maxLookupConcurrency {0};
+        int lookupCacheSize {0};
+        int lookupCachePositiveTTL {0};
+        int lookupCacheNegativeTTL {0};
+        int storageMmapSize {0};
+        int storageCacheSize {0};
+        int memoryStorageSize {0};
+        bool logStorage {false};
+        int storageBudget {0};
+        int storageOriginQuota {0};
+        int storagePrefixQuota {0};
     };
 
 private:
@@ -148,6 +281,21 @@ private:
     std::string storagePath {};
     std::vector<Sp<NodeInfo>> bootstrapNodes {};
     std::map<std::string, std::any> addons {};
+
+    int wideBucketSize {0};
+    int maintenancePingRate {0};
+    int minLookupConcurrency {0};
+    int maxLookupConcurrency {0};
+    int lookupCacheSize {0};
+    int lookupCachePositiveTTL {0};
+    int lookupCacheNegativeTTL {0};
+    int storageMmapSize {0};
+    int storageCacheSize {0};
+    int memoryStorageSize {0};
+    bool logStorage {false};
+    int storageBudget {0};
+    int storageOriginQuota {0};
+    int storagePrefixQuota {0};
 };
 
 } // namespace carrier
@@ -26,6 +26,8 @@
 #include <vector>
 #include <stdexcept>
 #include <string>
+#include <cstring>
+#include <functional>
 
 #include "def.h"
 #include "types.h"
@@ -117,6 +119,9 @@ public:
      */
     int threeWayCompare(const Id& id1, const Id& id2) const;
 
+    // Counts the number of leading 0's in this Id
+    int getLeadingZeros() const;
+
     static bool bitsEqual(const Id& id1, const Id& id2, int bits);
     static void bitsCopy(const Id& src, Id& dest, int depth);
 
@@ -160,11 +165,22 @@ private:
     void fromBase58String(const std::string&);
     void fromHexString(const std::string&);
 
-    // Counts the number of leading 0's in this Id
-    int getLeadingZeros();
-
     std::array<uint8_t, ID_BYTES> bytes {0};
 };
 
 } // namespace carrier
 } // namespace elastos
+
+namespace std {
+
+// The ids are hashes already, the leading bytes are as good as any hash of them
+template<>
+struct hash<elastos::carrier::Id> {
+    size_t operator()(const elastos::carrier::Id& id) const noexcept {
+        size_t hash;
+        std::memcpy(&hash, id.data(), sizeof(hash));
+        return hash;
+    }
+};
+
+} // namespace std
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "def.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The handle of a streaming lookup: the findNode, findValue and findPeer
+ * overloads that deliver every new result to a handler as it arrives.
+ */
+class CARRIER_PUBLIC LookupHandle {
+public:
+    LookupHandle() = default;
+    LookupHandle(const LookupHandle&) = delete;
+    LookupHandle& operator=(const LookupHandle&) = delete;
+
+    /**
+     * Stop the lookup early, no more results are delivered and the pending
+     * requests are abandoned. Can be called from any thread, including the
+     * result handler.
+     */
+    void cancel();
+
+    bool isCanceled() const {
+        return canceled;
+    }
+
+    /**
+     * The lookup completed, either exhausted or canceled.
+     */
+    bool isDone() const;
+
+    void wait();
+    bool waitFor(std::chrono::milliseconds timeout);
+
+private:
+    friend class Node;
+
+    void addCanceler(std::function<void()> canceler);
+    void complete();
+
+    std::atomic<bool> canceled {false};
+    bool done {false};
+    std::vector<std::function<void()>> cancelers {};
+
+    mutable std::mutex lock {};
+    std::condition_variable cv {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "def.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The accumulated statistics of the user-level lookups (findNode, findValue
+ * and findPeer) since the node started.
+ */
+struct CARRIER_PUBLIC LookupStats {
+    uint64_t lookups {0};     /* number of the completed lookups */
+    uint64_t hops {0};        /* sum of the hop counts to the closest responded node */
+    uint64_t requests {0};    /* sum of the sent RPC requests */
+    uint64_t latency {0};     /* sum of the lookup durations in milliseconds */
+    uint64_t concurrency {0}; /* sum of the peak request concurrency (alpha) */
+    uint64_t coalesced {0};   /* number of the lookups served by an identical one in flight */
+    uint64_t cached {0};      /* number of the lookups answered by the result cache */
+
+    double averageHops() const {
+        return lookups ? static_cast<double>(hops) / lookups : 0.0;
+    }
+
+    double averageRequests() const {
+        return lookups ? static_cast<double>(requests) / lookups : 0.0;
+    }
+
+    double averageLatency() const {
+        return lookups ? static_cast<double>(latency) / lookups : 0.0;
+    }
+
+    double averageConcurrency() const {
+        return lookups ? static_cast<double>(concurrency) / lookups : 0.0;
+    }
+
+    LookupStats& operator+=(const LookupStats& other) {
+        lookups += other.lookups;
+        hops += other.hops;
+        requests += other.requests;
+        latency += other.latency;
+        concurrency += other.concurrency;
+        coalesced += other.coalesced;
+        cached += other.cached;
+        return *this;
+    }
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
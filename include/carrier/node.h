@@ -26,6 +26,8 @@
 #include <vector>
 #include <functional>
 #include <future>
+#include <atomic>
+#include <mutex>
 
 #include "def.h"
 #include "types.h"
@@ -36,6 +38,10 @@
 #include "peer_info.h"
 #include "configuration.h"
 #include "lookup_option.h"
+#include "lookup_stats.h"
+#include "announce_stats.h"
+#include "storage_stats.h"
+#include "lookup_handle.h"
 #include "node_status.h"
 #include "node_status_listener.h"
 
@@ -46,7 +52,13 @@ class RPCServer;
 class CryptoCache;
 class TokenManager;
 class DataStorage;
+class StorageQuota;
+class PathCache;
 class DHT;
+class Task;
+class LookupCoalescer;
+class LookupCache;
+class AnnounceScheduler;
 class Logger;
 
 class CARRIER_PUBLIC Node{
@@ -73,14 +85,19 @@ public:
         defaultLookupOption = option;
     }
 
+    /**
+     * The listener is held by reference, it should be removed before destroyed.
+     * The ready notification comes from the RPC thread. Once removed, a listener
+     * is not called any more, so the listeners should not block.
+     */
     inline void addStatusListener(NodeStatusListener& listener) {
-        statusListeners.emplace_back(listener);
+        std::lock_guard<std::recursive_mutex> lock(statusListenersLock);
+        statusListeners.emplace_back(&listener);
     }
 
     void removeStatusListener(const NodeStatusListener& listener) {
-        //TODO:: need to implement the NodeStatusListener operator '=='
-        //       Or use Sp<NodeStatusListener>?
-        // statusListeners.remove(listener);
+        std::lock_guard<std::recursive_mutex> lock(statusListenersLock);
+        statusListeners.remove(const_cast<NodeStatusListener*>(&listener));
     }
 
     void bootstrap(const NodeInfo& node);
@@ -91,6 +108,10 @@ public:
         return status == NodeStatus::Running;
     }
 
+    bool isReady() const {
+        return ready;
+    }
+
     std::future<std::vector<Sp<NodeInfo>>> findNode(const Id& id) const {
         return findNode(id, defaultLookupOption);
     }
@@ -114,10 +135,49 @@ public:
     std::future<std::vector<PeerInfo>> findPeer(const Id &id, int expectedNum, LookupOption option) const;
     std::future<void> announcePeer(const PeerInfo& peer, bool persistent = false) const;
 
+    /**
+     * The bulk announces are paced by the announce scheduler, the nearby
+     * targets share the lookup work. The future is ready when all of them
+     * are announced.
+     */
+    std::future<void> storeValues(const std::vector<Value>& values, bool persistent = false) const;
+    std::future<void> announcePeers(const std::vector<PeerInfo>& peers, bool persistent = false) const;
+
+    /**
+     * The streaming lookups deliver every new deduplicated result as soon as it
+     * is discovered, instead of all of them after both DHT lookups completed.
+     *
+     * The locally known results are delivered first on the calling thread, the
+     * others on the RPC thread, so the handlers should not block. The result
+     * handler returns false to stop the lookup, the returned handle can also
+     * cancel it from any thread. The complete handler is called once when the
+     * lookup is exhausted or canceled.
+     */
+    Sp<LookupHandle> findNode(const Id& id, LookupOption option,
+            std::function<bool(Sp<NodeInfo>)> resultHandler, std::function<void()> completeHandler = nullptr) const;
+    Sp<LookupHandle> findValue(const Id& id, LookupOption option,
+            std::function<bool(Sp<Value>)> resultHandler, std::function<void()> completeHandler = nullptr) const;
+    Sp<LookupHandle> findPeer(const Id& id, int expectedNum, LookupOption option,
+            std::function<bool(const PeerInfo&)> resultHandler, std::function<void()> completeHandler = nullptr) const;
+
+    LookupStats getLookupStats() const;
+    AnnounceStats getAnnounceStats() const;
+    StorageStats getStorageStats() const;
+
     Sp<DataStorage> getStorage() const {
         return storage;
     }
 
+    // the values and peers stored by the other nodes go through the quotas
+    Sp<StorageQuota> getStorageQuota() const {
+        return storageQuota;
+    }
+
+    // the copies of the values and peers cached here by the lookups passing by
+    Sp<PathCache> getPathCache() const {
+        return pathCache;
+    }
+
     int getPort();
 
     Sp<DHT> getDHT(int type) const noexcept;
@@ -143,11 +203,28 @@ private:
     void initKey(const std::string&);
     void writeIdFile(const std::string&);
     void setStatus(NodeStatus expected, NodeStatus newStatus);
+    void setReady();
     void setupCryptoBoxesCache();
 
     void persistentAnnounce();
+    void doFindNode(const Id& id, LookupOption option, std::function<void(std::vector<Sp<NodeInfo>>)> resultHandler) const;
+    void doFindValue(const Id& id, LookupOption option, std::function<void(Sp<Value>)> resultHandler) const;
+    void doFindPeer(const Id& id, int expected, LookupOption option, std::function<void(std::vector<PeerInfo>)> resultHandler) const;
     std::future<void> doStoreValue(const Value& value) const;
+    void doStoreValue(const Value& value, const std::list<Sp<NodeInfo>>& seeds,
+            std::function<void(std::list<Sp<NodeInfo>>)> completeHandler) const;
     std::future<void> doAnnouncePeer(const PeerInfo& peer) const;
+    void doAnnouncePeer(const PeerInfo& peer, const std::list<Sp<NodeInfo>>& seeds,
+            std::function<void(std::list<Sp<NodeInfo>>)> completeHandler) const;
+    void scheduleAnnounce(const Value& value, uint64_t due, std::function<void()> completeHandler = nullptr) const;
+    void scheduleAnnounce(const PeerInfo& peer, uint64_t due, std::function<void()> completeHandler = nullptr) const;
+    // the stored records of the local node, read from the storage when the announces start
+    void scheduleValueAnnounce(const Id& valueId, uint64_t due) const;
+    void schedulePeerAnnounce(const Id& peerId, uint64_t due) const;
+    std::future<void> scheduleAnnounces(const std::vector<Value>& values, const std::vector<PeerInfo>& peers,
+            uint64_t start, uint64_t interval) const;
+    void doStreamingLookup(Sp<LookupHandle> handle, std::function<Sp<Task>(DHT&, std::function<void()>)> lookup,
+            std::function<void()> completeHandler) const;
 
     Signature::KeyPair keyPair {};
     CryptoBox::KeyPair encryptionKeyPair {};
@@ -163,11 +240,18 @@ private:
 
     NodeStatus status;
     StatusCallback statusCb {nullptr};
-    std::list<NodeStatusListener> statusListeners {};
+    std::list<NodeStatusListener*> statusListeners {};
+    std::recursive_mutex statusListenersLock {};
+    std::atomic<bool> ready {false};
 
     Sp<Configuration> config {};
     Sp<TokenManager> tokenManager {};
+    Sp<LookupCoalescer> lookupCoalescer {};
+    Sp<LookupCache> lookupCache {};
+    Sp<AnnounceScheduler> announceScheduler {};
     Sp<DataStorage> storage {};
+    Sp<StorageQuota> storageQuota {};
+    Sp<PathCache> pathCache {};
     Sp<RPCServer> server {};
     Sp<CryptoCache> cryptoContexts {};
     Sp<Logger> log {};
@@ -31,6 +31,13 @@ namespace carrier {
 class CARRIER_PUBLIC NodeStatusListener {
 public:
     virtual void statusChanged(NodeStatus newStatus, NodeStatus oldStatus) {};
+
+    /**
+     * Called once after the node started, when the routing table is trustworthy
+     * for the lookups: either enough cached entries answered the warm start pings,
+     * or the bootstrap finished.
+     */
+    virtual void ready() {};
 };
 
 } /* namespace carrier */
@@ -184,6 +184,11 @@ public:
         bool operator()(const SocketAddress& a, const SocketAddress& b) const noexcept;
     };
 
+    class Hash {
+    public:
+        size_t operator()(const SocketAddress& addr) const noexcept;
+    };
+
 private:
     static socklen_t sslen(sa_family_t family);
 
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+
+#include "def.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The data storage of the node: the write-behind queue, the writes are
+ * visible at once and committed by a background thread in batches, and the
+ * in-memory cache of the hot values and peers, and the records stored for
+ * the other nodes under the storage quotas, and the copies cached by the
+ * lookups passing by.
+ */
+struct CARRIER_PUBLIC StorageStats {
+    uint64_t queueDepth {0};         /* number of the writes waiting to be committed */
+    uint64_t maxQueueDepth {0};      /* the max queue depth since the storage opened */
+    uint64_t commits {0};            /* number of the committed transactions */
+    uint64_t writes {0};             /* number of the committed writes */
+    uint64_t expired {0};            /* number of the expired values and peers removed */
+    uint64_t commitLatency {0};      /* microseconds the last commit took */
+    uint64_t maxCommitLatency {0};   /* the max commit latency since the storage opened */
+    uint64_t totalCommitLatency {0}; /* microseconds all the commits took */
+    uint64_t cacheHits {0};          /* number of the reads served from the cache */
+    uint64_t cacheMisses {0};        /* number of the reads passed to the storage */
+    uint64_t quotaBytes {0};         /* bytes of the records stored for the other nodes */
+    uint64_t quotaRecords {0};       /* number of the records stored for the other nodes */
+    uint64_t quotaRejected {0};      /* number of the stores rejected over the per-origin or per-prefix quota */
+    uint64_t quotaEvicted {0};       /* number of the records evicted over the storage budget */
+    uint64_t pathCacheRecords {0};   /* number of the values and peers cached on the lookup paths */
+    uint64_t pathCacheBytes {0};     /* bytes of the records cached on the lookup paths */
+    uint64_t pathCacheHits {0};      /* number of the lookups answered from the path cache */
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <optional>
+
+#include "carrier/id.h"
+#include "utils/time.h"
+#include "task/closest_set.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The closest nodes of the recent announce lookups, together with the write
+ * tokens they issued, keyed by the announce target.
+ *
+ * A remote node accepts its token for at least the token timeout after it
+ * was issued, so an announce of the same target within the max age can be
+ * sent to the cached nodes directly, without a new lookup. The acquired time
+ * should be the start time of the lookup, no token can be older than it.
+ * The current time can be given to get() and put() for the tests.
+ *
+ * Thread safe.
+ */
+class AnnounceCache {
+public:
+    AnnounceCache(uint64_t maxAge) : maxAge(maxAge) {}
+
+    std::optional<ClosestSet> get(const Id& target, uint64_t now = currentTimeMillis()) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = entries.find(target);
+        if (it == entries.end())
+            return std::nullopt;
+
+        if (isExpired(it->second, now)) {
+            entries.erase(it);
+            return std::nullopt;
+        }
+
+        return it->second.closest;
+    }
+
+    void put(const Id& target, const ClosestSet& closest, uint64_t acquired,
+            uint64_t now = currentTimeMillis()) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (isExpired(it->second, now))
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+
+        if (closest.size() == 0 || now - acquired >= maxAge) {
+            entries.erase(target);
+            return;
+        }
+
+        entries.insert_or_assign(target, Entry{closest, acquired});
+    }
+
+    void remove(const Id& target) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(target);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+private:
+    struct Entry {
+        ClosestSet closest;
+        uint64_t acquired;
+    };
+
+    bool isExpired(const Entry& entry, uint64_t now) const {
+        return now - entry.acquired >= maxAge;
+    }
+
+    const uint64_t maxAge;
+
+    std::map<Id, Entry> entries {};
+    mutable std::mutex mutex {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
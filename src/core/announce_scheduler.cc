@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <algorithm>
+
+#include "utils/time.h"
+#include "announce_scheduler.h"
+
+namespace elastos {
+namespace carrier {
+
+// The closest nodes of the recent announces kept to seed the nearby ones
+static const size_t MAX_RECENT_RESULTS = 16;
+// The targets sharing less prefix have few closest nodes in common
+static const int MIN_SHARED_PREFIX_BITS = 8;
+
+void AnnounceScheduler::add(Kind kind, const Id& target, uint64_t due, Announce announce, std::function<void()> completeHandler) {
+    std::lock_guard<std::mutex> lk(mutex);
+
+    auto it = pending.find({kind, target});
+    if (it != pending.end()) {
+        auto entry = it->second;
+        entry->announce = announce;
+        if (completeHandler)
+            entry->completeHandlers.push_back(completeHandler);
+
+        if (due < entry->due) {
+            queue.erase({entry->due, target, kind});
+            entry->due = due;
+            queue.emplace(Key{due, target, kind}, entry);
+        }
+        return;
+    }
+
+    auto entry = std::make_shared<Entry>(Entry{kind, target, due, announce, {}});
+    if (completeHandler)
+        entry->completeHandlers.push_back(completeHandler);
+
+    queue.emplace(Key{due, target, kind}, entry);
+    pending.emplace(std::make_pair(kind, target), entry);
+    stats.pending = pending.size();
+}
+
+void AnnounceScheduler::dispatch() {
+    std::unique_lock<std::mutex> lk(mutex);
+
+    // the announces completed while dispatching, even at once on this thread, are
+    // picked up by the running loop instead of a nested dispatch
+    redispatch = true;
+    if (dispatching)
+        return;
+
+    dispatching = true;
+    while (redispatch) {
+        redispatch = false;
+
+        std::vector<std::pair<Sp<Entry>, std::list<Sp<NodeInfo>>>> started {};
+        auto now = currentTimeMillis();
+        while (!queue.empty() && inFlight < maxInFlight) {
+            auto it = queue.begin();
+            auto entry = it->second;
+            if (entry->due > now)
+                break;
+
+            queue.erase(it);
+            pending.erase({entry->kind, entry->target});
+            running.insert(entry);
+            inFlight++;
+
+            auto seeds = getSeeds(entry->target);
+            if (!seeds.empty())
+                stats.seeded++;
+            started.emplace_back(entry, seeds);
+        }
+
+        if (!queue.empty() && queue.begin()->second->due < now) {
+            stats.lag = now - queue.begin()->second->due;
+            stats.maxLag = std::max(stats.maxLag, stats.lag);
+        } else {
+            stats.lag = 0;
+        }
+
+        stats.pending = pending.size();
+        stats.inFlight = inFlight;
+
+        // outside of the lock, the announce may complete at once
+        lk.unlock();
+        try {
+            for (const auto& [entry, seeds] : started) {
+                entry->announce(seeds, [=](std::list<Sp<NodeInfo>> closest) {
+                    onComplete(entry, closest);
+                });
+            }
+        } catch (...) {
+            lk.lock();
+            dispatching = false;
+            throw;
+        }
+        lk.lock();
+    }
+
+    dispatching = false;
+}
+
+void AnnounceScheduler::onComplete(const Sp<Entry>& entry, const std::list<Sp<NodeInfo>>& closest) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        // given up by clear()
+        if (running.erase(entry) == 0)
+            return;
+
+        inFlight--;
+        stats.inFlight = inFlight;
+        stats.completed++;
+
+        if (!closest.empty()) {
+            recent.emplace_front(entry->target, closest);
+            if (recent.size() > MAX_RECENT_RESULTS)
+                recent.pop_back();
+        }
+    }
+
+    for (const auto& handler : entry->completeHandlers)
+        handler();
+
+    dispatch();
+}
+
+void AnnounceScheduler::clear() {
+    std::vector<Sp<Entry>> dropped {};
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        for (const auto& [key, entry] : queue)
+            dropped.push_back(entry);
+        dropped.insert(dropped.end(), running.begin(), running.end());
+
+        queue.clear();
+        pending.clear();
+        running.clear();
+        recent.clear();
+        inFlight = 0;
+        stats.pending = 0;
+        stats.inFlight = 0;
+        stats.lag = 0;
+    }
+
+    for (const auto& entry : dropped) {
+        for (const auto& handler : entry->completeHandlers)
+            handler();
+    }
+}
+
+AnnounceStats AnnounceScheduler::getStats() const {
+    std::lock_guard<std::mutex> lk(mutex);
+    return stats;
+}
+
+std::list<Sp<NodeInfo>> AnnounceScheduler::getSeeds(const Id& target) {
+    const std::list<Sp<NodeInfo>>* nearest {nullptr};
+    Id nearestTarget {};
+
+    for (const auto& [id, closest] : recent) {
+        if (nearest == nullptr || target.threeWayCompare(id, nearestTarget) < 0) {
+            nearest = &closest;
+            nearestTarget = id;
+        }
+    }
+
+    if (nearest == nullptr || target.distance(nearestTarget).getLeadingZeros() < MIN_SHARED_PREFIX_BITS)
+        return {};
+
+    return *nearest;
+}
+
+} /* namespace carrier */
+} /* namespace elastos */
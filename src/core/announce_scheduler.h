@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <mutex>
+#include <functional>
+
+#include "carrier/id.h"
+#include "carrier/node_info.h"
+#include "carrier/announce_stats.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * Paces the announces of the node, so a large batch of values and peers does
+ * not start all its lookups at once.
+ *
+ * Every announce is queued with a due time, and started at that time or
+ * later when fewer than the max announces are in flight. The announces due
+ * at the same time start in the order of their targets, and the lookup of
+ * each one is seeded with the closest nodes found for the nearest recently
+ * announced target, so the nearby targets share most of the lookup work.
+ *
+ * Thread safe.
+ */
+class AnnounceScheduler {
+public:
+    enum class Kind { VALUE, PEER };
+
+    using CompleteHandler = std::function<void(std::list<Sp<NodeInfo>>)>;
+    using Announce = std::function<void(const std::list<Sp<NodeInfo>>&, CompleteHandler)>;
+
+    AnnounceScheduler(int maxInFlight) : maxInFlight(maxInFlight) {}
+
+    /**
+     * Queues the announce of the target, the announce is called with the
+     * seed nodes and must call the complete handler with the closest nodes
+     * it announced to. A pending announce of the same kind and target is
+     * replaced, but keeps the earlier due time.
+     */
+    void add(Kind kind, const Id& target, uint64_t due, Announce announce, std::function<void()> completeHandler = nullptr);
+
+    /**
+     * Starts the due announces, called periodically and on every completion.
+     * A call made while another one is starting announces, e.g. by a
+     * completion that fires at once, makes that one run another round.
+     */
+    void dispatch();
+
+    /**
+     * Drops the pending announces and gives up the in-flight ones, their
+     * complete handlers are called. The later completions of the given up
+     * announces are ignored.
+     */
+    void clear();
+
+    AnnounceStats getStats() const;
+
+private:
+    using Key = std::tuple<uint64_t, Id, Kind>;
+
+    struct Entry {
+        Kind kind;
+        Id target;
+        uint64_t due;
+        Announce announce;
+        std::vector<std::function<void()>> completeHandlers;
+    };
+
+    std::list<Sp<NodeInfo>> getSeeds(const Id& target);
+    void onComplete(const Sp<Entry>& entry, const std::list<Sp<NodeInfo>>& closest);
+
+    const int maxInFlight;
+
+    std::map<Key, Sp<Entry>> queue {};
+    std::map<std::pair<Kind, Id>, Sp<Entry>> pending {};
+    std::set<Sp<Entry>> running {};
+    std::list<std::pair<Id, std::list<Sp<NodeInfo>>>> recent {};
+
+    int inFlight {0};
+    bool dispatching {false};
+    bool redispatch {false};
+    AnnounceStats stats {};
+    mutable std::mutex mutex {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
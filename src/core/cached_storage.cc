@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <set>
+
+#include "crypto/random.h"
+#include "utils/time.h"
+#include "constants.h"
+#include "cached_storage.h"
+
+namespace elastos {
+namespace carrier {
+
+CachedStorage::CachedStorage(Sp<DataStorage> storage, size_t capacity, uint64_t ttl)
+        : storage(storage), ttl(ttl) {
+    size_t perShard = std::max(capacity / SHARDS, (size_t)1);
+    for (int i = 0; i < SHARDS; i++)
+        shards.emplace_back(std::make_unique<Shard>(perShard, ttl));
+}
+
+void CachedStorage::invalidate(const Id& id) {
+    auto& shard = shardOf(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.values.remove(id);
+    shard.peers.remove(id);
+    shard.generation++;
+}
+
+void CachedStorage::invalidateAll() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->values.clear();
+        shard->peers.clear();
+        shard->generation++;
+    }
+}
+
+// Picks at most maxPeers of them at random, like the storage does
+std::vector<PeerInfo> CachedStorage::sample(const std::vector<PeerInfo>& peers, int maxPeers) {
+    if (maxPeers <= 0 || peers.size() <= (size_t)maxPeers)
+        return peers;
+
+    std::vector<size_t> indexes(peers.size());
+    for (size_t i = 0; i < indexes.size(); i++)
+        indexes[i] = i;
+
+    std::vector<PeerInfo> result {};
+    result.reserve(maxPeers);
+    for (size_t i = 0; i < (size_t)maxPeers; i++) {
+        auto j = i + Random::uint32(indexes.size() - i);
+        std::swap(indexes[i], indexes[j]);
+        result.push_back(peers[indexes[i]]);
+    }
+
+    return result;
+}
+
+Sp<Value> CachedStorage::getValue(const Id& valueId) {
+    auto& shard = shardOf(valueId);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto entry = shard.values.get(valueId);
+        if (entry != nullptr && entry->expiration > currentTimeMillis()) {
+            hits++;
+            return entry->value;
+        }
+        generation = shard.generation;
+    }
+
+    misses++;
+    auto value = storage->getValue(valueId);
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.generation == generation)
+        shard.values.put(valueId, { value, currentTimeMillis() + ttl });
+
+    return value;
+}
+
+bool CachedStorage::removeValue(const Id& valueId) {
+    auto removed = storage->removeValue(valueId);
+    invalidate(valueId);
+    return removed;
+}
+
+Sp<Value> CachedStorage::putValue(const Value& value, int expectedSeq, bool persistent, bool updateLastAnnounce) {
+    auto old = storage->putValue(value, expectedSeq, persistent, updateLastAnnounce);
+    invalidate(value.getId());
+    return old;
+}
+
+void CachedStorage::updateValueLastAnnounce(const Id& valueId) {
+    storage->updateValueLastAnnounce(valueId);
+}
+
+std::vector<Id> CachedStorage::scanValueIds(ScanCursor& cursor, size_t limit) {
+    return storage->scanValueIds(cursor, limit);
+}
+
+std::vector<Value> CachedStorage::scanValues(ScanCursor& cursor, size_t limit) {
+    return storage->scanValues(cursor, limit);
+}
+
+std::vector<Value> CachedStorage::scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    return storage->scanPersistentValues(lastAnnounceBefore, cursor, limit);
+}
+
+std::vector<PeerInfo> CachedStorage::getPeer(const Id& peerId, int maxPeers) {
+    auto& shard = shardOf(peerId);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto entry = shard.peers.get(peerId);
+        if (entry != nullptr && entry->expiration > currentTimeMillis()) {
+            hits++;
+            return sample(*entry->peers, maxPeers);
+        }
+        generation = shard.generation;
+    }
+
+    misses++;
+    // read one more than the cached lists may hold, to tell whether it is all of them
+    auto peers = storage->getPeer(peerId, Constants::STORAGE_RECORD_CACHE_MAX_PEERS + 1);
+    if (peers.size() > (size_t)Constants::STORAGE_RECORD_CACHE_MAX_PEERS) {
+        // too many to cache, they are a random pick already
+        if (maxPeers > 0 && (size_t)maxPeers <= peers.size())
+            return sample(peers, maxPeers);
+        else
+            return storage->getPeer(peerId, maxPeers);
+    }
+
+    auto all = std::make_shared<const std::vector<PeerInfo>>(std::move(peers));
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.generation == generation)
+            shard.peers.put(peerId, { all, currentTimeMillis() + ttl });
+    }
+
+    return sample(*all, maxPeers);
+}
+
+Sp<PeerInfo> CachedStorage::getPeer(const Id& peerId, const Id& origin) {
+    auto& shard = shardOf(peerId);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto entry = shard.peers.get(peerId);
+        if (entry != nullptr && entry->expiration > currentTimeMillis()) {
+            hits++;
+            for (const auto& peer : *entry->peers) {
+                if (peer.getOrigin() == origin)
+                    return std::make_shared<PeerInfo>(peer);
+            }
+            return nullptr;
+        }
+    }
+
+    misses++;
+    return storage->getPeer(peerId, origin);
+}
+
+bool CachedStorage::removePeer(const Id& peerId, const Id& origin) {
+    auto removed = storage->removePeer(peerId, origin);
+    invalidate(peerId);
+    return removed;
+}
+
+void CachedStorage::putPeer(const std::vector<PeerInfo>& peers) {
+    storage->putPeer(peers);
+
+    std::set<Id> ids {};
+    for (const auto& peer : peers)
+        ids.insert(peer.getId());
+    for (const auto& id : ids)
+        invalidate(id);
+}
+
+void CachedStorage::putPeer(const PeerInfo& peer, bool persistent, bool updateLastAnnounce) {
+    storage->putPeer(peer, persistent, updateLastAnnounce);
+    invalidate(peer.getId());
+}
+
+void CachedStorage::updatePeerLastAnnounce(const Id& peerId, const Id& origin) {
+    storage->updatePeerLastAnnounce(peerId, origin);
+}
+
+std::vector<Id> CachedStorage::scanPeerIds(ScanCursor& cursor, size_t limit) {
+    return storage->scanPeerIds(cursor, limit);
+}
+
+std::vector<PeerInfo> CachedStorage::scanPeers(ScanCursor& cursor, size_t limit) {
+    return storage->scanPeers(cursor, limit);
+}
+
+std::vector<PeerInfo> CachedStorage::scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    return storage->scanPersistentPeers(lastAnnounceBefore, cursor, limit);
+}
+
+PrefixStats CachedStorage::getPrefixStats(const Prefix& prefix) {
+    return storage->getPrefixStats(prefix);
+}
+
+void CachedStorage::batch(const std::function<void()>& writes) {
+    storage->batch(writes);
+}
+
+size_t CachedStorage::expire(size_t maxEntries) {
+    auto removed = storage->expire(maxEntries);
+    if (removed > 0)
+        invalidateAll();
+
+    return removed;
+}
+
+StorageStats CachedStorage::getStats() const {
+    auto stats = storage->getStats();
+    stats.cacheHits = hits;
+    stats.cacheMisses = misses;
+    return stats;
+}
+
+void CachedStorage::close() {
+    invalidateAll();
+    storage->close();
+}
+
+} /* namespace carrier */
+} /* namespace elastos */
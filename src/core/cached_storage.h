@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/peer_info.h"
+#include "carrier/storage_stats.h"
+#include "utils/lru_cache.h"
+#include "data_storage.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * Serves the hot values and peers from memory.
+ *
+ * The values and the peer lists of the recently read ids are cached, the
+ * misses too, in shards with their own lock and LRU order. The cached
+ * values are shared with the callers, not copied.
+ *
+ * The writes through this storage drop the entries of their ids, and an
+ * entry lives no longer than the TTL however often it is read. The records
+ * expired below this storage, e.g. on the write-behind thread, are not seen
+ * by it: call invalidateAll() when the storage expired some of them.
+ *
+ * Thread safe.
+ */
+class CachedStorage final : public DataStorage {
+public:
+    // capacity is the number of the values, and of the peer lists, kept in memory
+    CachedStorage(Sp<DataStorage> storage, size_t capacity, uint64_t ttl);
+
+    Sp<Value> getValue(const Id& valueId) override;
+    bool removeValue(const Id& valueId) override;
+    Sp<Value> putValue(const Value& value, int expectedSeq = -1, bool persistent = false, bool updateLastAnnounce = false) override;
+    using DataStorage::putValue;
+    void updateValueLastAnnounce(const Id& valueId) override;
+    std::vector<Id> scanValueIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanValues(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+
+    std::vector<PeerInfo> getPeer(const Id& peerId, int maxPeers) override;
+    Sp<PeerInfo> getPeer(const Id& peerId, const Id& origin) override;
+    bool removePeer(const Id& peerId, const Id& origin) override;
+    void putPeer(const std::vector<PeerInfo>& peers) override;
+    void putPeer(const PeerInfo& peer, bool persistent = false, bool updateLastAnnounce = false) override;
+    void updatePeerLastAnnounce(const Id& peerId, const Id& origin) override;
+    std::vector<Id> scanPeerIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPeers(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+    PrefixStats getPrefixStats(const Prefix& prefix) override;
+
+    void batch(const std::function<void()>& writes) override;
+    size_t expire(size_t maxEntries) override;
+    StorageStats getStats() const override;
+
+    void close() override;
+
+    // drops all the cached entries
+    void invalidateAll();
+
+private:
+    static const int SHARDS = 16;
+
+    // a null value, or no peers, for a cached miss
+    struct ValueEntry {
+        Sp<Value> value;
+        uint64_t expiration;
+    };
+
+    struct PeersEntry {
+        Sp<const std::vector<PeerInfo>> peers;
+        uint64_t expiration;
+    };
+
+    struct Shard {
+        Shard(size_t capacity, uint64_t ttl) : values(capacity, ttl), peers(capacity, ttl) {}
+
+        LRUCache<Id, ValueEntry> values;
+        LRUCache<Id, PeersEntry> peers;
+        // bumped on every write, a read started before it does not fill the cache
+        uint64_t generation {0};
+        std::mutex mutex {};
+    };
+
+    Shard& shardOf(const Id& id) {
+        return *shards[id.data()[Id::BYTES - 1] % SHARDS];
+    }
+
+    void invalidate(const Id& id);
+
+    static std::vector<PeerInfo> sample(const std::vector<PeerInfo>& peers, int maxPeers);
+
+    Sp<DataStorage> storage;
+    const uint64_t ttl;
+    std::vector<std::unique_ptr<Shard>> shards {};
+
+    std::atomic<uint64_t> hits {0};
+    std::atomic<uint64_t> misses {0};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
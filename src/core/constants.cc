@@ -30,11 +30,21 @@ const int Constants::DEFAULT_DHT_PORT                       = 39001;
 const int Constants::RPC_SERVER_REACHABILITY_TIMEOUT        = 60 * 1000;
 const int Constants::MAX_ACTIVE_CALLS                       = 256;
 const int Constants::RPC_CALL_TIMEOUT_MAX                   = 10 * 1000;
+const int Constants::RPC_CALL_STALL_TIMEOUT                 = 2 * 1000;
 const int Constants::RPC_CALL_TIMEOUT_BASELINE_MIN          = 100; // ms
 const int Constants::RECEIVE_BUFFER_SIZE                    = 5 * 1024;
 
 const int Constants::MAX_CONCURRENT_TASK_REQUESTS           = 10;
+const int Constants::MIN_CONCURRENT_LOOKUP_REQUESTS         = 3;
+const int Constants::MAX_CONCURRENT_LOOKUP_REQUESTS         = 16;
 const int Constants::MAX_ACTIVE_TASKS                       = 16;
+const int Constants::USER_TASKS_RESERVED                    = 8;
+const int Constants::LOOKUP_CACHE_POSITIVE_TTL              = 60 * 1000;        // 1 minute
+const int Constants::LOOKUP_CACHE_NEGATIVE_TTL              = 10 * 1000;        // 10 seconds
+const int Constants::PATH_CACHE_SIZE                        = 8 * 1024 * 1024;
+const int Constants::PATH_CACHE_TTL                         = 30 * 60 * 1000;   // 30 minutes
+const int Constants::PATH_CACHE_MIN_TTL                     = 60 * 1000;        // 1 minute
+const int Constants::PATH_CACHE_MAX_PEERS                   = 4;
 
 const int Constants::DHT_UPDATE_INTERVAL                    = 1000;
 const int Constants::BOOTSTRAP_MIN_INTERVAL                 = 4 * 60 * 1000;
@@ -43,6 +53,11 @@ const int Constants::SELF_LOOKUP_INTERVAL                   = 30 * 60 * 1000;
 const int Constants::RANDOM_LOOKUP_INTERVAL                 = 10 * 60 * 1000;   // 10 minutes
 const int Constants::RANDOM_PING_INTERVAL                   = 10 * 1000;        // 10 seconds
 const int Constants::ROUTING_TABLE_PERSIST_INTERVAL         = 10 * 60 * 1000;   // 10 minutes
+const int Constants::KNOWN_NODES_MAX_ENTRIES                = 16 * 1024;
+const int Constants::KNOWN_NODES_EXPIRE_TIME                = 60 * 60 * 1000;   // 60 minutes
+const int Constants::WARM_START_PING_RATE                   = 200;              // pings per second
+const int Constants::WARM_START_PING_INTERVAL               = 100;
+const int Constants::WARM_START_QUORUM                      = 16;
 
 const int Constants::MAX_ENTRIES_PER_BUCKET                 = 8;
 const int Constants::BUCKET_REFRESH_INTERVAL                = 15 * 60 * 1000;
@@ -55,10 +70,31 @@ const int Constants::KBUCKET_PING_BACKOFF_BASE_INTERVAL     = 60 * 1000;
 const int Constants::BUCKET_CACHE_PING_MIN_INTERVAL         = 30 * 1000;
 
 const int Constants::STORAGE_EXPIRE_INTERVAL                = 5 * 60 * 1000;
+const int Constants::STORAGE_MMAP_SIZE                      = 64 * 1024 * 1024;
+const int Constants::STORAGE_CACHE_SIZE                     = 8 * 1024 * 1024;
+const int Constants::STORAGE_EXPIRE_CHUNK                   = 256;
+const int Constants::STORAGE_BUSY_TIMEOUT                   = 5000;
+const int Constants::STORAGE_WRITE_BATCH                    = 1024;
+const int Constants::STORAGE_WRITE_QUEUE_LIMIT              = 64 * 1024;
+const int Constants::STORAGE_RECORD_CACHE_SIZE              = 4096;
+const int Constants::STORAGE_RECORD_CACHE_TTL               = 60 * 1000;
+const int Constants::STORAGE_RECORD_CACHE_MAX_PEERS         = 64;
+const int Constants::STORAGE_EXPIRE_WHEEL_TICK              = 60 * 1000;
+const int Constants::STORAGE_LOG_SEGMENT_SIZE               = 16 * 1024 * 1024;
+const int Constants::STORAGE_LOG_SYNC_INTERVAL              = 1000;
+const int Constants::STORAGE_LOG_COMPACT_RATIO              = 50;
+const int Constants::STORAGE_BUDGET                         = 256 * 1024 * 1024;
+const int Constants::STORAGE_ORIGIN_QUOTA                   = 4 * 1024 * 1024;
+const int Constants::STORAGE_PREFIX_QUOTA                   = 16 * 1024 * 1024;
+const int Constants::STORAGE_QUOTA_PREFIX4                  = 24;
+const int Constants::STORAGE_QUOTA_PREFIX6                  = 48;
+const int Constants::STORAGE_SCAN_PAGE                      = 256;
 const int Constants::TOKEN_TIMEOUT                          = 5 * 60 * 1000;
+const int Constants::ANNOUNCE_TOKEN_REUSE_TIME              = 4 * 60 * 1000;
 const int Constants::MAX_PEER_AGE                           = 120 * 60 * 1000;
 const int Constants::MAX_VALUE_AGE                          = 120 * 60 * 1000;
 const int Constants::RE_ANNOUNCE_INTERVAL                   = 5 * 60 * 1000;
+const int Constants::ANNOUNCE_DISPATCH_INTERVAL             = 1000;
 
 const std::string Constants::NODE_NAME                      = "Meerkat";
 const std::string Constants::NODE_SHORT_NAME                = "MK";
@@ -41,6 +41,7 @@ struct Constants {
     static const int        RPC_SERVER_REACHABILITY_TIMEOUT;
     static const int        MAX_ACTIVE_CALLS;
     static const int        RPC_CALL_TIMEOUT_MAX;
+    static const int        RPC_CALL_STALL_TIMEOUT;
     static const int        RPC_CALL_TIMEOUT_BASELINE_MIN;
     static const int        RECEIVE_BUFFER_SIZE;
 
@@ -48,7 +49,21 @@ struct Constants {
     // Task & Lookup constants
     ///////////////////////////////////////////////////////////////////////////
     static const int        MAX_CONCURRENT_TASK_REQUESTS;
+    // the default bounds of the adaptive lookup concurrency (alpha)
+    static const int        MIN_CONCURRENT_LOOKUP_REQUESTS;
+    static const int        MAX_CONCURRENT_LOOKUP_REQUESTS;
     static const int        MAX_ACTIVE_TASKS;
+    static const int        USER_TASKS_RESERVED;
+    // the default lifetime of the cached lookup results
+    static const int        LOOKUP_CACHE_POSITIVE_TTL;
+    static const int        LOOKUP_CACHE_NEGATIVE_TTL;
+    // the copies of the lookup results cached on the lookup paths: the memory
+    // of the cache, the lifetime at the closest node, halved for each node
+    // closer to the target down to the min, and the peers cached per lookup
+    static const int        PATH_CACHE_SIZE;
+    static const int        PATH_CACHE_TTL;
+    static const int        PATH_CACHE_MIN_TTL;
+    static const int        PATH_CACHE_MAX_PEERS;
 
     ///////////////////////////////////////////////////////////////////////////
     // DHT maintenance constants
@@ -60,6 +75,13 @@ struct Constants {
     static const int        RANDOM_LOOKUP_INTERVAL;
     static const int        RANDOM_PING_INTERVAL;
     static const int        ROUTING_TABLE_PERSIST_INTERVAL;
+    // address -> node id cache for the ID-change detection
+    static const int        KNOWN_NODES_MAX_ENTRIES;
+    static const int        KNOWN_NODES_EXPIRE_TIME;
+    // verification of the cached routing table at startup
+    static const int        WARM_START_PING_RATE;
+    static const int        WARM_START_PING_INTERVAL;
+    static const int        WARM_START_QUORUM;
 
     ///////////////////////////////////////////////////////////////////////////
     // Routing table and KBucket constants
@@ -80,10 +102,49 @@ struct Constants {
     // Tokens and data storage constants
     ///////////////////////////////////////////////////////////////////////////
     static const int        STORAGE_EXPIRE_INTERVAL;
+    // the default memory of the SQLite storage: mapped and page cache
+    static const int        STORAGE_MMAP_SIZE;
+    static const int        STORAGE_CACHE_SIZE;
+    // the expired rows removed per step, between the steps the writes go on
+    static const int        STORAGE_EXPIRE_CHUNK;
+    // how long a connection waits for the write lock held by another one
+    static const int        STORAGE_BUSY_TIMEOUT;
+    // the max writes committed in one transaction by the write-behind thread
+    static const int        STORAGE_WRITE_BATCH;
+    // the writes may queue before the writers wait for the write-behind thread
+    static const int        STORAGE_WRITE_QUEUE_LIMIT;
+    // the cache of the hot values and peer lists: entries of each, and how
+    // long an entry lives, which bounds how long an expired record is served
+    static const int        STORAGE_RECORD_CACHE_SIZE;
+    static const int        STORAGE_RECORD_CACHE_TTL;
+    // the peer lists longer than this are not cached
+    static const int        STORAGE_RECORD_CACHE_MAX_PEERS;
+    // the slot width of the expiration wheel of the memory storage
+    static const int        STORAGE_EXPIRE_WHEEL_TICK;
+    // the log storage starts a new segment file past this size, syncs the
+    // appends to the disk at this interval, and compacts a sealed segment
+    // once less than this percent of it is still live
+    static const int        STORAGE_LOG_SEGMENT_SIZE;
+    static const int        STORAGE_LOG_SYNC_INTERVAL;
+    static const int        STORAGE_LOG_COMPACT_RATIO;
+    // the bytes of the records the other nodes may store here: in total, for
+    // each origin node, and for each IP prefix of the origins
+    static const int        STORAGE_BUDGET;
+    static const int        STORAGE_ORIGIN_QUOTA;
+    static const int        STORAGE_PREFIX_QUOTA;
+    // the prefix lengths in bits the per-prefix quota groups the origins by
+    static const int        STORAGE_QUOTA_PREFIX4;
+    static const int        STORAGE_QUOTA_PREFIX6;
+    // the records read per page by the storage scans
+    static const int        STORAGE_SCAN_PAGE;
     static const int        TOKEN_TIMEOUT;
+    // how long the tokens from an announce lookup are reused for the later
+    // announces of the same target, less than TOKEN_TIMEOUT for a margin
+    static const int        ANNOUNCE_TOKEN_REUSE_TIME;
     static const int        MAX_PEER_AGE;
     static const int        MAX_VALUE_AGE;
     static const int        RE_ANNOUNCE_INTERVAL;
+    static const int        ANNOUNCE_DISPATCH_INTERVAL;
 
     ///////////////////////////////////////////////////////////////////////////
     // Node software name and version
@@ -23,14 +23,69 @@
 #pragma once
 
 #include <list>
+#include <vector>
+#include <iterator>
+#include <functional>
+#include <stdexcept>
 
 #include "carrier/id.h"
 #include "carrier/value.h"
 #include "carrier/peer_info.h"
+#include "carrier/prefix.h"
+#include "carrier/storage_stats.h"
+#include "constants.h"
 
 namespace elastos {
 namespace carrier {
 
+/**
+ * The position of a paged scan. The scans return the records in the order of
+ * their keys after the last one returned, so the records put or removed
+ * between the pages do not shift the others. A new cursor starts from the
+ * first record under its prefix, all of them by default, and is done after
+ * the last page.
+ */
+struct ScanCursor {
+    ScanCursor() = default;
+    ScanCursor(const Prefix& prefix) : prefix(prefix) {}
+
+    Prefix prefix {};
+    Id id {};
+    Id nodeId {};
+    Id origin {};
+    bool started {false};
+    bool done {false};
+};
+
+// The live records under a prefix, the bytes as the backend accounts them
+struct PrefixStats {
+    size_t values {0};
+    size_t valueBytes {0};
+    size_t peers {0};
+    size_t peerBytes {0};
+};
+
+// The rough memory footprint of the values and peers, one estimate for the
+// memory storage, the storage quotas and the lookup cache
+struct RecordSize {
+    // besides the record itself: the hash or list entries and the deadline
+    static const size_t OVERHEAD = 128;
+
+    static size_t recordBytes(const Value& value) {
+        return sizeof(Value) + value.getData().size();
+    }
+
+    static size_t recordBytes(const PeerInfo& peer) {
+        return sizeof(PeerInfo) + peer.getSignature().size() +
+                (peer.hasAlternativeURL() ? peer.getAlternativeURL().size() : 0);
+    }
+
+    // a stored record with its overhead
+    template <typename T>
+    static size_t storedBytes(const T& record) {
+        return OVERHEAD + recordBytes(record);
+    }
+};
 
 class DataStorage {
 public:
@@ -41,8 +96,6 @@ public:
         return putValue(value, -1, persistent, true);
     }
     virtual void updateValueLastAnnounce(const Id& valueId) = 0;
-    virtual std::vector<Value> getPersistentValues(uint64_t lastAnnounceBefore) = 0;
-    virtual std::vector<Id> getAllValues() = 0;
 
     virtual std::vector<PeerInfo> getPeer(const Id& peerId, int maxPeers) = 0;
     virtual Sp<PeerInfo> getPeer(const Id& peerId, const Id& origin) = 0;
@@ -56,10 +109,132 @@ public:
         return putPeer(peer, false, false);
     }
     virtual void updatePeerLastAnnounce(const Id& peerId, const Id& origin) = 0;
-    virtual std::vector<PeerInfo> getPersistentPeers(uint64_t lastAnnounceBefore) = 0;
-    virtual std::vector<Id> getAllPeers() = 0;
+
+    /**
+     * The scans return the next page of at most limit records from the
+     * cursor, in the id order, and move the cursor past them. The cursor is
+     * done when a page comes short, so a caller holds a page at a time:
+     *
+     *     ScanCursor cursor {};
+     *     while (!cursor.done) {
+     *         for (const auto& id : storage->scanValueIds(cursor, Constants::STORAGE_SCAN_PAGE))
+     *             ...
+     *     }
+     *
+     * The id scans return the ids of the live values and peers, the record
+     * scans the full live records, and the persistent scans the full
+     * persistent records last announced before the time. The peers come in
+     * the order of id, node id and origin. A cursor with a prefix covers the
+     * ids under it only, they are a range of the id order.
+     */
+    virtual std::vector<Id> scanValueIds(ScanCursor& cursor, size_t limit) = 0;
+    virtual std::vector<Value> scanValues(ScanCursor& cursor, size_t limit) = 0;
+    virtual std::vector<Value> scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) = 0;
+    virtual std::vector<Id> scanPeerIds(ScanCursor& cursor, size_t limit) = 0;
+    virtual std::vector<PeerInfo> scanPeers(ScanCursor& cursor, size_t limit) = 0;
+    virtual std::vector<PeerInfo> scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) = 0;
+
+    // counts the live records under the prefix, by a range of the id index
+    virtual PrefixStats getPrefixStats(const Prefix& prefix) = 0;
+
+    // all of the scanned records at once, for the small stores
+    std::vector<Id> getAllValues() {
+        return collect<Id>([&](ScanCursor& cursor, size_t limit) {
+            return scanValueIds(cursor, limit);
+        });
+    }
+
+    std::vector<Value> getPersistentValues(uint64_t lastAnnounceBefore) {
+        return collect<Value>([&](ScanCursor& cursor, size_t limit) {
+            return scanPersistentValues(lastAnnounceBefore, cursor, limit);
+        });
+    }
+
+    std::vector<Id> getAllPeers() {
+        return collect<Id>([&](ScanCursor& cursor, size_t limit) {
+            return scanPeerIds(cursor, limit);
+        });
+    }
+
+    std::vector<PeerInfo> getPersistentPeers(uint64_t lastAnnounceBefore) {
+        return collect<PeerInfo>([&](ScanCursor& cursor, size_t limit) {
+            return scanPersistentPeers(lastAnnounceBefore, cursor, limit);
+        });
+    }
+
+    /**
+     * Runs the writes in one transaction if the storage supports it, the
+     * default runs them one by one.
+     */
+    virtual void batch(const std::function<void()>& writes) {
+        writes();
+    }
+
+    /**
+     * Removes at most maxEntries of the expired values and at most maxEntries
+     * of the expired peers, returns the number removed. The caller repeats it
+     * while it removes something to expire all of them in small steps.
+     */
+    virtual size_t expire(size_t maxEntries) = 0;
+
+    virtual StorageStats getStats() const {
+        return {};
+    }
 
     virtual void close() = 0;
+
+protected:
+    // Moves the cursor past the page
+    static void advance(ScanCursor& cursor, const std::vector<Id>& page, size_t limit) {
+        if (!page.empty())
+            cursor.id = page.back();
+        cursor.started = true;
+        cursor.done = page.size() < limit;
+    }
+
+    static void advance(ScanCursor& cursor, const std::vector<Value>& page, size_t limit) {
+        if (!page.empty())
+            cursor.id = page.back().getId();
+        cursor.started = true;
+        cursor.done = page.size() < limit;
+    }
+
+    static void advance(ScanCursor& cursor, const std::vector<PeerInfo>& page, size_t limit) {
+        if (!page.empty()) {
+            cursor.id = page.back().getId();
+            cursor.nodeId = page.back().getNodeId();
+            cursor.origin = page.back().getOrigin();
+        }
+        cursor.started = true;
+        cursor.done = page.size() < limit;
+    }
+
+    // Throws if the value can not replace the old one stored with the same id
+    static void checkReplace(const Sp<Value>& old, const Value& value, int expectedSeq) {
+        if (old == nullptr || !old->isMutable())
+            return;
+
+        if(!value.isMutable())
+            throw std::invalid_argument("Can not replace mutable value with immutable is not supported");
+        if (old->hasPrivateKey() && !value.hasPrivateKey())
+            throw std::invalid_argument("Not the owner of value");
+        if(value.getSequenceNumber() < old->getSequenceNumber())
+            throw std::invalid_argument("Sequence number less than current");
+        if(expectedSeq >= 0 && old->getSequenceNumber() >= 0 && old->getSequenceNumber() != expectedSeq)
+            throw std::invalid_argument("CAS failure");
+    }
+
+private:
+    template <typename T, typename Scan>
+    static std::vector<T> collect(Scan scan) {
+        std::vector<T> result {};
+        ScanCursor cursor {};
+        while (!cursor.done) {
+            auto page = scan(cursor, Constants::STORAGE_SCAN_PAGE);
+            result.insert(result.end(), std::make_move_iterator(page.begin()), std::make_move_iterator(page.end()));
+        }
+        return result;
+    }
 };
 
 } // namespace carrier
@@ -115,6 +115,55 @@ void Builder::load(const std::string& filePath) {
         }
     }
 
+    if (root.contains("routingTable")) {
+        const auto routingTable = root["routingTable"];
+        if (!routingTable.is_object())
+            throw std::invalid_argument("Config file error: routingTable");
+
+        if (routingTable.contains("wideBucketSize"))
+            setWideBucketSize(routingTable["wideBucketSize"].get<int>());
+
+        if (routingTable.contains("maintenancePingRate"))
+            setMaintenancePingRate(routingTable["maintenancePingRate"].get<int>());
+    }
+
+    if (root.contains("lookup")) {
+        const auto lookup = root["lookup"];
+        if (!lookup.is_object())
+            throw std::invalid_argument("Config file error: lookup");
+
+        int min = lookup.contains("minConcurrency") ? lookup["minConcurrency"].get<int>() : 0;
+        int max = lookup.contains("maxConcurrency") ? lookup["maxConcurrency"].get<int>() : 0;
+        setLookupConcurrency(min, max);
+
+        if (lookup.contains("cacheSize")) {
+            int positiveTTL = lookup.contains("cachePositiveTTL") ? lookup["cachePositiveTTL"].get<int>() : 0;
+            int negativeTTL = lookup.contains("cacheNegativeTTL") ? lookup["cacheNegativeTTL"].get<int>() : 0;
+            setLookupCache(lookup["cacheSize"].get<int>(), positiveTTL, negativeTTL);
+        }
+    }
+
+    if (root.contains("storage")) {
+        const auto storage = root["storage"];
+        if (!storage.is_object())
+            throw std::invalid_argument("Config file error: storage");
+
+        int mmapSize = storage.contains("mmapSize") ? storage["mmapSize"].get<int>() : 0;
+        int cacheSize = storage.contains("cacheSize") ? storage["cacheSize"].get<int>() : 0;
+        setStorageMemory(mmapSize, cacheSize);
+
+        if (storage.contains("memory"))
+            setMemoryStorage(storage["memory"].get<int>());
+
+        if (storage.contains("log"))
+            setLogStorage(storage["log"].get<bool>());
+
+        int budget = storage.contains("budget") ? storage["budget"].get<int>() : 0;
+        int originQuota = storage.contains("originQuota") ? storage["originQuota"].get<int>() : 0;
+        int prefixQuota = storage.contains("prefixQuota") ? storage["prefixQuota"].get<int>() : 0;
+        setStorageQuota(budget, originQuota, prefixQuota);
+    }
+
     if (root.contains("addons")) {
         const auto _addons = root["addons"];
         if (!_addons.is_array())
@@ -147,6 +196,20 @@ void Builder::reset() {
     storagePath = {};
     bootstrapNodes.clear();
     addons.clear();
+    wideBucketSize = 0;
+    maintenancePingRate = 0;
+    minLookupConcurrency = 0;
+    maxLookupConcurrency = 0;
+    lookupCacheSize = 0;
+    lookupCachePositiveTTL = 0;
+    lookupCacheNegativeTTL = 0;
+    storageMmapSize = 0;
+    storageCacheSize = 0;
+    memoryStorageSize = 0;
+    logStorage = false;
+    storageBudget = 0;
+    storageOriginQuota = 0;
+    storagePrefixQuota = 0;
 }
 
 Sp<Configuration> Builder::build() {
@@ -157,6 +220,20 @@ Sp<Configuration> Builder::build() {
         ip6 = getLocalIPv6();
 
     auto dataStorage = std::make_shared<DefaultConfiguration>(ip4, ip6,  port, storagePath, bootstrapNodes, addons);
+    dataStorage->wideBucketSize = wideBucketSize;
+    dataStorage->maintenancePingRate = maintenancePingRate;
+    dataStorage->minLookupConcurrency = minLookupConcurrency;
+    dataStorage->maxLookupConcurrency = maxLookupConcurrency;
+    dataStorage->lookupCacheSize = lookupCacheSize;
+    dataStorage->lookupCachePositiveTTL = lookupCachePositiveTTL;
+    dataStorage->lookupCacheNegativeTTL = lookupCacheNegativeTTL;
+    dataStorage->storageMmapSize = storageMmapSize;
+    dataStorage->storageCacheSize = storageCacheSize;
+    dataStorage->memoryStorageSize = memoryStorageSize;
+    dataStorage->logStorage = logStorage;
+    dataStorage->storageBudget = storageBudget;
+    dataStorage->storageOriginQuota = storageOriginQuota;
+    dataStorage->storagePrefixQuota = storagePrefixQuota;
     return std::static_pointer_cast<Configuration>(dataStorage);
 }
 
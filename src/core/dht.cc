@@ -20,6 +20,7 @@
 * SOFTWARE.
 */
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 
@@ -55,20 +56,42 @@
 #include "rpccall.h"
 #include "routing_table.h"
 #include "data_storage.h"
+#include "storage_quota.h"
+#include "path_cache.h"
 #include "kclosest_nodes.h"
 #include "dht.h"
 
 namespace elastos {
 namespace carrier {
 
+static std::list<Sp<NodeInfo>> toNodeList(const ClosestSet& closestSet) {
+    std::list<Sp<NodeInfo>> result {};
+    for (const auto& item: closestSet.getEntries())
+        result.push_back(item);
+    return result;
+}
+
 DHT::DHT(Type _type, const Node& _node, const SocketAddress& _addr)
     :type(_type), node(_node), addr(_addr), bootstrapping(false) {
 
     log = Logger::get("dht");
+
+    auto config = node.getConfig();
+    routingTable.setWideBucketSize(config->getWideBucketSize());
+    routingTable.setMaintenancePingRate(config->getMaintenancePingRate());
+
+    if (config->getMinLookupConcurrency() > 0)
+        minLookupConcurrency = config->getMinLookupConcurrency();
+    if (config->getMaxLookupConcurrency() > 0)
+        maxLookupConcurrency = config->getMaxLookupConcurrency();
+    maxLookupConcurrency = std::max(minLookupConcurrency, maxLookupConcurrency);
 }
 
 Sp<NodeInfo> DHT::getNode(const Id& nodeId) const {
-    return routingTable.getEntry(nodeId);
+    // Might be called from the user threads, use the lock-free snapshot
+    auto snapshot = routingTable.getSnapshot();
+    auto entry = snapshot->getEntry(nodeId);
+    return entry != nullptr ? std::make_shared<NodeInfo>(*entry) : nullptr;
 }
 
 void DHT::bootstrap() {
@@ -133,6 +156,7 @@ void DHT::bootstrap(const NodeInfo& ni) {
 void DHT::fillHomeBucket(const std::list<Sp<NodeInfo>>& nodes) {
     if (routingTable.getNumBucketEntries() == 0 && nodes.empty()) {
         bootstrapping = false;
+        setReady();
         return;
     }
 
@@ -146,11 +170,13 @@ void DHT::fillHomeBucket(const std::list<Sp<NodeInfo>>& nodes) {
         if (!isRunning())
             return;
 
+        setReady();
+
         if (routingTable.getNumBucketEntries() > Constants::MAX_ENTRIES_PER_BUCKET + 2)
             routingTable.fillBuckets();
     });
 
-    taskMan.add(task);
+    taskMan.add(task, TaskManager::Priority::MAINTENANCE);
 }
 
 void DHT::update () {
@@ -163,6 +189,7 @@ void DHT::update () {
 
     rpcServer->updateReachability(now);
     routingTable.maintenance();
+    routingTable.publish();
 
     if (routingTable.getNumBucketEntries() < Constants::BOOTSTRAP_IF_LESS_THAN_X_PEERS ||
             now - lastBootstrap > Constants::SELF_LOOKUP_INTERVAL)
@@ -176,6 +203,85 @@ void DHT::update () {
     }
 }
 
+void DHT::warmStart() {
+    for (const auto& bucket: routingTable.getBuckets()) {
+        for (const auto& entry: bucket->getEntries())
+            warmStartQueue.push_back(entry);
+    }
+
+    if (warmStartQueue.empty())
+        return;
+
+    warmStartInFlight = 0;
+    warmStartResponded = 0;
+    warmStartQuorum = std::min<int>(warmStartQueue.size(), Constants::WARM_START_QUORUM);
+
+    log->info("DHT {} warm start: verifying {} cached entries", getTypeName(), warmStartQueue.size());
+    warmStartPing();
+}
+
+void DHT::warmStartPing() {
+    if (!isRunning()) {
+        warmStartQueue.clear();
+        return;
+    }
+
+    // Pings all the cached entries concurrently, but at a bounded rate
+    int budget = std::max(1, Constants::WARM_START_PING_RATE * Constants::WARM_START_PING_INTERVAL / 1000);
+    while (budget-- > 0 && !warmStartQueue.empty()) {
+        auto entry = warmStartQueue.front();
+        warmStartQueue.pop_front();
+
+        auto q = std::make_shared<PingRequest>();
+        auto call = std::make_shared<RPCCall>(this, entry, q);
+        call->addStateChangeHandler([=](RPCCall* c, RPCCall::State previous, RPCCall::State current) {
+            if (current == RPCCall::State::RESPONDED) {
+                if (++warmStartResponded == warmStartQuorum) {
+                    log->info("DHT {} warm start: {} cached entries verified", getTypeName(), warmStartResponded);
+                    setReady();
+                }
+            } else if (current == RPCCall::State::TIMEOUT) {
+                // the cached entry is not reachable any more
+                routingTable.remove(c->getTargetId());
+            } else if (current != RPCCall::State::ERR && current != RPCCall::State::CANCELED) {
+                return;
+            }
+
+            if (--warmStartInFlight == 0 && warmStartQueue.empty()) {
+                log->info("DHT {} warm start finished, {} of the cached entries responded",
+                        getTypeName(), warmStartResponded);
+                // Not enough live entries, the node still can work with the bootstrap nodes
+                if (bootstrapNodes.empty())
+                    setReady();
+            }
+        });
+
+        warmStartInFlight++;
+        try {
+            rpcServer->sendCall(call);
+        } catch (const std::exception& e) {
+            warmStartInFlight--;
+            log->error("Error on sending the warm start ping: {}", e.what());
+        }
+    }
+
+    if (!warmStartQueue.empty()) {
+        rpcServer->getScheduler().add([&]() {
+            warmStartPing();
+        }, Constants::WARM_START_PING_INTERVAL);
+    }
+}
+
+void DHT::setReady() {
+    bool expected {false};
+    if (!ready.compare_exchange_strong(expected, true))
+        return;
+
+    log->info("DHT {} is ready", getTypeName());
+    if (readyListener)
+        readyListener();
+}
+
 void DHT::start(std::vector<Sp<NodeInfo>>& nodes) {
     if (running)
         return;
@@ -183,6 +289,7 @@ void DHT::start(std::vector<Sp<NodeInfo>>& nodes) {
     if (persistFile != "" /* && persistFile.exists() && persistFile.isFile()*/) {
         log->info("Loading routing table from {} ...", persistFile);
         routingTable.load(persistFile);
+        routingTable.publish();
     }
 
     for (auto node: nodes) {
@@ -196,21 +303,11 @@ void DHT::start(std::vector<Sp<NodeInfo>>& nodes) {
 
     auto& scheduler = rpcServer->getScheduler();
 
-    scheduler.add([&]() {
-        // tasks maintenance that should run all the time, before the first queries
-        taskMan.dequeue();
-    }, 5000, Constants::DHT_UPDATE_INTERVAL);
+    // Verify the routing table loaded from cache
+    warmStart();
 
-    // Ping check if the routing table loaded from cache
-    for (auto& bucket: routingTable.getBuckets()) {
-        if (bucket->size() == 0)
-            continue;
-
-        std::vector<PingRefreshTask::Options> options{PingRefreshTask::Options::removeOnTimeout};
-        auto task = std::make_shared<PingRefreshTask>(this, bucket, options);
-        task->setName("Bootstrap cached table ping for " + bucket->getPrefix().toString());
-        taskMan.add(task);
-    }
+    if (bootstrapNodes.empty() && warmStartQueue.empty())
+        setReady();
 
     bootstrap();
 
@@ -242,7 +339,7 @@ void DHT::start(std::vector<Sp<NodeInfo>>& nodes) {
         auto task = std::make_shared<NodeLookup>(this, Id::random());
         task->addListener([](Task* t) {});
         task->setName(getTypeName() + ":Random Refresh Lookup");
-        taskMan.add(task);
+        taskMan.add(task, TaskManager::Priority::MAINTENANCE);
     }, Constants::RANDOM_LOOKUP_INTERVAL, Constants::RANDOM_LOOKUP_INTERVAL);
 }
 
@@ -253,10 +350,13 @@ void DHT::stop() {
     log->info("{} initated DHT shutdown...", getTypeName());
     log->info("stopping servers");
     running = false;
+    ready = false;
 
     if (persistFile != "") {
         log->info("Persisting routing table on shutdown...");
+        routingTable.waitForPendingSave();
         routingTable.save(persistFile);
+        routingTable.waitForPendingSave();
     }
 
     taskMan.cancelAll();
@@ -285,6 +385,7 @@ void DHT::onMessage(Sp<Message> msg) {
     }
 
     received(msg);
+    routingTable.publish();
 }
 
 void DHT::received(Sp<Message> msg) {
@@ -316,10 +417,9 @@ void DHT::received(Sp<Message> msg) {
         return;
     }
 
-    auto iter = knownNodes.find(addr);
-    if (iter != knownNodes.end() && iter->second != id) {
-        Id knownId = iter->second;
-        auto knownEntry = routingTable.getEntry(knownId);
+    auto knownId = knownNodes.get(addr);
+    if (knownId != nullptr && *knownId != id) {
+        auto knownEntry = routingTable.getEntry(*knownId);
         if (knownEntry != nullptr) {
             // 1. a node with that address is in our routing table
             // 2. the ID does not match our routing table entry
@@ -329,23 +429,20 @@ void DHT::received(Sp<Message> msg) {
             // In either case we don't want it in our routing table
             log->warn("force-removing routing table entry {} because ID-change was detected; new ID {}",
                 knownEntry->toString(), id.toString());
-            routingTable.remove(knownId);
+            routingTable.remove(knownEntry->getId());
 
             // might be pollution attack, check other entries in the same bucket too in case
             // random
             // pings can't keep up with scrubbing.
-            auto bucket = routingTable.getBucket(knownId);
+            auto bucket = routingTable.getBucket(knownEntry->getId());
             auto name = "Checking bucket " + bucket->getPrefix().toString() + " after ID change was detected";
             routingTable.tryPingMaintenance(bucket, {PingRefreshTask::Options::checkAll}, name);
-            knownNodes[addr] = id;
+            knownNodes.put(addr, id);
             return;
         }
-        else {
-            knownNodes.erase(iter);
-        }
     }
 
-    knownNodes[addr] = id;
+    knownNodes.put(addr, id);
     auto newEntry = std::make_shared<KBucketEntry>(id, addr, msg->getVersion());
 
     if (call != nullptr) {
@@ -438,11 +535,14 @@ void DHT::onFindValue(const Sp<Message>& msg) {
 
     auto response = std::make_shared<FindValueResponse>(msg->getTxid());
 
-    auto token = tokenManager->generateToken(request->getId(), request->getOrigin(), node.getId());
+    auto token = tokenManager->generateToken(request->getId(), request->getOrigin(), request->getTarget());
     response->setToken(token);
 
     auto hasValue {false};
     auto value = node.getStorage()->getValue(request->getTarget());
+    // the copy cached by the lookups passing by, if there is no authoritative value
+    if (value == nullptr)
+        value = node.getPathCache()->getValue(request->getTarget());
     if (value != nullptr) {
         if (request->getSequenceNumber() < 0 || value->getSequenceNumber() < 0
                 || request->getSequenceNumber() <= value->getSequenceNumber()) {
@@ -476,7 +576,19 @@ void DHT::onStoreValue(const Sp<Message>& msg) {
         return;
     }
 
-    node.getStorage()->putValue(value, request->getExpectedSequenceNumber());
+    if (request->isCache()) {
+        // a copy from a lookup passing by never replaces the authoritative value
+        if (node.getStorage()->getValue(valueId) == nullptr)
+            node.getPathCache()->putValue(value, std::min(request->getTTL(), Constants::PATH_CACHE_TTL));
+    } else {
+        if (!node.getStorageQuota()->putValue(request->getId(), request->getOrigin(), value,
+                request->getExpectedSequenceNumber())) {
+            log->warn("Rejected a store value request from {}, over the storage quota", request->getOrigin().toString());
+            sendError(request, ErrorCode::ProtocolError, "Storage quota exceeded");
+            return;
+        }
+        node.getPathCache()->removeValue(valueId);
+    }
 
     auto response = std::make_shared<StoreValueResponse>(request->getTxid());
     response->setRemote(request->getId(), request->getOrigin());
@@ -494,6 +606,8 @@ void DHT::onFindPeers(const Sp<Message>& msg) {
 
     bool hasPeers {false};
     auto peers = storage->getPeer(target, 8);
+    if (peers.empty())
+        peers = node.getPathCache()->getPeer(target, 8);
     if (!peers.empty()) {
         response->setPeers(peers);
         hasPeers = true;
@@ -530,10 +644,33 @@ void DHT::onAnnouncePeer(const Sp<Message>& msg) {
     }
 
 
+    // the sender announces its own peers, another origin comes with a cached copy only
+    if (!request->isCache() && request->hasOrigin()) {
+        log->warn("Received an announce peer request with a foreign origin from {}", request->getOrigin().toString());
+        sendError(request, ErrorCode::ProtocolError, "Invalid peer: origin without ttl");
+        return;
+    }
+
     auto peer = request->getPeer();
-    log->debug("Received an announce peer request from {}, saving peer {}", request->getOrigin().toString(),
-                request->getTarget().toString());
-    node.getStorage()->putPeer(peer);
+    if (!peer.isValid()) {
+        sendError(request, ErrorCode::ProtocolError, "Invalid peer");
+        return;
+    }
+
+    if (request->isCache()) {
+        // a copy from a lookup passing by, announced by another origin
+        if (node.getStorage()->getPeer(peer.getId(), peer.getOrigin()) == nullptr)
+            node.getPathCache()->putPeer(peer, std::min(request->getTTL(), Constants::PATH_CACHE_TTL));
+    } else {
+        log->debug("Received an announce peer request from {}, saving peer {}", request->getOrigin().toString(),
+                    request->getTarget().toString());
+        if (!node.getStorageQuota()->putPeer(request->getId(), request->getOrigin(), peer)) {
+            log->warn("Rejected an announce peer request from {}, over the storage quota", request->getOrigin().toString());
+            sendError(request, ErrorCode::ProtocolError, "Storage quota exceeded");
+            return;
+        }
+        node.getPathCache()->removePeer(peer.getId(), peer.getOrigin());
+    }
 
     auto response = std::make_shared<AnnouncePeerResponse>(request->getTxid());
     response->setRemote(request->getId(), request->getOrigin());
@@ -546,6 +683,7 @@ void DHT::onTimeout(RPCCall* call) {
         return;
 
     routingTable.onTimeout(call->getTargetId());
+    routingTable.publish();
 }
 
 void DHT::onSend(const Id& id) {
@@ -598,15 +736,29 @@ void DHT::getNodes(const Id& id, Sp<NodeInfo> node, std::function<void(std::list
 }
 #endif
 
+void DHT::recordLookup(const LookupTask* task) {
+    // the task was canceled before it got started
+    if (task->getStartTime() == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(lookupStatsLock);
+    lookupStats.lookups++;
+    lookupStats.hops += task->getHops();
+    lookupStats.requests += task->getSentCalls();
+    lookupStats.concurrency += task->getPeakConcurrency();
+    lookupStats.latency += task->getFinishedTime() - task->getStartTime();
+}
+
 Sp<Task> DHT::findNode(const Id& id, std::function<void(Sp<NodeInfo>)> completeHandler) {
     auto task = std::make_shared<NodeLookup>(this, id);
 
     task->addListener([=](Task* t) {
-        Sp<NodeInfo> ni = routingTable.getEntry(id);
-        completeHandler(ni);
+        recordLookup(static_cast<LookupTask*>(t));
+        auto entry = routingTable.getEntry(id);
+        completeHandler(entry != nullptr ? std::make_shared<NodeInfo>(*entry) : nullptr);
     });
     task->setName("User-level node lookup");
-    taskMan.add(task);
+    taskMan.add(task, TaskManager::Priority::USER);
     return task;
 }
 
@@ -625,17 +777,47 @@ Sp<Task> DHT::findValue(const Id& id, LookupOption option, std::function<void(Sp
         }
     });
 
-    task->addListener([=](Task*) {
+    task->addListener([=](Task* t) {
+        recordLookup(static_cast<LookupTask*>(t));
+        if (*valuePtr)
+            cacheOnPath(static_cast<LookupTask*>(t), **valuePtr);
         completeHandler(*valuePtr);
     });
     task->setName("User-level value lookup");
-    taskMan.add(task);
+    taskMan.add(task, TaskManager::Priority::USER);
     return task;
 }
 
-Sp<Task> DHT::storeValue(const Value& value, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler) {
+Sp<Task> DHT::storeValue(const Value& value, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+        const std::list<Sp<NodeInfo>>& seeds) {
+    auto closestSet = announceCache.get(value.getId());
+    if (!closestSet)
+        return lookupAndStoreValue(value, completeHandler, seeds);
+
+    // Store to the closest nodes of the recent lookup with their tokens, and
+    // fall back to a new lookup if any of them rejected or missed the request
+    auto announce = std::make_shared<ValueAnnounce>(this, *closestSet, value);
+    announce->addListener([=](Task* t) {
+        if (t->getState() == Task::State::FINISHED && static_cast<ValueAnnounce*>(t)->getFailedCalls() > 0) {
+            log->debug("Store value {} with the cached tokens failed, retry with a new lookup", value.getId().toString());
+            announceCache.remove(value.getId());
+            lookupAndStoreValue(value, completeHandler, seeds);
+            return;
+        }
+
+        completeHandler(toNodeList(*closestSet));
+    });
+
+    announce->setName("Value store with cached tokens");
+    taskMan.add(announce, TaskManager::Priority::ANNOUNCE);
+    return announce;
+}
+
+Sp<Task> DHT::lookupAndStoreValue(const Value& value, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+        const std::list<Sp<NodeInfo>>& seeds) {
     auto task = std::make_shared<NodeLookup>(this, value.getId());
     task->setWantToken(true);
+    injectSeeds(*task, seeds);
     task->addListener([=](Task* t) {
         if (t->getState() != Task::State::FINISHED)
             return;
@@ -648,21 +830,21 @@ Sp<Task> DHT::storeValue(const Value& value, std::function<void(std::list<Sp<Nod
             return;
         }
 
+        auto acquired = t->getStartTime();
         auto announce = std::make_shared<ValueAnnounce>(this, closestSet, value);
-        announce->addListener([=](Task*) {
-            std::list<Sp<NodeInfo>> result{};
-            for(const auto& item: closestSet.getEntries()) {
-                result.push_back(item);
-            }
-            completeHandler(result);
+        announce->addListener([=](Task* t) {
+            if (static_cast<ValueAnnounce*>(t)->getFailedCalls() == 0)
+                announceCache.put(value.getId(), closestSet, acquired);
+
+            completeHandler(toNodeList(closestSet));
         });
         announce->setName("Nested value Store");
         t->setNestedTask(announce);
-        taskMan.add(announce);
+        taskMan.add(announce, TaskManager::Priority::ANNOUNCE);
     });
 
     task->setName("StoreValue task");
-    taskMan.add(task);
+    taskMan.add(task, TaskManager::Priority::ANNOUNCE);
     return task;
 }
 
@@ -686,18 +868,46 @@ Sp<Task> DHT::findPeer(const Id& id, int expected, LookupOption option, std::fun
         }
     });
 
-    task->addListener([=](Task*) {
+    task->addListener([=](Task* t) {
+        recordLookup(static_cast<LookupTask*>(t));
+        cacheOnPath(static_cast<LookupTask*>(t), *peers);
         completeHandler(*peers);
     });
 
     task->setName("User-level peer lookup");
-    taskMan.add(task);
+    taskMan.add(task, TaskManager::Priority::USER);
     return task;
 }
 
-Sp<Task> DHT::announcePeer(const PeerInfo& peer, const std::function<void(std::list<Sp<NodeInfo>>)> completeHandler) {
+Sp<Task> DHT::announcePeer(const PeerInfo& peer, const std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+        const std::list<Sp<NodeInfo>>& seeds) {
+    auto closestSet = announceCache.get(peer.getId());
+    if (!closestSet)
+        return lookupAndAnnouncePeer(peer, completeHandler, seeds);
+
+    // Same as storeValue: reuse the recent lookup, or fall back to a new one
+    auto announce = std::make_shared<PeerAnnounce>(this, *closestSet, peer);
+    announce->addListener([=](Task* t) {
+        if (t->getState() == Task::State::FINISHED && static_cast<PeerAnnounce*>(t)->getFailedCalls() > 0) {
+            log->debug("Announce peer {} with the cached tokens failed, retry with a new lookup", peer.getId().toString());
+            announceCache.remove(peer.getId());
+            lookupAndAnnouncePeer(peer, completeHandler, seeds);
+            return;
+        }
+
+        completeHandler(toNodeList(*closestSet));
+    });
+
+    announce->setName("Peer announce with cached tokens");
+    taskMan.add(announce, TaskManager::Priority::ANNOUNCE);
+    return announce;
+}
+
+Sp<Task> DHT::lookupAndAnnouncePeer(const PeerInfo& peer, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+        const std::list<Sp<NodeInfo>>& seeds) {
     auto task = std::make_shared<NodeLookup>(this, peer.getId());
     task->setWantToken(true);
+    injectSeeds(*task, seeds);
     task->addListener([=](Task* t) {
         if (t->getState() != Task::State::FINISHED)
             return;
@@ -710,25 +920,159 @@ Sp<Task> DHT::announcePeer(const PeerInfo& peer, const std::function<void(std::l
             return;
         }
 
+        auto acquired = t->getStartTime();
         auto announce = std::make_shared<PeerAnnounce>(this, closestSet, peer);
         announce->addListener([=](Task* t) {
-            std::list<Sp<NodeInfo>> result{};
-            for(const auto& item: closestSet.getEntries()) {
-                result.push_back(item);
-            }
-            completeHandler(result);
+            if (static_cast<PeerAnnounce*>(t)->getFailedCalls() == 0)
+                announceCache.put(peer.getId(), closestSet, acquired);
+
+            completeHandler(toNodeList(closestSet));
         });
         announce->setName("Nested peer announce");
 
         t->setNestedTask(announce);
-        taskMan.add(announce);
+        taskMan.add(announce, TaskManager::Priority::ANNOUNCE);
     });
 
     task->setName("AnoouncePeer Task");
-    taskMan.add(task);
+    taskMan.add(task, TaskManager::Priority::ANNOUNCE);
+    return task;
+}
+
+void DHT::injectSeeds(NodeLookup& task, const std::list<Sp<NodeInfo>>& seeds) const {
+    std::list<Sp<NodeInfo>> nodes {};
+    for (const auto& ni : seeds) {
+        if (type == Type::IPV4 ? ni->isIPv4() : ni->isIPv6())
+            nodes.push_back(ni);
+    }
+
+    if (!nodes.empty())
+        task.injectCandidates(nodes);
+}
+
+Sp<Task> DHT::findNode(const Id& id, std::function<bool(Sp<NodeInfo>)> resultHandler, std::function<void()> completeHandler) {
+    auto task = std::make_shared<NodeLookup>(this, id);
+    auto found = std::make_shared<bool>(false);
+
+    task->setResultHandler([=](Sp<NodeInfo> ni, Task* t) {
+        *found = true;
+        if (!resultHandler(std::make_shared<NodeInfo>(*ni)))
+            t->cancel();
+    });
+
+    task->addListener([=](Task* t) {
+        recordLookup(static_cast<LookupTask*>(t));
+
+        // The target did not respond during the lookup, but it is a known node
+        if (!*found && t->getState() == Task::State::FINISHED) {
+            auto entry = routingTable.getEntry(id);
+            if (entry != nullptr)
+                resultHandler(std::make_shared<NodeInfo>(*entry));
+        }
+
+        completeHandler();
+    });
+    task->setName("User-level streaming node lookup");
+    taskMan.add(task, TaskManager::Priority::USER);
     return task;
 }
 
+Sp<Task> DHT::findValue(const Id& id, std::function<bool(const Value&)> resultHandler, std::function<void()> completeHandler) {
+    auto task = std::make_shared<ValueLookup>(this, id);
+    Sp<Sp<Value>> latest = std::make_shared<Sp<Value>>();
+
+    task->setResultHandler([=](const Value& value, Task* t) {
+        if (!*latest || (value.isMutable() && (*latest)->getSequenceNumber() < value.getSequenceNumber()))
+            *latest = std::make_shared<Value>(value);
+
+        if (!resultHandler(value))
+            t->cancel();
+    });
+
+    task->addListener([=](Task* t) {
+        recordLookup(static_cast<LookupTask*>(t));
+        if (*latest)
+            cacheOnPath(static_cast<LookupTask*>(t), **latest);
+        completeHandler();
+    });
+    task->setName("User-level streaming value lookup");
+    taskMan.add(task, TaskManager::Priority::USER);
+    return task;
+}
+
+Sp<Task> DHT::findPeer(const Id& id, std::function<bool(const PeerInfo&)> resultHandler, std::function<void()> completeHandler) {
+    auto task = std::make_shared<PeerLookup>(this, id);
+    auto found = std::make_shared<std::vector<PeerInfo>>();
+
+    task->setResultHandler([=](std::vector<PeerInfo>& peers, Task* t) {
+        for (const auto& peer : peers) {
+            if (found->size() < (size_t)Constants::PATH_CACHE_MAX_PEERS)
+                found->push_back(peer);
+
+            if (!resultHandler(peer)) {
+                t->cancel();
+                return;
+            }
+        }
+    });
+
+    task->addListener([=](Task* t) {
+        recordLookup(static_cast<LookupTask*>(t));
+        cacheOnPath(static_cast<LookupTask*>(t), *found);
+        completeHandler();
+    });
+    task->setName("User-level streaming peer lookup");
+    taskMan.add(task, TaskManager::Priority::USER);
+    return task;
+}
+
+int DHT::pathCacheTTL(const LookupTask* task) const {
+    // Halved for each node closer to the target which responded to the lookup,
+    // the farther copies expire sooner as fewer lookups pass by them
+    const auto& target = task->getTarget();
+    auto candidate = task->getCacheCandidate();
+    int closer = 0;
+    for (const auto& entry : task->getClosestSet().getEntries()) {
+        if (target.threeWayCompare(entry->getId(), candidate->getId()) < 0)
+            closer++;
+    }
+
+    return std::max(Constants::PATH_CACHE_TTL >> std::min(closer, 16), Constants::PATH_CACHE_MIN_TTL);
+}
+
+void DHT::cacheOnPath(const LookupTask* task, const Value& value) {
+    auto candidate = task->getCacheCandidate();
+    if (candidate == nullptr || !isRunning())
+        return;
+
+    auto request = std::make_shared<StoreValueRequest>(value, candidate->getToken());
+    request->setTTL(pathCacheTTL(task));
+
+    log->debug("Cache value {} on the lookup path at {}", value.getId().toString(), candidate->getId().toString());
+    auto call = std::make_shared<RPCCall>(this, candidate, request);
+    rpcServer->sendCall(call);
+}
+
+void DHT::cacheOnPath(const LookupTask* task, const std::vector<PeerInfo>& peers) {
+    auto candidate = task->getCacheCandidate();
+    if (candidate == nullptr || peers.empty() || !isRunning())
+        return;
+
+    auto ttl = pathCacheTTL(task);
+    auto count = std::min(peers.size(), (size_t)Constants::PATH_CACHE_MAX_PEERS);
+    log->debug("Cache {} peers {} on the lookup path at {}", count, task->getTarget().toString(),
+            candidate->getId().toString());
+
+    for (size_t i = 0; i < count; i++) {
+        auto request = std::make_shared<AnnouncePeerRequest>();
+        request->setToken(candidate->getToken());
+        request->setCachedPeer(peers[i], ttl);
+
+        auto call = std::make_shared<RPCCall>(this, candidate, request);
+        rpcServer->sendCall(call);
+    }
+}
+
 void DHT::populateClosestNodes(Sp<LookupResponse> response, const Id& target, int v4, int v6) {
     if (v4 > 0) {
         auto& dht4 = (type == Type::IPV4) ? *this : *node.getDHT(Type::IPV4);
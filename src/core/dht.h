@@ -27,18 +27,22 @@
 #include <cstdio>
 #include <atomic>
 #include <map>
+#include <mutex>
 
 #include "carrier/id.h"
 #include "carrier/value.h"
 #include "carrier/node_info.h"
 #include "carrier/peer_info.h"
 #include "carrier/lookup_option.h"
+#include "carrier/lookup_stats.h"
 #include "carrier/types.h"
 
+#include "utils/lru_cache.h"
 #include "task/task_manager.h"
 #include "rpcserver.h"
 #include "routing_table.h"
 #include "token_manager.h"
+#include "announce_cache.h"
 
 namespace elastos {
 namespace carrier {
@@ -47,6 +51,8 @@ class Message;
 class PingRequest;
 class RoutingTable;
 class LookupResponse;
+class LookupTask;
+class NodeLookup;
 class Node;
 
 class DHT {
@@ -108,6 +114,18 @@ public:
         return taskMan;
     }
 
+    AnnounceCache& getAnnounceCache() noexcept {
+        return announceCache;
+    }
+
+    int getMinLookupConcurrency() const noexcept {
+        return minLookupConcurrency;
+    }
+
+    int getMaxLookupConcurrency() const noexcept {
+        return maxLookupConcurrency;
+    }
+
     void enablePersistence(const std::string& path) noexcept {
         persistFile = path;
     }
@@ -136,16 +154,52 @@ public:
         return running;
     }
 
+    /**
+     * The DHT is ready for the lookups once enough cached entries are verified
+     * or the bootstrap finished.
+     */
+    bool isReady() const noexcept {
+        return ready;
+    }
+
+    void setReadyListener(std::function<void()> listener) noexcept {
+        readyListener = std::move(listener);
+    }
+
+    size_t getNumberOfKnownNodes() const noexcept {
+        return knownNodes.size();
+    }
+
+    LookupStats getLookupStats() const {
+        std::lock_guard<std::mutex> lock(lookupStatsLock);
+        return lookupStats;
+    }
+
 #ifdef CARRIER_CRAWLER
     void ping(Sp<NodeInfo> node, std::function<void(Sp<NodeInfo>)> completeHandler);
     void getNodes(const Id& id, Sp<NodeInfo> node, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler);
 #endif
 
+    /*
+     * storeValue and announcePeer skip the lookup if a recent one of the same
+     * target left the closest nodes and their tokens in the announce cache,
+     * otherwise the lookup starts from the seeds besides the routing table.
+     */
     Sp<Task> findNode(const Id& id, std::function<void(Sp<NodeInfo>)> completeHandler);
     Sp<Task> findValue(const Id& id, LookupOption option, std::function<void(Sp<Value>)> completeHandler);
-    Sp<Task> storeValue(const Value& value, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler);
+    Sp<Task> storeValue(const Value& value, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+            const std::list<Sp<NodeInfo>>& seeds = {});
     Sp<Task> findPeer(const Id& id, int expected, LookupOption option, std::function<void(std::vector<PeerInfo>)> completeHandler);
-    Sp<Task> announcePeer(const PeerInfo& peer, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler);
+    Sp<Task> announcePeer(const PeerInfo& peer, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+            const std::list<Sp<NodeInfo>>& seeds = {});
+
+    /*
+     * The streaming lookups, the result handler is called on the RPC thread
+     * for every result as it arrives, and returns false to stop the lookup.
+     */
+    Sp<Task> findNode(const Id& id, std::function<bool(Sp<NodeInfo>)> resultHandler, std::function<void()> completeHandler);
+    Sp<Task> findValue(const Id& id, std::function<bool(const Value&)> resultHandler, std::function<void()> completeHandler);
+    Sp<Task> findPeer(const Id& id, std::function<bool(const PeerInfo&)> resultHandler, std::function<void()> completeHandler);
 
     void onTimeout(RPCCall* call);
     void onSend(const Id& id);
@@ -160,6 +214,21 @@ public:
 private:
     void received(Sp<Message>);
     void update();
+
+    void warmStart();
+    void warmStartPing();
+    void setReady();
+    void recordLookup(const LookupTask* task);
+    Sp<Task> lookupAndStoreValue(const Value& value, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+            const std::list<Sp<NodeInfo>>& seeds);
+    Sp<Task> lookupAndAnnouncePeer(const PeerInfo& peer, std::function<void(std::list<Sp<NodeInfo>>)> completeHandler,
+            const std::list<Sp<NodeInfo>>& seeds);
+    void injectSeeds(NodeLookup& task, const std::list<Sp<NodeInfo>>& seeds) const;
+    // Kademlia path caching: the result of a successful lookup is copied to
+    // the closest node on the path which did not have it
+    void cacheOnPath(const LookupTask* task, const Value& value);
+    void cacheOnPath(const LookupTask* task, const std::vector<PeerInfo>& peers);
+    int pathCacheTTL(const LookupTask* task) const;
     void sendError(Sp<Message> q, int code, const std::string& msg);
 
     void onRequest(Sp<Message>);
@@ -185,16 +254,35 @@ private:
     SocketAddress addr;
 
     RoutingTable routingTable {*this};
-    TaskManager taskMan {};
+    TaskManager taskMan {*this};
+
+    int minLookupConcurrency {Constants::MIN_CONCURRENT_LOOKUP_REQUESTS};
+    int maxLookupConcurrency {Constants::MAX_CONCURRENT_LOOKUP_REQUESTS};
 
     std::vector<Sp<NodeInfo>> bootstrapNodes = {};
-    std::map<SocketAddress, Id> knownNodes = {};
+    LRUCache<SocketAddress, Id, SocketAddress::Hash> knownNodes {
+        static_cast<size_t>(Constants::KNOWN_NODES_MAX_ENTRIES),
+        static_cast<uint64_t>(Constants::KNOWN_NODES_EXPIRE_TIME)
+    };
     std::atomic<bool> bootstrapping;
     uint64_t lastBootstrap {0};
 
     uint64_t lastSave {0};
     bool running = false;
 
+    std::atomic<bool> ready {false};
+    std::function<void()> readyListener {};
+
+    std::list<Sp<KBucketEntry>> warmStartQueue {};
+    int warmStartInFlight {0};
+    int warmStartResponded {0};
+    int warmStartQuorum {0};
+
+    LookupStats lookupStats {};
+    mutable std::mutex lookupStatsLock {};
+
+    AnnounceCache announceCache {static_cast<uint64_t>(Constants::ANNOUNCE_TOKEN_REUSE_TIME)};
+
     std::string persistFile;
 
     Sp<Logger> log;
@@ -137,7 +137,7 @@ void Id::bitsCopy(const Id& src, Id& dest, int depth) {
     dest.bytes[idx] |= (src.bytes[idx] & mask);
 }
 
-int Id::getLeadingZeros() {
+int Id::getLeadingZeros() const {
     int msb = 0;
     int i = 0;
 
@@ -38,6 +38,7 @@ void KBucket::_put(Sp<KBucketEntry> newEntry) {
     for (auto& entry: entriesRef) {
         if (entry->equals(*newEntry)) {
             entry->merge(newEntry);
+            modified = true;
             return;
         }
 
@@ -51,7 +52,7 @@ void KBucket::_put(Sp<KBucketEntry> newEntry) {
     }
 
     if (newEntry->isReachable()) {
-        if (entriesRef.size() < Constants::MAX_ENTRIES_PER_BUCKET) {
+        if (entriesRef.size() < capacity) {
             // insert to the list if it still has room
             _update(nullptr, newEntry);
             return;
@@ -103,6 +104,7 @@ void KBucket::_update(Sp<KBucketEntry> toRefresh) {
     for (auto& entry: getEntries()) {
         if (entry->equals(*toRefresh)) {
             entry->merge(toRefresh);
+            modified = true;
             return;
         }
     }
@@ -127,7 +129,7 @@ void KBucket::_update(Sp<KBucketEntry> toRemove, Sp<KBucketEntry> toInsert) {
 
     if (toInsert != nullptr) {
         int oldSize = newEntries.size();
-        bool wasFull = oldSize >= Constants::MAX_ENTRIES_PER_BUCKET;
+        bool wasFull = oldSize >= capacity;
         auto youngest = oldSize > 0 ? list_get(newEntries, oldSize - 1) : nullptr;
         bool unorderedInsert = youngest != nullptr && toInsert->getCreationTime() < youngest->getCreationTime();
 
@@ -158,6 +160,7 @@ void KBucket::_notifyOfResponse(Sp<Message>& msg) {
     for (auto& entry: getEntries()) {
         if (entry->getId() == msg->getId()) {
             entry->signalResponse();
+            modified = true;
             return;
         }
     }
@@ -167,6 +170,7 @@ void KBucket::_onTimeout(const Id& id) {
     for (auto& entry: getEntries()) {
         if (entry->getId() == id) {
             entry->signalRequestTimeout();
+            modified = true;
 
             // NOTICE: Test only - merge buckets
             //   remove when the entry needs replacement
@@ -184,11 +188,26 @@ void KBucket::_onSend(const Id& id) {
     for (auto& entry: getEntries()) {
         if (entry->getId() == id) {
             entry->signalRequest();
+            modified = true;
             return;
         }
     }
 }
 
+Sp<const std::vector<KBucketEntry>> KBucket::_snapshot() {
+    if (modified || !published) {
+        auto copies = std::make_shared<std::vector<KBucketEntry>>();
+        copies->reserve(entries.size());
+        for (const auto& entry: entries)
+            copies->push_back(*entry);
+
+        published = copies;
+        modified = false;
+    }
+
+    return published;
+}
+
 std::string KBucket::toString() const {
     std::stringstream ss;
     ss.str().reserve(1024);
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <list>
+#include <vector>
 #include <memory>
 
 #include "carrier/prefix.h"
@@ -56,7 +57,8 @@ class Message;
  */
 class KBucket {
 public:
-    KBucket(const Prefix& _prefix, bool isHome): prefix(_prefix), homeBucket(isHome) {
+    KBucket(const Prefix& _prefix, bool isHome, int _capacity = Constants::MAX_ENTRIES_PER_BUCKET)
+            : prefix(_prefix), homeBucket(isHome), capacity(_capacity) {
         log = Logger::get("KBucket");
     }
 
@@ -70,6 +72,10 @@ public:
         return homeBucket;
     }
 
+    int getCapacity() const noexcept {
+        return capacity;
+    }
+
     const std::list<Sp<KBucketEntry>>& getEntries() const noexcept {
         return entries;
     }
@@ -79,7 +85,7 @@ public:
     }
 
     bool isFull() const noexcept {
-        return getEntries().size() >= Constants::MAX_ENTRIES_PER_BUCKET;
+        return getEntries().size() >= capacity;
     }
 
     Sp<KBucketEntry> random() {
@@ -133,6 +139,12 @@ public:
 
     std::string toString() const;
 
+    /**
+     * Immutable copy of the current entries for the routing table snapshot.
+     * The copy is only rebuilt if the bucket was modified since the last call.
+     */
+    Sp<const std::vector<KBucketEntry>> _snapshot();
+
 //protected:
     void _put(Sp<KBucketEntry> newEntry);
     void _removeIfBad(Sp<KBucketEntry> toRemove, bool force);
@@ -159,14 +171,19 @@ private:
 
     void setEntries(const std::list<Sp<KBucketEntry>>& entries) noexcept {
         this->entries = entries;
+        modified = true;
     }
 
     const Prefix prefix;
     bool homeBucket { false };
+    int capacity { Constants::MAX_ENTRIES_PER_BUCKET };
 
     std::list<Sp<KBucketEntry>> entries {};
     uint64_t lastRefresh {0};
 
+    bool modified {true};
+    Sp<const std::vector<KBucketEntry>> published {};
+
     Sp<Logger> log;
 };
 
@@ -103,6 +103,74 @@ nlohmann::json KBucketEntry::toJson() const {
     return root;
 }
 
+template <typename T>
+static inline void writeLE(uint8_t*& p, T v) {
+    for (size_t i = 0; i < sizeof(T); i++)
+        *p++ = static_cast<uint8_t>(static_cast<uint64_t>(v) >> (i * 8));
+}
+
+template <typename T>
+static inline T readLE(const uint8_t*& p) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+        v |= static_cast<uint64_t>(*p++) << (i * 8);
+    return static_cast<T>(v);
+}
+
+Sp<KBucketEntry> KBucketEntry::fromBinary(const uint8_t* record) {
+    const uint8_t* p = record;
+
+    Id id {Blob(p, Id::BYTES)};
+    p += Id::BYTES;
+
+    uint8_t family = *p++;
+    bool reachable = *p++ != 0;
+    uint16_t port = readLE<uint16_t>(p);
+
+    size_t addrLen;
+    if (family == 4)
+        addrLen = 4;
+    else if (family == 6)
+        addrLen = 16;
+    else
+        throw std::invalid_argument("Invalid address family in routing table record");
+
+    SocketAddress addr{Blob(p, addrLen), port};
+    p += 16;
+
+    auto entry = std::make_shared<KBucketEntry>(id, addr, readLE<int32_t>(p));
+    entry->failedRequests = readLE<int32_t>(p);
+    entry->created = readLE<uint64_t>(p);
+    entry->lastSeen = readLE<uint64_t>(p);
+    entry->lastSend = readLE<uint64_t>(p);
+    entry->reachable = reachable;
+
+    return entry;
+}
+
+void KBucketEntry::toBinary(uint8_t* record) const {
+    uint8_t* p = record;
+
+    std::memcpy(p, getId().data(), Id::BYTES);
+    p += Id::BYTES;
+
+    *p++ = getAddress().family() == AF_INET ? 4 : 6;
+    *p++ = reachable ? 1 : 0;
+    writeLE<uint16_t>(p, getAddress().port());
+
+    std::memset(p, 0, 16);
+    std::memcpy(p, getAddress().inaddr(), std::min<size_t>(getAddress().inaddrLength(), 16));
+    p += 16;
+
+    writeLE<int32_t>(p, getVersion());
+    writeLE<int32_t>(p, failedRequests);
+    writeLE<uint64_t>(p, created);
+    writeLE<uint64_t>(p, lastSeen);
+    writeLE<uint64_t>(p, lastSend);
+
+    assert(p - record == BINARY_RECORD_SIZE);
+}
+
 std::string KBucketEntry::toString() const {
     auto now = currentTimeMillis();
     std::string str {};
@@ -149,6 +149,17 @@ public:
     static Sp<KBucketEntry> fromJson(nlohmann::json& json);
     nlohmann::json toJson() const;
 
+    /**
+     * Fixed size binary record used by the routing table persistence:
+     *   id(32) | family(1) | reachable(1) | port(2) | address(16) | version(4)
+     *   | failedRequests(4) | created(8) | lastSeen(8) | lastSend(8)
+     * All integers are little-endian, IPv4 address uses the first 4 bytes.
+     */
+    static const size_t BINARY_RECORD_SIZE = 84;
+
+    static Sp<KBucketEntry> fromBinary(const uint8_t* record);
+    void toBinary(uint8_t* record) const;
+
     std::string toString() const;
 
 protected:
@@ -0,0 +1,1158 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "crypto/random.h"
+#include "utils/time.h"
+#include "log_storage.h"
+
+namespace fs = std::filesystem;
+
+namespace elastos {
+namespace carrier {
+
+/*
+ * A record is [length: 4][checksum: 4][body: length], the CRC-32 checksum
+ * covers the body, the integers are little-endian. The body starts with the
+ * type, the puts go on with the metadata, so it can be rewritten in place:
+ *
+ *   PUT_VALUE:    persistent, timestamp, announced, id, public key, private key,
+ *                 recipient, nonce, sequence number, signature, data
+ *   PUT_PEER:     persistent, timestamp, announced, id, node id, origin,
+ *                 private key, port, alternative URL, signature
+ *   REMOVE_VALUE: id
+ *   REMOVE_PEER:  id, node id, origin
+ */
+enum RecordType : uint8_t {
+    PUT_VALUE = 1,
+    PUT_PEER = 2,
+    REMOVE_VALUE = 3,
+    REMOVE_PEER = 4
+};
+
+static const size_t HEADER_SIZE = 8;
+static const size_t METADATA_OFFSET = HEADER_SIZE + 1;
+// larger lengths are taken as a corrupted header
+static const uint32_t MAX_RECORD_SIZE = 16 * 1024 * 1024;
+
+static uint32_t crc32(const uint8_t* data, size_t size) {
+    static const auto table = []() {
+        std::array<uint32_t, 256> table {};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void putInt(uint8_t* ptr, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++)
+        ptr[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint64_t getInt(const uint8_t* ptr, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++)
+        value |= (uint64_t)ptr[i] << (8 * i);
+    return value;
+}
+
+// Fills the length and the checksum of the header
+static void seal(std::vector<uint8_t>& record) {
+    auto length = record.size() - HEADER_SIZE;
+    putInt(record.data(), length, 4);
+    putInt(record.data() + 4, crc32(record.data() + HEADER_SIZE, length), 4);
+}
+
+static bool verify(const std::vector<uint8_t>& record) {
+    return record.size() > HEADER_SIZE &&
+            getInt(record.data(), 4) == record.size() - HEADER_SIZE &&
+            getInt(record.data() + 4, 4) == crc32(record.data() + HEADER_SIZE, record.size() - HEADER_SIZE);
+}
+
+// Rewrites the metadata of a put record
+static void retag(std::vector<uint8_t>& record, bool persistent, uint64_t timestamp, uint64_t announced) {
+    record[METADATA_OFFSET] = persistent ? 1 : 0;
+    putInt(record.data() + METADATA_OFFSET + 1, timestamp, 8);
+    putInt(record.data() + METADATA_OFFSET + 9, announced, 8);
+    seal(record);
+}
+
+class RecordWriter {
+public:
+    RecordWriter(RecordType type) {
+        record.reserve(256);
+        record.resize(HEADER_SIZE);
+        u8(type);
+    }
+
+    void u8(uint8_t value) {
+        record.push_back(value);
+    }
+
+    void u16(uint16_t value) {
+        integer(value, 2);
+    }
+
+    void u32(uint32_t value) {
+        integer(value, 4);
+    }
+
+    void u64(uint64_t value) {
+        integer(value, 8);
+    }
+
+    void id(const Id& id) {
+        record.insert(record.end(), id.data(), id.data() + id.size());
+    }
+
+    void blob(const Blob& blob) {
+        u32(blob.size());
+        record.insert(record.end(), blob.ptr(), blob.ptr() + blob.size());
+    }
+
+    std::vector<uint8_t>& finish() {
+        seal(record);
+        return record;
+    }
+
+private:
+    void integer(uint64_t value, size_t bytes) {
+        auto size = record.size();
+        record.resize(size + bytes);
+        putInt(record.data() + size, value, bytes);
+    }
+
+    std::vector<uint8_t> record {};
+};
+
+class RecordReader {
+public:
+    RecordReader(const std::vector<uint8_t>& record)
+        : ptr(record.data() + HEADER_SIZE), end(record.data() + record.size()) {}
+
+    uint8_t u8() {
+        return (uint8_t)integer(1);
+    }
+
+    uint16_t u16() {
+        return (uint16_t)integer(2);
+    }
+
+    uint32_t u32() {
+        return (uint32_t)integer(4);
+    }
+
+    uint64_t u64() {
+        return integer(8);
+    }
+
+    Id id() {
+        return Id(take(Id::BYTES));
+    }
+
+    Blob blob() {
+        return take(u32());
+    }
+
+private:
+    Blob take(size_t size) {
+        if ((size_t)(end - ptr) < size)
+            throw std::runtime_error("Corrupted record in the storage log.");
+
+        Blob blob(ptr, size);
+        ptr += size;
+        return blob;
+    }
+
+    uint64_t integer(size_t bytes) {
+        return getInt(take(bytes).ptr(), bytes);
+    }
+
+    const uint8_t* ptr;
+    const uint8_t* end;
+};
+
+static std::vector<uint8_t> encodeValue(const Value& value, bool persistent, uint64_t timestamp, uint64_t announced) {
+    RecordWriter writer(PUT_VALUE);
+    writer.u8(persistent);
+    writer.u64(timestamp);
+    writer.u64(announced);
+    writer.id(value.getId());
+    writer.blob(value.isMutable() ? value.getPublicKey().blob() : Blob());
+    writer.blob(value.hasPrivateKey() ? value.getPrivateKey().blob() : Blob());
+    writer.blob(value.isEncrypted() ? value.getRecipient().blob() : Blob());
+    writer.blob(value.isMutable() ? value.getNonce().blob() : Blob());
+    writer.u32(value.getSequenceNumber());
+    writer.blob(value.isSigned() ? Blob(value.getSignature()) : Blob());
+    writer.blob(value.getData());
+    return std::move(writer.finish());
+}
+
+static std::vector<uint8_t> encodePeer(const PeerInfo& peer, bool persistent, uint64_t timestamp, uint64_t announced) {
+    RecordWriter writer(PUT_PEER);
+    writer.u8(persistent);
+    writer.u64(timestamp);
+    writer.u64(announced);
+    writer.id(peer.getId());
+    writer.id(peer.getNodeId());
+    writer.id(peer.getOrigin());
+    writer.blob(peer.hasPrivateKey() ? peer.getPrivateKey().blob() : Blob());
+    writer.u16(peer.getPort());
+    const auto& alt = peer.hasAlternativeURL() ? peer.getAlternativeURL() : std::string();
+    writer.blob(Blob(alt.data(), alt.size()));
+    writer.blob(peer.getSignature());
+    return std::move(writer.finish());
+}
+
+static std::vector<uint8_t> encodeValueRemoval(const Id& id) {
+    RecordWriter writer(REMOVE_VALUE);
+    writer.id(id);
+    return std::move(writer.finish());
+}
+
+static std::vector<uint8_t> encodePeerRemoval(const Id& id, const Id& nodeId, const Id& origin) {
+    RecordWriter writer(REMOVE_PEER);
+    writer.id(id);
+    writer.id(nodeId);
+    writer.id(origin);
+    return std::move(writer.finish());
+}
+
+static bool seek(FILE* file, uint64_t offset) {
+#if defined(_WIN32) || defined(_WIN64)
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool syncFile(FILE* file) {
+#if defined(_WIN32) || defined(_WIN64)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+static bool truncateFile(FILE* file, uint64_t size) {
+#if defined(_WIN32) || defined(_WIN64)
+    return _chsize_s(_fileno(file), size) == 0;
+#else
+    return ftruncate(fileno(file), size) == 0;
+#endif
+}
+
+// Reads the next record, false at the end or at a torn or corrupted record
+static bool readRecord(FILE* file, std::vector<uint8_t>& record) {
+    uint8_t header[HEADER_SIZE];
+    if (std::fread(header, 1, HEADER_SIZE, file) != HEADER_SIZE)
+        return false;
+
+    auto length = getInt(header, 4);
+    if (length == 0 || length > MAX_RECORD_SIZE)
+        return false;
+
+    record.resize(HEADER_SIZE + length);
+    std::memcpy(record.data(), header, HEADER_SIZE);
+    if (std::fread(record.data() + HEADER_SIZE, 1, length, file) != length)
+        return false;
+
+    return verify(record);
+}
+
+LogStorage::LogStorage(const std::string& path, uint64_t segmentSize)
+        : path(path), segmentSize(segmentSize) {
+    log = Logger::get("Storage");
+    recover();
+
+    running = true;
+    thread = std::thread([this]() {
+        run();
+    });
+}
+
+LogStorage::~LogStorage() {
+    close();
+}
+
+void LogStorage::recover() {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    fs::create_directories(path);
+
+    std::vector<uint64_t> numbers {};
+    for (const auto& file : fs::directory_iterator(path)) {
+        auto stem = file.path().stem().string();
+        if (!file.is_regular_file() || file.path().extension() != ".log" || stem.empty() ||
+                !std::all_of(stem.begin(), stem.end(), [](char c) { return std::isdigit((unsigned char)c); }))
+            continue;
+
+        numbers.push_back(std::stoull(stem));
+    }
+    std::sort(numbers.begin(), numbers.end());
+
+    for (auto number : numbers) {
+        auto segment = std::make_shared<Segment>();
+        segment->number = number;
+        segment->path = (fs::path(path) / fs::path(name(number))).string();
+        segment->file = std::fopen(segment->path.c_str(), "r+b");
+        if (segment->file == nullptr)
+            throw std::runtime_error("Open the storage log segment " + segment->path + " failed.");
+
+        segments[number] = segment;
+
+        auto end = load(*segment);
+        auto size = fs::file_size(segment->path);
+        if (end < size) {
+            // only the tail of the last segment is expected to be torn, by a crash
+            log->warn("Storage log segment {} is cut at {}, the {} bytes after are torn or corrupted",
+                    segment->path, end, size - end);
+            if (!truncateFile(segment->file, end))
+                throw std::runtime_error("Truncate the storage log segment " + segment->path + " failed.");
+        }
+        segment->size = end;
+    }
+
+    if (!segments.empty() && segments.rbegin()->second->size < segmentSize)
+        head = segments.rbegin()->second;
+    else
+        head = createSegment(segments.empty() ? 1 : segments.rbegin()->first + 1);
+
+    log->info("Storage log {} opened, {} values and {} peers in {} segments", path,
+            values.size(), peers.size(), segments.size());
+}
+
+std::string LogStorage::name(uint64_t number) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llu.log", (unsigned long long)number);
+    return name;
+}
+
+uint64_t LogStorage::load(Segment& segment) {
+    if (!seek(segment.file, 0))
+        throw std::runtime_error("Read the storage log segment " + segment.path + " failed.");
+
+    uint64_t offset = 0;
+    std::vector<uint8_t> record {};
+    while (readRecord(segment.file, record)) {
+        replay(record, {segment.number, offset, (uint32_t)record.size()});
+        offset += record.size();
+    }
+
+    return offset;
+}
+
+void LogStorage::replay(const std::vector<uint8_t>& record, const Location& location) {
+    RecordReader reader(record);
+    auto type = reader.u8();
+    auto now = currentTimeMillis();
+
+    if (type == PUT_VALUE || type == PUT_PEER) {
+        bool persistent = reader.u8();
+        auto timestamp = reader.u64();
+        auto announced = reader.u64();
+        auto id = reader.id();
+
+        // an expired record supersedes the older ones all the same, it stays in the
+        // index if it does, until expire() drops it and writes its removal
+        if (type == PUT_VALUE) {
+            bool shadows = values.find(id) != values.end();
+            if (!persistent && timestamp < now - Constants::MAX_VALUE_AGE && !shadows)
+                unindexValue(id);
+            else
+                indexValue(id, {location, persistent, timestamp, announced, shadows});
+        } else {
+            PeerKey key {reader.id(), reader.id()};
+            auto set = peers.find(id);
+            bool shadows = set != peers.end() && set->second.find(key) != set->second.end();
+            if (!persistent && timestamp < now - Constants::MAX_PEER_AGE && !shadows)
+                unindexPeer(id, key);
+            else
+                indexPeer(id, key, {location, persistent, timestamp, announced, shadows});
+        }
+    } else if (type == REMOVE_VALUE) {
+        unindexValue(reader.id());
+        segments.at(location.segment)->removals += location.length;
+    } else if (type == REMOVE_PEER) {
+        auto id = reader.id();
+        auto nodeId = reader.id();
+        auto origin = reader.id();
+        unindexPeer(id, {nodeId, origin});
+        segments.at(location.segment)->removals += location.length;
+    } else {
+        throw std::runtime_error("Unknown record in the storage log.");
+    }
+}
+
+Sp<LogStorage::Segment> LogStorage::createSegment(uint64_t number) {
+    auto segment = std::make_shared<Segment>();
+    segment->number = number;
+    segment->path = (fs::path(path) / fs::path(name(number))).string();
+    segment->file = std::fopen(segment->path.c_str(), "w+b");
+    if (segment->file == nullptr)
+        throw std::runtime_error("Create the storage log segment " + segment->path + " failed.");
+
+    segments[number] = segment;
+    return segment;
+}
+
+void LogStorage::roll() {
+    flush();
+    if (!syncFile(head->file))
+        log->warn("Sync the storage log segment {} failed", head->path);
+
+    head = createSegment(head->number + 1);
+}
+
+LogStorage::Location LogStorage::append(const std::vector<uint8_t>& record, bool removal) {
+    if (head == nullptr)
+        throw std::runtime_error("The storage is closed.");
+
+    if (head->size > 0 && head->size + record.size() > segmentSize)
+        roll();
+
+    if (!seek(head->file, head->size) || std::fwrite(record.data(), 1, record.size(), head->file) != record.size())
+        throw std::runtime_error("Append to the storage log segment " + head->path + " failed.");
+
+    Location location {head->number, head->size, (uint32_t)record.size()};
+    head->size += record.size();
+    if (removal)
+        head->removals += record.size();
+
+    dirty = true;
+    if (batchDepth == 0)
+        flush();
+
+    return location;
+}
+
+std::vector<uint8_t> LogStorage::read(const Location& location) {
+    auto it = segments.find(location.segment);
+    if (it == segments.end())
+        throw std::runtime_error("The storage log segment of a record is missing.");
+
+    auto& segment = it->second;
+    std::vector<uint8_t> record(location.length);
+    if (!seek(segment->file, location.offset) ||
+            std::fread(record.data(), 1, record.size(), segment->file) != record.size())
+        throw std::runtime_error("Read the storage log segment " + segment->path + " failed.");
+
+    if (!verify(record))
+        throw std::runtime_error("Corrupted record in the storage log segment " + segment->path + ".");
+
+    return record;
+}
+
+void LogStorage::flush() {
+    if (head != nullptr && std::fflush(head->file) != 0)
+        throw std::runtime_error("Flush the storage log segment " + head->path + " failed.");
+}
+
+void LogStorage::release(const Location& location) {
+    auto it = segments.find(location.segment);
+    if (it != segments.end())
+        it->second->live -= location.length;
+}
+
+void LogStorage::retain(const Location& location) {
+    auto it = segments.find(location.segment);
+    if (it != segments.end())
+        it->second->live += location.length;
+}
+
+void LogStorage::indexValue(const Id& id, const Entry& entry) {
+    auto it = values.find(id);
+    if (it != values.end()) {
+        release(it->second.location);
+        if (!it->second.persistent)
+            valueAges.erase({it->second.timestamp, id});
+        it->second = entry;
+    } else {
+        values.emplace(id, entry);
+    }
+
+    retain(entry.location);
+    if (!entry.persistent)
+        valueAges.emplace(entry.timestamp, id);
+}
+
+void LogStorage::unindexValue(const Id& id) {
+    auto it = values.find(id);
+    if (it == values.end())
+        return;
+
+    release(it->second.location);
+    if (!it->second.persistent)
+        valueAges.erase({it->second.timestamp, id});
+    values.erase(it);
+}
+
+void LogStorage::indexPeer(const Id& id, const PeerKey& key, const Entry& entry) {
+    auto& set = peers[id];
+    auto it = set.find(key);
+    if (it != set.end()) {
+        release(it->second.location);
+        if (!it->second.persistent)
+            peerAges.erase({it->second.timestamp, id, key.first, key.second});
+        it->second = entry;
+    } else {
+        set.emplace(key, entry);
+    }
+
+    retain(entry.location);
+    if (!entry.persistent)
+        peerAges.emplace(entry.timestamp, id, key.first, key.second);
+}
+
+void LogStorage::unindexPeer(const Id& id, const PeerKey& key) {
+    auto set = peers.find(id);
+    if (set == peers.end())
+        return;
+
+    auto it = set->second.find(key);
+    if (it == set->second.end())
+        return;
+
+    release(it->second.location);
+    if (!it->second.persistent)
+        peerAges.erase({it->second.timestamp, id, key.first, key.second});
+    set->second.erase(it);
+    if (set->second.empty())
+        peers.erase(set);
+}
+
+Value LogStorage::readValue(const Location& location) {
+    auto record = read(location);
+    RecordReader reader(record);
+    reader.u8();
+    reader.u8();
+    reader.u64();
+    reader.u64();
+    reader.id();
+
+    auto publicKey = reader.blob();
+    auto privateKey = reader.blob();
+    auto recipient = reader.blob();
+    auto nonce = reader.blob();
+    if (nonce.size() != CryptoBox::Nonce::BYTES)
+        nonce = {};
+    int sequenceNumber = (int)reader.u32();
+    auto signature = reader.blob();
+    auto data = reader.blob();
+
+    return Value::of(publicKey, privateKey, recipient, nonce, sequenceNumber, signature, data);
+}
+
+PeerInfo LogStorage::readPeer(const Location& location) {
+    auto record = read(location);
+    RecordReader reader(record);
+    reader.u8();
+    reader.u8();
+    reader.u64();
+    reader.u64();
+
+    auto id = reader.id();
+    auto nodeId = reader.id();
+    auto origin = reader.id();
+    auto privateKey = reader.blob();
+    auto port = reader.u16();
+    auto alt = reader.blob();
+    auto signature = reader.blob();
+
+    return PeerInfo::of(id.blob(), privateKey, nodeId.blob(), origin.blob(), port,
+            std::string((const char*)alt.ptr(), alt.size()), signature);
+}
+
+Sp<Value> LogStorage::getValue(const Id& valueId) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    auto it = values.find(valueId);
+    if (it == values.end() || it->second.timestamp < currentTimeMillis() - Constants::MAX_VALUE_AGE)
+        return nullptr;
+
+    return std::make_shared<Value>(readValue(it->second.location));
+}
+
+bool LogStorage::removeValue(const Id& valueId) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    if (values.find(valueId) == values.end())
+        return false;
+
+    append(encodeValueRemoval(valueId), true);
+    unindexValue(valueId);
+    return true;
+}
+
+Sp<Value> LogStorage::putValue(const Value& value, int expectedSeq, bool persistent, bool updateLastAnnounce) {
+    if (value.isMutable() && !value.isValid())
+        throw std::invalid_argument("Value signature validation failed");
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    auto now = currentTimeMillis();
+    auto id = value.getId();
+
+    Sp<Value> old {};
+    auto it = values.find(id);
+    if (it != values.end() && it->second.timestamp >= now - Constants::MAX_VALUE_AGE)
+        old = std::make_shared<Value>(readValue(it->second.location));
+
+    checkReplace(old, value, expectedSeq);
+
+    // like the SQLite upsert, a stored value keeps its persistence and last announce
+    Entry entry {{}, persistent, now, updateLastAnnounce ? now : 0};
+    if (it != values.end()) {
+        entry.persistent = it->second.persistent;
+        entry.announced = it->second.announced;
+        entry.shadows = true;
+    }
+
+    entry.location = append(encodeValue(value, entry.persistent, entry.timestamp, entry.announced));
+    indexValue(id, entry);
+    return old;
+}
+
+void LogStorage::updateValueLastAnnounce(const Id& valueId) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    auto it = values.find(valueId);
+    if (it == values.end())
+        return;
+
+    auto now = currentTimeMillis();
+    auto entry = it->second;
+    auto record = read(entry.location);
+    retag(record, entry.persistent, now, now);
+
+    entry.location = append(record);
+    entry.timestamp = now;
+    entry.announced = now;
+    indexValue(valueId, entry);
+}
+
+std::vector<Id> LogStorage::scanValueIds(ScanCursor& cursor, size_t limit) {
+    std::vector<Id> ids {};
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    for (const auto* entry : scanValueEntries(cursor, limit, [&](const Entry& entry) {
+        return entry.timestamp >= when;
+    }))
+        ids.push_back(entry->first);
+
+    advance(cursor, ids, limit);
+    return ids;
+}
+
+std::vector<Value> LogStorage::scanValues(ScanCursor& cursor, size_t limit) {
+    std::vector<Value> result {};
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    for (const auto* entry : scanValueEntries(cursor, limit, [&](const Entry& entry) {
+        return entry.timestamp >= when;
+    }))
+        result.push_back(readValue(entry->second.location));
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<Value> LogStorage::scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    std::vector<Value> result {};
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    for (const auto* entry : scanValueEntries(cursor, limit, [&](const Entry& entry) {
+        return entry.persistent && entry.announced <= lastAnnounceBefore;
+    }))
+        result.push_back(readValue(entry->second.location));
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<const std::pair<const Id, LogStorage::Entry>*> LogStorage::scanValueEntries(const ScanCursor& cursor,
+        size_t limit, const std::function<bool(const Entry&)>& filter) {
+    std::vector<const std::pair<const Id, Entry>*> result {};
+
+    auto last = cursor.prefix.last();
+    auto it = cursor.started ? values.upper_bound(cursor.id) : values.lower_bound(cursor.prefix.first());
+    for (; it != values.end() && result.size() < limit && !(last < it->first); ++it) {
+        if (filter(it->second))
+            result.push_back(&*it);
+    }
+
+    return result;
+}
+
+std::vector<PeerInfo> LogStorage::getPeer(const Id& peerId, int maxPeers) {
+    std::vector<PeerInfo> result {};
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return result;
+
+    std::vector<const Entry*> live {};
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    for (const auto& [key, entry] : it->second) {
+        if (entry.timestamp >= when)
+            live.push_back(&entry);
+    }
+
+    // a random pick of the entries, only the picked records are read
+    if (maxPeers > 0 && live.size() > (size_t)maxPeers) {
+        for (size_t i = 0; i < (size_t)maxPeers; i++)
+            std::swap(live[i], live[i + Random::uint32(live.size() - i)]);
+        live.resize(maxPeers);
+    }
+
+    result.reserve(live.size());
+    for (const auto* entry : live)
+        result.push_back(readPeer(entry->location));
+
+    return result;
+}
+
+Sp<PeerInfo> LogStorage::getPeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return nullptr;
+
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    for (const auto& [key, entry] : it->second) {
+        if (key.second == origin && entry.timestamp >= when)
+            return std::make_shared<PeerInfo>(readPeer(entry.location));
+    }
+
+    return nullptr;
+}
+
+bool LogStorage::removePeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return false;
+
+    std::vector<PeerKey> keys {};
+    for (const auto& [key, entry] : it->second) {
+        if (key.second == origin)
+            keys.push_back(key);
+    }
+
+    if (keys.empty())
+        return false;
+
+    // a removal for each node id, the compaction drops each of them on its own
+    batch([&]() {
+        for (const auto& key : keys) {
+            append(encodePeerRemoval(peerId, key.first, key.second), true);
+            unindexPeer(peerId, key);
+        }
+    });
+
+    return true;
+}
+
+void LogStorage::putPeer(const std::vector<PeerInfo>& peers) {
+    batch([&]() {
+        for (const auto& peer : peers)
+            putPeer(peer, false, false);
+    });
+}
+
+void LogStorage::putPeer(const PeerInfo& peer, bool persistent, bool updateLastAnnounce) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    auto now = currentTimeMillis();
+    PeerKey key {peer.getNodeId(), peer.getOrigin()};
+    auto set = peers.find(peer.getId());
+
+    Entry entry {{}, persistent, now, updateLastAnnounce ? now : 0};
+    entry.shadows = set != peers.end() && set->second.find(key) != set->second.end();
+    entry.location = append(encodePeer(peer, persistent, entry.timestamp, entry.announced));
+    indexPeer(peer.getId(), key, entry);
+}
+
+void LogStorage::updatePeerLastAnnounce(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return;
+
+    std::vector<std::pair<PeerKey, Entry>> matched {};
+    for (const auto& [key, entry] : it->second) {
+        if (key.second == origin)
+            matched.emplace_back(key, entry);
+    }
+
+    auto now = currentTimeMillis();
+    batch([&]() {
+        for (auto& [key, entry] : matched) {
+            auto record = read(entry.location);
+            retag(record, entry.persistent, now, now);
+
+            entry.location = append(record);
+            entry.timestamp = now;
+            entry.announced = now;
+            indexPeer(peerId, key, entry);
+        }
+    });
+}
+
+std::vector<Id> LogStorage::scanPeerIds(ScanCursor& cursor, size_t limit) {
+    std::vector<Id> ids {};
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    auto last = cursor.prefix.last();
+    auto it = cursor.started ? peers.upper_bound(cursor.id) : peers.lower_bound(cursor.prefix.first());
+    for (; it != peers.end() && ids.size() < limit && !(last < it->first); ++it) {
+        auto live = std::any_of(it->second.begin(), it->second.end(), [&](const auto& entry) {
+            return entry.second.timestamp >= when;
+        });
+        if (live)
+            ids.push_back(it->first);
+    }
+
+    advance(cursor, ids, limit);
+    return ids;
+}
+
+std::vector<PeerInfo> LogStorage::scanPeers(ScanCursor& cursor, size_t limit) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    auto result = scanPeerEntries(cursor, limit, [&](const Entry& entry) {
+        return entry.timestamp >= when;
+    });
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<PeerInfo> LogStorage::scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto result = scanPeerEntries(cursor, limit, [&](const Entry& entry) {
+        return entry.persistent && entry.announced <= lastAnnounceBefore;
+    });
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<PeerInfo> LogStorage::scanPeerEntries(const ScanCursor& cursor, size_t limit,
+        const std::function<bool(const Entry&)>& filter) {
+    std::vector<PeerInfo> result {};
+
+    auto last = cursor.prefix.last();
+    auto it = cursor.started ? peers.lower_bound(cursor.id) : peers.lower_bound(cursor.prefix.first());
+    for (; it != peers.end() && result.size() < limit && !(last < it->first); ++it) {
+        auto& set = it->second;
+        auto entry = cursor.started && it->first == cursor.id ?
+                set.upper_bound({cursor.nodeId, cursor.origin}) : set.begin();
+        for (; entry != set.end() && result.size() < limit; ++entry) {
+            if (filter(entry->second))
+                result.push_back(readPeer(entry->second.location));
+        }
+    }
+
+    return result;
+}
+
+PrefixStats LogStorage::getPrefixStats(const Prefix& prefix) {
+    PrefixStats stats {};
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto first = prefix.first();
+    auto last = prefix.last();
+
+    // the bytes of the records in the log
+    auto when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    for (auto it = values.lower_bound(first); it != values.end() && !(last < it->first); ++it) {
+        if (it->second.timestamp >= when) {
+            stats.values++;
+            stats.valueBytes += it->second.location.length;
+        }
+    }
+
+    when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    for (auto it = peers.lower_bound(first); it != peers.end() && !(last < it->first); ++it) {
+        for (const auto& [key, entry] : it->second) {
+            if (entry.timestamp >= when) {
+                stats.peers++;
+                stats.peerBytes += entry.location.length;
+            }
+        }
+    }
+
+    return stats;
+}
+
+void LogStorage::batch(const std::function<void()>& writes) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    batchDepth++;
+    try {
+        writes();
+    } catch (...) {
+        if (--batchDepth == 0)
+            flush();
+        throw;
+    }
+
+    if (--batchDepth == 0)
+        flush();
+}
+
+size_t LogStorage::expire(size_t maxEntries, uint64_t now) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    size_t removed = 0;
+
+    // the records are skipped by the replay and the compaction, a removal hides
+    // the older records of the key they may have superseded after they are gone
+    batch([&]() {
+        auto when = now - Constants::MAX_VALUE_AGE;
+        for (size_t i = 0; i < maxEntries && !valueAges.empty() && valueAges.begin()->first < when; i++) {
+            auto id = valueAges.begin()->second;
+            if (values.at(id).shadows)
+                append(encodeValueRemoval(id), true);
+            unindexValue(id);
+            removed++;
+        }
+
+        when = now - Constants::MAX_PEER_AGE;
+        for (size_t i = 0; i < maxEntries && !peerAges.empty() && std::get<0>(*peerAges.begin()) < when; i++) {
+            auto [timestamp, id, nodeId, origin] = *peerAges.begin();
+            if (peers.at(id).at({nodeId, origin}).shadows)
+                append(encodePeerRemoval(id, nodeId, origin), true);
+            unindexPeer(id, {nodeId, origin});
+            removed++;
+        }
+    });
+
+    return removed;
+}
+
+void LogStorage::sync() {
+    Sp<Segment> segment {};
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        if (head == nullptr || !dirty)
+            return;
+
+        flush();
+        dirty = false;
+        segment = head;
+    }
+
+    // the writers go on meanwhile, only the flushed appends are synced
+    if (!syncFile(segment->file))
+        log->warn("Sync the storage log segment {} failed", segment->path);
+}
+
+bool LogStorage::compact() {
+    std::lock_guard<std::mutex> guard(compacting);
+
+    Sp<Segment> victim {};
+    bool oldest = true;
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        for (const auto& [number, segment] : segments) {
+            if (segment == head)
+                break;
+
+            // the removals are kept until they reach the oldest segment, nothing older is left to hide then
+            auto live = segment->live + (oldest ? 0 : segment->removals);
+            if (live * 100 < segment->size * Constants::STORAGE_LOG_COMPACT_RATIO) {
+                victim = segment;
+                break;
+            }
+
+            oldest = false;
+        }
+
+        if (victim == nullptr)
+            return false;
+    }
+
+    // a sealed segment is never written, so it is read without the lock
+    auto in = std::fopen(victim->path.c_str(), "rb");
+    if (in == nullptr)
+        throw std::runtime_error("Open the storage log segment " + victim->path + " failed.");
+
+    uint64_t offset = 0;
+    std::vector<uint8_t> record {};
+    while (offset < victim->size && readRecord(in, record)) {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        relocate(record, {victim->number, offset, (uint32_t)record.size()}, oldest);
+        offset += record.size();
+    }
+    std::fclose(in);
+
+    // the copies are on the disk before the segment is gone
+    sync();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        segments.erase(victim->number);
+    }
+
+    auto file = victim->path;
+    victim.reset();
+
+    std::error_code ec;
+    fs::remove(file, ec);
+    log->debug("Storage log segment {} compacted", file);
+    return true;
+}
+
+void LogStorage::relocate(const std::vector<uint8_t>& record, const Location& location, bool oldest) {
+    RecordReader reader(record);
+    auto type = reader.u8();
+
+    if (type == PUT_VALUE || type == PUT_PEER) {
+        reader.u8();
+        reader.u64();
+        reader.u64();
+        auto id = reader.id();
+
+        // only the live records move, the superseded and expired ones are not in the index
+        if (type == PUT_VALUE) {
+            auto it = values.find(id);
+            if (it != values.end() && it->second.location == location) {
+                auto entry = it->second;
+                entry.location = append(record);
+                indexValue(id, entry);
+            }
+        } else {
+            PeerKey key {reader.id(), reader.id()};
+            auto set = peers.find(id);
+            if (set == peers.end())
+                return;
+
+            auto it = set->second.find(key);
+            if (it != set->second.end() && it->second.location == location) {
+                auto entry = it->second;
+                entry.location = append(record);
+                indexPeer(id, key, entry);
+            }
+        }
+    } else if (!oldest) {
+        // a removal still hides the records of the older segments, unless the key is put
+        // again since, then the live record hides them in its place
+        auto id = reader.id();
+        Entry* entry = nullptr;
+        if (type == REMOVE_VALUE) {
+            auto it = values.find(id);
+            if (it != values.end())
+                entry = &it->second;
+        } else {
+            PeerKey key {reader.id(), reader.id()};
+            auto set = peers.find(id);
+            if (set != peers.end()) {
+                auto it = set->second.find(key);
+                if (it != set->second.end())
+                    entry = &it->second;
+            }
+        }
+
+        if (entry != nullptr)
+            entry->shadows = true;
+        else
+            append(record, true);
+    }
+}
+
+void LogStorage::close() {
+    {
+        std::lock_guard<std::mutex> lock(threadMutex);
+        running = false;
+    }
+
+    stopping.notify_all();
+    if (thread.joinable())
+        thread.join();
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (head != nullptr) {
+        flush();
+        if (!syncFile(head->file))
+            log->warn("Sync the storage log segment {} failed", head->path);
+    }
+
+    head.reset();
+    segments.clear();
+    values.clear();
+    peers.clear();
+    valueAges.clear();
+    peerAges.clear();
+}
+
+void LogStorage::run() {
+    std::unique_lock<std::mutex> lock(threadMutex);
+    while (running) {
+        stopping.wait_for(lock, std::chrono::milliseconds(Constants::STORAGE_LOG_SYNC_INTERVAL), [&]() {
+            return !running;
+        });
+        if (!running)
+            break;
+
+        lock.unlock();
+        try {
+            sync();
+            compact();
+        } catch (const std::exception& e) {
+            log->error("Storage log maintenance failed: {}", e.what());
+        }
+        lock.lock();
+    }
+}
+
+} /* namespace carrier */
+} /* namespace elastos */
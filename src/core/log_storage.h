@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/peer_info.h"
+#include "utils/log.h"
+#include "utils/time.h"
+#include "constants.h"
+#include "data_storage.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * Keeps the values and peers in an append-only log of segment files under a
+ * directory, with an in-memory index of where the live record of each value
+ * and peer is, in the id order for the paged scans.
+ *
+ * Every write appends a checksummed record, a put or a removal, so a write is
+ * a sequential append and a read is one positioned read. At startup the
+ * segments are replayed in order to rebuild the index, a torn or corrupted
+ * tail left by a crash is cut off. The appends are flushed to the OS after
+ * each write or batch, and synced to the disk every STORAGE_LOG_SYNC_INTERVAL
+ * by a background thread, which also compacts the sealed segments mostly
+ * taken by the superseded and expired records: their live records are copied
+ * to the head of the log and the segment file is deleted.
+ *
+ * The expired records are dropped from the index and go away with the
+ * compaction, they are not read back after a restart. An expired record that
+ * superseded an older one of its key, which may still be in an older segment,
+ * is followed by a removal, so the older one is not read back either.
+ *
+ * Thread safe.
+ */
+class LogStorage final : public DataStorage {
+public:
+    LogStorage(const std::string& path, uint64_t segmentSize = Constants::STORAGE_LOG_SEGMENT_SIZE);
+    ~LogStorage();
+
+    Sp<Value> getValue(const Id& valueId) override;
+    bool removeValue(const Id& valueId) override;
+    Sp<Value> putValue(const Value& value, int expectedSeq = -1, bool persistent = false, bool updateLastAnnounce = false) override;
+    using DataStorage::putValue;
+    void updateValueLastAnnounce(const Id& valueId) override;
+    std::vector<Id> scanValueIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanValues(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+
+    std::vector<PeerInfo> getPeer(const Id& peerId, int maxPeers) override;
+    Sp<PeerInfo> getPeer(const Id& peerId, const Id& origin) override;
+    bool removePeer(const Id& peerId, const Id& origin) override;
+    void putPeer(const std::vector<PeerInfo>& peers) override;
+    void putPeer(const PeerInfo& peer, bool persistent = false, bool updateLastAnnounce = false) override;
+    void updatePeerLastAnnounce(const Id& peerId, const Id& origin) override;
+    std::vector<Id> scanPeerIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPeers(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+    PrefixStats getPrefixStats(const Prefix& prefix) override;
+
+    // the writes are flushed to the OS once at the end
+    void batch(const std::function<void()>& writes) override;
+    size_t expire(size_t maxEntries) override {
+        return expire(maxEntries, currentTimeMillis());
+    }
+    // expires the records past their age at the time
+    size_t expire(size_t maxEntries, uint64_t now);
+    void close() override;
+
+    // syncs the appended records to the disk
+    void sync();
+
+    // compacts the first sealed segment below the live ratio, returns false if none is
+    bool compact();
+
+    size_t getSegmentCount() const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        return segments.size();
+    }
+
+private:
+    struct Segment {
+        uint64_t number {0};
+        std::string path {};
+        FILE* file {nullptr};
+        uint64_t size {0};
+        // the bytes of the indexed records, and of the removals
+        uint64_t live {0};
+        uint64_t removals {0};
+
+        ~Segment() {
+            if (file != nullptr)
+                std::fclose(file);
+        }
+    };
+
+    struct Location {
+        uint64_t segment;
+        uint64_t offset;
+        uint32_t length;
+
+        bool operator==(const Location& other) const {
+            return segment == other.segment && offset == other.offset;
+        }
+    };
+
+    struct Entry {
+        Location location;
+        bool persistent;
+        uint64_t timestamp;
+        uint64_t announced;
+        // an older record of the key may be in the log, hidden by this one only
+        bool shadows {false};
+    };
+
+    // by node id and origin
+    using PeerKey = std::pair<Id, Id>;
+    using PeerAge = std::tuple<uint64_t, Id, Id, Id>;
+
+    static std::string name(uint64_t number);
+
+    void recover();
+    uint64_t load(Segment& segment);
+    void replay(const std::vector<uint8_t>& record, const Location& location);
+    void relocate(const std::vector<uint8_t>& record, const Location& location, bool oldest);
+    Sp<Segment> createSegment(uint64_t number);
+    void roll();
+    Location append(const std::vector<uint8_t>& record, bool removal = false);
+    std::vector<uint8_t> read(const Location& location);
+    void flush();
+
+    void indexValue(const Id& id, const Entry& entry);
+    void unindexValue(const Id& id);
+    void indexPeer(const Id& id, const PeerKey& key, const Entry& entry);
+    void unindexPeer(const Id& id, const PeerKey& key);
+    void release(const Location& location);
+    void retain(const Location& location);
+
+    // from the cursor within its prefix, until limit entries pass the filter
+    std::vector<const std::pair<const Id, Entry>*> scanValueEntries(const ScanCursor& cursor, size_t limit,
+            const std::function<bool(const Entry&)>& filter);
+    std::vector<PeerInfo> scanPeerEntries(const ScanCursor& cursor, size_t limit,
+            const std::function<bool(const Entry&)>& filter);
+
+    Value readValue(const Location& location);
+    PeerInfo readPeer(const Location& location);
+
+    void run();
+
+    const std::string path;
+    const uint64_t segmentSize;
+
+    std::map<uint64_t, Sp<Segment>> segments {};
+    Sp<Segment> head {};
+    int batchDepth {0};
+    bool dirty {false};
+
+    std::map<Id, Entry> values {};
+    std::map<Id, std::map<PeerKey, Entry>> peers {};
+    // the non-persistent records by their timestamps, the oldest expire first
+    std::set<std::pair<uint64_t, Id>> valueAges {};
+    std::set<PeerAge> peerAges {};
+
+    mutable std::recursive_mutex mutex {};
+    std::mutex compacting {};
+
+    bool running {false};
+    std::thread thread {};
+    std::mutex threadMutex {};
+    std::condition_variable stopping {};
+
+    Sp<Logger> log {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
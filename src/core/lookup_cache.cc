@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "utils/time.h"
+#include "data_storage.h"
+#include "lookup_cache.h"
+
+namespace elastos {
+namespace carrier {
+
+std::optional<std::vector<Sp<NodeInfo>>> LookupCache::getNode(const Id& id, LookupOption option) {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto entry = lookup({Kind::NODE, id}, option);
+    if (entry == nullptr)
+        return std::nullopt;
+
+    return std::get<std::vector<Sp<NodeInfo>>>(entry->result);
+}
+
+std::optional<Sp<Value>> LookupCache::getValue(const Id& id, LookupOption option) {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto entry = lookup({Kind::VALUE, id}, option);
+    if (entry == nullptr)
+        return std::nullopt;
+
+    return std::get<Sp<Value>>(entry->result);
+}
+
+std::optional<std::vector<PeerInfo>> LookupCache::getPeer(const Id& id, int expected, LookupOption option) {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto entry = find({Kind::PEER, id});
+    if (entry == nullptr || entry->option < option) {
+        misses++;
+        return std::nullopt;
+    }
+
+    const auto& peers = std::get<std::vector<PeerInfo>>(entry->result);
+    if (!peers.empty() && expected > 0 && peers.size() < (size_t)expected) {
+        misses++;
+        return std::nullopt;
+    }
+
+    hits++;
+    return peers;
+}
+
+void LookupCache::putNode(const Id& id, const std::vector<Sp<NodeInfo>>& nodes, LookupOption option) {
+    size_t size = nodes.size() * (sizeof(NodeInfo) + sizeof(Sp<NodeInfo>));
+
+    std::lock_guard<std::mutex> lk(mutex);
+    put({Kind::NODE, id}, nodes, option, !nodes.empty(), size);
+}
+
+void LookupCache::putValue(const Id& id, const Sp<Value>& value, LookupOption option) {
+    size_t size = value ? RecordSize::recordBytes(*value) : 0;
+
+    std::lock_guard<std::mutex> lk(mutex);
+    auto entry = find({Kind::VALUE, id});
+    if (entry != nullptr) {
+        auto cached = std::get<Sp<Value>>(entry->result);
+        if (cached != nullptr) {
+            if (value == nullptr)
+                return;
+            if (cached->isMutable() && cached->getSequenceNumber() > value->getSequenceNumber())
+                return;
+        }
+    }
+
+    put({Kind::VALUE, id}, value, option, value != nullptr, size);
+}
+
+void LookupCache::putPeer(const Id& id, const std::vector<PeerInfo>& peers, LookupOption option) {
+    size_t size = 0;
+    for (const auto& peer : peers)
+        size += RecordSize::recordBytes(peer);
+
+    std::lock_guard<std::mutex> lk(mutex);
+    put({Kind::PEER, id}, peers, option, !peers.empty(), size);
+}
+
+void LookupCache::removeValue(const Id& id) {
+    std::lock_guard<std::mutex> lk(mutex);
+    remove({Kind::VALUE, id});
+}
+
+void LookupCache::removePeer(const Id& id) {
+    std::lock_guard<std::mutex> lk(mutex);
+    remove({Kind::PEER, id});
+}
+
+void LookupCache::clear() {
+    std::lock_guard<std::mutex> lk(mutex);
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+LookupCache::Entry* LookupCache::find(const Key& key) {
+    auto it = index.find(key);
+    if (it == index.end())
+        return nullptr;
+
+    if (it->second->expiration <= currentTimeMillis()) {
+        bytes -= it->second->bytes;
+        entries.erase(it->second);
+        index.erase(it);
+        return nullptr;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    return &*it->second;
+}
+
+LookupCache::Entry* LookupCache::lookup(const Key& key, LookupOption option) {
+    auto entry = find(key);
+    if (entry == nullptr || entry->option < option) {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    return entry;
+}
+
+void LookupCache::put(const Key& key, Result&& result, LookupOption option, bool positive, size_t size) {
+    size += RecordSize::OVERHEAD;
+    if (size > maxBytes)
+        return;
+
+    auto entry = find(key);
+    if (entry != nullptr && entry->option > option)
+        return;
+
+    remove(key);
+
+    // Evict the least recently used entries, the expired ones are evicted too as they get there
+    while (!entries.empty() && bytes + size > maxBytes) {
+        bytes -= entries.back().bytes;
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    auto ttl = positive ? positiveTTL : negativeTTL;
+    entries.push_front({key, std::move(result), option, size, currentTimeMillis() + ttl});
+    index[key] = entries.begin();
+    bytes += size;
+}
+
+void LookupCache::remove(const Key& key) {
+    auto it = index.find(key);
+    if (it == index.end())
+        return;
+
+    bytes -= it->second->bytes;
+    entries.erase(it->second);
+    index.erase(it);
+}
+
+}
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <variant>
+#include <vector>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/node_info.h"
+#include "carrier/peer_info.h"
+#include "carrier/lookup_option.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The in-memory cache of the recent user-level lookup results.
+ *
+ * Both the results that found something (positive) and that found nothing
+ * (negative) are cached, each with its own time-to-live counted from when
+ * the result was put. The cache is bounded by the estimated memory of the
+ * entries, the least recently used entries are evicted first.
+ *
+ * A get returns std::nullopt on miss, and an empty result (nullptr or an
+ * empty vector) on a negative hit.
+ *
+ * Every entry remembers the lookup option it came from, and only answers
+ * the lookups with the same or a weaker option: an ARBITRARY result may be
+ * a local one and never answers an OPTIMISTIC or CONSERVATIVE lookup.
+ *
+ * Thread safe.
+ */
+class LookupCache {
+public:
+    LookupCache(size_t maxBytes, uint64_t positiveTTL, uint64_t negativeTTL)
+        : maxBytes(maxBytes), positiveTTL(positiveTTL), negativeTTL(negativeTTL) {}
+
+    std::optional<std::vector<Sp<NodeInfo>>> getNode(const Id& id,
+            LookupOption option = LookupOption::CONSERVATIVE);
+    std::optional<Sp<Value>> getValue(const Id& id, LookupOption option = LookupOption::CONSERVATIVE);
+    // hits only if it holds the expected number of peers, or it is negative
+    std::optional<std::vector<PeerInfo>> getPeer(const Id& id, int expected,
+            LookupOption option = LookupOption::CONSERVATIVE);
+
+    // a result never replaces an alive one from a stronger lookup option
+    void putNode(const Id& id, const std::vector<Sp<NodeInfo>>& nodes,
+            LookupOption option = LookupOption::CONSERVATIVE);
+    // a mutable value never replaces the cached one with a higher sequence number,
+    // and a negative result never replaces an alive positive one
+    void putValue(const Id& id, const Sp<Value>& value, LookupOption option = LookupOption::CONSERVATIVE);
+    void putPeer(const Id& id, const std::vector<PeerInfo>& peers,
+            LookupOption option = LookupOption::CONSERVATIVE);
+
+    void removeValue(const Id& id);
+    void removePeer(const Id& id);
+
+    void clear();
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        return entries.size();
+    }
+
+    size_t getBytes() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        return bytes;
+    }
+
+    uint64_t getHits() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        return hits;
+    }
+
+    uint64_t getMisses() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        return misses;
+    }
+
+private:
+    enum class Kind { NODE, VALUE, PEER };
+    using Key = std::pair<Kind, Id>;
+    using Result = std::variant<std::vector<Sp<NodeInfo>>, Sp<Value>, std::vector<PeerInfo>>;
+
+    struct Entry {
+        Key key;
+        Result result;
+        LookupOption option;
+        size_t bytes;
+        uint64_t expiration;
+    };
+
+    // the entry if alive, refreshes its recency
+    Entry* find(const Key& key);
+    // the entry if alive and good enough for the option, counts the hit or miss
+    Entry* lookup(const Key& key, LookupOption option);
+    void put(const Key& key, Result&& result, LookupOption option, bool positive, size_t bytes);
+    void remove(const Key& key);
+
+    size_t maxBytes;
+    uint64_t positiveTTL;
+    uint64_t negativeTTL;
+
+    size_t bytes {0};
+    uint64_t hits {0};
+    uint64_t misses {0};
+
+    std::list<Entry> entries {};
+    std::map<Key, std::list<Entry>::iterator> index {};
+
+    mutable std::mutex mutex {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <map>
+#include <tuple>
+#include <vector>
+#include <future>
+#include <functional>
+#include <mutex>
+#include <atomic>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/node_info.h"
+#include "carrier/peer_info.h"
+#include "carrier/lookup_option.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * Single-flight for the user-level lookups: the concurrent lookups of the
+ * same target with the same parameters (expected count and lookup option)
+ * attach to the one in flight, and all of them get its result.
+ *
+ * A lookup is started by the first caller, and detached as soon as it
+ * completes, so the later calls start a fresh one.
+ */
+class LookupCoalescer {
+public:
+    template <typename Result>
+    using Lookup = std::function<void(std::function<void(Result)>)>;
+
+    std::future<std::vector<Sp<NodeInfo>>> findNode(const Id& id, LookupOption option,
+            Lookup<std::vector<Sp<NodeInfo>>> lookup) {
+        return nodeLookups.join({id, 0, option}, lookup, coalesced);
+    }
+
+    std::future<Sp<Value>> findValue(const Id& id, LookupOption option, Lookup<Sp<Value>> lookup) {
+        return valueLookups.join({id, 0, option}, lookup, coalesced);
+    }
+
+    std::future<std::vector<PeerInfo>> findPeer(const Id& id, int expected, LookupOption option,
+            Lookup<std::vector<PeerInfo>> lookup) {
+        return peerLookups.join({id, expected, option}, lookup, coalesced);
+    }
+
+    // number of the lookups served by another one in flight
+    uint64_t getCoalesced() const {
+        return coalesced;
+    }
+
+private:
+    using Key = std::tuple<Id, int, LookupOption>;
+
+    template <typename Result>
+    class Flights {
+    public:
+        std::future<Result> join(const Key& key, const Lookup<Result>& lookup, std::atomic<uint64_t>& coalesced) {
+            auto promise = std::make_shared<std::promise<Result>>();
+            auto future = promise->get_future();
+
+            Sp<Flight> flight {};
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                auto it = flights.find(key);
+                if (it != flights.end()) {
+                    it->second->waiters.push_back(promise);
+                    coalesced++;
+                    return future;
+                }
+
+                flight = std::make_shared<Flight>();
+                flight->waiters.push_back(promise);
+                flights.emplace(key, flight);
+            }
+
+            try {
+                lookup([=](Result result) {
+                    for (auto& waiter : land(key, flight))
+                        waiter->set_value(result);
+                });
+            } catch (...) {
+                for (auto& waiter : land(key, flight))
+                    waiter->set_exception(std::current_exception());
+            }
+
+            return future;
+        }
+
+    private:
+        struct Flight {
+            std::vector<Sp<std::promise<Result>>> waiters {};
+        };
+
+        // Detach the flight, the waiters are returned only once
+        std::vector<Sp<std::promise<Result>>> land(const Key& key, const Sp<Flight>& flight) {
+            std::vector<Sp<std::promise<Result>>> waiters {};
+
+            std::lock_guard<std::mutex> lk(mutex);
+            auto it = flights.find(key);
+            if (it != flights.end() && it->second == flight)
+                flights.erase(it);
+
+            waiters.swap(flight->waiters);
+            return waiters;
+        }
+
+        std::map<Key, Sp<Flight>> flights {};
+        std::mutex mutex {};
+    };
+
+    Flights<std::vector<Sp<NodeInfo>>> nodeLookups {};
+    Flights<Sp<Value>> valueLookups {};
+    Flights<std::vector<PeerInfo>> peerLookups {};
+
+    std::atomic<uint64_t> coalesced {0};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
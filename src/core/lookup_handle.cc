@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "carrier/lookup_handle.h"
+
+namespace elastos {
+namespace carrier {
+
+void LookupHandle::cancel() {
+    if (canceled.exchange(true))
+        return;
+
+    std::vector<std::function<void()>> toCancel {};
+    {
+        std::unique_lock<std::mutex> lk(lock);
+        toCancel.swap(cancelers);
+    }
+
+    for (auto& canceler : toCancel)
+        canceler();
+}
+
+bool LookupHandle::isDone() const {
+    std::unique_lock<std::mutex> lk(lock);
+    return done;
+}
+
+void LookupHandle::wait() {
+    std::unique_lock<std::mutex> lk(lock);
+    cv.wait(lk, [this] { return done; });
+}
+
+bool LookupHandle::waitFor(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lk(lock);
+    return cv.wait_for(lk, timeout, [this] { return done; });
+}
+
+void LookupHandle::addCanceler(std::function<void()> canceler) {
+    {
+        std::unique_lock<std::mutex> lk(lock);
+        if (!canceled && !done) {
+            cancelers.push_back(std::move(canceler));
+            return;
+        }
+    }
+
+    if (canceled)
+        canceler();
+}
+
+void LookupHandle::complete() {
+    {
+        std::unique_lock<std::mutex> lk(lock);
+        done = true;
+        // the cancelers hold the tasks, which hold the handle
+        cancelers.clear();
+    }
+
+    cv.notify_all();
+}
+
+}
+}
@@ -0,0 +1,536 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "crypto/random.h"
+#include "utils/time.h"
+#include "constants.h"
+#include "memory_storage.h"
+
+namespace elastos {
+namespace carrier {
+
+MemoryStorage::MemoryStorage(size_t maxBytes) : maxBytes(maxBytes) {
+    // a round of the wheel covers the longest lifetime, so a slot only holds the deadlines of one round
+    auto maxAge = std::max(Constants::MAX_VALUE_AGE, Constants::MAX_PEER_AGE);
+    wheel.resize(maxAge / Constants::STORAGE_EXPIRE_WHEEL_TICK + 2);
+    wheelTick = currentTimeMillis() / Constants::STORAGE_EXPIRE_WHEEL_TICK;
+}
+
+Sp<DataStorage> MemoryStorage::open(size_t maxBytes, Scheduler& scheduler) {
+    auto storage = std::make_shared<MemoryStorage>(maxBytes);
+
+    scheduler.add([=]() {
+        while (storage->expire(Constants::STORAGE_EXPIRE_CHUNK) > 0);
+    }, Constants::STORAGE_EXPIRE_WHEEL_TICK, Constants::STORAGE_EXPIRE_WHEEL_TICK);
+
+    return std::static_pointer_cast<DataStorage>(storage);
+}
+
+void MemoryStorage::schedule(DeadlineRef& ref, bool peer, const Id& id, const PeerKey& key, uint64_t expiration) {
+    unschedule(ref);
+
+    ref.slot = (expiration / Constants::STORAGE_EXPIRE_WHEEL_TICK) % wheel.size();
+    auto& slot = wheel[ref.slot];
+    ref.it = slot.insert(slot.end(), {peer, id, key, expiration});
+    ref.scheduled = true;
+}
+
+void MemoryStorage::unschedule(DeadlineRef& ref) {
+    if (!ref.scheduled)
+        return;
+
+    wheel[ref.slot].erase(ref.it);
+    ref.scheduled = false;
+}
+
+bool MemoryStorage::drop(Deadline deadline) {
+    if (!deadline.peer) {
+        auto it = values.find(deadline.id);
+        if (it == values.end())
+            return false;
+
+        unschedule(it->second.deadline);
+        bytes -= it->second.bytes;
+        values.erase(it);
+        return true;
+    }
+
+    auto it = peers.find(deadline.id);
+    if (it == peers.end())
+        return false;
+
+    auto& set = it->second;
+    auto index = set.index.find(deadline.key);
+    if (index == set.index.end())
+        return false;
+
+    removePeerRecord(set, index->second);
+    if (set.records.empty())
+        peers.erase(it);
+
+    return true;
+}
+
+void MemoryStorage::reserve(size_t size) {
+    // evict the records that expire first
+    for (size_t i = 0; i < wheel.size() && bytes + size > maxBytes; i++) {
+        auto& slot = wheel[(wheelTick + i) % wheel.size()];
+        while (!slot.empty() && bytes + size > maxBytes) {
+            if (!drop(slot.front()))
+                slot.pop_front();
+        }
+    }
+
+    if (bytes + size > maxBytes)
+        throw std::runtime_error("The memory storage is full.");
+}
+
+void MemoryStorage::removePeerRecord(PeerSet& set, size_t index) {
+    auto& record = set.records[index];
+    unschedule(record.deadline);
+    bytes -= record.bytes;
+    set.index.erase({record.peer.getNodeId(), record.peer.getOrigin()});
+
+    if (index != set.records.size() - 1) {
+        record = std::move(set.records.back());
+        set.index[{record.peer.getNodeId(), record.peer.getOrigin()}] = index;
+    }
+    set.records.pop_back();
+}
+
+Sp<Value> MemoryStorage::getValue(const Id& valueId) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = values.find(valueId);
+    if (it == values.end() || it->second.timestamp < currentTimeMillis() - Constants::MAX_VALUE_AGE)
+        return nullptr;
+
+    return it->second.value;
+}
+
+bool MemoryStorage::removeValue(const Id& valueId) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = values.find(valueId);
+    if (it == values.end())
+        return false;
+
+    unschedule(it->second.deadline);
+    bytes -= it->second.bytes;
+    values.erase(it);
+    return true;
+}
+
+Sp<Value> MemoryStorage::putValue(const Value& value, int expectedSeq, bool persistent, bool updateLastAnnounce) {
+    if (value.isMutable() && !value.isValid())
+        throw std::invalid_argument("Value signature validation failed");
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto now = currentTimeMillis();
+    auto id = value.getId();
+    auto size = RecordSize::storedBytes(value);
+
+    Sp<Value> old {};
+    auto it = values.find(id);
+    if (it != values.end() && it->second.timestamp >= now - Constants::MAX_VALUE_AGE)
+        old = it->second.value;
+
+    checkReplace(old, value, expectedSeq);
+
+    reserve(it == values.end() ? size : size - std::min(size, it->second.bytes));
+
+    // like the SQLite upsert, a stored value keeps its persistence and last announce
+    it = values.find(id);
+    if (it != values.end()) {
+        bytes = bytes - it->second.bytes + size;
+        it->second.value = std::make_shared<Value>(value);
+        it->second.timestamp = now;
+        it->second.bytes = size;
+    } else {
+        it = values.emplace(id, ValueRecord {std::make_shared<Value>(value), persistent, now,
+                updateLastAnnounce ? now : 0, size}).first;
+        bytes += size;
+    }
+
+    if (!it->second.persistent)
+        schedule(it->second.deadline, false, id, {}, now + Constants::MAX_VALUE_AGE);
+
+    return old;
+}
+
+void MemoryStorage::updateValueLastAnnounce(const Id& valueId) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = values.find(valueId);
+    if (it == values.end())
+        return;
+
+    auto now = currentTimeMillis();
+    it->second.timestamp = now;
+    it->second.announced = now;
+    if (!it->second.persistent)
+        schedule(it->second.deadline, false, valueId, {}, now + Constants::MAX_VALUE_AGE);
+}
+
+std::vector<Id> MemoryStorage::scanValueIds(ScanCursor& cursor, size_t limit) {
+    std::vector<Id> ids {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    for (const auto* record : scanValueRecords(cursor, limit, [&](const ValueRecord& record) {
+        return record.timestamp >= when;
+    }))
+        ids.push_back(record->first);
+
+    advance(cursor, ids, limit);
+    return ids;
+}
+
+std::vector<Value> MemoryStorage::scanValues(ScanCursor& cursor, size_t limit) {
+    std::vector<Value> result {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    for (const auto* record : scanValueRecords(cursor, limit, [&](const ValueRecord& record) {
+        return record.timestamp >= when;
+    }))
+        result.push_back(*record->second.value);
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<Value> MemoryStorage::scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    std::vector<Value> result {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto* record : scanValueRecords(cursor, limit, [&](const ValueRecord& record) {
+        return record.persistent && record.announced <= lastAnnounceBefore;
+    }))
+        result.push_back(*record->second.value);
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<const std::pair<const Id, MemoryStorage::ValueRecord>*> MemoryStorage::scanValueRecords(
+        const ScanCursor& cursor, size_t limit, const std::function<bool(const ValueRecord&)>& filter) {
+    std::vector<const std::pair<const Id, ValueRecord>*> result {};
+
+    auto last = cursor.prefix.last();
+    auto it = cursor.started ? values.upper_bound(cursor.id) : values.lower_bound(cursor.prefix.first());
+    for (; it != values.end() && result.size() < limit && !(last < it->first); ++it) {
+        if (filter(it->second))
+            result.push_back(&*it);
+    }
+
+    return result;
+}
+
+std::vector<PeerInfo> MemoryStorage::getPeer(const Id& peerId, int maxPeers) {
+    std::vector<PeerInfo> result {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return result;
+
+    const auto& records = it->second.records;
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    if (maxPeers <= 0 || (size_t)maxPeers >= records.size()) {
+        for (const auto& record : records) {
+            if (record.timestamp >= when)
+                result.push_back(record.peer);
+        }
+        return result;
+    }
+
+    // Floyd's sampling of k distinct records in O(k), the expired ones not
+    // removed by the wheel yet are skipped, so it may return a few less
+    std::unordered_set<size_t> picked {};
+    picked.reserve(maxPeers);
+    result.reserve(maxPeers);
+    for (size_t i = records.size() - maxPeers; i < records.size(); i++) {
+        size_t index = Random::uint32(i + 1);
+        if (!picked.insert(index).second) {
+            index = i;
+            picked.insert(index);
+        }
+
+        if (records[index].timestamp >= when)
+            result.push_back(records[index].peer);
+    }
+
+    return result;
+}
+
+Sp<PeerInfo> MemoryStorage::getPeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return nullptr;
+
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    for (const auto& record : it->second.records) {
+        if (record.peer.getOrigin() == origin && record.timestamp >= when)
+            return std::make_shared<PeerInfo>(record.peer);
+    }
+
+    return nullptr;
+}
+
+bool MemoryStorage::removePeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return false;
+
+    // backwards, the record moved into a removed slot is already checked
+    bool removed = false;
+    auto& set = it->second;
+    for (size_t i = set.records.size(); i-- > 0;) {
+        if (set.records[i].peer.getOrigin() == origin) {
+            removePeerRecord(set, i);
+            removed = true;
+        }
+    }
+
+    if (set.records.empty())
+        peers.erase(it);
+
+    return removed;
+}
+
+void MemoryStorage::upsertPeer(const PeerInfo& peer, bool persistent, uint64_t now, uint64_t announced) {
+    auto size = RecordSize::storedBytes(peer);
+    PeerKey key {peer.getNodeId(), peer.getOrigin()};
+
+    size_t growth = size;
+    auto it = peers.find(peer.getId());
+    if (it != peers.end()) {
+        auto index = it->second.index.find(key);
+        if (index != it->second.index.end())
+            growth = size - std::min(size, it->second.records[index->second].bytes);
+    }
+
+    reserve(growth);
+
+    auto& set = peers[peer.getId()];
+    auto index = set.index.find(key);
+    if (index != set.index.end()) {
+        auto& record = set.records[index->second];
+        bytes = bytes - record.bytes + size;
+        record = {peer, persistent, now, announced, size, record.deadline};
+    } else {
+        set.index.emplace(key, set.records.size());
+        set.records.push_back({peer, persistent, now, announced, size});
+        bytes += size;
+    }
+
+    auto& record = set.records[set.index[key]];
+    if (!persistent)
+        schedule(record.deadline, true, peer.getId(), key, now + Constants::MAX_PEER_AGE);
+    else
+        unschedule(record.deadline);
+}
+
+void MemoryStorage::putPeer(const std::vector<PeerInfo>& peers) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto now = currentTimeMillis();
+    for (const auto& peer : peers)
+        upsertPeer(peer, false, now, 0);
+}
+
+void MemoryStorage::putPeer(const PeerInfo& peer, bool persistent, bool updateLastAnnounce) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto now = currentTimeMillis();
+    upsertPeer(peer, persistent, now, updateLastAnnounce ? now : 0);
+}
+
+void MemoryStorage::updatePeerLastAnnounce(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = peers.find(peerId);
+    if (it == peers.end())
+        return;
+
+    auto now = currentTimeMillis();
+    for (auto& record : it->second.records) {
+        if (record.peer.getOrigin() != origin)
+            continue;
+
+        record.timestamp = now;
+        record.announced = now;
+        if (!record.persistent)
+            schedule(record.deadline, true, peerId, {record.peer.getNodeId(), origin}, now + Constants::MAX_PEER_AGE);
+    }
+}
+
+std::vector<Id> MemoryStorage::scanPeerIds(ScanCursor& cursor, size_t limit) {
+    std::vector<Id> ids {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    auto last = cursor.prefix.last();
+    auto it = cursor.started ? peers.upper_bound(cursor.id) : peers.lower_bound(cursor.prefix.first());
+    for (; it != peers.end() && ids.size() < limit && !(last < it->first); ++it) {
+        const auto& records = it->second.records;
+        auto live = std::any_of(records.begin(), records.end(), [&](const PeerRecord& record) {
+            return record.timestamp >= when;
+        });
+        if (live)
+            ids.push_back(it->first);
+    }
+
+    advance(cursor, ids, limit);
+    return ids;
+}
+
+std::vector<PeerInfo> MemoryStorage::scanPeers(ScanCursor& cursor, size_t limit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    auto result = scanPeerRecords(cursor, limit, [&](const PeerRecord& record) {
+        return record.timestamp >= when;
+    });
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<PeerInfo> MemoryStorage::scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto result = scanPeerRecords(cursor, limit, [&](const PeerRecord& record) {
+        return record.persistent && record.announced <= lastAnnounceBefore;
+    });
+
+    advance(cursor, result, limit);
+    return result;
+}
+
+std::vector<PeerInfo> MemoryStorage::scanPeerRecords(const ScanCursor& cursor, size_t limit,
+        const std::function<bool(const PeerRecord&)>& filter) {
+    std::vector<PeerInfo> result {};
+
+    PeerKey after {cursor.nodeId, cursor.origin};
+    auto last = cursor.prefix.last();
+    auto it = cursor.started ? peers.lower_bound(cursor.id) : peers.lower_bound(cursor.prefix.first());
+    for (; it != peers.end() && result.size() < limit && !(last < it->first); ++it) {
+        // the records of an id are not ordered, sort the matched ones by node id and origin
+        std::vector<std::pair<PeerKey, const PeerInfo*>> matched {};
+        for (const auto& record : it->second.records) {
+            PeerKey key {record.peer.getNodeId(), record.peer.getOrigin()};
+            if (cursor.started && it->first == cursor.id && !(after < key))
+                continue;
+            if (filter(record))
+                matched.emplace_back(key, &record.peer);
+        }
+
+        std::sort(matched.begin(), matched.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+
+        for (size_t i = 0; i < matched.size() && result.size() < limit; i++)
+            result.push_back(*matched[i].second);
+    }
+
+    return result;
+}
+
+PrefixStats MemoryStorage::getPrefixStats(const Prefix& prefix) {
+    PrefixStats stats {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto first = prefix.first();
+    auto last = prefix.last();
+
+    auto when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    for (auto it = values.lower_bound(first); it != values.end() && !(last < it->first); ++it) {
+        if (it->second.timestamp >= when) {
+            stats.values++;
+            stats.valueBytes += it->second.bytes;
+        }
+    }
+
+    when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    for (auto it = peers.lower_bound(first); it != peers.end() && !(last < it->first); ++it) {
+        for (const auto& record : it->second.records) {
+            if (record.timestamp >= when) {
+                stats.peers++;
+                stats.peerBytes += record.bytes;
+            }
+        }
+    }
+
+    return stats;
+}
+
+size_t MemoryStorage::expire(size_t maxEntries) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto now = currentTimeMillis();
+    auto nowTick = now / Constants::STORAGE_EXPIRE_WHEEL_TICK;
+    size_t removed = 0;
+
+    // the passed slots only, the current one is still filling
+    while (wheelTick < nowTick && removed < maxEntries) {
+        auto& slot = wheel[wheelTick % wheel.size()];
+        for (auto it = slot.begin(); it != slot.end() && removed < maxEntries;) {
+            // a deadline only goes away with its record
+            auto next = std::next(it);
+            if (it->expiration <= now) {
+                if (drop(*it))
+                    removed++;
+                else
+                    slot.erase(it);
+            }
+            it = next;
+        }
+
+        // done with the slot, unless stopped by the limit
+        if (removed < maxEntries)
+            wheelTick++;
+    }
+
+    return removed;
+}
+
+void MemoryStorage::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    values.clear();
+    peers.clear();
+    for (auto& slot : wheel)
+        slot.clear();
+    bytes = 0;
+}
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/peer_info.h"
+#include "data_storage.h"
+#include "scheduler.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * Keeps the values and peers in memory only, for the nodes that need no
+ * durability.
+ *
+ * The values and peers are kept in the id order for the paged scans, the
+ * peers of an id are hashed by node id and origin, and also kept in a vector
+ * so a random pick of k of them takes O(k). The non-persistent records are
+ * expired by a time wheel with a slot per STORAGE_EXPIRE_WHEEL_TICK, instead
+ * of a scan. Every such record has exactly one deadline in the wheel, moved
+ * in place when the record is refreshed.
+ *
+ * The memory of the records is bounded, when a write would go over the
+ * budget the non-persistent records that expire first are evicted.
+ *
+ * Thread safe.
+ */
+class MemoryStorage final : public DataStorage {
+public:
+    MemoryStorage(size_t maxBytes);
+
+    // expires the storage periodically on the scheduler
+    static Sp<DataStorage> open(size_t maxBytes, Scheduler& scheduler);
+
+    Sp<Value> getValue(const Id& valueId) override;
+    bool removeValue(const Id& valueId) override;
+    Sp<Value> putValue(const Value& value, int expectedSeq = -1, bool persistent = false, bool updateLastAnnounce = false) override;
+    using DataStorage::putValue;
+    void updateValueLastAnnounce(const Id& valueId) override;
+    std::vector<Id> scanValueIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanValues(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+
+    std::vector<PeerInfo> getPeer(const Id& peerId, int maxPeers) override;
+    Sp<PeerInfo> getPeer(const Id& peerId, const Id& origin) override;
+    bool removePeer(const Id& peerId, const Id& origin) override;
+    void putPeer(const std::vector<PeerInfo>& peers) override;
+    void putPeer(const PeerInfo& peer, bool persistent = false, bool updateLastAnnounce = false) override;
+    void updatePeerLastAnnounce(const Id& peerId, const Id& origin) override;
+    std::vector<Id> scanPeerIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPeers(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+    PrefixStats getPrefixStats(const Prefix& prefix) override;
+
+    size_t expire(size_t maxEntries) override;
+    void close() override;
+
+    // the memory in bytes taken by the records
+    size_t getBytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return bytes;
+    }
+
+    // the deadlines in the expiration wheel
+    size_t getDeadlines() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t total = 0;
+        for (const auto& slot : wheel)
+            total += slot.size();
+        return total;
+    }
+
+private:
+    // by node id and origin
+    using PeerKey = std::pair<Id, Id>;
+
+    // a non-persistent record to expire at the time
+    struct Deadline {
+        bool peer;
+        Id id;
+        PeerKey key;
+        uint64_t expiration;
+    };
+
+    // the deadline of a record in the wheel
+    struct DeadlineRef {
+        bool scheduled {false};
+        size_t slot {0};
+        std::list<Deadline>::iterator it {};
+    };
+
+    struct ValueRecord {
+        Sp<Value> value;
+        bool persistent;
+        uint64_t timestamp;
+        uint64_t announced;
+        size_t bytes;
+        DeadlineRef deadline {};
+    };
+
+    struct PeerRecord {
+        PeerInfo peer;
+        bool persistent;
+        uint64_t timestamp;
+        uint64_t announced;
+        size_t bytes;
+        DeadlineRef deadline {};
+    };
+
+    struct PeerKeyHash {
+        size_t operator()(const PeerKey& key) const noexcept {
+            std::hash<Id> hash;
+            return hash(key.first) ^ (hash(key.second) * 31);
+        }
+    };
+
+    struct PeerSet {
+        std::vector<PeerRecord> records {};
+        std::unordered_map<PeerKey, size_t, PeerKeyHash> index {};
+    };
+
+    // from the cursor within its prefix, until limit records pass the filter
+    std::vector<const std::pair<const Id, ValueRecord>*> scanValueRecords(const ScanCursor& cursor, size_t limit,
+            const std::function<bool(const ValueRecord&)>& filter);
+    std::vector<PeerInfo> scanPeerRecords(const ScanCursor& cursor, size_t limit,
+            const std::function<bool(const PeerRecord&)>& filter);
+
+    void upsertPeer(const PeerInfo& peer, bool persistent, uint64_t now, uint64_t announced);
+    void removePeerRecord(PeerSet& set, size_t index);
+    // replaces the deadline of the record, if any
+    void schedule(DeadlineRef& ref, bool peer, const Id& id, const PeerKey& key, uint64_t expiration);
+    void unschedule(DeadlineRef& ref);
+    // removes the record of the deadline and the deadline, false if there is no such record
+    bool drop(Deadline deadline);
+    void reserve(size_t size);
+
+    const size_t maxBytes;
+    size_t bytes {0};
+
+    std::map<Id, ValueRecord> values {};
+    std::map<Id, PeerSet> peers {};
+
+    std::vector<std::list<Deadline>> wheel;
+    uint64_t wheelTick;
+
+    mutable std::mutex mutex {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -45,6 +45,12 @@ void AnnouncePeerRequest::serializeInternal(nlohmann::json& root) const {
     if (!alternativeURL.empty())
         object[Message::KEY_REQ_ALT] = alternativeURL;
 
+    if (origin.has_value())
+        object[Message::KEY_REQ_ORIGIN] = origin.value();
+
+    if (ttl > 0)
+        object[Message::KEY_REQ_TTL] = ttl;
+
     Message::serializeInternal(root);
     root[getKeyString()] = object;
 }
@@ -66,6 +72,10 @@ void AnnouncePeerRequest::parse(const std::string& fieldName, nlohmann::json& ob
             signature = value.get_binary();
         else if(key == Message::KEY_REQ_TOKEN)
             value.get_to(token);
+        else if(key == Message::KEY_REQ_ORIGIN)
+            value.get_to(origin);
+        else if(key == Message::KEY_REQ_TTL)
+            value.get_to(ttl);
         else
             throw MessageError("Invalid message with unkown key: " + key);
     }
@@ -75,6 +85,8 @@ int AnnouncePeerRequest::estimateSize() const {
     int size = 4 + 9 + 36 + 5 + 6 + Signature::BYTES;
     size += nodeId.has_value() ? 0 : 4 + Id::BYTES;
     size += alternativeURL.empty() ? 0 : 6 + strlen(alternativeURL.c_str());
+    size += origin.has_value() ? 4 + Id::BYTES : 0;
+    size += ttl > 0 ? 9 : 0;
     return Message::estimateSize() + size;
 }
 
@@ -86,6 +98,10 @@ void AnnouncePeerRequest::toString(std::stringstream& ss) const {
     ss << ",p:" << std::to_string(port);
     if (!alternativeURL.empty())
         ss << ",alt:" << alternativeURL;
+    if (origin.has_value())
+        ss << ",o:" << origin.value();
+    if (ttl > 0)
+        ss << ",ttl:" << std::to_string(ttl);
     ss << ",sig:" << Hex::encode(signature)
         << ",tok:" << std::to_string(token)
         << "}";
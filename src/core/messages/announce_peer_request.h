@@ -63,9 +63,35 @@ public:
         signature = peer.getSignature();
     }
 
+    /**
+     * A path cache announce carries a peer announced by another node, with
+     * its origin, and the lifetime (ms) of the copy. It is kept apart from
+     * the authoritative peers by the receiver.
+     */
+    void setCachedPeer(const PeerInfo& peer, int ttl) {
+        setPeer(peer);
+        nodeId = peer.getNodeId();
+        origin = peer.getOrigin();
+        this->ttl = ttl;
+    }
+
+    int getTTL() const {
+        return ttl;
+    }
+
+    bool isCache() const {
+        return ttl > 0;
+    }
+
+    // only a cache announce may carry an origin, the sender is the origin of the others
+    bool hasOrigin() const {
+        return origin.has_value();
+    }
+
     PeerInfo getPeer() {
         const Id& _nodeId = nodeId.has_value() ? nodeId.value() : getId();
-        return PeerInfo::of(peerId.blob(), {}, _nodeId.blob(), getId().blob(), port, alternativeURL, signature);
+        const Id& _origin = isCache() && origin.has_value() ? origin.value() : getId();
+        return PeerInfo::of(peerId.blob(), {}, _nodeId.blob(), _origin.blob(), port, alternativeURL, signature);
     }
 
     const Id& getTarget() const {
@@ -83,9 +109,11 @@ private:
     int token;
     Id peerId;
     std::optional<Id> nodeId {};
+    std::optional<Id> origin {};
     uint16_t port;
     std::string alternativeURL {};
     std::vector<uint8_t> signature {};
+    int ttl {0};
 };
 
 }
@@ -65,6 +65,9 @@ void StoreValueRequest::serializeInternal(nlohmann::json& root) const {
             object[Message::KEY_REQ_CAS] = expectedSequenceNumber;
     }
 
+    if (ttl > 0)
+        object[Message::KEY_REQ_TTL] = ttl;
+
     object[Message::KEY_REQ_VALUE] = nlohmann::json::binary_t {value};
 
     Message::serializeInternal(root);
@@ -90,6 +93,8 @@ void StoreValueRequest::parse(const std::string& fieldName, nlohmann::json& obje
             object.get_to(expectedSequenceNumber);
         } else if (key == Message::KEY_REQ_TOKEN) {
             object.get_to(token);
+        } else if (key == Message::KEY_REQ_TTL) {
+            object.get_to(ttl);
         } else if (key == Message::KEY_RES_VALUE) {
             value = object.get_binary();
         } else {
@@ -114,6 +119,9 @@ void StoreValueRequest::toString(std::stringstream& ss) const {
             ss << "\n    ExpectedSequenceNumber: " << std::to_string(expectedSequenceNumber);
     }
 
+    if (ttl > 0)
+        ss << "\n    TTL: " << std::to_string(ttl);
+
     ss << "\n    Token: " << std::to_string(token)
         << "\n    Value: " << Hex::encode(value->getData());
 }
@@ -135,8 +143,10 @@ void StoreValueRequest::toString(std::stringstream& ss) const {
         ss << ",";
     }
 
-    ss << "tok:" << std::to_string(token)
-        << ",v:" << Hex::encode(value)
+    ss << "tok:" << std::to_string(token);
+    if (ttl > 0)
+        ss << ",ttl:" << std::to_string(ttl);
+    ss << ",v:" << Hex::encode(value)
         << "}";
 }
 #endif
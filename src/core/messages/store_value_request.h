@@ -60,6 +60,22 @@ public:
         this->expectedSequenceNumber = expectedSequenceNumber;
     }
 
+    /**
+     * A path cache store carries the lifetime (ms) of the copy, it is kept
+     * apart from the authoritative values by the receiver.
+     */
+    int getTTL() const noexcept {
+        return ttl;
+    }
+
+    void setTTL(int ttl) noexcept {
+        this->ttl = ttl;
+    }
+
+    bool isCache() const noexcept {
+        return ttl > 0;
+    }
+
     void setValue(const Value& value);
     Value getValue() const;
 
@@ -76,7 +92,7 @@ public:
     }
 
     int estimateSize() const override {
-        return Message::estimateSize() + 208 + value.size();
+        return Message::estimateSize() + 208 + (ttl > 0 ? 9 : 0) + value.size();
     }
 
 protected:
@@ -92,6 +108,7 @@ private:
     std::optional<std::vector<uint8_t>> signature {};
     int sequenceNumber {-1};
     int expectedSequenceNumber {-1};
+    int ttl {0};
     std::vector<uint8_t> value;
 };
 
@@ -21,6 +21,9 @@
  */
 
 #include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 #include <chrono>
 #include <sys/stat.h>
 #include <exception>
@@ -32,8 +35,17 @@
 #include "carrier/node_status.h"
 #include "exceptions/state_error.h"
 #include "sqlite_storage.h"
+#include "write_behind_storage.h"
+#include "cached_storage.h"
+#include "memory_storage.h"
+#include "log_storage.h"
+#include "storage_quota.h"
+#include "path_cache.h"
 #include "crypto_cache.h"
 #include "dht.h"
+#include "lookup_coalescer.h"
+#include "lookup_cache.h"
+#include "announce_scheduler.h"
 
 namespace fs = std::filesystem;
 
@@ -126,10 +138,26 @@ void Node::setStatus(NodeStatus expected, NodeStatus newStatus) {
 
     auto old = status;
     status = newStatus;
-    if (!statusListeners.empty()) {
-        for (auto& listener: statusListeners)
-            listener.statusChanged(newStatus, old);
-    }
+
+    // Hold the lock until notified, so a removed listener is never called.
+    // The listeners may add or remove the listeners, iterate a copy.
+    std::lock_guard<std::recursive_mutex> lock(statusListenersLock);
+    auto listeners = statusListeners;
+    for (auto& listener: listeners)
+        listener->statusChanged(newStatus, old);
+}
+
+void Node::setReady() {
+    bool expected {false};
+    if (!ready.compare_exchange_strong(expected, true))
+        return;
+
+    log->info("Carrier node {} is ready", id.toString());
+
+    std::lock_guard<std::recursive_mutex> lock(statusListenersLock);
+    auto listeners = statusListeners;
+    for (auto& listener: listeners)
+        listener->ready();
 }
 
 Node::Node(std::shared_ptr<Configuration> _config): config(_config)
@@ -182,6 +210,17 @@ Node::Node(std::shared_ptr<Configuration> _config): config(_config)
     setupCryptoBoxesCache();
 
     tokenManager = std::make_shared<TokenManager>();
+    lookupCoalescer = std::make_shared<LookupCoalescer>();
+    if (config->getLookupCacheSize() > 0) {
+        int positiveTTL = config->getLookupCachePositiveTTL();
+        int negativeTTL = config->getLookupCacheNegativeTTL();
+        lookupCache = std::make_shared<LookupCache>(config->getLookupCacheSize(),
+                positiveTTL > 0 ? positiveTTL : Constants::LOOKUP_CACHE_POSITIVE_TTL,
+                negativeTTL > 0 ? negativeTTL : Constants::LOOKUP_CACHE_NEGATIVE_TTL);
+    }
+    pathCache = std::make_shared<PathCache>(Constants::PATH_CACHE_SIZE);
+    // leave the rest of the active tasks to the user-level lookups
+    announceScheduler = std::make_shared<AnnounceScheduler>(Constants::MAX_ACTIVE_TASKS - Constants::USER_TASKS_RESERVED);
     defaultLookupOption = LookupOption::CONSERVATIVE;
     status = NodeStatus::Stopped;
 }
@@ -229,7 +268,45 @@ void Node::start() {
     dbPath += PATH_SEP;
     dbPath += "node.db";
 
-    storage = SqliteStorage::open(dbPath, scheduler);
+    Sp<WriteBehindStorage> writeBehind {};
+    if (config->getMemoryStorageSize() > 0) {
+        log->info("Keep the values and peers in memory only, up to {} bytes", config->getMemoryStorageSize());
+        storage = MemoryStorage::open(config->getMemoryStorageSize(), scheduler);
+    } else if (config->useLogStorage()) {
+        auto logPath = storagePath + PATH_SEP + "node.log";
+        log->info("Keep the values and peers in the storage log {}", logPath);
+        auto logStorage = std::make_shared<LogStorage>(logPath);
+        // the appends are batched by the write-behind thread too, the log serves the reads
+        writeBehind = std::make_shared<WriteBehindStorage>(logStorage, logStorage);
+    } else {
+        // the writes are committed on the write-behind thread, the reads the overlay
+        // misses and the scans still go to SQLite on the calling thread, through the reader
+        auto mmapSize = config->getStorageMmapSize();
+        auto cacheSize = config->getStorageCacheSize();
+        writeBehind = std::make_shared<WriteBehindStorage>(SqliteStorage::open(dbPath, mmapSize, cacheSize),
+                SqliteStorage::open(dbPath, mmapSize, cacheSize));
+    }
+
+    if (writeBehind) {
+        // the hot values and peers are served from memory, until the write-behind thread expires some
+        auto cached = std::make_shared<CachedStorage>(writeBehind, Constants::STORAGE_RECORD_CACHE_SIZE,
+                Constants::STORAGE_RECORD_CACHE_TTL);
+        std::weak_ptr<CachedStorage> weakCached = cached;
+        writeBehind->setExpireListener([weakCached]() {
+            if (auto cached = weakCached.lock())
+                cached->invalidateAll();
+        });
+        storage = cached;
+    }
+
+    auto budget = config->getStorageBudget();
+    auto originQuota = config->getStorageOriginQuota();
+    auto prefixQuota = config->getStoragePrefixQuota();
+    storageQuota = std::make_shared<StorageQuota>(storage,
+            budget > 0 ? budget : Constants::STORAGE_BUDGET,
+            originQuota > 0 ? originQuota : Constants::STORAGE_ORIGIN_QUOTA,
+            prefixQuota > 0 ? prefixQuota : Constants::STORAGE_PREFIX_QUOTA);
+    storageQuota->recover();
 
     //Start crypto context loading cache check expriration
     scheduler.add([&]() {
@@ -242,12 +319,14 @@ void Node::start() {
     if (dht4 != nullptr) {
         dht4->setServer(server);
         dht4->setTokenManager(tokenManager);
+        dht4->setReadyListener([&]() { setReady(); });
         dht4->start(nodes);
         numDHTs++;
     }
     if (dht6 != nullptr) {
         dht6->setServer(server);
         dht6->setTokenManager(tokenManager);
+        dht6->setReadyListener([&]() { setReady(); });
         dht6->start(nodes);
         numDHTs++;
     }
@@ -256,6 +335,11 @@ void Node::start() {
         persistentAnnounce();
     }, 60000, Constants::RE_ANNOUNCE_INTERVAL);
     scheduledActions.emplace_back(job);
+
+    job = scheduler.add([&]() {
+        announceScheduler->dispatch();
+    }, Constants::ANNOUNCE_DISPATCH_INTERVAL, Constants::ANNOUNCE_DISPATCH_INTERVAL);
+    scheduledActions.emplace_back(job);
 }
 
 void Node::stop() {
@@ -269,6 +353,7 @@ void Node::stop() {
         job->cancel();
     }
     scheduledActions.clear();
+    announceScheduler->clear();
 
     if (server != nullptr) {
         server->stop();
@@ -285,6 +370,7 @@ void Node::stop() {
     }
 
     try {
+        storageQuota.reset();
         if (storage != nullptr) {
             storage->close();
             storage.reset();
@@ -293,33 +379,139 @@ void Node::stop() {
         log->error("Close data storage failed: {}", e.what());
     }
 
+    ready = false;
     setStatus(NodeStatus::Running, NodeStatus::Stopped);
     log->info("Carrier Kademlia node {} stopped", id.toString());
 }
 
-void Node::persistentAnnounce() {
-    log->info("Re-announce the persistent values and peers...");
+// The offset in the interval at the position of the id in the id space
+static uint64_t offsetOf(const Id& id, uint64_t interval) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < sizeof(prefix); i++)
+        prefix = (prefix << 8) | id.data()[i];
+
+    return (uint64_t)(std::ldexp((double)prefix, -64) * interval);
+}
 
-    std::list<std::future<void>> futures {};
+void Node::persistentAnnounce() {
+    // a page of the records at a time, each one is due at the position of its
+    // id, so the round is spread over the interval in the order of the targets.
+    // Only the ids are queued, the records are read again when they are due
+    auto start = currentTimeMillis();
+    size_t numValues = 0;
+    size_t numPeers = 0;
 
     auto ts = currentTimeMillis() - Constants::MAX_VALUE_AGE +
             Constants::RE_ANNOUNCE_INTERVAL * 2;
-    auto values = storage->getPersistentValues(ts);
-    for (auto& value : values) {
-        log->debug("Re-announce the value: {}", value.getId().toString());
-        storage->updateValueLastAnnounce(value.getId());
-        futures.emplace_back(doStoreValue(value));
+    ScanCursor cursor {};
+    while (!cursor.done) {
+        auto values = storage->scanPersistentValues(ts, cursor, Constants::STORAGE_SCAN_PAGE);
+        for (const auto& value : values) {
+            storage->updateValueLastAnnounce(value.getId());
+            scheduleValueAnnounce(value.getId(), start + offsetOf(value.getId(), Constants::RE_ANNOUNCE_INTERVAL));
+        }
+        numValues += values.size();
     }
 
     ts = currentTimeMillis() - Constants::MAX_PEER_AGE +
             Constants::RE_ANNOUNCE_INTERVAL * 2;
+    cursor = {};
+    while (!cursor.done) {
+        auto peers = storage->scanPersistentPeers(ts, cursor, Constants::STORAGE_SCAN_PAGE);
+        for (const auto& peer : peers) {
+            storage->updatePeerLastAnnounce(peer.getId(), peer.getOrigin());
+            schedulePeerAnnounce(peer.getId(), start + offsetOf(peer.getId(), Constants::RE_ANNOUNCE_INTERVAL));
+        }
+        numPeers += peers.size();
+    }
+
+    auto stats = announceScheduler->getStats();
+    log->info("Re-announce {} persistent values and {} peers, {} announces pending, lagging {}ms",
+            numValues, numPeers, stats.pending, stats.lag);
 
-    auto ps = storage->getPersistentPeers(ts);
-    for (auto& p : ps) {
-        log->debug("Re-announce the peer: {}", p.getId().toString());
-        storage->updatePeerLastAnnounce(p.getId(), p.getOrigin());
-        futures.emplace_back(doAnnouncePeer(p));
+    announceScheduler->dispatch();
+}
+
+void Node::scheduleAnnounce(const Value& value, uint64_t due, std::function<void()> completeHandler) const {
+    announceScheduler->add(AnnounceScheduler::Kind::VALUE, value.getId(), due,
+        [=](const std::list<Sp<NodeInfo>>& seeds, AnnounceScheduler::CompleteHandler handler) {
+            doStoreValue(value, seeds, handler);
+        }, completeHandler);
+}
+
+void Node::scheduleAnnounce(const PeerInfo& peer, uint64_t due, std::function<void()> completeHandler) const {
+    announceScheduler->add(AnnounceScheduler::Kind::PEER, peer.getId(), due,
+        [=](const std::list<Sp<NodeInfo>>& seeds, AnnounceScheduler::CompleteHandler handler) {
+            doAnnouncePeer(peer, seeds, handler);
+        }, completeHandler);
+}
+
+void Node::scheduleValueAnnounce(const Id& valueId, uint64_t due) const {
+    announceScheduler->add(AnnounceScheduler::Kind::VALUE, valueId, due,
+        [=](const std::list<Sp<NodeInfo>>& seeds, AnnounceScheduler::CompleteHandler handler) {
+            auto value = getStorage()->getValue(valueId);
+            // removed meanwhile
+            if (value == nullptr) {
+                handler({});
+                return;
+            }
+
+            doStoreValue(*value, seeds, handler);
+        });
+}
+
+void Node::schedulePeerAnnounce(const Id& peerId, uint64_t due) const {
+    announceScheduler->add(AnnounceScheduler::Kind::PEER, peerId, due,
+        [=](const std::list<Sp<NodeInfo>>& seeds, AnnounceScheduler::CompleteHandler handler) {
+            auto peer = getStorage()->getPeer(peerId, getId());
+            if (peer == nullptr) {
+                handler({});
+                return;
+            }
+
+            doAnnouncePeer(*peer, seeds, handler);
+        });
+}
+
+std::future<void> Node::scheduleAnnounces(const std::vector<Value>& values, const std::vector<PeerInfo>& peers,
+        uint64_t start, uint64_t interval) const {
+    // in the order of the targets, so the nearby ones are announced one after another
+    std::vector<std::pair<Id, std::function<void(uint64_t, std::function<void()>)>>> announces {};
+    announces.reserve(values.size() + peers.size());
+
+    for (const auto& value : values) {
+        announces.emplace_back(value.getId(), [=](uint64_t due, std::function<void()> completeHandler) {
+            scheduleAnnounce(value, due, completeHandler);
+        });
     }
+
+    for (const auto& peer : peers) {
+        announces.emplace_back(peer.getId(), [=](uint64_t due, std::function<void()> completeHandler) {
+            scheduleAnnounce(peer, due, completeHandler);
+        });
+    }
+
+    std::sort(announces.begin(), announces.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    auto promise = std::make_shared<std::promise<void>>();
+    if (announces.empty()) {
+        promise->set_value();
+        return promise->get_future();
+    }
+
+    auto remaining = std::make_shared<std::atomic<size_t>>(announces.size());
+    auto completeHandler = [=]() {
+        if (--(*remaining) == 0)
+            promise->set_value();
+    };
+
+    for (size_t i = 0; i < announces.size(); i++)
+        announces[i].second(start + interval * i / announces.size(), completeHandler);
+
+    announceScheduler->dispatch();
+    return promise->get_future();
 }
 
 #ifdef CARRIER_CRAWLER
@@ -346,7 +538,25 @@ std::future<std::vector<Sp<NodeInfo>>> Node::findNode(const Id& id, LookupOption
     checkState(isRunning(), "Node not running");
     checkArgument(id != Id::MIN_ID, "Invalid peer id");
 
-    auto promise = std::make_shared<std::promise<std::vector<Sp<NodeInfo>>>>();
+    if (lookupCache) {
+        auto cached = lookupCache->getNode(id, option);
+        if (cached) {
+            std::promise<std::vector<Sp<NodeInfo>>> promise {};
+            promise.set_value(*cached);
+            return promise.get_future();
+        }
+    }
+
+    return lookupCoalescer->findNode(id, option, [=](std::function<void(std::vector<Sp<NodeInfo>>)> completeHandler) {
+        doFindNode(id, option, [=](std::vector<Sp<NodeInfo>> nodes) {
+            if (lookupCache)
+                lookupCache->putNode(id, nodes, option);
+            completeHandler(nodes);
+        });
+    });
+}
+
+void Node::doFindNode(const Id& id, LookupOption option, std::function<void(std::vector<Sp<NodeInfo>>)> resultHandler) const {
     auto results = std::make_shared<std::vector<Sp<NodeInfo>>>();
 
     if (option == LookupOption::ARBITRARY) {
@@ -362,8 +572,8 @@ std::future<std::vector<Sp<NodeInfo>>> Node::findNode(const Id& id, LookupOption
         }
 
         if (!results->empty()) {
-            promise->set_value(std::move(*results));
-            return promise->get_future();
+            resultHandler(*results);
+            return;
         }
     }
 
@@ -374,7 +584,7 @@ std::future<std::vector<Sp<NodeInfo>>> Node::findNode(const Id& id, LookupOption
             results->emplace_back(ni);
 
         if ((option == LookupOption::OPTIMISTIC && !results->empty()) || *completion >= numDHTs) {
-            promise->set_value(std::move(*results));
+            resultHandler(*results);
         }
     };
 
@@ -382,21 +592,38 @@ std::future<std::vector<Sp<NodeInfo>>> Node::findNode(const Id& id, LookupOption
         dht4->findNode(id, completeHandler);
     if (dht6 != nullptr)
         dht6->findNode(id, completeHandler);
-
-    return promise->get_future();
 }
 
 std::future<Sp<Value>> Node::findValue(const Id& id, LookupOption option) const {
     checkState(isRunning(), "Node not running");
     checkArgument(id != Id::MIN_ID, "Invalid peer id");
 
-    auto promise = std::make_shared<std::promise<Sp<Value>>>();
+    if (lookupCache) {
+        // The conservative lookups still look for the newer version of a mutable value
+        auto cached = lookupCache->getValue(id, option);
+        if (cached && (*cached == nullptr || !(*cached)->isMutable() || option != LookupOption::CONSERVATIVE)) {
+            std::promise<Sp<Value>> promise {};
+            promise.set_value(*cached);
+            return promise.get_future();
+        }
+    }
+
+    return lookupCoalescer->findValue(id, option, [=](std::function<void(Sp<Value>)> completeHandler) {
+        doFindValue(id, option, [=](Sp<Value> value) {
+            if (lookupCache)
+                lookupCache->putValue(id, value, option);
+            completeHandler(value);
+        });
+    });
+}
+
+void Node::doFindValue(const Id& id, LookupOption option, std::function<void(Sp<Value>)> resultHandler) const {
     auto valuePtr = std::make_shared<Sp<Value>>();
 
     auto localVal = getStorage()->getValue(id);
     if (localVal != nullptr && (option == LookupOption::ARBITRARY || !localVal->isMutable())) {
-        promise->set_value(localVal);
-        return promise->get_future();
+        resultHandler(localVal);
+        return;
     }
 
     *valuePtr = localVal;
@@ -418,7 +645,7 @@ std::future<Sp<Value>> Node::findValue(const Id& id, LookupOption option) const
             } catch (const std::exception& e) {
                 log->warn("Perisist value in local storage failed {}", e.what());
             }
-            promise->set_value((*valuePtr));
+            resultHandler(*valuePtr);
         }
     };
 
@@ -426,8 +653,6 @@ std::future<Sp<Value>> Node::findValue(const Id& id, LookupOption option) const
         dht4->findValue(id, option, completeHandler);
     if (dht6 != nullptr)
         dht6->findValue(id, option, completeHandler);
-
-    return promise->get_future();
 }
 
 std::future<void> Node::storeValue(const Value& value, bool persistent) const {
@@ -441,6 +666,9 @@ std::future<void> Node::storeValue(const Value& value, bool persistent) const {
     auto promise = std::promise<void>();
     try {
         getStorage()->putValue(value, persistent);
+        storageQuota->ownValue(value.getId());
+        if (lookupCache)
+            lookupCache->putValue(value.getId(), std::make_shared<Value>(value));
     } catch (std::exception& ex) {
         log->error("Perisist value in local storage failed {}", ex.what());
         promise.set_exception(std::current_exception());
@@ -452,26 +680,79 @@ std::future<void> Node::storeValue(const Value& value, bool persistent) const {
 
 std::future<void> Node::doStoreValue(const Value& value) const {
     auto promise = std::make_shared<std::promise<void>>();
-    auto completion = std::make_shared<std::atomic<int>>(0);
-    auto completeHandler = [=](std::list<Sp<NodeInfo>> nl) {
-        (*completion)++;
-        if (*completion >= numDHTs)
-            promise->set_value();
+    doStoreValue(value, {}, [=](std::list<Sp<NodeInfo>>) {
+        promise->set_value();
+    });
+
+    return promise->get_future();
+}
+
+void Node::doStoreValue(const Value& value, const std::list<Sp<NodeInfo>>& seeds,
+        std::function<void(std::list<Sp<NodeInfo>>)> completeHandler) const {
+    auto mutex = std::make_shared<std::mutex>();
+    auto closest = std::make_shared<std::list<Sp<NodeInfo>>>();
+    auto completion = std::make_shared<int>(0);
+    auto dhtCompleteHandler = [=](std::list<Sp<NodeInfo>> nl) {
+        {
+            std::lock_guard<std::mutex> lk(*mutex);
+            closest->splice(closest->end(), nl);
+            if (++(*completion) < numDHTs)
+                return;
+        }
+        completeHandler(*closest);
     };
 
     if (dht4 != nullptr)
-        dht4->storeValue(value, completeHandler);
+        dht4->storeValue(value, dhtCompleteHandler, seeds);
     if (dht6 != nullptr)
-        dht6->storeValue(value, completeHandler);
+        dht6->storeValue(value, dhtCompleteHandler, seeds);
+}
 
-    return promise->get_future();
+std::future<void> Node::storeValues(const std::vector<Value>& values, bool persistent) const {
+    checkState(isRunning(), "Node not running");
+    for (const auto& value : values)
+        checkArgument(value.isValid(), "Invalid value");
+
+    try {
+        for (const auto& value : values) {
+            getStorage()->putValue(value, persistent);
+            storageQuota->ownValue(value.getId());
+            if (lookupCache)
+                lookupCache->putValue(value.getId(), std::make_shared<Value>(value));
+        }
+    } catch (std::exception& ex) {
+        log->error("Perisist values in local storage failed {}", ex.what());
+        auto promise = std::promise<void>();
+        promise.set_exception(std::current_exception());
+        return promise.get_future();
+    }
+
+    return scheduleAnnounces(values, {}, currentTimeMillis(), 0);
 }
 
 std::future<std::vector<PeerInfo>> Node::findPeer(const Id& id, int expected, LookupOption option) const {
     checkState(isRunning(), "Node not running");
     checkArgument(id != Id::MIN_ID, "Invalid peer id");
 
-    auto promise = std::make_shared<std::promise<std::vector<PeerInfo>>>();
+    if (lookupCache) {
+        auto cached = lookupCache->getPeer(id, expected, option);
+        if (cached) {
+            std::promise<std::vector<PeerInfo>> promise {};
+            promise.set_value(*cached);
+            return promise.get_future();
+        }
+    }
+
+    return lookupCoalescer->findPeer(id, expected, option, [=](std::function<void(std::vector<PeerInfo>)> completeHandler) {
+        doFindPeer(id, expected, option, [=](std::vector<PeerInfo> peers) {
+            if (lookupCache)
+                lookupCache->putPeer(id, peers, option);
+            completeHandler(peers);
+        });
+    });
+}
+
+void Node::doFindPeer(const Id& id, int expected, LookupOption option, std::function<void(std::vector<PeerInfo>)> resultHandler) const {
     auto dedup_result = std::make_shared<std::set<PeerInfo>>();
     auto results = std::make_shared<std::vector<PeerInfo>>();
 
@@ -482,8 +763,8 @@ std::future<std::vector<PeerInfo>> Node::findPeer(const Id& id, int expected, Lo
             results->push_back(item);
     }
     if (expected > 0 && results->size() >= expected && option == LookupOption::ARBITRARY) {
-        promise->set_value(std::move(*results));
-        return promise->get_future();
+        resultHandler(*results);
+        return;
     }
 
     // TODO exception
@@ -500,16 +781,21 @@ std::future<std::vector<PeerInfo>> Node::findPeer(const Id& id, int expected, Lo
     auto completeHandler = [=](std::vector<PeerInfo> peers) {
         (*completion)++;
 
+        // only the newly found peers, the earlier ones are stored already
+        std::vector<PeerInfo> found {};
         for (const auto &item : peers) {
             auto rc = dedup_result->insert(item);
-            if (rc.second)
+            if (rc.second) {
                 results->push_back(item);
+                found.push_back(item);
+            }
         }
 
-        getStorage()->putPeer(*results);
+        if (!found.empty())
+            getStorage()->putPeer(found);
 
         if (*completion >= numDHTs) {
-            promise->set_value(std::move(*results));
+            resultHandler(*results);
         }
     };
 
@@ -517,8 +803,6 @@ std::future<std::vector<PeerInfo>> Node::findPeer(const Id& id, int expected, Lo
         dht4->findPeer(id, expected, option, completeHandler);
     if (dht6 != nullptr)
         dht6->findPeer(id, expected, option, completeHandler);
-
-    return promise->get_future();
 }
 
 std::future<void> Node::announcePeer(const PeerInfo& peer, bool persistent) const {
@@ -531,6 +815,9 @@ std::future<void> Node::announcePeer(const PeerInfo& peer, bool persistent) cons
 
     try {
         getStorage()->putPeer(peer, persistent);
+        storageQuota->ownPeer(peer.getId(), peer.getOrigin());
+        if (lookupCache)
+            lookupCache->removePeer(peer.getId());
     } catch (std::exception& ex) {
         log->error("Perisist peer in local storage failed {}", ex.what());
         promise.set_exception(std::current_exception());
@@ -542,20 +829,299 @@ std::future<void> Node::announcePeer(const PeerInfo& peer, bool persistent) cons
 
 std::future<void> Node::doAnnouncePeer(const PeerInfo& peer) const {
     auto promise = std::make_shared<std::promise<void>>();
+    doAnnouncePeer(peer, {}, [=](std::list<Sp<NodeInfo>>) {
+        promise->set_value();
+    });
+
+    return promise->get_future();
+}
 
+void Node::doAnnouncePeer(const PeerInfo& peer, const std::list<Sp<NodeInfo>>& seeds,
+        std::function<void(std::list<Sp<NodeInfo>>)> completeHandler) const {
+    auto mutex = std::make_shared<std::mutex>();
+    auto closest = std::make_shared<std::list<Sp<NodeInfo>>>();
+    auto completion = std::make_shared<int>(0);
+    auto dhtCompleteHandler = [=](std::list<Sp<NodeInfo>> nl) {
+        {
+            std::lock_guard<std::mutex> lk(*mutex);
+            closest->splice(closest->end(), nl);
+            if (++(*completion) < numDHTs)
+                return;
+        }
+        completeHandler(*closest);
+    };
+
+    if (dht4 != nullptr)
+        dht4->announcePeer(peer, dhtCompleteHandler, seeds);
+    if (dht6 != nullptr)
+        dht6->announcePeer(peer, dhtCompleteHandler, seeds);
+}
+
+std::future<void> Node::announcePeers(const std::vector<PeerInfo>& peers, bool persistent) const {
+    checkState(isRunning(), "Node not running");
+    for (const auto& peer : peers) {
+        checkArgument(peer.getOrigin() == getId(), "Invaid peer: not belongs to current node");
+        checkArgument(peer.isValid(), "Invalid peer");
+    }
+
+    try {
+        for (const auto& peer : peers) {
+            getStorage()->putPeer(peer, persistent);
+            storageQuota->ownPeer(peer.getId(), peer.getOrigin());
+            if (lookupCache)
+                lookupCache->removePeer(peer.getId());
+        }
+    } catch (std::exception& ex) {
+        log->error("Perisist peers in local storage failed {}", ex.what());
+        auto promise = std::promise<void>();
+        promise.set_exception(std::current_exception());
+        return promise.get_future();
+    }
+
+    return scheduleAnnounces({}, peers, currentTimeMillis(), 0);
+}
+
+Sp<LookupHandle> Node::findNode(const Id& id, LookupOption option,
+        std::function<bool(Sp<NodeInfo>)> resultHandler, std::function<void()> completeHandler) const {
+    checkState(isRunning(), "Node not running");
+    checkArgument(id != Id::MIN_ID, "Invalid node id");
+    checkArgument(!!resultHandler, "Invalid result handler");
+
+    auto handle = std::make_shared<LookupHandle>();
+    auto mutex = std::make_shared<std::mutex>();
+    auto delivered = std::make_shared<std::vector<Sp<NodeInfo>>>();
+
+    auto deliver = [=](Sp<NodeInfo> ni, bool remote) {
+        {
+            std::lock_guard<std::mutex> lk(*mutex);
+            if (handle->isCanceled())
+                return false;
+
+            for (const auto& item : *delivered) {
+                if (*item == *ni)
+                    return true;
+            }
+            delivered->push_back(ni);
+        }
+
+        if (!resultHandler(ni) || (remote && option == LookupOption::OPTIMISTIC)) {
+            handle->cancel();
+            return false;
+        }
+        return true;
+    };
+
+    if (option == LookupOption::ARBITRARY) {
+        for (const auto& dht : {dht4, dht6}) {
+            if (dht == nullptr)
+                continue;
+
+            auto ni = dht->getNode(id);
+            if (ni != nullptr && !deliver(ni, false))
+                break;
+        }
+
+        if (!delivered->empty()) {
+            if (completeHandler)
+                completeHandler();
+            handle->complete();
+            return handle;
+        }
+    }
+
+    doStreamingLookup(handle, [=](DHT& dht, std::function<void()> done) {
+        return dht.findNode(id, [=](Sp<NodeInfo> ni) {
+            return deliver(ni, true);
+        }, done);
+    }, completeHandler);
+
+    return handle;
+}
+
+Sp<LookupHandle> Node::findValue(const Id& id, LookupOption option,
+        std::function<bool(Sp<Value>)> resultHandler, std::function<void()> completeHandler) const {
+    checkState(isRunning(), "Node not running");
+    checkArgument(id != Id::MIN_ID, "Invalid value id");
+    checkArgument(!!resultHandler, "Invalid result handler");
+
+    auto handle = std::make_shared<LookupHandle>();
+    auto mutex = std::make_shared<std::mutex>();
+    auto latest = std::make_shared<Sp<Value>>();
+
+    // Deliver the first value, then only the newer versions of a mutable value
+    auto deliver = [=](const Value& value, bool remote) {
+        auto v = std::make_shared<Value>(value);
+        {
+            std::lock_guard<std::mutex> lk(*mutex);
+            if (handle->isCanceled())
+                return false;
+
+            if (*latest && (!value.isMutable() || (*latest)->getSequenceNumber() >= value.getSequenceNumber()))
+                return true;
+            *latest = v;
+        }
+
+        if (remote) {
+            try {
+                getStorage()->putValue(*v);
+            } catch (const std::exception& e) {
+                log->warn("Perisist value in local storage failed {}", e.what());
+            }
+        }
+
+        if (!resultHandler(v) || (remote && (option != LookupOption::CONSERVATIVE || !v->isMutable()))) {
+            handle->cancel();
+            return false;
+        }
+        return true;
+    };
+
+    auto localVal = getStorage()->getValue(id);
+    if (localVal != nullptr) {
+        deliver(*localVal, false);
+
+        if (option == LookupOption::ARBITRARY || !localVal->isMutable()) {
+            if (completeHandler)
+                completeHandler();
+            handle->complete();
+            return handle;
+        }
+    }
+
+    doStreamingLookup(handle, [=](DHT& dht, std::function<void()> done) {
+        return dht.findValue(id, [=](const Value& value) {
+            return deliver(value, true);
+        }, done);
+    }, completeHandler);
+
+    return handle;
+}
+
+Sp<LookupHandle> Node::findPeer(const Id& id, int expected, LookupOption option,
+        std::function<bool(const PeerInfo&)> resultHandler, std::function<void()> completeHandler) const {
+    checkState(isRunning(), "Node not running");
+    checkArgument(id != Id::MIN_ID, "Invalid peer id");
+    checkArgument(!!resultHandler, "Invalid result handler");
+
+    auto handle = std::make_shared<LookupHandle>();
+    auto mutex = std::make_shared<std::mutex>();
+    auto delivered = std::make_shared<std::set<PeerInfo>>();
+    auto found = std::make_shared<int>(0);
+
+    // Deliver every peer once, the new peers are stored as they are discovered
+    auto deliver = [=](const PeerInfo& peer, bool remote) {
+        bool enough = false;
+        {
+            std::lock_guard<std::mutex> lk(*mutex);
+            if (handle->isCanceled())
+                return false;
+
+            if (!delivered->insert(peer).second)
+                return true;
+
+            if (remote)
+                enough = option != LookupOption::CONSERVATIVE && expected > 0 && ++(*found) >= expected;
+        }
+
+        if (remote) {
+            try {
+                getStorage()->putPeer(peer, false, false);
+            } catch (const std::exception& e) {
+                log->warn("Perisist peer in local storage failed {}", e.what());
+            }
+        }
+
+        if (!resultHandler(peer) || enough) {
+            handle->cancel();
+            return false;
+        }
+        return true;
+    };
+
+    for (const auto& peer : getStorage()->getPeer(id, expected)) {
+        if (!deliver(peer, false))
+            break;
+    }
+
+    if (expected > 0 && delivered->size() >= expected && option == LookupOption::ARBITRARY) {
+        if (completeHandler)
+            completeHandler();
+        handle->complete();
+        return handle;
+    }
+
+    doStreamingLookup(handle, [=](DHT& dht, std::function<void()> done) {
+        return dht.findPeer(id, [=](const PeerInfo& peer) {
+            return deliver(peer, true);
+        }, done);
+    }, completeHandler);
+
+    return handle;
+}
+
+void Node::doStreamingLookup(Sp<LookupHandle> handle, std::function<Sp<Task>(DHT&, std::function<void()>)> lookup,
+        std::function<void()> completeHandler) const {
     auto completion = std::make_shared<std::atomic<int>>(0);
-    auto completeHandler = [=](std::list<Sp<NodeInfo>> nl) {
-        (*completion)++;
-        if (*completion >= numDHTs)
-            promise->set_value();
+    auto done = [=]() {
+        if (++(*completion) < numDHTs)
+            return;
+
+        if (completeHandler)
+            completeHandler();
+        handle->complete();
     };
 
+    // Stopped by the local results
+    if (handle->isCanceled()) {
+        if (completeHandler)
+            completeHandler();
+        handle->complete();
+        return;
+    }
+
+    for (const auto& dht : {dht4, dht6}) {
+        if (dht == nullptr)
+            continue;
+
+        auto task = lookup(*dht, done);
+        handle->addCanceler([=]() {
+            dht->getTaskManager().cancel(task);
+        });
+    }
+}
+
+LookupStats Node::getLookupStats() const {
+    LookupStats stats {};
     if (dht4 != nullptr)
-        dht4->announcePeer(peer, completeHandler);
+        stats += dht4->getLookupStats();
     if (dht6 != nullptr)
-        dht6->announcePeer(peer, completeHandler);
+        stats += dht6->getLookupStats();
 
-    return promise->get_future();
+    stats.coalesced = lookupCoalescer->getCoalesced();
+    if (lookupCache)
+        stats.cached = lookupCache->getHits();
+    return stats;
+}
+
+AnnounceStats Node::getAnnounceStats() const {
+    return announceScheduler->getStats();
+}
+
+StorageStats Node::getStorageStats() const {
+    auto stats = storage != nullptr ? storage->getStats() : StorageStats{};
+    if (storageQuota != nullptr) {
+        auto usage = storageQuota->getUsage();
+        stats.quotaBytes = usage.bytes;
+        stats.quotaRecords = usage.records;
+        stats.quotaRejected = usage.rejected;
+        stats.quotaEvicted = usage.evicted;
+    }
+    if (pathCache != nullptr) {
+        stats.pathCacheRecords = pathCache->size();
+        stats.pathCacheBytes = pathCache->getBytes();
+        stats.pathCacheHits = pathCache->getHits();
+    }
+    return stats;
 }
 
 Sp<Value> Node::getValue(const Id& valueId) {
@@ -567,6 +1133,12 @@ Sp<Value> Node::getValue(const Id& valueId) {
 bool Node::removeValue(const Id& valueId) {
     checkArgument(valueId != Id::MIN_ID, "Invalid value id");
 
+    if (lookupCache)
+        lookupCache->removeValue(valueId);
+    if (pathCache)
+        pathCache->removeValue(valueId);
+    if (storageQuota)
+        storageQuota->releaseValue(valueId);
     return getStorage()->removeValue(valueId);
 }
 
@@ -579,6 +1151,12 @@ Sp<PeerInfo> Node::getPeer(const Id& peerId) {
 bool Node::removePeer(const Id& peerId) {
     checkArgument(peerId != Id::zero(), "Invalid peer id");
 
+    if (lookupCache)
+        lookupCache->removePeer(peerId);
+    if (pathCache)
+        pathCache->removePeer(peerId, this->getId());
+    if (storageQuota)
+        storageQuota->releasePeer(peerId, this->getId());
     return getStorage()->removePeer(peerId, this->getId());
 }
 
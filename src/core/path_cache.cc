@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "utils/time.h"
+#include "path_cache.h"
+
+namespace elastos {
+namespace carrier {
+
+// The rough memory footprint of an entry besides its record
+static const size_t ENTRY_OVERHEAD = 160;
+
+Sp<Value> PathCache::getValue(const Id& id) {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = index.find({Kind::VALUE, id, Id::MIN_ID});
+    if (it == index.end())
+        return nullptr;
+
+    if (it->second->expiration <= currentTimeMillis()) {
+        remove(it);
+        return nullptr;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    hits++;
+    return std::make_shared<Value>(std::get<Value>(it->second->record));
+}
+
+std::vector<PeerInfo> PathCache::getPeer(const Id& id, int maxPeers) {
+    std::vector<PeerInfo> peers {};
+    auto now = currentTimeMillis();
+
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = index.lower_bound({Kind::PEER, id, Id::MIN_ID});
+    while (it != index.end() && std::get<0>(it->first) == Kind::PEER && std::get<1>(it->first) == id &&
+            peers.size() < (size_t)maxPeers) {
+        if (it->second->expiration <= now) {
+            it = remove(it);
+            continue;
+        }
+
+        entries.splice(entries.begin(), entries, it->second);
+        peers.push_back(std::get<PeerInfo>(it->second->record));
+        ++it;
+    }
+
+    if (!peers.empty())
+        hits++;
+    return peers;
+}
+
+bool PathCache::putValue(const Value& value, uint64_t ttl) {
+    Key key {Kind::VALUE, value.getId(), Id::MIN_ID};
+    size_t size = sizeof(Value) + value.getData().size();
+
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = index.find(key);
+    if (it != index.end() && it->second->expiration > currentTimeMillis()) {
+        const auto& cached = std::get<Value>(it->second->record);
+        if (cached.isMutable() && cached.getSequenceNumber() > value.getSequenceNumber())
+            return false;
+    }
+
+    put(key, value, size, ttl);
+    return true;
+}
+
+void PathCache::putPeer(const PeerInfo& peer, uint64_t ttl) {
+    Key key {Kind::PEER, peer.getId(), peer.getOrigin()};
+    size_t size = sizeof(PeerInfo) + peer.getSignature().size() +
+            (peer.hasAlternativeURL() ? peer.getAlternativeURL().size() : 0);
+
+    std::lock_guard<std::mutex> lk(mutex);
+    put(key, peer, size, ttl);
+}
+
+void PathCache::removeValue(const Id& id) {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = index.find({Kind::VALUE, id, Id::MIN_ID});
+    if (it != index.end())
+        remove(it);
+}
+
+void PathCache::removePeer(const Id& id, const Id& origin) {
+    std::lock_guard<std::mutex> lk(mutex);
+    auto it = index.find({Kind::PEER, id, origin});
+    if (it != index.end())
+        remove(it);
+}
+
+void PathCache::clear() {
+    std::lock_guard<std::mutex> lk(mutex);
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+void PathCache::put(const Key& key, Record&& record, size_t size, uint64_t ttl) {
+    size += ENTRY_OVERHEAD;
+    if (size > maxBytes || ttl == 0)
+        return;
+
+    auto it = index.find(key);
+    if (it != index.end())
+        remove(it);
+
+    // Evict the least recently used entries, the expired ones are evicted too as they get there
+    while (!entries.empty() && bytes + size > maxBytes) {
+        bytes -= entries.back().bytes;
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+
+    entries.push_front({key, std::move(record), size, currentTimeMillis() + ttl});
+    index[key] = entries.begin();
+    bytes += size;
+}
+
+PathCache::Index::iterator PathCache::remove(Index::iterator it) {
+    bytes -= it->second->bytes;
+    entries.erase(it->second);
+    return index.erase(it);
+}
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/peer_info.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The copies of the values and peers cached on this node by the lookups that
+ * passed it by, Kademlia path caching.
+ *
+ * The copies are kept apart from the data storage: they are never persisted,
+ * re-announced or counted in the storage quotas, and they are only served
+ * when the storage has no authoritative record. Each copy lives for the TTL
+ * it was put with, the cache is bounded by the estimated memory of the
+ * entries, the least recently used entries are evicted first.
+ *
+ * Thread safe.
+ */
+class PathCache {
+public:
+    PathCache(size_t maxBytes) : maxBytes(maxBytes) {}
+
+    Sp<Value> getValue(const Id& id);
+    std::vector<PeerInfo> getPeer(const Id& id, int maxPeers);
+
+    // a mutable value never replaces the cached one with a higher sequence
+    // number, returns false if it was not cached
+    bool putValue(const Value& value, uint64_t ttl);
+    void putPeer(const PeerInfo& peer, uint64_t ttl);
+
+    void removeValue(const Id& id);
+    void removePeer(const Id& id, const Id& origin);
+
+    void clear();
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        return entries.size();
+    }
+
+    size_t getBytes() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        return bytes;
+    }
+
+    uint64_t getHits() const {
+        std::lock_guard<std::mutex> lk(mutex);
+        return hits;
+    }
+
+private:
+    enum class Kind { VALUE, PEER };
+    // the values have no origin, the peers of an id are contiguous by origin
+    using Key = std::tuple<Kind, Id, Id>;
+    using Record = std::variant<Value, PeerInfo>;
+
+    struct Entry {
+        Key key;
+        Record record;
+        size_t bytes;
+        uint64_t expiration;
+    };
+
+    using Index = std::map<Key, std::list<Entry>::iterator>;
+
+    void put(const Key& key, Record&& record, size_t bytes, uint64_t ttl);
+    Index::iterator remove(Index::iterator it);
+
+    size_t maxBytes;
+
+    size_t bytes {0};
+    uint64_t hits {0};
+
+    std::list<Entry> entries {};
+    Index index {};
+
+    mutable std::mutex mutex {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -25,11 +25,25 @@
 #include "kbucket.h"
 #include "routing_table.h"
 #include "carrier/node.h"
+#include "task/node_lookup.h"
 #include "dht.h"
 
 #include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include <nlohmann/json.hpp>
 
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "crypto/shasum.h"
 namespace elastos {
 namespace carrier {
 
@@ -115,9 +129,9 @@ void RoutingTable::_split(const Sp<KBucket>& bucket) {
 
     auto& prefix = bucket->getPrefix();
     const Prefix& pl = prefix.splitBranch(false);
-    Sp<KBucket> l = std::make_shared<KBucket>(pl, isHomeBucket(pl));
+    Sp<KBucket> l = createBucket(pl);
     const Prefix& ph = prefix.splitBranch(true);
-    Sp<KBucket> h = std::make_shared<KBucket>(ph, isHomeBucket(ph));
+    Sp<KBucket> h = createBucket(ph);
 
     for (auto& entry: bucket->getEntries()) {
         if (l->getPrefix().isPrefixOf(entry->getId()))
@@ -164,11 +178,11 @@ void RoutingTable::_mergeBuckets() {
             int effectiveSize2 = getEffectiveSize(b2);;
 
             // check if the buckets can be merged without losing any effective entries
-            if (effectiveSize1 + effectiveSize2 <= Constants::MAX_ENTRIES_PER_BUCKET) {
+            auto parent = b1->getPrefix().getParent();
+            if (effectiveSize1 + effectiveSize2 <= getBucketCapacity(parent)) {
                 // Insert into a new bucket directly, no splitting to avoid
                 // fibrillation between merge and split operations
-                auto parent = b1->getPrefix().getParent();
-                auto newBucket = std::make_shared<KBucket>(parent, isHomeBucket(parent));
+                auto newBucket = createBucket(parent);
 
                 for (auto& entry: b1->getEntries()) {
                     newBucket->_put(entry);
@@ -206,9 +220,10 @@ void RoutingTable::_maintenance() {
     const Id& localId = dht.getNode().getId();
     auto bootstrapIds = dht.getBootstrapIds();
 
+    std::vector<Sp<KBucket>> toRefresh {};
     for (auto& bucket : getBuckets()) {
         std::list<Sp<KBucketEntry>> entries = bucket->getEntries();
-        auto wasFull = entries.size() >= Constants::MAX_ENTRIES_PER_BUCKET;
+        auto wasFull = entries.size() >= bucket->getCapacity();
         for (auto& entry : entries) {
             // remove really old entries, ourselves and bootstrap nodes if the bucket is full
             if (entry->getId() == localId || (wasFull && vector_contains(bootstrapIds, entry->getId()))) {
@@ -223,12 +238,44 @@ void RoutingTable::_maintenance() {
             }
         }
 
-        bool refreshNeeded = bucket->needsToBeRefreshed();
-        if (refreshNeeded) {
-            auto name =  "Refreshing Bucket - " + bucket->getPrefix().toString();
-            tryPingMaintenance(bucket, {PingRefreshTask::Options::probeCache}, name);
+        if (bucket->needsToBeRefreshed())
+            toRefresh.push_back(bucket);
+    }
+
+    if (maintenancePingRate > 0 && !toRefresh.empty()) {
+        // Start from the first bucket deferred by the previous pass, so the
+        // buckets at the end of the table are not starved by the first ones
+        auto start = std::find_if(toRefresh.begin(), toRefresh.end(), [&](const Sp<KBucket>& bucket) {
+            return !(bucket->getPrefix().last() < pingCursor);
+        });
+        std::rotate(toRefresh.begin(), start, toRefresh.end());
+    }
+
+    bool deferred = false;
+    for (auto& bucket : toRefresh) {
+        if (maintenancePingRate > 0) {
+            int pings = 0;
+            for (const auto& entry : bucket->getEntries()) {
+                if (entry->needsPing())
+                    pings++;
+            }
+
+            // The budget carries across the passes. The buckets out of the
+            // budget keep their refresh timers and go on the next passes.
+            if (!pingBudget.tryTake(pings, now)) {
+                if (!deferred)
+                    pingCursor = bucket->getPrefix().first();
+                deferred = true;
+                continue;
+            }
         }
+
+        auto name =  "Refreshing Bucket - " + bucket->getPrefix().toString();
+        tryPingMaintenance(bucket, {PingRefreshTask::Options::probeCache}, name);
     }
+
+    if (!deferred)
+        pingCursor = Id::MIN_ID;
 }
 
 void RoutingTable::tryPingMaintenance(Sp<KBucket> bucket, const std::vector<PingRefreshTask::Options>& options, const std::string& name) {
@@ -245,7 +292,7 @@ void RoutingTable::tryPingMaintenance(Sp<KBucket> bucket, const std::vector<Ping
     });
 
     maintenanceTasks[bucket] = task;
-    dht.getTaskManager().add(task);
+    dht.getTaskManager().add(task, TaskManager::Priority::REFRESH);
 }
 
 void RoutingTable::fillBuckets() {
@@ -254,99 +301,313 @@ void RoutingTable::fillBuckets() {
 
         // just try to fill partially populated buckets
         // not empty ones, they may arise as artifacts from deep splitting
-        if (num < Constants::MAX_ENTRIES_PER_BUCKET) {
+        if (num < bucket->getCapacity()) {
             bucket->updateRefreshTimer();
 
-            auto completeHandler = ([](Sp<NodeInfo>) {});
-            auto task = dht.findNode(bucket->getPrefix().createRandomId(), completeHandler);
+            auto task = std::make_shared<NodeLookup>(&dht, bucket->getPrefix().createRandomId());
             task->setName("Filling Bucket - " + bucket->getPrefix().toString());
+            dht.getTaskManager().add(task, TaskManager::Priority::MAINTENANCE);
         }
     }
 }
 
+// Binary routing table file:
+//   magic(4) | format version(2) | record size(2) | count(4) | reserved(4)
+//   | timestamp(8) | SHA256 checksum(32) | records...
+// The checksum covers the first 24 bytes of the header and all records.
+static const uint8_t  PERSIST_MAGIC[4]      = { 'C', 'R', 'T', 'B' };
+static const uint16_t PERSIST_VERSION       = 1;
+static const size_t   PERSIST_HEADER_SIZE   = 56;
+static const size_t   PERSIST_CHECKSUM_OFF  = 24;
+
+template <typename T>
+static inline void putLE(uint8_t* p, T v) {
+    for (size_t i = 0; i < sizeof(T); i++)
+        p[i] = static_cast<uint8_t>(static_cast<uint64_t>(v) >> (i * 8));
+}
+
+template <typename T>
+static inline T getLE(const uint8_t* p) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+        v |= static_cast<uint64_t>(p[i]) << (i * 8);
+    return static_cast<T>(v);
+}
+
+static std::vector<uint8_t> persistChecksum(const uint8_t* data, size_t length) {
+    SHA256 sha;
+    sha.update(Blob(data, PERSIST_CHECKSUM_OFF));
+    sha.update(Blob(data + PERSIST_HEADER_SIZE, length - PERSIST_HEADER_SIZE));
+    return sha.digest();
+}
+
+static void writeSnapshot(const std::string& path, const RoutingTableSnapshot& snapshot) {
+    size_t count = snapshot.getNumBucketEntries();
+    std::vector<uint8_t> data(PERSIST_HEADER_SIZE + count * KBucketEntry::BINARY_RECORD_SIZE);
+
+    uint8_t* p = data.data();
+    std::memcpy(p, PERSIST_MAGIC, sizeof(PERSIST_MAGIC));
+    putLE<uint16_t>(p + 4, PERSIST_VERSION);
+    putLE<uint16_t>(p + 6, KBucketEntry::BINARY_RECORD_SIZE);
+    putLE<uint32_t>(p + 8, count);
+    putLE<uint32_t>(p + 12, 0);
+    putLE<uint64_t>(p + 16, snapshot.getTimestamp());
+
+    p += PERSIST_HEADER_SIZE;
+    for (const auto& bucket : snapshot.getBuckets()) {
+        for (const auto& entry : *bucket.entries) {
+            entry.toBinary(p);
+            p += KBucketEntry::BINARY_RECORD_SIZE;
+        }
+    }
+
+    auto checksum = persistChecksum(data.data(), data.size());
+    std::memcpy(data.data() + PERSIST_CHECKSUM_OFF, checksum.data(), checksum.size());
+
+    // Write to a temporary file then replace, never leave a truncated table behind
+    auto tmpPath = path + ".tmp";
+    FILE* fp = std::fopen(tmpPath.c_str(), "wb");
+    if (fp == nullptr)
+        throw std::runtime_error("Can not open " + tmpPath);
+
+    bool ok = std::fwrite(data.data(), 1, data.size(), fp) == data.size() && std::fflush(fp) == 0;
+#if defined(_WIN32) || defined(_WIN64)
+    ok = ok && _commit(_fileno(fp)) == 0;
+#else
+    ok = ok && fsync(fileno(fp)) == 0;
+#endif
+    std::fclose(fp);
+
+    if (!ok) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("Write " + tmpPath + " failed");
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Rename " + tmpPath + " to " + path + " failed");
+}
+
+int RoutingTable::_bulkPut(std::vector<Sp<KBucketEntry>> entries) {
+    int before = getNumBucketEntries();
+
+    // The older entries are preferred by the buckets, insert them first.
+    std::stable_sort(entries.begin(), entries.end(), [](const Sp<KBucketEntry>& a, const Sp<KBucketEntry>& b) {
+        return a->getCreationTime() < b->getCreationTime();
+    });
+
+    // An entry rejected by a full bucket may fit after the later splits,
+    // so retry the rejected entries until no more progress.
+    std::vector<Sp<KBucketEntry>> pending {};
+    while (!entries.empty()) {
+        for (auto& entry : entries) {
+            _put(entry);
+            if (!getBucket(entry->getId())->exists(entry->getId()))
+                pending.push_back(entry);
+        }
+
+        if (pending.size() == entries.size())
+            break;
+
+        entries.swap(pending);
+        pending.clear();
+    }
+
+    return getNumBucketEntries() - before;
+}
+
 void RoutingTable::load(const std::string& path) {
     assert(!path.empty());
 
+#if defined(_WIN32) || defined(_WIN64)
     std::ifstream file(path, std::ios::binary);
     if (!file.is_open())
         return;
 
     std::vector<uint8_t> data{};
-    if (!file.bad()) {
-        auto length = file.rdbuf()->pubseekoff(0, std::ios_base::end);
-        if (length == 0) {
-            file.close();
-            return;
-        }
+    auto length = file.rdbuf()->pubseekoff(0, std::ios_base::end);
+    if (length <= 0)
+        return;
+
+    data.resize(length);
+    file.rdbuf()->pubseekoff(0, std::ios_base::beg);
+    file.read(reinterpret_cast<char*>(data.data()), length);
+    file.close();
+
+    load(data.data(), data.size());
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
 
-        data.resize(length);
-        file.rdbuf()->pubseekoff(0, std::ios_base::beg);
-        file.read(reinterpret_cast<char*>(data.data()), length);
+    size_t length = st.st_size;
+    void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        log->error("Map file '{}' failed", path);
+        return;
     }
 
+    load(static_cast<const uint8_t*>(data), length);
+    munmap(data, length);
+#endif
+}
+
+void RoutingTable::load(const uint8_t* data, size_t length) {
+    if (length < sizeof(PERSIST_MAGIC) || std::memcmp(data, PERSIST_MAGIC, sizeof(PERSIST_MAGIC)) != 0) {
+        loadLegacy(data, length);
+        return;
+    }
+
+    if (length < PERSIST_HEADER_SIZE) {
+        log->error("Routing table file is truncated, ignored");
+        return;
+    }
+
+    auto version = getLE<uint16_t>(data + 4);
+    auto recordSize = getLE<uint16_t>(data + 6);
+    auto count = getLE<uint32_t>(data + 8);
+    auto timestamp = getLE<uint64_t>(data + 16);
+
+    if (version != PERSIST_VERSION || recordSize != KBucketEntry::BINARY_RECORD_SIZE) {
+        log->warn("Unsupported routing table file version {}, ignored", version);
+        return;
+    }
+
+    if (length != PERSIST_HEADER_SIZE + (size_t)count * recordSize) {
+        log->error("Routing table file is truncated, ignored");
+        return;
+    }
+
+    auto checksum = persistChecksum(data, length);
+    if (std::memcmp(checksum.data(), data + PERSIST_CHECKSUM_OFF, checksum.size()) != 0) {
+        log->error("Routing table file checksum mismatch, ignored");
+        return;
+    }
+
+    std::vector<Sp<KBucketEntry>> entries {};
+    entries.reserve(count);
+
+    const uint8_t* p = data + PERSIST_HEADER_SIZE;
+    for (uint32_t i = 0; i < count; i++, p += recordSize) {
+        try {
+            entries.push_back(KBucketEntry::fromBinary(p));
+        } catch (const std::exception& e) {
+            log->warn("Skip the invalid routing table record: {}", e.what());
+        }
+    }
+
+    auto inserted = _bulkPut(entries);
+
+    log->info("Loaded {} of {} entries from persistent file. it was {} min old.",
+        inserted, count, (currentTimeMillis() - timestamp) / (60 * 1000));
+}
+
+void RoutingTable::loadLegacy(const uint8_t* data, size_t length) {
     try {
-        nlohmann::json root = nlohmann::json::from_cbor(data);
+        nlohmann::json root = nlohmann::json::from_cbor(data, data + length);
 
         long timestamp = root.at("timestamp").get<long>();
         auto nodes = root.at("entries");
+
+        std::vector<Sp<KBucketEntry>> entries {};
         for (auto &node : nodes)
-           _put(KBucketEntry::fromJson(node));
+            entries.push_back(KBucketEntry::fromJson(node));
+
+        auto inserted = _bulkPut(entries);
 
-        log->info("Loaded {} entries from persistent file. it was {} min old.",
-            nodes.size(), (currentTimeMillis() - timestamp) / (60 * 1000));
+        log->info("Loaded {} of {} entries from legacy persistent file. it was {} min old.",
+            inserted, nodes.size(), (currentTimeMillis() - timestamp) / (60 * 1000));
     } catch (const std::exception& e) {
-        log->error("read file '{}' error: {}", path, e.what());
+        log->error("read legacy routing table file error: {}", e.what());
     }
-
-    file.close();
 }
 
 void RoutingTable::save(const std::string& path) {
     assert(!path.empty());
 
-    std::ofstream file(path, std::ios::binary);
-    if (!file.is_open())
-        return;
-
-    if (getNumBucketEntries() == 0) {
+    // Take the snapshot inside the pipeline, the background writer only
+    // touches the immutable copy.
+    publish();
+    auto current = getSnapshot();
+    if (current->getNumBucketEntries() == 0) {
         log->trace("Skip to save the empty routing table.");
         return;
     }
 
-    nlohmann::json entries = nlohmann::json::array();
-    for (auto& bucket : getBuckets()) {
-        for (auto& entry : bucket->getEntries()) {
-            entries.push_back(entry->toJson());
-        }
+    if (pendingSave.valid() && pendingSave.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        log->info("The previous routing table save still in progress, skip this time.");
+        return;
     }
 
-    nlohmann::json root = nlohmann::json::object();
-    root["timestamp"] = currentTimeMillis();
-    root["entries"] = entries;
+    auto logger = log;
+    pendingSave = std::async(std::launch::async, [path, current, logger]() {
+        try {
+            writeSnapshot(path, *current);
+            logger->debug("Saved {} entries to {}", current->getNumBucketEntries(), path);
+        } catch (const std::exception& e) {
+            logger->error("Save routing table to '{}' error: {}", path, e.what());
+        }
+    });
+}
 
-    auto data = nlohmann::json::to_cbor(root);
-    file.write(reinterpret_cast<char*>(data.data()), data.size());
-    file.close();
+void RoutingTable::waitForPendingSave() {
+    if (pendingSave.valid())
+        pendingSave.wait();
 }
 
 bool RoutingTable::isHomeBucket(const Prefix& prefix) const {
     return prefix.isPrefixOf(dht.getNode().getId());
 }
 
-std::string RoutingTable::toString() const {
-    std::string str {};
+int RoutingTable::getBucketCapacity(const Prefix& prefix) const {
+    // The home bucket keeps the standard size, it splits as the local
+    // neighbourhood grows. The far buckets can hold more contacts on the
+    // wide mode, which saves the hops of the lookups.
+    if (isHomeBucket(prefix) || wideBucketSize <= Constants::MAX_ENTRIES_PER_BUCKET)
+        return Constants::MAX_ENTRIES_PER_BUCKET;
+
+    return wideBucketSize;
+}
 
-    auto buckets = getBuckets();
-    str.append("buckets: ")
-        .append(std::to_string(buckets.size()))
-        .append(" / entries: ")
-        .append(std::to_string(getNumBucketEntries()))
-        .append(1, '\n');
+Sp<KBucket> RoutingTable::createBucket(const Prefix& prefix) const {
+    return std::make_shared<KBucket>(prefix, isHomeBucket(prefix), getBucketCapacity(prefix));
+}
+
+void RoutingTable::publish() {
+    auto current = getSnapshot();
+    bool changed = current == nullptr || current->size() != buckets.size();
 
+    std::vector<RoutingTableSnapshot::Bucket> bucketsView {};
+    bucketsView.reserve(buckets.size());
     for (auto& bucket : buckets) {
-        str.append(bucket->toString()).append(1, '\n');
+        auto entries = bucket->_snapshot();
+        if (!changed) {
+            const auto& old = current->getBuckets()[bucketsView.size()];
+            // a new or modified bucket always comes with a new entries copy
+            changed = old.entries != entries;
+        }
+        bucketsView.push_back({bucket->getPrefix(), bucket->isHomeBucket(), entries});
     }
-    return str;
+
+    // Nothing changed since the last publish, keep the current snapshot
+    if (!changed)
+        return;
+
+    auto newSnapshot = std::make_shared<const RoutingTableSnapshot>(std::move(bucketsView), currentTimeMillis());
+    std::atomic_store(&snapshot, newSnapshot);
+}
+
+std::string RoutingTable::toString() const {
+    return getSnapshot()->toString();
 }
 
 }
@@ -27,6 +27,7 @@
 #include <functional>
 #include <memory>
 #include <map>
+#include <future>
 
 #include "carrier/id.h"
 #include "carrier/node_info.h"
@@ -35,8 +36,11 @@
 #include "utils/random_generator.h"
 #include "utils/mtqueue.h"
 #include "utils/log.h"
+#include "utils/token_bucket.h"
+#include "constants.h"
 #include "task/ping_refresh_task.h"
 #include "kbucket.h"
+#include "routing_table_snapshot.h"
 
 namespace elastos {
 namespace carrier {
@@ -51,6 +55,7 @@ public:
     RoutingTable(DHT& dht): dht(dht) {
         buckets.emplace_back(std::make_shared<KBucket>(Prefix {}, true));
         log = Logger::get("RoutingTable");
+        publish();
     }
 
     const std::list<Sp<KBucket>>& getBuckets() const noexcept {
@@ -98,6 +103,44 @@ public:
 
     bool isHomeBucket(const Prefix& prefix) const;
 
+    /**
+     * The capacity of the bucket with the given prefix, the non-home buckets
+     * use the wide bucket size if it's configured.
+     */
+    int getBucketCapacity(const Prefix& prefix) const;
+
+    void setWideBucketSize(int size) noexcept {
+        wideBucketSize = size;
+    }
+
+    int getWideBucketSize() const noexcept {
+        return wideBucketSize;
+    }
+
+    /**
+     * Limit the pings of the periodic maintenance to the given rate (pings per
+     * second), 0 means unlimited. The unused budget is kept for up to one
+     * maintenance interval.
+     */
+    void setMaintenancePingRate(int rate) noexcept {
+        maintenancePingRate = rate;
+        pingBudget = TokenBucket(rate, (double)rate * Constants::ROUTING_TABLE_MAINTENANCE_INTERVAL / 1000);
+    }
+
+    /**
+     * Get the latest published snapshot, safe to be called from any thread.
+     */
+    Sp<const RoutingTableSnapshot> getSnapshot() const noexcept {
+        return std::atomic_load(&snapshot);
+    }
+
+    /**
+     * Make the modifications since the last call visible to the snapshot
+     * readers. Should be called inside the routing table's pipeline, after
+     * each batch of modifications.
+     */
+    void publish();
+
     void _refreshOnly(Sp<KBucketEntry> toRefresh) {
         getBucket(toRefresh->getId())->_update(toRefresh);
     }
@@ -125,7 +168,12 @@ public:
     void fillBuckets();
 
     void load(const std::string&);
+
+    /**
+     * Persist the latest snapshot, the file is written on a background thread.
+     */
     void save(const std::string&);
+    void waitForPendingSave();
 
     void tryPingMaintenance(Sp<KBucket> bucket, const std::vector<PingRefreshTask::Options>& options, const std::string& name);
     std::string toString() const;
@@ -141,6 +189,13 @@ private:
     void _split(const Sp<KBucket>& bucket);
     void _mergeBuckets();
 
+    Sp<KBucket> createBucket(const Prefix& prefix) const;
+    // returns the number of the entries inserted
+    int _bulkPut(std::vector<Sp<KBucketEntry>> entries);
+
+    void load(const uint8_t* data, size_t length);
+    void loadLegacy(const uint8_t* data, size_t length);
+
     /**
      * Check if a buckets needs to be refreshed, and refresh if necessary.
      */
@@ -148,12 +203,20 @@ private:
 
     DHT& dht;
     std::list<Sp<KBucket>> buckets {};
+    Sp<const RoutingTableSnapshot> snapshot {};
 
     long timeOfLastPingCheck {0};
 
+    int wideBucketSize {0};
+    int maintenancePingRate {0};
+    TokenBucket pingBudget {};
+    Id pingCursor {};
+
     std::atomic_bool writeLock {false};
     std::map<Sp<KBucket>, Sp<Task>> maintenanceTasks{};
 
+    std::future<void> pendingSave {};
+
     Sp<Logger> log;
 };
 
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cassert>
+
+#include "routing_table_snapshot.h"
+
+namespace elastos {
+namespace carrier {
+
+RoutingTableSnapshot::RoutingTableSnapshot(std::vector<Bucket>&& _buckets, uint64_t _timestamp)
+    : buckets(std::move(_buckets)), timestamp(_timestamp) {
+    assert(!buckets.empty());
+
+    for (const auto& bucket: buckets)
+        numEntries += bucket.entries->size();
+}
+
+const RoutingTableSnapshot::Bucket& RoutingTableSnapshot::getBucket(const Id& id) const {
+    int low = 0;
+    int mid = 0;
+    int cmp = 0;
+    int high = buckets.size() - 1;
+
+    while (low <= high) {
+        mid = (low + high) >> 1;
+        cmp = id.compareTo(buckets[mid].prefix);
+        if (cmp > 0)
+            low = mid + 1;
+        else if (cmp < 0)
+            high = mid - 1;
+        else  // match the current bucket
+            return buckets[mid];
+    }
+
+    return buckets[cmp < 0 ? mid - 1 : mid];
+}
+
+const KBucketEntry* RoutingTableSnapshot::getEntry(const Id& id) const {
+    for (const auto& entry: *getBucket(id).entries) {
+        if (entry.getId() == id)
+            return &entry;
+    }
+    return nullptr;
+}
+
+std::string RoutingTableSnapshot::toString() const {
+    std::string str {};
+
+    str.append("buckets: ")
+        .append(std::to_string(buckets.size()))
+        .append(" / entries: ")
+        .append(std::to_string(numEntries))
+        .append(1, '\n');
+
+    for (const auto& bucket : buckets) {
+        str.append("Prefix: ").append(bucket.prefix.toString());
+        if (bucket.home)
+            str.append(" [Home]");
+        str.append(1, '\n');
+
+        if (!bucket.entries->empty()) {
+            str.append("  entries[").append(std::to_string(bucket.entries->size())).append("]:\n");
+            for (const auto& entry: *bucket.entries)
+                str.append("    ").append(entry.toString()).append(1, '\n');
+        }
+        str.append(1, '\n');
+    }
+    return str;
+}
+
+} // namespace carrier
+} // namespace elastos
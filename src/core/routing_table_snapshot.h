@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <string>
+
+#include "carrier/id.h"
+#include "carrier/prefix.h"
+#include "carrier/node_info.h"
+#include "carrier/types.h"
+#include "kbucket_entry.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * An immutable view of the routing table.
+ *
+ * The routing table is only modified inside the RPC server's pipeline, the
+ * writer publishes a new snapshot after each batch of modifications. Readers
+ * on any other thread (user API, shell, statistics) grab the current snapshot
+ * without taking any lock, and keep a consistent view for as long as they hold
+ * the reference.
+ *
+ * The entries of the snapshot are copies, so the writer can keep updating the
+ * live entries without racing with the readers. The entries of an unchanged
+ * bucket are shared between the consecutive snapshots.
+ */
+class RoutingTableSnapshot {
+public:
+    struct Bucket {
+        Prefix prefix;
+        bool home;
+        Sp<const std::vector<KBucketEntry>> entries;
+    };
+
+    RoutingTableSnapshot(std::vector<Bucket>&& buckets, uint64_t timestamp);
+
+    const std::vector<Bucket>& getBuckets() const noexcept {
+        return buckets;
+    }
+
+    int size() const noexcept {
+        return buckets.size();
+    }
+
+    int getNumBucketEntries() const noexcept {
+        return numEntries;
+    }
+
+    uint64_t getTimestamp() const noexcept {
+        return timestamp;
+    }
+
+    const Bucket& getBucket(const Id& id) const;
+    const KBucketEntry* getEntry(const Id& id) const;
+
+    std::string toString() const;
+
+private:
+    std::vector<Bucket> buckets;
+    int numEntries {0};
+    uint64_t timestamp {0};
+};
+
+} // namespace carrier
+} // namespace elastos
@@ -84,7 +84,7 @@ void RPCCall::sent(RPCServer* server) {
     // int smear = ThreadLocalRandom.current().nextInt(-1000, 1000);
     // timeoutTimer = scheduler.schedule(this::checkTimeout,
     //         expectedRTT * 1000 + smear, TimeUnit.MICROSECONDS);
-    timeoutTimer = scheduler->get().add(std::bind(&RPCCall::checkTimeout, this), 2000);
+    timeoutTimer = scheduler->get().add(std::bind(&RPCCall::checkTimeout, this), Constants::RPC_CALL_STALL_TIMEOUT);
 }
 
 void RPCCall::responsed(Sp<Message> response) {
@@ -247,11 +247,28 @@ RPCServer::bindSockets(const SocketAddress& bind4, const SocketAddress& bind6)
 void
 RPCServer::openSockets()
 {
+    int lw = -1;
+    SocketAddress lwAddr {};
+    try {
+        lw = bindSocket(SocketAddress("127.0.0.1", 0), lwAddr);
+    } catch (const std::exception& e) {
+        // Not fatal, the RPC loop still wakes up on the select timeout
+        log->warn("Can't bind the wakeup socket: {}", e.what());
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(wakeupLock);
+        wakeupSock = lw;
+        wakeupAddr = lwAddr;
+    }
+
     running = true;
-    rcv_thread = std::thread([this, ls4=sock4, ls6=sock6]() mutable {
-        int selectFd = std::max({ls4, ls6}) + 1;
+    rcv_thread = std::thread([this, ls4=sock4, ls6=sock6, lw]() mutable {
+        int selectFd = std::max({ls4, ls6, lw}) + 1;
         struct timeval timeout;
 
+        rpcThreadId = std::this_thread::get_id();
+
 // TODO:: will be remove
         // //--------------------For Debug-----------------------
         // char name[16];
@@ -269,6 +286,9 @@ RPCServer::openSockets()
                 if (ls6 >= 0) {
                     FD_SET(ls6, &readfds);
                 }
+                if (lw >= 0) {
+                    FD_SET(lw, &readfds);
+                }
 
                 timeout.tv_sec = 0;
                 timeout.tv_usec = 100000;
@@ -285,6 +305,14 @@ RPCServer::openSockets()
                 if (not running)
                     break;
 
+                if (rc > 0 && lw >= 0 && FD_ISSET(lw, &readfds)) {
+                    // Drain the wakeup signals, the periodic jobs run below
+                    char signal[16];
+                    wakeupPending = false;
+                    while (recv(lw, signal, sizeof(signal), 0) > 0) {}
+                    rc--;
+                }
+
                 if (rc > 0) {
                     std::array<uint8_t, 1024 * 64> buf;
                     sockaddr_storage from;
@@ -339,7 +367,7 @@ RPCServer::openSockets()
                                     break;
                                 sock4 = ls4;
                                 sock6 = ls6;
-                                selectFd = std::max({ls4, ls6}) + 1;
+                                selectFd = std::max({ls4, ls6, lw}) + 1;
                             } else {
                                 break;
                             }
@@ -368,7 +396,6 @@ RPCServer::openSockets()
             close(ls6);
 #endif
         }
-
         std::unique_lock<std::mutex> lk(lock, std::try_to_lock);
         if (lk.owns_lock()) {
             sock4 = -1;
@@ -408,12 +435,40 @@ void RPCServer::stop() {
     if (rcv_thread.joinable())
         rcv_thread.join();
 
+    closeWakeupSocket();
+
     if (bound4)
         log->info("Stopped RPC Server ipv4: {}", bound4.toString());
     if (bound6)
         log->info("Stopped RPC Server ipv6: {}", bound6.toString());
 }
 
+void RPCServer::wakeup() {
+    if (wakeupPending.exchange(true))
+        return;
+
+    // closed by stop() under the same lock, never sent to once closed
+    std::lock_guard<std::mutex> lk(wakeupLock);
+    if (wakeupSock < 0)
+        return;
+
+    char signal = 0;
+    sendto(wakeupSock, &signal, 1, 0, wakeupAddr.addr(), wakeupAddr.length());
+}
+
+void RPCServer::closeWakeupSocket() {
+    std::lock_guard<std::mutex> lk(wakeupLock);
+    if (wakeupSock < 0)
+        return;
+
+#if defined(_WIN32) || defined(_WIN64)
+    closesocket(wakeupSock);
+#else
+    close(wakeupSock);
+#endif
+    wakeupSock = -1;
+}
+
 void RPCServer::updateReachability(uint64_t now) {
     // don't do pings too often if we're not receiving anything
     // (connection might be dead)
@@ -616,6 +671,12 @@ void RPCServer::periodic() {
         sendData(msg);
     }
 
+    // start the tasks submitted from the other threads
+    if (dht4)
+        dht4->get().getTaskManager().dequeue();
+    if (dht6)
+        dht6->get().getTaskManager().dequeue();
+
     scheduler.syncTime();
     scheduler.run();
 }
@@ -26,6 +26,8 @@
 #include <queue>
 #include <random>
 #include <optional>
+#include <thread>
+#include <atomic>
 
 #include "utils/log.h"
 #include "messages/message.h"
@@ -76,6 +78,20 @@ public:
         return scheduler;
     }
 
+    /**
+     * Check if the caller is running on the RPC thread, where the tasks and
+     * the scheduler jobs run.
+     */
+    bool isRPCThread() const {
+        return std::this_thread::get_id() == rpcThreadId.load();
+    }
+
+    /**
+     * Wake up the RPC thread to run the periodic jobs without waiting for
+     * the select timeout, can be called from any thread.
+     */
+    void wakeup();
+
     int getNumberOfActiveRPCCalls() {
         return calls.size();
     }
@@ -89,6 +105,7 @@ public:
 private:
     void bindSockets(const SocketAddress& bind4, const SocketAddress& bind6);
     void openSockets();
+    void closeWakeupSocket();
     int sendData(Sp<Message>& msg);
     void handlePacket(const uint8_t *buf, size_t buflen, const SocketAddress& from);
     void periodic();
@@ -110,8 +127,15 @@ private:
     SocketAddress bound6;
 
     std::thread rcv_thread;
+    std::atomic<std::thread::id> rpcThreadId {};
     std::atomic_bool running {false};
 
+    // owned by stop(), not by the RPC thread, the wakeups may come after the thread exited
+    int wakeupSock {-1};
+    SocketAddress wakeupAddr;
+    std::atomic_bool wakeupPending {false};
+    std::mutex wakeupLock;
+
     std::list<Sp<RPCCall>> callQueue;
     std::map<int, Sp<RPCCall>> calls;
 
@@ -20,6 +20,8 @@
  * SOFTWARE.
  */
 
+#include <cstring>
+
 #include "carrier/id.h"
 #include "carrier/peer_info.h"
 #include "crypto/hex.h"
@@ -80,15 +82,32 @@ static std::string UPSERT_VALUE = "INSERT INTO valores(\
         signature=excluded.signature, sequenceNumber=excluded.sequenceNumber, \
         data=excluded.data, timestamp=excluded.timestamp";
 
-static std::string SELECT_VALUE = "SELECT * from valores \
+// The columns read by readValue() and readPeer(), by ordinal
+#define VALUE_COLUMNS "publicKey, privateKey, recipient, nonce, signature, sequenceNumber, data"
+#define PEER_COLUMNS "id, nodeId, origin, privateKey, port, alternativeURL, signature"
+
+static std::string SELECT_VALUE = "SELECT " VALUE_COLUMNS " from valores \
         WHERE id = ? and timestamp >= ?";
 
 static std::string UPDATE_VALUE_LAST_ANNOUNCE = "UPDATE valores \
         SET timestamp=?, announced = ? WHERE id = ?";
 
-static std::string GET_VALUES = "SELECT id from valores WHERE timestamp >= ? ORDER BY id";
+// The scans page by the primary key from the cursor, an empty blob sorts
+// before any id, within the id range of the prefix of the cursor
+static std::string SCAN_VALUE_IDS = "SELECT id from valores \
+        WHERE id > ? AND id BETWEEN ? AND ? AND timestamp >= ? ORDER BY id LIMIT ?";
+
+static std::string SCAN_VALUES = "SELECT " VALUE_COLUMNS " from valores \
+        WHERE id > ? AND id BETWEEN ? AND ? AND timestamp >= ? ORDER BY id LIMIT ?";
+
+static std::string SCAN_PERSISTENT_VALUES = "SELECT " VALUE_COLUMNS " FROM valores \
+        WHERE id > ? AND id BETWEEN ? AND ? AND persistent = true AND announced <= ? ORDER BY id LIMIT ?";
 
-static std::string GET_PERSISTENT_VALUES = "SELECT * FROM valores WHERE persistent = true AND announced <= ?";
+// The unary + keeps the planner on the id range instead of the timestamp index
+static std::string COUNT_VALUES = "SELECT count(*), total(length(id) + ifnull(length(publicKey), 0) + \
+        ifnull(length(privateKey), 0) + ifnull(length(recipient), 0) + ifnull(length(nonce), 0) + \
+        ifnull(length(signature), 0) + ifnull(length(data), 0)) \
+        FROM valores WHERE id BETWEEN ? AND ? AND +timestamp >= ?";
 
 static std::string REMOVE_VALUE = "DELETE FROM valores WHERE id = ?";
 
@@ -100,53 +119,203 @@ static std::string UPSERT_PEER = "INSERT INTO peers(\
         signature=excluded.signature, timestamp=excluded.timestamp, \
 		announced=excluded.announced";
 
-static std::string SELECT_PEER = "SELECT * from peers \
+static std::string SELECT_PEER = "SELECT " PEER_COLUMNS " from peers \
         WHERE id = ? and timestamp >= ? \
         ORDER BY RANDOM() LIMIT ?";
 
-static std::string SELECT_PEER_WITH_SRC = "SELECT * from peers \
+static std::string SELECT_PEER_WITH_SRC = "SELECT " PEER_COLUMNS " from peers \
         WHERE id = ? and origin = ? and timestamp >= ?";
 
 static std::string UPDATE_PEER_LAST_ANNOUNCE = "UPDATE peers \
         SET timestamp=?, announced = ? WHERE id = ? and origin = ?";
 
-static std::string GET_PEERS = "SELECT DISTINCT id from peers WHERE timestamp >= ? ORDER BY id";
+static std::string SCAN_PEER_IDS = "SELECT DISTINCT id from peers \
+        WHERE id > ? AND id BETWEEN ? AND ? AND timestamp >= ? ORDER BY id LIMIT ?";
 
-static std::string GET_PERSISTENT_PEERS = "SELECT * FROM peers WHERE persistent = true AND announced <= ?";
+static std::string SCAN_PEERS = "SELECT " PEER_COLUMNS " FROM peers \
+        WHERE (id, nodeId, origin) > (?, ?, ?) AND id BETWEEN ? AND ? AND timestamp >= ? \
+        ORDER BY id, nodeId, origin LIMIT ?";
+
+static std::string SCAN_PERSISTENT_PEERS = "SELECT " PEER_COLUMNS " FROM peers \
+        WHERE (id, nodeId, origin) > (?, ?, ?) AND id BETWEEN ? AND ? AND persistent = true AND announced <= ? \
+        ORDER BY id, nodeId, origin LIMIT ?";
+
+static std::string COUNT_PEERS = "SELECT count(*), total(length(id) + length(nodeId) + length(origin) + \
+        ifnull(length(privateKey), 0) + ifnull(length(alternativeURL), 0) + length(signature)) \
+        FROM peers WHERE id BETWEEN ? AND ? AND +timestamp >= ?";
 
 static std::string REMOVE_PEER = "DELETE FROM peers WHERE id = ? and origin = ?";
 
-SqliteStorage::~SqliteStorage() {
-    if (sqlite_store) {
-        sqlite3_close(sqlite_store);
-        sqlite_store = NULL;
+// Expire in chunks of at most the given rows, so a large expiration does not hold the database
+static std::string EXPIRE_VALUES = "DELETE FROM valores WHERE id IN (\
+        SELECT id FROM valores WHERE persistent != TRUE and timestamp < ? LIMIT ?)";
+
+static std::string EXPIRE_PEERS = "DELETE FROM peers WHERE (id, nodeId, origin) IN (\
+        SELECT id, nodeId, origin FROM peers WHERE persistent != TRUE and timestamp < ? LIMIT ?)";
+
+/*
+ * Resets the prepared statement when leaving the scope, so it is ready for
+ * the next use. The statements are kept for the lifetime of the connection.
+ */
+class StatementScope {
+public:
+    StatementScope(sqlite3_stmt* stmt) : stmt(stmt) {
+        if (stmt == nullptr)
+            throw std::runtime_error("SQLite storage is closed.");
+    }
+
+    ~StatementScope() {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+    }
+
+private:
+    sqlite3_stmt* stmt;
+};
+
+static Blob columnBlob(sqlite3_stmt* stmt, int column) {
+    if (sqlite3_column_type(stmt, column) != SQLITE_BLOB)
+        return {};
+
+    return Blob(sqlite3_column_blob(stmt, column), sqlite3_column_bytes(stmt, column));
+}
+
+// Reads the VALUE_COLUMNS of the current row
+static Value readValue(sqlite3_stmt* stmt) {
+    auto nonce = columnBlob(stmt, 3);
+    if (nonce.size() != CryptoBox::Nonce::BYTES)
+        nonce = {};
+
+    int sequenceNumber = sqlite3_column_type(stmt, 5) == SQLITE_INTEGER ? sqlite3_column_int(stmt, 5) : 0;
+
+    return Value::of(columnBlob(stmt, 0), columnBlob(stmt, 1), columnBlob(stmt, 2), nonce,
+            sequenceNumber, columnBlob(stmt, 4), columnBlob(stmt, 6));
+}
+
+// Reads the PEER_COLUMNS of the current row
+static PeerInfo readPeer(sqlite3_stmt* stmt) {
+    auto alt = (const char*)sqlite3_column_text(stmt, 5);
+
+    return PeerInfo::of(columnBlob(stmt, 0), columnBlob(stmt, 3), columnBlob(stmt, 1), columnBlob(stmt, 2),
+            sqlite3_column_int(stmt, 4), alt ? alt : "", columnBlob(stmt, 6));
+}
+
+// Binds a key of the cursor, or the empty blob before the first page
+static void bindCursor(sqlite3_stmt* stmt, int index, const ScanCursor& cursor, const Id& key) {
+    if (cursor.started)
+        sqlite3_bind_blob(stmt, index, key.data(), key.size(), SQLITE_STATIC);
+    else
+        sqlite3_bind_zeroblob(stmt, index, 0);
+}
+
+// Binds the first and the last id under the prefix
+static void bindRange(sqlite3_stmt* stmt, int index, const Prefix& prefix) {
+    auto first = prefix.first();
+    auto last = prefix.last();
+    sqlite3_bind_blob(stmt, index, first.data(), first.size(), SQLITE_TRANSIENT);
+    sqlite3_bind_blob(stmt, index + 1, last.data(), last.size(), SQLITE_TRANSIENT);
+}
+
+static void bindPeer(sqlite3_stmt* stmt, const PeerInfo& peer, bool persistent, uint64_t now, uint64_t announced) {
+    sqlite3_bind_blob(stmt, 1, peer.getId().data(), peer.getId().size(), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 2, peer.getNodeId().data(), peer.getNodeId().size(), SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 3, peer.getOrigin().data(), peer.getOrigin().size(), SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, persistent);
+    if (peer.hasPrivateKey())
+        sqlite3_bind_blob(stmt, 5, peer.getPrivateKey().bytes(), peer.getPrivateKey().size(), SQLITE_STATIC);
+    else
+        sqlite3_bind_null(stmt, 5);
+    sqlite3_bind_int(stmt, 6, peer.getPort());
+    if (peer.hasAlternativeURL()) {
+        const auto& alt = peer.getAlternativeURL();
+        sqlite3_bind_text(stmt, 7, alt.c_str(), alt.size(), SQLITE_STATIC);
+    } else {
+        sqlite3_bind_null(stmt, 7);
     }
+    sqlite3_bind_blob(stmt, 8, peer.getSignature().data(), peer.getSignature().size(), SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 9, now);
+    sqlite3_bind_int64(stmt, 10, announced);
 }
 
-void SqliteStorage::expire() {
-    const char *sqls[2] = { "DELETE FROM valores WHERE persistent != TRUE and timestamp < ?",  "DELETE FROM peers WHERE persistent != TRUE and timestamp < ?"};
+SqliteStorage::~SqliteStorage() {
+    close();
+}
+
+size_t SqliteStorage::expire(size_t maxEntries) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (sqlite_store == nullptr)
+        return 0;
+
+    sqlite3_stmt* stmts[2] = { expireValues, expirePeers };
     uint64_t ts[2];
     ts[0] = currentTimeMillis() - Constants::MAX_VALUE_AGE;
     ts[1] = currentTimeMillis() - Constants::MAX_PEER_AGE;
 
+    size_t removed = 0;
     for (int i = 0; i < 2; i++) {
-        sqlite3_stmt *pStmt;
-        if (sqlite3_prepare_v2(sqlite_store, sqls[i], strlen(sqls[i]), &pStmt, 0) != SQLITE_OK) {
-            sqlite3_finalize(pStmt);
-            throw std::runtime_error("Prepare sqlite failed.");
-        }
+        StatementScope scope(stmts[i]);
+        sqlite3_bind_int64(stmts[i], 1, ts[i]);
+        sqlite3_bind_int64(stmts[i], 2, maxEntries);
+        if (sqlite3_step(stmts[i]) == SQLITE_DONE)
+            removed += sqlite3_changes(sqlite_store);
+    }
 
-        sqlite3_bind_int64(pStmt, 1, ts[i]);
-        sqlite3_step(pStmt);
-        sqlite3_finalize(pStmt);
+    return removed;
+}
+
+void SqliteStorage::batch(const std::function<void()>& writes) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (sqlite_store == nullptr)
+        throw std::runtime_error("SQLite storage is closed.");
+
+    // nested in an outer batch
+    if (!sqlite3_get_autocommit(sqlite_store)) {
+        writes();
+        return;
+    }
+
+    if (sqlite3_exec(sqlite_store, "BEGIN", 0, 0, 0) != 0)
+        throw std::runtime_error("Begin the SQLite transaction failed.");
+
+    try {
+        writes();
+    } catch (...) {
+        sqlite3_exec(sqlite_store, "ROLLBACK", 0, 0, 0);
+        throw;
+    }
+
+    if (sqlite3_exec(sqlite_store, "COMMIT", 0, 0, 0) != 0) {
+        sqlite3_exec(sqlite_store, "ROLLBACK", 0, 0, 0);
+        throw std::runtime_error("Commit the SQLite transaction failed: " + std::string(sqlite3_errmsg(sqlite_store)));
     }
 }
 
-void SqliteStorage::init(const std::string& path, Scheduler& scheduler) {
+void SqliteStorage::prepare(sqlite3_stmt** stmt, const std::string& sql) {
+    if (sqlite3_prepare_v3(sqlite_store, sql.c_str(), sql.size(), SQLITE_PREPARE_PERSISTENT, stmt, nullptr) != SQLITE_OK)
+        throw std::runtime_error("Prepare sqlite failed: " + std::string(sqlite3_errmsg(sqlite_store)));
+}
+
+void SqliteStorage::init(const std::string& path, int mmapSize, int cacheSize) {
     int rc = sqlite3_open(path.c_str(), &sqlite_store);
     if (rc)
         throw std::runtime_error("Failed to open the SQLite storage.");
 
+    // the other connections on the same file may hold the write lock for a commit
+    sqlite3_busy_timeout(sqlite_store, Constants::STORAGE_BUSY_TIMEOUT);
+
+    // WAL lets the reads go on during a write, and with synchronous=NORMAL a
+    // commit does not wait for the fsync, only the checkpoints do. A power
+    // loss may lose the last commits, but never corrupts the database.
+    auto mmap = "PRAGMA mmap_size = " + std::to_string(mmapSize > 0 ? mmapSize : Constants::STORAGE_MMAP_SIZE);
+    // the negative cache size is in KiB, not pages
+    auto cache = "PRAGMA cache_size = -" + std::to_string((cacheSize > 0 ? cacheSize : Constants::STORAGE_CACHE_SIZE) / 1024);
+    if (sqlite3_exec(sqlite_store, "PRAGMA journal_mode = WAL", 0, 0, 0) != 0 ||
+        sqlite3_exec(sqlite_store, "PRAGMA synchronous = NORMAL", 0, 0, 0) != 0 ||
+        sqlite3_exec(sqlite_store, mmap.c_str(), 0, 0, 0) != 0 ||
+        sqlite3_exec(sqlite_store, cache.c_str(), 0, 0, 0) != 0) {
+        throw std::runtime_error("Failed to set the SQLite pragmas.");
+    }
+
     // if we change the schema,
     // we should check the user version, do the schema update,
     // then increase the user_version;
@@ -171,18 +340,55 @@ void SqliteStorage::init(const std::string& path, Scheduler& scheduler) {
         throw std::runtime_error("Failed to update SQLite text.");
     }
 
+    prepare(&selectValue, SELECT_VALUE);
+    prepare(&upsertValue, UPSERT_VALUE);
+    prepare(&updateValueAnnounced, UPDATE_VALUE_LAST_ANNOUNCE);
+    prepare(&selectValueIds, SCAN_VALUE_IDS);
+    prepare(&selectValueRange, SCAN_VALUES);
+    prepare(&selectPersistentValues, SCAN_PERSISTENT_VALUES);
+    prepare(&countValues, COUNT_VALUES);
+    prepare(&deleteValue, REMOVE_VALUE);
+    prepare(&upsertPeer, UPSERT_PEER);
+    prepare(&selectPeers, SELECT_PEER);
+    prepare(&selectPeer, SELECT_PEER_WITH_SRC);
+    prepare(&updatePeerAnnounced, UPDATE_PEER_LAST_ANNOUNCE);
+    prepare(&selectPeerIds, SCAN_PEER_IDS);
+    prepare(&selectPeerRange, SCAN_PEERS);
+    prepare(&selectPersistentPeers, SCAN_PERSISTENT_PEERS);
+    prepare(&countPeers, COUNT_PEERS);
+    prepare(&deletePeer, REMOVE_PEER);
+    prepare(&expireValues, EXPIRE_VALUES);
+    prepare(&expirePeers, EXPIRE_PEERS);
+}
+
+Sp<DataStorage> SqliteStorage::open(const std::string& path, Scheduler& scheduler, int mmapSize, int cacheSize) {
+    Sp<SqliteStorage> storage = std::make_shared<SqliteStorage>();
+    storage->init(path, mmapSize, cacheSize);
+
     scheduler.add([=]() {
-        expire();
+        while (storage->expire(Constants::STORAGE_EXPIRE_CHUNK) > 0);
     }, 0, Constants::STORAGE_EXPIRE_INTERVAL);
+
+    return std::static_pointer_cast<DataStorage>(storage);
 }
 
-Sp<DataStorage> SqliteStorage::open(const std::string& path, Scheduler& scheduler) {
+Sp<DataStorage> SqliteStorage::open(const std::string& path, int mmapSize, int cacheSize) {
     Sp<SqliteStorage> storage = std::make_shared<SqliteStorage>();
-    storage->init(path, scheduler);
+    storage->init(path, mmapSize, cacheSize);
     return std::static_pointer_cast<DataStorage>(storage);
 }
 
 void SqliteStorage::close() {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
+    for (auto stmt : { &selectValue, &upsertValue, &updateValueAnnounced, &selectValueIds, &selectValueRange,
+            &selectPersistentValues, &countValues, &deleteValue, &upsertPeer, &selectPeers, &selectPeer,
+            &updatePeerAnnounced, &selectPeerIds, &selectPeerRange, &selectPersistentPeers, &countPeers,
+            &deletePeer, &expireValues, &expirePeers }) {
+        sqlite3_finalize(*stmt);
+        *stmt = nullptr;
+    }
+
     if (sqlite_store) {
         sqlite3_close(sqlite_store);
         sqlite_store = NULL;
@@ -205,86 +411,31 @@ int SqliteStorage::getUserVersion() {
 }
 
 Sp<Value> SqliteStorage::getValue(const Id& valueId) {
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, SELECT_VALUE.c_str(), strlen(SELECT_VALUE.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectValue);
 
     const uint64_t when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
-    sqlite3_bind_blob(pStmt, 1, valueId.data(), valueId.size(), SQLITE_STATIC);
-    sqlite3_bind_int64(pStmt, 2, when);
-
-    if (sqlite3_step(pStmt) == SQLITE_ROW) {
-        Blob publicKey {};
-        Blob privateKey {};
-        Blob recipient {};
-        Blob nonce {};
-        Blob signature {};
-        Blob data {};
-        int sequenceNumber {0};
-
-        int cNum = sqlite3_column_count(pStmt);
-        for (int i = 0; i < cNum; i++) {
-            const char* name = sqlite3_column_name(pStmt, i);
-            const int cType = sqlite3_column_type(pStmt, i);
-            int len= 0;
-            const void *ptr = NULL;
-
-            if (cType == SQLITE_BLOB) {
-                len = sqlite3_column_bytes(pStmt, i);
-                ptr = sqlite3_column_blob(pStmt, i);
-            }
-
-            if (std::strcmp(name, "publicKey") == 0 && len > 0) {
-                publicKey = Blob(ptr, len);
-            } else if (std::strcmp(name, "privateKey") == 0 && len > 0) {
-                privateKey = Blob(ptr, len);
-            } else if (strcmp(name, "recipient") == 0 && len > 0) {
-                recipient = Blob(ptr, len);
-            } else if (strcmp(name, "nonce") == 0 && len > 0 && len == CryptoBox::Nonce::BYTES) {
-                nonce = Blob(ptr, len);
-            } else if (strcmp(name, "signature") == 0 && len > 0) {
-                signature = Blob(ptr, len);
-            } else if (strcmp(name, "sequenceNumber") == 0 && cType == SQLITE_INTEGER) {
-                sequenceNumber = sqlite3_column_int(pStmt, i);
-            } else if (strcmp(name, "data") == 0 && len > 0) {
-                data = Blob(ptr, len);
-            }
-        }
+    sqlite3_bind_blob(selectValue, 1, valueId.data(), valueId.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(selectValue, 2, when);
 
-        auto value = Value::of(publicKey, privateKey, recipient, nonce, sequenceNumber, signature, data);
-        sqlite3_finalize(pStmt);
-        return std::make_shared<Value>(value);
-    }
+    if (sqlite3_step(selectValue) == SQLITE_ROW)
+        return std::make_shared<Value>(readValue(selectValue));
 
-    sqlite3_finalize(pStmt);
     return nullptr;
 }
 
 Sp<Value> SqliteStorage::putValue(const Value& value, int expectedSeq, bool persistent, bool updateLastAnnounce) {
-    sqlite3_stmt *pStmt;
-
     if (value.isMutable() && !value.isValid())
         throw std::invalid_argument("Value signature validation failed");
 
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+
     auto id = value.getId();
     auto old = getValue(id);
-    if (old != nullptr && old->isMutable()) {
-        if(!value.isMutable())
-            throw std::invalid_argument("Can not replace mutable value with immutable is not supported");
-        if (old->hasPrivateKey() && !value.hasPrivateKey())
-            throw std::invalid_argument("Not the owner of value");
-        if(value.getSequenceNumber() < old->getSequenceNumber())
-            throw std::invalid_argument("Sequence number less than current");
-        if(expectedSeq >= 0 && old->getSequenceNumber() >= 0 && old->getSequenceNumber() != expectedSeq)
-            throw std::invalid_argument("CAS failure");
-    }
+    checkReplace(old, value, expectedSeq);
 
-    if (sqlite3_prepare_v2(sqlite_store, UPSERT_VALUE.c_str(), strlen(UPSERT_VALUE.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
+    auto pStmt = upsertValue;
+    StatementScope scope(pStmt);
 
     sqlite3_bind_blob(pStmt, 1, id.data(), id.size(), SQLITE_STATIC);
     sqlite3_bind_int(pStmt, 2, persistent);
@@ -334,131 +485,84 @@ Sp<Value> SqliteStorage::putValue(const Value& value, int expectedSeq, bool pers
     sqlite3_bind_int64(pStmt, 11, updateLastAnnounce ? now : 0);
 
     sqlite3_step(pStmt);
-    sqlite3_finalize(pStmt);
     return old;
 }
 
-std::vector<Id> SqliteStorage::getAllValues() {
+std::vector<Id> SqliteStorage::scanValueIds(ScanCursor& cursor, size_t limit) {
     std::vector<Id> ids {};
 
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, GET_VALUES.c_str(), strlen(GET_VALUES.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectValueIds);
 
     const uint64_t when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
-    sqlite3_bind_int64(pStmt, 1, when);
+    bindCursor(selectValueIds, 1, cursor, cursor.id);
+    bindRange(selectValueIds, 2, cursor.prefix);
+    sqlite3_bind_int64(selectValueIds, 4, when);
+    sqlite3_bind_int64(selectValueIds, 5, limit);
 
-    while (sqlite3_step(pStmt) == SQLITE_ROW) {
-        int cNum = sqlite3_column_count(pStmt);
-        for (int i = 0; i < cNum; i++) {
-            const int cType = sqlite3_column_type(pStmt, i);
-            size_t len {0};
-            const uint8_t* ptr {};
+    while (sqlite3_step(selectValueIds) == SQLITE_ROW)
+        ids.emplace_back(columnBlob(selectValueIds, 0));
 
-            if (cType == SQLITE_BLOB) {
-                len = sqlite3_column_bytes(pStmt, i);
-                ptr = (const uint8_t*)sqlite3_column_blob(pStmt, i);
+    advance(cursor, ids, limit);
+    return ids;
+}
 
-                ids.emplace_back(Blob(ptr, len));
-            }
-        }
-    }
+std::vector<Value> SqliteStorage::scanValues(ScanCursor& cursor, size_t limit) {
+    std::vector<Value> values {};
 
-    sqlite3_finalize(pStmt);
-    return ids;
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectValueRange);
+
+    const uint64_t when = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    bindCursor(selectValueRange, 1, cursor, cursor.id);
+    bindRange(selectValueRange, 2, cursor.prefix);
+    sqlite3_bind_int64(selectValueRange, 4, when);
+    sqlite3_bind_int64(selectValueRange, 5, limit);
+
+    while (sqlite3_step(selectValueRange) == SQLITE_ROW)
+        values.emplace_back(readValue(selectValueRange));
+
+    advance(cursor, values, limit);
+    return values;
 }
 
 void SqliteStorage::updateValueLastAnnounce(const Id& valueId) {
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, UPDATE_VALUE_LAST_ANNOUNCE.c_str(), strlen(UPDATE_VALUE_LAST_ANNOUNCE.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(updateValueAnnounced);
 
     auto now = currentTimeMillis();
-    sqlite3_bind_int64(pStmt, 1, now);
-    sqlite3_bind_int64(pStmt, 2, now);
-    sqlite3_bind_blob(pStmt, 3, valueId.data(), valueId.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(updateValueAnnounced, 1, now);
+    sqlite3_bind_int64(updateValueAnnounced, 2, now);
+    sqlite3_bind_blob(updateValueAnnounced, 3, valueId.data(), valueId.size(), SQLITE_STATIC);
 
-    sqlite3_step(pStmt);
-    sqlite3_finalize(pStmt);
+    sqlite3_step(updateValueAnnounced);
 }
 
-std::vector<Value> SqliteStorage::getPersistentValues(uint64_t lastAnnounceBefore) {
+std::vector<Value> SqliteStorage::scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
     std::vector<Value> values {};
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, GET_PERSISTENT_VALUES.c_str(), strlen(GET_PERSISTENT_VALUES.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
 
-    sqlite3_bind_int64(pStmt, 1, lastAnnounceBefore);
-
-    while (sqlite3_step(pStmt) == SQLITE_ROW) {
-        Blob publicKey {};
-        Blob privateKey {};
-        Blob recipient {};
-        Blob nonce {};
-        Blob  signature {};
-        Blob data {};
-        int sequenceNumber {0};
-
-        int cNum = sqlite3_column_count(pStmt);
-        for (int i = 0; i < cNum; i++) {
-            const char* name = sqlite3_column_name(pStmt, i);
-            const int cType = sqlite3_column_type(pStmt, i);
-            int len= 0;
-            const void *ptr = NULL;
-
-            if (cType == SQLITE_BLOB) {
-                len = sqlite3_column_bytes(pStmt, i);
-                ptr = sqlite3_column_blob(pStmt, i);
-            }
-
-            if (std::strcmp(name, "publicKey") == 0 && len > 0) {
-                publicKey = Blob(ptr, len);
-            } else if (std::strcmp(name, "privateKey") == 0 && len > 0) {
-                privateKey = Blob(ptr, len);
-            } else if (strcmp(name, "recipient") == 0 && len > 0) {
-                recipient = Blob(ptr, len);
-            } else if (strcmp(name, "nonce") == 0 && len > 0 && len == CryptoBox::Nonce::BYTES) {
-                nonce = Blob(ptr, len);
-            } else if (strcmp(name, "signature") == 0 && len > 0) {
-                signature = Blob(ptr, len);
-            } else if (strcmp(name, "sequenceNumber") == 0 && cType == SQLITE_INTEGER) {
-                sequenceNumber = sqlite3_column_int(pStmt, i);
-            } else if (strcmp(name, "data") == 0 && len > 0) {
-                data = Blob(ptr, len);
-            }
-        }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectPersistentValues);
 
-        auto value = Value::of(publicKey, privateKey, recipient, nonce, sequenceNumber, signature, data);
-        values.emplace_back(value);
-    }
+    bindCursor(selectPersistentValues, 1, cursor, cursor.id);
+    bindRange(selectPersistentValues, 2, cursor.prefix);
+    sqlite3_bind_int64(selectPersistentValues, 4, lastAnnounceBefore);
+    sqlite3_bind_int64(selectPersistentValues, 5, limit);
 
-    sqlite3_finalize(pStmt);
+    while (sqlite3_step(selectPersistentValues) == SQLITE_ROW)
+        values.emplace_back(readValue(selectPersistentValues));
+
+    advance(cursor, values, limit);
     return values;
 }
 
 bool SqliteStorage::removeValue(const Id& valueId) {
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, REMOVE_VALUE.c_str(), strlen(REMOVE_VALUE.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
-
-    sqlite3_bind_blob(pStmt, 1, valueId.data(), valueId.size(), SQLITE_STATIC);
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(deleteValue);
 
-    bool ret = false;
-    if (sqlite3_step(pStmt) == SQLITE_DONE) {
-        if (sqlite3_changes(sqlite_store) > 0)
-            ret = true;
-    }
+    sqlite3_bind_blob(deleteValue, 1, valueId.data(), valueId.size(), SQLITE_STATIC);
 
-    sqlite3_finalize(pStmt);
-    return ret;
+    return sqlite3_step(deleteValue) == SQLITE_DONE && sqlite3_changes(sqlite_store) > 0;
 }
 
 std::vector<PeerInfo> SqliteStorage::getPeer(const Id& peerId, int maxPeers) {
@@ -466,314 +570,168 @@ std::vector<PeerInfo> SqliteStorage::getPeer(const Id& peerId, int maxPeers) {
         maxPeers = 0x7fffffff;
 
     std::vector<PeerInfo> peers {};
-    sqlite3_stmt *pStmt;
-    if(sqlite3_prepare_v2(sqlite_store, SELECT_PEER.c_str(), strlen(SELECT_PEER.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");
-    }
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectPeers);
 
     uint64_t when = currentTimeMillis() - Constants::MAX_PEER_AGE;
-    sqlite3_bind_blob(pStmt, 1, peerId.data(), peerId.size(), SQLITE_STATIC);
-    sqlite3_bind_int64(pStmt, 2, when);
-    sqlite3_bind_int(pStmt, 3, maxPeers);
-
-    while (sqlite3_step(pStmt) == SQLITE_ROW) {
-        Blob privateKey {};
-        Blob nodeId {};
-        Blob origin {};
-        uint16_t port {0};
-        std::string alt {};
-        Blob signature {};
-
-        int cNum = sqlite3_column_count(pStmt);
-        for (int i = 0; i < cNum; i++) {
-            const char *name = sqlite3_column_name(pStmt, i);
-            int cType = sqlite3_column_type(pStmt, i);
-            int len = 0;
-            const void *ptr = NULL;
-
-            if (cType == SQLITE_BLOB) {
-                len = sqlite3_column_bytes(pStmt, i);
-                ptr = sqlite3_column_blob(pStmt, i);
-            }
-
-            if (std::strcmp(name, "privateKey") == 0 && len > 0) {
-                privateKey = Blob(ptr, len);
-            } else if (std::strcmp(name, "nodeId") == 0 && len > 0) {
-                nodeId = Blob(ptr, len);
-            } else if (std::strcmp(name, "origin") == 0 && len > 0) {
-                origin = Blob(ptr, len);
-            } else if (std::strcmp(name, "port") == 0) {
-                port = sqlite3_column_int(pStmt, i);
-            } else if (std::strcmp(name, "alternativeURL") == 0) {
-                auto c = (char *)sqlite3_column_text(pStmt, i);
-                alt = c ? c : "";
-            } else if (std::strcmp(name, "signature") == 0) {
-                signature = Blob(ptr, len);
-            }
-        }
+    sqlite3_bind_blob(selectPeers, 1, peerId.data(), peerId.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(selectPeers, 2, when);
+    sqlite3_bind_int(selectPeers, 3, maxPeers);
 
-        auto peer = PeerInfo::of(peerId.blob(), privateKey, nodeId, origin, port, alt, signature);
-        peers.emplace_back(peer);
-    }
-    sqlite3_finalize(pStmt);
+    while (sqlite3_step(selectPeers) == SQLITE_ROW)
+        peers.emplace_back(readPeer(selectPeers));
 
     return peers;
 }
 
 Sp<PeerInfo> SqliteStorage::getPeer(const Id& peerId, const Id& origin) {
-    sqlite3_stmt *pStmt {nullptr};
-    if(sqlite3_prepare_v2(sqlite_store, SELECT_PEER_WITH_SRC.c_str(), strlen(SELECT_PEER_WITH_SRC.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");
-    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectPeer);
 
     const uint64_t when = currentTimeMillis() - Constants::MAX_PEER_AGE;
-    sqlite3_bind_blob(pStmt, 1, peerId.data(), peerId.size(), SQLITE_STATIC);
-    sqlite3_bind_blob(pStmt, 2, origin.data(), origin.size(), SQLITE_STATIC);
-    sqlite3_bind_int64(pStmt, 3, when);
-
-    if (sqlite3_step(pStmt) == SQLITE_ROW) {
-        Blob privateKey {};
-        Blob nodeId {};
-        Blob origin {};
-        uint16_t port {0};
-        std::string alt {};
-        Blob  signature {};
-
-        const int cNum = sqlite3_column_count(pStmt);
-        for (int i = 0; i < cNum; i++) {
-            const char* name = sqlite3_column_name(pStmt, i);
-            const int cType = sqlite3_column_type(pStmt, i);
-            int len = 0;
-            const void *ptr = NULL;
-
-            if (cType == SQLITE_BLOB) {
-                len = sqlite3_column_bytes(pStmt, i);
-                ptr = sqlite3_column_blob(pStmt, i);
-            }
-
-            if (std::strcmp(name, "privateKey") == 0 && len > 0) {
-                privateKey = Blob(ptr, len);
-            } else if (std::strcmp(name, "nodeId") == 0 && len > 0) {
-                nodeId = Blob(ptr, len);
-            } else if (std::strcmp(name, "origin") == 0 && len > 0) {
-                origin = Blob(ptr, len);
-            } else if (std::strcmp(name, "port") == 0) {
-                port = sqlite3_column_int(pStmt, i);
-            } else if (std::strcmp(name, "alternativeURL") == 0) {
-                auto c = (char *)sqlite3_column_text(pStmt, i);
-                alt = c ? c : "";
-            } else if (std::strcmp(name, "signature") == 0) {
-                signature = Blob(ptr, len);
-            }
-        }
+    sqlite3_bind_blob(selectPeer, 1, peerId.data(), peerId.size(), SQLITE_STATIC);
+    sqlite3_bind_blob(selectPeer, 2, origin.data(), origin.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(selectPeer, 3, when);
 
-        auto peer = PeerInfo::of(peerId.blob(), privateKey, nodeId, origin, port, alt, signature);
-        sqlite3_finalize(pStmt);
-        return std::make_shared<PeerInfo>(peer);
-    }
+    if (sqlite3_step(selectPeer) == SQLITE_ROW)
+        return std::make_shared<PeerInfo>(readPeer(selectPeer));
 
-    sqlite3_finalize(pStmt);
     return nullptr;
 }
 
 void SqliteStorage::putPeer(const std::vector<PeerInfo>& peers) {
-    if (sqlite3_exec(sqlite_store, "BEGIN", 0, 0, 0) != 0)
-        throw std::runtime_error("Open auto commit mode failed.");
+    batch([&]() {
+        StatementScope scope(upsertPeer);
 
-    sqlite3_stmt *pStmt {nullptr};
-    if(sqlite3_prepare_v2(sqlite_store, UPSERT_PEER.c_str(), strlen(UPSERT_PEER.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");
-    }
+        uint64_t now = currentTimeMillis();
+        for (const auto& peer : peers) {
+            bindPeer(upsertPeer, peer, false, now, 0);
 
-    uint64_t now = currentTimeMillis();
-    for (const auto& peer : peers) {
-        sqlite3_bind_blob(pStmt, 1, peer.getId().data(), peer.getId().size(), SQLITE_STATIC);
-        sqlite3_bind_blob(pStmt, 2, peer.getNodeId().data(), peer.getNodeId().size(), SQLITE_STATIC);
-        sqlite3_bind_blob(pStmt, 3, peer.getOrigin().data(), peer.getOrigin().size(), SQLITE_STATIC);
-        sqlite3_bind_int(pStmt, 4, false);
-        if (peer.hasPrivateKey())
-            sqlite3_bind_blob(pStmt, 5, peer.getPrivateKey().bytes(), peer.getPrivateKey().size(), SQLITE_STATIC);
-        else
-            sqlite3_bind_null(pStmt, 5);
-        sqlite3_bind_int(pStmt, 6, peer.getPort());
-        if (peer.hasAlternativeURL()) {
-            const char* alt = peer.getAlternativeURL().c_str();
-            sqlite3_bind_text(pStmt, 7, alt, strlen(alt), SQLITE_STATIC);
-        } else {
-            sqlite3_bind_null(pStmt, 7);
-        }
-        sqlite3_bind_blob(pStmt, 8, peer.getSignature().data(), peer.getSignature().size(), SQLITE_STATIC);
-        sqlite3_bind_int64(pStmt, 9, now);
-        sqlite3_bind_int64(pStmt, 10, 0);
+            if (sqlite3_step(upsertPeer) != SQLITE_DONE)
+                throw std::runtime_error("Step sqlite failed.");
 
-        if (sqlite3_step(pStmt) != SQLITE_DONE) {
-            sqlite3_finalize(pStmt);
-            throw std::runtime_error("Step sqlite failed.");
+            sqlite3_reset(upsertPeer);
         }
-
-        sqlite3_reset(pStmt);
-    }
-
-    sqlite3_finalize(pStmt);
-    sqlite3_exec(sqlite_store, "COMMIT", 0, 0, 0);
+    });
 }
 
 void SqliteStorage::putPeer(const PeerInfo& peer, bool persistent, bool updateLastAnnounce) {
-    sqlite3_stmt *pStmt {nullptr};
-    if(sqlite3_prepare_v2(sqlite_store, UPSERT_PEER.c_str(), strlen(UPSERT_PEER.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");
-    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(upsertPeer);
 
-    sqlite3_bind_blob(pStmt, 1, peer.getId().data(), peer.getId().size(), SQLITE_STATIC);
-    sqlite3_bind_blob(pStmt, 2, peer.getNodeId().data(), peer.getNodeId().size(), SQLITE_STATIC);
-    sqlite3_bind_blob(pStmt, 3, peer.getOrigin().data(), peer.getOrigin().size(), SQLITE_STATIC);
-    sqlite3_bind_int(pStmt, 4, persistent);
-    if (peer.hasPrivateKey())
-        sqlite3_bind_blob(pStmt, 5, peer.getPrivateKey().bytes(), peer.getPrivateKey().size(), SQLITE_STATIC);
-    else
-        sqlite3_bind_null(pStmt, 5);
-    sqlite3_bind_int(pStmt, 6, peer.getPort());
-    if (peer.hasAlternativeURL()) {
-        const char *alt = peer.getAlternativeURL().c_str();
-        sqlite3_bind_text(pStmt, 7, alt, strlen(alt), SQLITE_STATIC);
-    } else {
-        sqlite3_bind_null(pStmt, 7);
-    }
-    sqlite3_bind_blob(pStmt, 8, peer.getSignature().data(), peer.getSignature().size(), SQLITE_STATIC);
     auto now = currentTimeMillis();
-    sqlite3_bind_int64(pStmt, 9, currentTimeMillis());
-    sqlite3_bind_int64(pStmt, 10, updateLastAnnounce ? now : 0);
+    bindPeer(upsertPeer, peer, persistent, now, updateLastAnnounce ? now : 0);
 
-    sqlite3_step(pStmt);
-    sqlite3_finalize(pStmt);
+    sqlite3_step(upsertPeer);
 }
 
-std::vector<Id> SqliteStorage::getAllPeers() {
+std::vector<Id> SqliteStorage::scanPeerIds(ScanCursor& cursor, size_t limit) {
     std::vector<Id> ids {};
 
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, GET_PEERS.c_str(), strlen(GET_PEERS.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectPeerIds);
 
     uint64_t when = currentTimeMillis() - Constants::MAX_PEER_AGE;
-    sqlite3_bind_int64(pStmt, 1, when);
+    bindCursor(selectPeerIds, 1, cursor, cursor.id);
+    bindRange(selectPeerIds, 2, cursor.prefix);
+    sqlite3_bind_int64(selectPeerIds, 4, when);
+    sqlite3_bind_int64(selectPeerIds, 5, limit);
 
-    while (sqlite3_step(pStmt) == SQLITE_ROW) {
-        int cNum = sqlite3_column_count(pStmt);
-        for (int i = 0; i < cNum; i++) {
-            const int cType = sqlite3_column_type(pStmt, i);
-            size_t len = 0;
-            const void *ptr = NULL;
+    while (sqlite3_step(selectPeerIds) == SQLITE_ROW)
+        ids.emplace_back(columnBlob(selectPeerIds, 0));
 
-            if (cType == SQLITE_BLOB) {
-                len = sqlite3_column_bytes(pStmt, i);
-                ptr = sqlite3_column_blob(pStmt, i);
+    advance(cursor, ids, limit);
+    return ids;
+}
 
-                ids.emplace_back(Blob{ptr, len});
-            }
-        }
-    }
+std::vector<PeerInfo> SqliteStorage::scanPeers(ScanCursor& cursor, size_t limit) {
+    std::vector<PeerInfo> peers {};
 
-    sqlite3_finalize(pStmt);
-    return ids;
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectPeerRange);
+
+    uint64_t when = currentTimeMillis() - Constants::MAX_PEER_AGE;
+    bindCursor(selectPeerRange, 1, cursor, cursor.id);
+    bindCursor(selectPeerRange, 2, cursor, cursor.nodeId);
+    bindCursor(selectPeerRange, 3, cursor, cursor.origin);
+    bindRange(selectPeerRange, 4, cursor.prefix);
+    sqlite3_bind_int64(selectPeerRange, 6, when);
+    sqlite3_bind_int64(selectPeerRange, 7, limit);
+
+    while (sqlite3_step(selectPeerRange) == SQLITE_ROW)
+        peers.emplace_back(readPeer(selectPeerRange));
+
+    advance(cursor, peers, limit);
+    return peers;
 }
 
 void SqliteStorage::updatePeerLastAnnounce(const Id& peerId, const Id& origin) {
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, UPDATE_PEER_LAST_ANNOUNCE.c_str(), strlen(UPDATE_PEER_LAST_ANNOUNCE.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(updatePeerAnnounced);
 
     auto now = currentTimeMillis();
-    sqlite3_bind_int64(pStmt, 1, now);
-    sqlite3_bind_int64(pStmt, 2, now);
-    sqlite3_bind_blob(pStmt, 3, peerId.data(), peerId.size(), SQLITE_STATIC);
-    sqlite3_bind_blob(pStmt, 4, origin.data(), origin.size(), SQLITE_STATIC);
+    sqlite3_bind_int64(updatePeerAnnounced, 1, now);
+    sqlite3_bind_int64(updatePeerAnnounced, 2, now);
+    sqlite3_bind_blob(updatePeerAnnounced, 3, peerId.data(), peerId.size(), SQLITE_STATIC);
+    sqlite3_bind_blob(updatePeerAnnounced, 4, origin.data(), origin.size(), SQLITE_STATIC);
 
-    sqlite3_step(pStmt);
-    sqlite3_finalize(pStmt);
+    sqlite3_step(updatePeerAnnounced);
 }
 
-std::vector<PeerInfo> SqliteStorage::getPersistentPeers(uint64_t lastAnnounceBefore) {
+std::vector<PeerInfo> SqliteStorage::scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
     std::vector<PeerInfo> peers {};
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, GET_PERSISTENT_PEERS.c_str(), strlen(GET_PERSISTENT_PEERS.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
 
-    sqlite3_bind_int64(pStmt, 1, lastAnnounceBefore);
-
-    while (sqlite3_step(pStmt) == SQLITE_ROW) {
-        Blob peerId {};
-        Blob privateKey {};
-        Blob nodeId {};
-        Blob origin {};
-        uint16_t port {0};
-        std::string alt {};
-        Blob signature {};
-
-        const int cNum = sqlite3_column_count(pStmt);
-        for (int i = 0; i < cNum; i++) {
-            const char* name = sqlite3_column_name(pStmt, i);
-            const int cType = sqlite3_column_type(pStmt, i);
-            int len = 0;
-            const void *ptr = NULL;
-
-            if (cType == SQLITE_BLOB) {
-                len = sqlite3_column_bytes(pStmt, i);
-                ptr = sqlite3_column_blob(pStmt, i);
-            }
-
-            if (std::strcmp(name, "id") == 0 && len > 0) {
-                peerId = Blob(ptr, len);
-            } else if (std::strcmp(name, "privateKey") == 0 && len > 0) {
-                privateKey = Blob(ptr, len);
-            } else if (std::strcmp(name, "nodeId") == 0 && len > 0) {
-                nodeId = Blob(ptr, len);
-            } else if (std::strcmp(name, "port") == 0) {
-                port = sqlite3_column_int(pStmt, i);
-            } else if (std::strcmp(name, "alternativeURL") == 0) {
-                auto c = (char *)sqlite3_column_text(pStmt, i);
-                alt = c ? c : "";
-            } else if (std::strcmp(name, "signature") == 0) {
-                signature = Blob(ptr, len);
-            }
-        }
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(selectPersistentPeers);
 
-        auto peer = PeerInfo::of(peerId, privateKey, nodeId, origin, port, alt, signature);
-        peers.emplace_back(peer);
-    }
+    bindCursor(selectPersistentPeers, 1, cursor, cursor.id);
+    bindCursor(selectPersistentPeers, 2, cursor, cursor.nodeId);
+    bindCursor(selectPersistentPeers, 3, cursor, cursor.origin);
+    bindRange(selectPersistentPeers, 4, cursor.prefix);
+    sqlite3_bind_int64(selectPersistentPeers, 6, lastAnnounceBefore);
+    sqlite3_bind_int64(selectPersistentPeers, 7, limit);
 
-    sqlite3_finalize(pStmt);
+    while (sqlite3_step(selectPersistentPeers) == SQLITE_ROW)
+        peers.emplace_back(readPeer(selectPersistentPeers));
+
+    advance(cursor, peers, limit);
     return peers;
 }
 
-bool SqliteStorage::removePeer(const Id& peerId, const Id& origin) {
-    sqlite3_stmt* pStmt {nullptr};
-    if (sqlite3_prepare_v2(sqlite_store, REMOVE_PEER.c_str(), strlen(REMOVE_PEER.c_str()), &pStmt, 0) != SQLITE_OK) {
-        sqlite3_finalize(pStmt);
-        throw std::runtime_error("Prepare sqlite failed.");;
-    }
+PrefixStats SqliteStorage::getPrefixStats(const Prefix& prefix) {
+    PrefixStats stats {};
+
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    sqlite3_stmt* stmts[2] = { countValues, countPeers };
+    uint64_t ts[2];
+    ts[0] = currentTimeMillis() - Constants::MAX_VALUE_AGE;
+    ts[1] = currentTimeMillis() - Constants::MAX_PEER_AGE;
 
-    sqlite3_bind_blob(pStmt, 1, peerId.data(), peerId.size(), SQLITE_STATIC);
-    sqlite3_bind_blob(pStmt, 2, origin.data(), origin.size(), SQLITE_STATIC);
+    for (int i = 0; i < 2; i++) {
+        StatementScope scope(stmts[i]);
+        bindRange(stmts[i], 1, prefix);
+        sqlite3_bind_int64(stmts[i], 3, ts[i]);
+        if (sqlite3_step(stmts[i]) != SQLITE_ROW)
+            continue;
 
-    bool ret = false;
-    if (sqlite3_step(pStmt) == SQLITE_DONE) {
-        if (sqlite3_changes(sqlite_store) > 0)
-            ret = true;
+        auto& count = i == 0 ? stats.values : stats.peers;
+        auto& bytes = i == 0 ? stats.valueBytes : stats.peerBytes;
+        count = sqlite3_column_int64(stmts[i], 0);
+        bytes = sqlite3_column_int64(stmts[i], 1);
     }
 
-    sqlite3_finalize(pStmt);
-    return ret;
+    return stats;
+}
+
+bool SqliteStorage::removePeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    StatementScope scope(deletePeer);
+
+    sqlite3_bind_blob(deletePeer, 1, peerId.data(), peerId.size(), SQLITE_STATIC);
+    sqlite3_bind_blob(deletePeer, 2, origin.data(), origin.size(), SQLITE_STATIC);
+
+    return sqlite3_step(deletePeer) == SQLITE_DONE && sqlite3_changes(sqlite_store) > 0;
 }
 
 }
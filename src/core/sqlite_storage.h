@@ -23,6 +23,7 @@
 #pragma once
 
 #include <list>
+#include <mutex>
 #include <sqlite3.h>
 
 #include "carrier/types.h"
@@ -39,15 +40,26 @@ public:
     SqliteStorage() {}
     ~SqliteStorage();
 
-    static Sp<DataStorage> open(const std::string& path, Scheduler& scheduler);
+    /**
+     * mmapSize and cacheSize are the memory in bytes SQLite may map and
+     * cache, 0 uses the built-in defaults.
+     */
+    static Sp<DataStorage> open(const std::string& path, Scheduler& scheduler, int mmapSize = 0, int cacheSize = 0);
+
+    /**
+     * Opens the storage without the periodic expiration, the caller should
+     * expire() it. Several connections may open the same file.
+     */
+    static Sp<DataStorage> open(const std::string& path, int mmapSize = 0, int cacheSize = 0);
     void close() override;
 
     Sp<Value> getValue(const Id& valueId) override;
     bool removeValue(const Id& valueId) override;
     Sp<Value> putValue(const Value& value, int expectedSeq = -1, bool persistent = false, bool updateLastAnnounce = false) override;
     void updateValueLastAnnounce(const Id& valueId) override;
-    std::vector<Value> getPersistentValues(uint64_t lastAnnounceBefore) override;
-    std::vector<Id> getAllValues() override;
+    std::vector<Id> scanValueIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanValues(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
 
     std::vector<PeerInfo> getPeer(const Id& peerId, int maxPeers) override;
     Sp<PeerInfo> getPeer(const Id& peerId, const Id& origin) override;
@@ -55,15 +67,44 @@ public:
     void putPeer(const std::vector<PeerInfo>& peers) override;
     void putPeer(const PeerInfo& peer, bool persistent = false, bool updateLastAnnounce = false) override;
     void updatePeerLastAnnounce(const Id& peerId, const Id& origin) override;
-    std::vector<PeerInfo> getPersistentPeers(uint64_t lastAnnounceBefore) override;
-    std::vector<Id> getAllPeers() override;
+    std::vector<Id> scanPeerIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPeers(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+    PrefixStats getPrefixStats(const Prefix& prefix) override;
+
+    void batch(const std::function<void()>& writes) override;
+    size_t expire(size_t maxEntries) override;
 
 private:
-    void init(const std::string& path, Scheduler& scheduler);
-    void expire();
+    void init(const std::string& path, int mmapSize, int cacheSize);
+    void prepare(sqlite3_stmt** stmt, const std::string& sql);
     int getUserVersion();
 
     sqlite3* sqlite_store {nullptr};
+
+    // prepared once for the lifetime of the connection, used under the mutex
+    sqlite3_stmt* selectValue {nullptr};
+    sqlite3_stmt* upsertValue {nullptr};
+    sqlite3_stmt* updateValueAnnounced {nullptr};
+    sqlite3_stmt* selectValueIds {nullptr};
+    sqlite3_stmt* selectValueRange {nullptr};
+    sqlite3_stmt* selectPersistentValues {nullptr};
+    sqlite3_stmt* countValues {nullptr};
+    sqlite3_stmt* deleteValue {nullptr};
+    sqlite3_stmt* upsertPeer {nullptr};
+    sqlite3_stmt* selectPeers {nullptr};
+    sqlite3_stmt* selectPeer {nullptr};
+    sqlite3_stmt* updatePeerAnnounced {nullptr};
+    sqlite3_stmt* selectPeerIds {nullptr};
+    sqlite3_stmt* selectPeerRange {nullptr};
+    sqlite3_stmt* selectPersistentPeers {nullptr};
+    sqlite3_stmt* countPeers {nullptr};
+    sqlite3_stmt* deletePeer {nullptr};
+    sqlite3_stmt* expireValues {nullptr};
+    sqlite3_stmt* expirePeers {nullptr};
+
+    // putValue reads the old value under the same lock
+    std::recursive_mutex mutex {};
 };
 
 } // namespace carrier
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <limits>
+
+#include "utils/time.h"
+#include "constants.h"
+#include "storage_quota.h"
+
+namespace elastos {
+namespace carrier {
+
+std::string StorageQuota::prefixOf(const SocketAddress& address) {
+    auto addr = address.isMappedIPv4() ? address.getMappedIPv4() : address;
+    auto length = addr.inaddrLength();
+    int bits = length == sizeof(in_addr) ? Constants::STORAGE_QUOTA_PREFIX4 : Constants::STORAGE_QUOTA_PREFIX6;
+
+    // the family length first keeps the IPv4 and IPv6 prefixes apart
+    std::string prefix(1, (char)length);
+    prefix.append((const char*)addr.inaddr(), std::min<size_t>(length, (bits + 7) / 8));
+    if (bits % 8 != 0 && prefix.size() > 1)
+        prefix.back() &= (char)(0xFF << (8 - bits % 8));
+
+    return prefix;
+}
+
+bool StorageQuota::admit(const Key& key, const Id& owner, const std::string& prefix, size_t bytes) {
+    if (bytes > maxBytes)
+        return false;
+
+    auto originIt = origins.find(owner);
+    size_t originBytes = originIt != origins.end() ? originIt->second : 0;
+    auto prefixIt = prefixes.find(prefix);
+    size_t prefixBytes = prefixIt != prefixes.end() ? prefixIt->second : 0;
+
+    // a store over its own record is charged the difference only
+    auto it = index.find(key);
+    if (it != index.end()) {
+        const auto& record = *it->second;
+        if (record.owner == owner)
+            originBytes -= record.bytes;
+        if (record.prefix == prefix)
+            prefixBytes -= record.bytes;
+    }
+
+    return originBytes + bytes <= maxOriginBytes && prefixBytes + bytes <= maxPrefixBytes;
+}
+
+void StorageQuota::charge(const Key& key, const Id& owner, const std::string& prefix, size_t bytes) {
+    auto it = index.find(key);
+    if (it != index.end())
+        release(it);
+
+    records.push_back({key, owner, prefix, bytes, currentTimeMillis()});
+    index[key] = std::prev(records.end());
+    origins[owner] += bytes;
+    prefixes[prefix] += bytes;
+    usage.bytes += bytes;
+    usage.records++;
+}
+
+void StorageQuota::release(std::map<Key, std::list<Record>::iterator>::iterator it) {
+    const auto& record = *it->second;
+
+    auto origin = origins.find(record.owner);
+    if ((origin->second -= record.bytes) == 0)
+        origins.erase(origin);
+
+    auto prefix = prefixes.find(record.prefix);
+    if ((prefix->second -= record.bytes) == 0)
+        prefixes.erase(prefix);
+
+    usage.bytes -= record.bytes;
+    usage.records--;
+    records.erase(it->second);
+    index.erase(it);
+}
+
+void StorageQuota::releaseAll(const Key& from, const Key& to) {
+    auto it = index.lower_bound(from);
+    while (it != index.end() && !(to < it->first))
+        release(it++);
+}
+
+void StorageQuota::age() {
+    auto now = currentTimeMillis();
+    while (!records.empty()) {
+        const auto& record = records.front();
+        auto maxAge = std::get<0>(record.key) ? Constants::MAX_PEER_AGE : Constants::MAX_VALUE_AGE;
+        if (record.stored + maxAge > now)
+            break;
+
+        // expired by the storage meanwhile
+        release(index.find(record.key));
+    }
+}
+
+void StorageQuota::evict() {
+    // the least recently stored first, never the record just stored
+    while (usage.bytes > maxBytes && records.size() > 1) {
+        auto [peer, id, origin, nodeId] = records.front().key;
+        if (locals.count(localKey(peer, id, origin))) {
+            // taken over by the local node meanwhile, the charge goes but not the record
+            release(index.find(records.front().key));
+            continue;
+        }
+
+        if (peer) {
+            // the storage removes the peers by origin, all the node ids of it go
+            storage->removePeer(id, origin);
+            releaseAll({true, id, origin, Id::MIN_ID}, {true, id, origin, Id::MAX_ID});
+        } else {
+            storage->removeValue(id);
+            release(index.find(records.front().key));
+        }
+
+        usage.evicted++;
+    }
+}
+
+bool StorageQuota::putValue(const Id& origin, const SocketAddress& address, const Value& value, int expectedSeq) {
+    Key key {false, value.getId(), {}, {}};
+    auto prefix = prefixOf(address);
+    auto bytes = RecordSize::storedBytes(value);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    age();
+
+    if (locals.count(localKey(false, value.getId()))) {
+        storage->putValue(value, expectedSeq);
+        return true;
+    }
+
+    if (!admit(key, origin, prefix, bytes)) {
+        usage.rejected++;
+        return false;
+    }
+
+    storage->putValue(value, expectedSeq);
+    charge(key, origin, prefix, bytes);
+    evict();
+    return true;
+}
+
+bool StorageQuota::putPeer(const Id& origin, const SocketAddress& address, const PeerInfo& peer) {
+    Key key {true, peer.getId(), peer.getOrigin(), peer.getNodeId()};
+    auto prefix = prefixOf(address);
+    auto bytes = RecordSize::storedBytes(peer);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    age();
+
+    // a put would turn the local persistent peer into a non-persistent one
+    if (locals.count(localKey(true, peer.getId(), peer.getOrigin())))
+        return true;
+
+    if (!admit(key, origin, prefix, bytes)) {
+        usage.rejected++;
+        return false;
+    }
+
+    storage->putPeer(peer);
+    charge(key, origin, prefix, bytes);
+    evict();
+    return true;
+}
+
+void StorageQuota::ownValue(const Id& valueId) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    locals.insert(localKey(false, valueId));
+    auto it = index.find({false, valueId, {}, {}});
+    if (it != index.end())
+        release(it);
+}
+
+void StorageQuota::ownPeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    locals.insert(localKey(true, peerId, origin));
+    releaseAll({true, peerId, origin, Id::MIN_ID}, {true, peerId, origin, Id::MAX_ID});
+}
+
+void StorageQuota::releaseValue(const Id& valueId) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    locals.erase(localKey(false, valueId));
+    auto it = index.find({false, valueId, {}, {}});
+    if (it != index.end())
+        release(it);
+}
+
+void StorageQuota::releasePeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    locals.erase(localKey(true, peerId, origin));
+    releaseAll({true, peerId, origin, Id::MIN_ID}, {true, peerId, origin, Id::MAX_ID});
+}
+
+void StorageQuota::recover() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // only the local node stores the persistent records
+    auto any = std::numeric_limits<uint64_t>::max();
+    ScanCursor cursor {};
+    while (!cursor.done) {
+        for (const auto& value : storage->scanPersistentValues(any, cursor, Constants::STORAGE_SCAN_PAGE))
+            locals.insert(localKey(false, value.getId()));
+    }
+
+    cursor = {};
+    while (!cursor.done) {
+        for (const auto& peer : storage->scanPersistentPeers(any, cursor, Constants::STORAGE_SCAN_PAGE))
+            locals.insert(localKey(true, peer.getId(), peer.getOrigin()));
+    }
+
+    // the owners are not known, only the budget bounds them
+    cursor = {};
+    while (!cursor.done) {
+        for (const auto& value : storage->scanValues(cursor, Constants::STORAGE_SCAN_PAGE)) {
+            if (!locals.count(localKey(false, value.getId())))
+                charge({false, value.getId(), {}, {}}, {}, {}, RecordSize::storedBytes(value));
+        }
+    }
+
+    cursor = {};
+    while (!cursor.done) {
+        for (const auto& peer : storage->scanPeers(cursor, Constants::STORAGE_SCAN_PAGE)) {
+            if (!locals.count(localKey(true, peer.getId(), peer.getOrigin())))
+                charge({true, peer.getId(), peer.getOrigin(), peer.getNodeId()}, {}, {}, RecordSize::storedBytes(peer));
+        }
+    }
+
+    evict();
+}
+
+StorageQuota::Usage StorageQuota::getUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usage;
+}
+
+size_t StorageQuota::getUsage(const Id& origin) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = origins.find(origin);
+    return it != origins.end() ? it->second : 0;
+}
+
+size_t StorageQuota::getUsage(const SocketAddress& address) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = prefixes.find(prefixOf(address));
+    return it != prefixes.end() ? it->second : 0;
+}
+
+} /* namespace carrier */
+} /* namespace elastos */
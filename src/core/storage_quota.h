@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <set>
+#include <tuple>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/peer_info.h"
+#include "carrier/socket_address.h"
+#include "data_storage.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * Bounds the storage taken by the values and peers the other nodes store and
+ * announce to this node.
+ *
+ * The bytes of every record are charged to the node that stored it last, and
+ * to the IP prefix of that node, a store over the quota of either is
+ * rejected. Over the global budget the least recently stored records are
+ * evicted from the storage. A record is uncharged when it ages out, or when
+ * the local node takes it over or removes it. The records of the local node,
+ * and the persistent ones, are never charged nor evicted, a store of them by
+ * another node only refreshes them.
+ *
+ * The charges are not kept over a restart, recover() charges the records left
+ * in the storage to no origin, as the least recently stored ones. The local
+ * records it knows by their persistence only, the non-persistent ones the
+ * local node stored before the restart are charged like the others until
+ * they age out or the local node stores them again.
+ *
+ * Thread safe.
+ */
+class StorageQuota {
+public:
+    struct Usage {
+        uint64_t bytes {0};
+        uint64_t records {0};
+        uint64_t rejected {0};
+        uint64_t evicted {0};
+    };
+
+    StorageQuota(Sp<DataStorage> storage, size_t maxBytes, size_t maxOriginBytes, size_t maxPrefixBytes)
+        : storage(storage), maxBytes(maxBytes), maxOriginBytes(maxOriginBytes), maxPrefixBytes(maxPrefixBytes) {}
+
+    // Stores the record from the origin node at the address, false if it is over the quotas
+    bool putValue(const Id& origin, const SocketAddress& address, const Value& value, int expectedSeq = -1);
+    bool putPeer(const Id& origin, const SocketAddress& address, const PeerInfo& peer);
+
+    // the local node took the record over
+    void ownValue(const Id& valueId);
+    void ownPeer(const Id& peerId, const Id& origin);
+
+    // the local node removed the record
+    void releaseValue(const Id& valueId);
+    void releasePeer(const Id& peerId, const Id& origin);
+
+    // Charges the records in the storage, at the start
+    void recover();
+
+    Usage getUsage() const;
+    size_t getUsage(const Id& origin) const;
+    size_t getUsage(const SocketAddress& address) const;
+
+private:
+    // kind, id, origin and node id of a peer, only the id of a value
+    using Key = std::tuple<bool, Id, Id, Id>;
+
+    static Key localKey(bool peer, const Id& id, const Id& origin = {}) {
+        return {peer, id, origin, {}};
+    }
+
+    struct Record {
+        Key key;
+        Id owner;
+        std::string prefix;
+        size_t bytes;
+        uint64_t stored;
+    };
+
+    static std::string prefixOf(const SocketAddress& address);
+
+    bool admit(const Key& key, const Id& owner, const std::string& prefix, size_t bytes);
+    void charge(const Key& key, const Id& owner, const std::string& prefix, size_t bytes);
+    void release(std::map<Key, std::list<Record>::iterator>::iterator it);
+    void releaseAll(const Key& from, const Key& to);
+    void evict();
+    void age();
+
+    Sp<DataStorage> storage;
+    const size_t maxBytes;
+    const size_t maxOriginBytes;
+    const size_t maxPrefixBytes;
+
+    // the least recently stored first
+    std::list<Record> records {};
+    std::map<Key, std::list<Record>::iterator> index {};
+    std::unordered_map<Id, size_t> origins {};
+    std::unordered_map<std::string, size_t> prefixes {};
+    // the records of the local node, the peers by id and origin
+    std::set<Key> locals {};
+    Usage usage {};
+
+    mutable std::mutex mutex {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -39,11 +39,26 @@ public:
 
     void setSent() {
         this->lastSent = currentTimeMillis();
+        this->stalled = false;
         this->pinged++;
     }
 
     void clearSent() {
         this->lastSent = 0;
+        this->stalled = false;
+    }
+
+    /**
+     * The pending request to this candidate got no response in time, but
+     * has not timed out yet.
+     */
+    void setStalled() {
+        if (lastSent != 0)
+            this->stalled = true;
+    }
+
+    bool isStalled() const {
+        return stalled;
     }
 
     int getPinged() const {
@@ -54,6 +69,10 @@ public:
         this->lastReply = currentTimeMillis();
     }
 
+    bool isReplied() const {
+        return lastReply != 0;
+    }
+
     void setToken(int token) {
         this->token = token;
     }
@@ -62,6 +81,18 @@ public:
         return token;
     }
 
+    /**
+     * The number of the hops from the lookup origin: 1 for the nodes from the
+     * local routing table, otherwise the hops of the responder plus one.
+     */
+    void setHops(int hops) {
+        this->hops = hops;
+    }
+
+    int getHops() const {
+        return hops;
+    }
+
     bool isReachable() const {
         return reachable;
     }
@@ -84,10 +115,12 @@ private:
     uint64_t lastReply {0};     /* the timestamp of last reply */
 
     bool reachable {false};
+    bool stalled {false};
     bool acked {false};        /* whether they acked our announcement */
     int  pinged {0};
 
     int token {0};
+    int hops {1};
 };
 
 } // namespace carrier
@@ -31,111 +31,106 @@ namespace elastos {
 namespace carrier {
 
 const Sp<CandidateNode>& ClosestCandidates::get(const Id& id) const {
-    const auto it = std::find_if(closest.begin(), closest.end(), [&](const Sp<CandidateNode>& node) {
-        return id == node->getId();
-    });
+    const auto it = closest.find(target.distance(id));
     if (it != closest.end())
-        return *it;
+        return it->second;
 
     static const Sp<CandidateNode> nullPtr = nullptr;
     return nullPtr;
 }
 
 const Sp<CandidateNode> ClosestCandidates::remove(const Id& id) {
-    const auto it = std::find_if(closest.begin(), closest.end(), [&](const Sp<CandidateNode>& node) {
-        return id == node->getId();
-    });
-
-    if (it != closest.end()) {
-        const Sp<CandidateNode> removed = std::move(*it);
-        closest.erase(it);
-        return removed;
-    }
-    return nullptr;
+    const auto distance = target.distance(id);
+    const auto it = closest.find(distance);
+    if (it == closest.end())
+        return nullptr;
+
+    const Sp<CandidateNode> removed = std::move(it->second);
+    closest.erase(it);
+    if (!removed->isInFlight())
+        queue.erase(queueKey(removed, distance));
+
+    return removed;
 }
 
 const Sp<CandidateNode> ClosestCandidates::next() const {
-    std::vector<Sp<CandidateNode>> candidates;
-    candidates.reserve(closest.size());
+    // The queue is ordered by pinged times first, the unreachable
+    // candidates(pinged >= 3) are always at the end of the queue.
+    if (queue.empty())
+        return nullptr;
 
-    for (const auto& node: closest) {
-        if (node->isEligible())
-            candidates.emplace_back(node);
-    }
+    const auto& cn = closest.at(queue.begin()->second);
+    return cn->isEligible() ? cn : nullptr;
+}
 
-    if (!candidates.empty()) {
-        std::sort(candidates.begin(), candidates.end(), [&](const Sp<CandidateNode>& a, const Sp<CandidateNode>& b){
-            return candidateOrder(a,b) < 0;
-        });
-        return candidates.front();
-    }
-    return nullptr;
+void ClosestCandidates::setSent(const Sp<CandidateNode>& cn) {
+    if (cn->isInFlight())
+        return;
+
+    queue.erase(queueKey(cn, target.distance(cn->getId())));
+    cn->setSent();
+}
+
+void ClosestCandidates::clearSent(const Sp<CandidateNode>& cn) {
+    if (!cn->isInFlight())
+        return;
+
+    cn->clearSent();
+    auto distance = target.distance(cn->getId());
+    if (closest.count(distance))
+        queue.insert(queueKey(cn, distance));
 }
 
 const Id ClosestCandidates::head() const {
     if (closest.empty()) {
         return target.distance(Id::MAX_ID);
     } else {
-        return closest.front()->getId();
+        return closest.cbegin()->second->getId();
     }
 }
 
+const Id ClosestCandidates::activeHead() const {
+    // Only a few candidates are stalled at the same time
+    for (const auto& [distance, cn] : closest) {
+        if (!cn->isStalled())
+            return cn->getId();
+    }
+
+    return target.distance(Id::MAX_ID);
+}
+
 const Id ClosestCandidates::tail() const {
     if (closest.empty()) {
         return target.distance(Id::MAX_ID);
     } else {
-        return closest.back()->getId();
+        return std::prev(closest.cend())->second->getId();
     }
 }
 
-int ClosestCandidates::candidateOrder(const Sp<CandidateNode>& a, const Sp<CandidateNode>& b) const {
-    int comparison = a->getPinged() - b->getPinged();
-    if (comparison != 0)
-        return comparison < 0 ? -1: 1;
-
-    return target.threeWayCompare(a->getId(), b->getId());
-}
-
-void ClosestCandidates::add(const std::list<Sp<NodeInfo>>& candidates) {
+void ClosestCandidates::add(const std::list<Sp<NodeInfo>>& candidates, int hops) {
     std::unique_lock<std::mutex> lock(closest_mtx);
-    std::list<Sp<CandidateNode>> filtered;
 
     for (const auto& item: candidates) {
         if (!dedup_ids.insert(item->getId()).second)
             continue;
+
         if (!dedups_addrs.insert(item->getAddress()).second)
             continue;
 
-        filtered.emplace_back(std::make_shared<CandidateNode>(*item));
+        auto cn = std::make_shared<CandidateNode>(*item);
+        cn->setHops(hops);
+
+        auto distance = target.distance(cn->getId());
+        queue.insert(queueKey(cn, distance));
+        closest.emplace(std::move(distance), std::move(cn));
     }
 
-    filtered.sort([&](const std::shared_ptr<CandidateNode> &node1, const std::shared_ptr<CandidateNode>& node2) {
-        return target.threeWayCompare(node1->getId(), node2->getId()) < 0;
-    });
-
-    closest.merge(filtered, [&](const Sp<CandidateNode>& a, const Sp<CandidateNode>& b) {
-        return target.threeWayCompare(a->getId(), b->getId()) < 0;
-    });
-
-    if (closest.size() > capacity) {
-        int count = 0;
-        std::list<Sp<CandidateNode>> toRemove {};
-        for (const auto& item : closest) {
-            if (!item->isInFlight()) {
-                toRemove.push_back(item);
-            }
-        }
-
-        if (toRemove.size() > capacity)  {
-            toRemove.sort([&](const Sp<CandidateNode>& a, const Sp<CandidateNode>& b) {
-                return candidateOrder(a, b) < 0;
-            });
-
-            auto vi = toRemove.begin();
-            std::advance(vi, capacity);
-            for(; vi != toRemove.end(); vi++)
-                remove((*vi)->getId());
-        }
+    // Evict the worst candidates which are not in flight, the in-flight
+    // candidates are kept until their requests completed.
+    while (closest.size() > capacity && queue.size() > capacity) {
+        auto worst = std::prev(queue.end());
+        closest.erase(worst->second);
+        queue.erase(worst);
     }
 }
 
@@ -32,6 +32,16 @@
 namespace elastos {
 namespace carrier {
 
+/**
+ * The candidates of a lookup, ordered by the XOR distance to the target.
+ *
+ * The candidates are indexed by distance, and the candidates which are not
+ * in flight are also kept in a queue ordered by (pinged, distance), so
+ * next(), get(), remove() and add() are all logarithmic.
+ *
+ * The in-flight state of a candidate must be changed through setSent() and
+ * clearSent() of this class to keep the queue consistent.
+ */
 class ClosestCandidates {
 public:
     ClosestCandidates(const Id& _target, int _capacity)
@@ -49,24 +59,35 @@ public:
     const Sp<CandidateNode> remove(const Id& id);
     const Sp<CandidateNode> next() const;
 
+    void setSent(const Sp<CandidateNode>& cn);
+    void clearSent(const Sp<CandidateNode>& cn);
+
     const Id head() const;
+    // the closest candidate without a stalled request
+    const Id activeHead() const;
     const Id tail() const;
-    void add(const std::list<Sp<NodeInfo>>& candidates);
+
+    void add(const std::list<Sp<NodeInfo>>& candidates, int hops = 1);
 
 private:
-    int candidateOrder(const Sp<CandidateNode>&, const Sp<CandidateNode>&) const;
+    using QueueKey = std::pair<int, Id>;    // (pinged, distance)
+
+    QueueKey queueKey(const Sp<CandidateNode>& cn, const Id& distance) const {
+        return { cn->getPinged(), distance };
+    }
 
     const Id& target;
     int capacity {0};
-    std::set<Id> dedup_ids {};
 
+    std::set<Id> dedup_ids {};
 #ifdef CARRIER_DEVELOPMENT
     std::set<SocketAddress> dedups_addrs {};
 #else
     std::set<SocketAddress, SocketAddress::IpCompare> dedups_addrs {};
 #endif
 
-    std::list<Sp<CandidateNode>> closest {};
+    std::map<Id, Sp<CandidateNode>> closest {};     // distance -> candidate
+    std::set<QueueKey> queue {};                    // the candidates not in flight
     mutable std::mutex closest_mtx {};
 };
 
@@ -22,16 +22,28 @@
 
 #pragma once
 
-#include <map>
+#include <list>
+#include <vector>
+#include <algorithm>
+
 #include "candidate_node.h"
 
 namespace elastos {
 namespace carrier {
 
+/**
+ * The closest nodes which responded to a lookup.
+ *
+ * A small fixed-capacity array kept sorted by the XOR distance to the target:
+ * head and tail are O(1), insert is a binary search plus a short move, and
+ * the farthest entry is evicted when the capacity is exceeded.
+ */
 class ClosestSet {
 public:
     ClosestSet(const Id& _target, int _capacity)
-        : target(_target), capacity(_capacity) {}
+        : target(_target), capacity(_capacity) {
+        closest.reserve(capacity + 1);
+    }
 
     bool reachedCapacity() const {
         return closest.size() >= capacity;
@@ -41,29 +53,31 @@ public:
         return closest.size();
     }
 
-    Sp<CandidateNode> get(const Id& id) {
-        return closest[id];
+    Sp<CandidateNode> get(const Id& id) const {
+        auto it = find(id);
+        return it != closest.end() ? *it : nullptr;
     }
 
     bool contains(const Id& id) const {
-        return closest.find(id) != closest.end();
+        return find(id) != closest.end();
     }
 
     void add(const Sp<CandidateNode>& cn) {
-        closest[cn->getId()] = cn;
-        if (closest.size() > capacity) {
-            auto last = std::prev(closest.cend());
-            closest.erase(last);
-
-            if (last->second == cn) {
-                insertAttemptsSinceTailModification++;
-            } else {
+        auto it = lowerBound(cn->getId());
+        if (it != closest.end() && (*it)->getId() == cn->getId()) {
+            *it = cn;
+        } else if (reachedCapacity() && it == closest.end()) {
+            // farther than all the entries, it would be evicted at once
+            insertAttemptsSinceTailModification++;
+        } else {
+            closest.insert(it, cn);
+            if (closest.size() > capacity) {
+                closest.pop_back();
                 insertAttemptsSinceTailModification = 0;
             }
         }
 
-        const auto head = closest.cbegin()->second;
-        if (head == cn) {
+        if (closest.front() == cn) {
             insertAttemptsSinceHeadModification = 0;
         } else {
             insertAttemptsSinceHeadModification++;
@@ -71,30 +85,27 @@ public:
     }
 
     void removeCandidate(const Id& id) {
-        if (!closest.empty())
-            closest.erase(id);
+        auto it = find(id);
+        if (it != closest.end())
+            closest.erase(it);
     }
 
     const std::list<Sp<CandidateNode>> getEntries() const {
-        std::list<Sp<CandidateNode>> entries {};
-        for (const auto& item: closest) {
-            entries.push_back(item.second);
-        }
-        return entries;
+        return std::list<Sp<CandidateNode>>(closest.begin(), closest.end());
     }
 
     Id tail() const {
         if (closest.empty())
             return target.distance(Id::MAX_ID);
 
-        return (std::prev(closest.cend()))->first;
+        return closest.back()->getId();
     }
 
     Id head() const {
         if (closest.empty())
             return target.distance(Id::MAX_ID);
 
-        return closest.cbegin()->first;
+        return closest.front()->getId();
     }
 
     bool isEligible() const {
@@ -102,10 +113,25 @@ public:
     }
 
 private:
-    const Id& target;
-    int capacity;
+    std::vector<Sp<CandidateNode>>::iterator lowerBound(const Id& id) {
+        return std::lower_bound(closest.begin(), closest.end(), id,
+            [&](const Sp<CandidateNode>& cn, const Id& key) {
+                return target.threeWayCompare(cn->getId(), key) < 0;
+            });
+    }
 
-    std::map<Id, Sp<CandidateNode>> closest {};
+    std::vector<Sp<CandidateNode>>::const_iterator find(const Id& id) const {
+        auto it = std::lower_bound(closest.cbegin(), closest.cend(), id,
+            [&](const Sp<CandidateNode>& cn, const Id& key) {
+                return target.threeWayCompare(cn->getId(), key) < 0;
+            });
+        return (it != closest.cend() && (*it)->getId() == id) ? it : closest.cend();
+    }
+
+    // A copy of the target, the set might outlive the lookup task
+    Id target;
+    int capacity;
+    std::vector<Sp<CandidateNode>> closest {};
 
     int insertAttemptsSinceTailModification {0};
     int insertAttemptsSinceHeadModification {0};
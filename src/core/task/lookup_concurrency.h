@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * The adaptive request concurrency (alpha) of a lookup task.
+ *
+ * The lookup starts with the lower bound. Every stalled or timed out request
+ * widens the window by one, so the lookup keeps making progress around the
+ * lost packets; a full window of prompt responses narrows it by one again,
+ * so a healthy network is never queried wider than the lower bound.
+ */
+class LookupConcurrency {
+public:
+    LookupConcurrency(int min, int max)
+        : min(std::max(1, min)), max(std::max(this->min, max)), alpha(this->min), peak(this->min) {}
+
+    int get() const {
+        return alpha;
+    }
+
+    /**
+     * The widest concurrency used since the lookup started.
+     */
+    int getPeak() const {
+        return peak;
+    }
+
+    int getMin() const {
+        return min;
+    }
+
+    int getMax() const {
+        return max;
+    }
+
+    void stalled() {
+        widen();
+    }
+
+    void timeout() {
+        widen();
+    }
+
+    void responded(bool prompt) {
+        if (!prompt) {
+            promptResponses = 0;
+            return;
+        }
+
+        if (++promptResponses >= alpha) {
+            promptResponses = 0;
+            if (alpha > min)
+                alpha--;
+        }
+    }
+
+private:
+    void widen() {
+        promptResponses = 0;
+        if (alpha < max)
+            peak = std::max(peak, ++alpha);
+    }
+
+    int min;
+    int max;
+    int alpha;
+    int peak;
+    int promptResponses {0};
+};
+
+} // namespace carrier
+} // namespace elastos
@@ -29,6 +29,12 @@
 namespace elastos {
 namespace carrier {
 
+LookupTask::LookupTask(DHT* dht, const Id& id, const std::string& taskName)
+    : Task(dht, taskName), target(id),
+    closestSet(target, Constants::MAX_ENTRIES_PER_BUCKET),
+    closestCandidates(target, Constants::MAX_ENTRIES_PER_BUCKET * 3),
+    concurrency(dht->getMinLookupConcurrency(), dht->getMaxLookupConcurrency()) {}
+
 bool LookupTask::isBogonAddress(const SocketAddress& addr) const {
 #ifdef CARRIER_DEVELOPMENT
     return !addr.isAnyUnicast();
@@ -37,7 +43,7 @@ bool LookupTask::isBogonAddress(const SocketAddress& addr) const {
 #endif
 }
 
-void LookupTask::addCandidates(const std::list<Sp<NodeInfo>>& nodes) {
+void LookupTask::addCandidates(const std::list<Sp<NodeInfo>>& nodes, int hops) {
     std::list<Sp<NodeInfo>> candidates {};
 
     for(const auto& node: nodes) {
@@ -51,21 +57,56 @@ void LookupTask::addCandidates(const std::list<Sp<NodeInfo>>& nodes) {
     }
 
     if (!candidates.empty())
-        closestCandidates.add(candidates);
+        closestCandidates.add(candidates, hops);
+}
+
+int LookupTask::getHops() const {
+    if (closestSet.size() == 0)
+        return 0;
+
+    return closestSet.get(closestSet.head())->getHops();
+}
+
+void LookupTask::missed(const RPCCall* call) {
+    auto candidateNode = std::static_pointer_cast<CandidateNode>(call->getTarget());
+    if (!candidateNode->isReplied())
+        return;
+
+    if (cacheCandidate == nullptr || target.threeWayCompare(candidateNode->getId(), cacheCandidate->getId()) < 0)
+        cacheCandidate = candidateNode;
+}
+
+Sp<CandidateNode> LookupTask::getNextCandidate() const {
+    // All the candidates still able to answer are beyond the converged
+    // closest set, they can't improve the result
+    if (closestSet.isEligible() &&
+            target.threeWayCompare(closestSet.tail(), closestCandidates.activeHead()) <= 0)
+        return nullptr;
+
+    return closestCandidates.next();
 }
 
 bool LookupTask::isDone() const {
-    return Task::isDone() &&
+    // The stalled requests are not waited for: the lookup completes as soon as
+    // the closest set is closer than all the candidates still able to answer.
+    return (getActiveCalls() == 0 || isFinished()) &&
         (closestCandidates.size() == 0 ||
             (closestSet.isEligible() &&
-                target.threeWayCompare(closestSet.tail(), closestCandidates.head()) <= 0));
+                target.threeWayCompare(closestSet.tail(), closestCandidates.activeHead()) <= 0));
 }
 
 void LookupTask::callError(RPCCall* call) {
     closestCandidates.remove(call->getTargetId());
 }
 
+void LookupTask::callStalled(RPCCall* call) {
+    std::static_pointer_cast<CandidateNode>(call->getTarget())->setStalled();
+    concurrency.stalled();
+}
+
 void LookupTask::callTimeout(RPCCall* call) {
+    concurrency.timeout();
+
     auto candidateNode = std::static_pointer_cast<CandidateNode>(call->getTarget());
     if (candidateNode->isUnreachable()) {
         closestCandidates.remove(candidateNode->getId());
@@ -73,10 +114,12 @@ void LookupTask::callTimeout(RPCCall* call) {
     }
 
     // Clear the sent time-stamp and make it available again for the next retry
-    candidateNode->clearSent();
+    closestCandidates.clearSent(candidateNode);
 }
 
 void LookupTask::callResponsed(RPCCall* call, Sp<Message> response) {
+    concurrency.responded(call->getResponseTime() - call->getSentTime() < Constants::RPC_CALL_STALL_TIMEOUT);
+
     auto candidateNode = removeCandidate(call->getTargetId());
     if (candidateNode == nullptr)
         return;
@@ -25,6 +25,7 @@
 #include "carrier/id.h"
 #include "closest_set.h"
 #include "closest_candidates.h"
+#include "lookup_concurrency.h"
 #include "task.h"
 
 namespace elastos {
@@ -32,10 +33,7 @@ namespace carrier {
 
 class LookupTask : public Task {
 public:
-    LookupTask(DHT* dht, const Id& id, const std::string& taskName)
-        : Task(dht, taskName), target(id),
-        closestSet(target, Constants::MAX_ENTRIES_PER_BUCKET),
-        closestCandidates(target, Constants::MAX_ENTRIES_PER_BUCKET * 3) {}
+    LookupTask(DHT* dht, const Id& id, const std::string& taskName);
 
     const Id& getTarget() const {
         return target;
@@ -49,15 +47,50 @@ public:
         return closestSet;
     }
 
+    /**
+     * The hops to the closest node which responded to this lookup.
+     */
+    int getHops() const;
+
+    /**
+     * The current request concurrency (alpha) of this lookup, adapted to the
+     * stalled requests and the response times.
+     */
+    int getConcurrency() const override {
+        return concurrency.get();
+    }
+
+    int getPeakConcurrency() const {
+        return concurrency.getPeak();
+    }
+
+    /**
+     * The closest node which responded to this lookup without the result,
+     * where the result is cached on the lookup path.
+     */
+    Sp<CandidateNode> getCacheCandidate() const {
+        return cacheCandidate;
+    }
+
 protected:
-    void addCandidates(const std::list<Sp<NodeInfo>>& nodes);
+    void addCandidates(const std::list<Sp<NodeInfo>>& nodes, int hops = 1);
+
+    // the hops of the nodes returned by the responder of the call
+    static int nextHops(const RPCCall* call) {
+        return std::static_pointer_cast<CandidateNode>(call->getTarget())->getHops() + 1;
+    }
+
+    // the responder of the call did not have the result
+    void missed(const RPCCall* call);
 
     Sp<CandidateNode> removeCandidate(const Id& id) {
         return closestCandidates.remove(id);
     }
 
-    Sp<CandidateNode> getNextCandidate() const {
-        return closestCandidates.next();
+    Sp<CandidateNode> getNextCandidate() const;
+
+    void markSent(const Sp<CandidateNode>& candidate) {
+        closestCandidates.setSent(candidate);
     }
 
     void addClosest(Sp<CandidateNode> candidateNode) {
@@ -68,6 +101,7 @@ protected:
     void callResponsed(RPCCall* call, Sp<Message> response) override;
     void callError(RPCCall* call) override;
     void callTimeout(RPCCall* call) override;
+    void callStalled(RPCCall* call) override;
 
 private:
     bool isBogonAddress(const SocketAddress& addr) const;
@@ -75,6 +109,8 @@ private:
     Id target;
     ClosestSet closestSet;
     ClosestCandidates closestCandidates;
+    LookupConcurrency concurrency;
+    Sp<CandidateNode> cacheCandidate {};
 };
 
 } // namespace carrier
@@ -60,7 +60,7 @@ void NodeLookup::update() {
 
         try {
             sendCall(candidate, request, [&](Sp<RPCCall> call) {
-                candidate->setSent();
+                markSent(candidate);
             });
         } catch (const std::exception& e) {
             log->error("Error on sending 'findNode' request: " + std::string(e.what()));
@@ -77,10 +77,16 @@ void NodeLookup::callResponsed(RPCCall* call, Sp<Message> response) {
         return;
     }
 
+    if (resultHandler && call->getTargetId() == getTarget()) {
+        resultHandler(call->getTarget(), this);
+        if (isFinished())
+            return;
+    }
+
     auto findNodeResponse = std::static_pointer_cast<FindNodeResponse>(response);
     auto nodes = findNodeResponse->getNodes(getDHT().getType());
     if (!nodes.empty())
-        addCandidates(nodes);
+        addCandidates(nodes, nextHops(call));
 }
 
 }
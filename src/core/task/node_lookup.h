@@ -48,6 +48,13 @@ public:
         addCandidates(nodes);
     }
 
+    /**
+     * Called when the target node itself responded.
+     */
+    void setResultHandler(std::function<void(Sp<NodeInfo>, Task*)> resultHandler) {
+        this->resultHandler = resultHandler;
+    }
+
 protected:
     void prepare() override;
     void update() override;
@@ -56,6 +63,7 @@ protected:
 private:
     bool bootstrap {false};
     bool wantToken {false};
+    std::function<void(Sp<NodeInfo>, Task*)> resultHandler {};
 };
 
 } /* namespace carrier */
@@ -39,14 +39,31 @@ class PeerAnnounce: public Task {
 public:
     PeerAnnounce(DHT* dht, const ClosestSet& closest, const PeerInfo& _peer);
 
+    /**
+     * The number of the announce requests which got an error (e.g. the token
+     * expired) or timed out.
+     */
+    int getFailedCalls() const {
+        return failedCalls;
+    }
+
 protected:
     void update() override;
     bool isDone() const override {
-        return todo.empty();
+        return todo.empty() && Task::isDone();
+    }
+
+    void callError(RPCCall* call) override {
+        failedCalls++;
+    }
+
+    void callTimeout(RPCCall* call) override {
+        failedCalls++;
     }
 
 private:
     std::list<Sp<CandidateNode>> todo {};
+    int failedCalls {0};
     PeerInfo peer;
 };
 
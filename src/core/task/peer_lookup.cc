@@ -50,7 +50,7 @@ void PeerLookup::update() {
 
         try {
             sendCall(candidate, request, [&](Sp<RPCCall> call) {
-                candidate->setSent();
+                markSent(candidate);
             });
         } catch (const std::exception& e) {
             log->error("Error on sending 'findPeer' request: " + std::string(e.what()));
@@ -81,9 +81,11 @@ void PeerLookup::callResponsed(RPCCall* call, Sp<Message> message) {
 
     }
     else {
+        missed(call);
+
         const auto& nodes = response->getNodes(getDHT().getType());
         if (!nodes.empty())
-            addCandidates(nodes);
+            addCandidates(nodes, nextHops(call));
     }
 }
 
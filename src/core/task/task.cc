@@ -114,6 +114,7 @@ void Task::clearInFlight() {
         call->addStateChangeHandler([](RPCCall*, RPCCall::State, RPCCall::State) {});
     }
     inFlight.clear();
+    stalledCalls = 0;
 }
 
 // TODO: CHECK ME!!!
@@ -162,11 +163,22 @@ bool Task::sendCall(Sp<NodeInfo> node, Sp<Message> request, std::function<void(S
     call->setName(name);
 #endif
     call->addStateChangeHandler([&](RPCCall* c, RPCCall::State previous, RPCCall::State current) {
+        if (previous == RPCCall::State::STALLED && current != RPCCall::State::STALLED)
+            stalledCalls--;
+
         switch (current) {
         case RPCCall::State::SENT:
             callSent(c);
             break;
 
+        case RPCCall::State::STALLED:
+            if (previous != RPCCall::State::STALLED) {
+                stalledCalls++;
+                if (!isFinished())
+                    callStalled(c);
+            }
+            break;
+
         case RPCCall::State::RESPONDED:
             removeCall(inFlight, c);
             if (!isFinished()) {
@@ -196,6 +208,7 @@ bool Task::sendCall(Sp<NodeInfo> node, Sp<Message> request, std::function<void(S
 
     modifyCallBeforeSubmit(call);
     inFlight[call->hash()] = call;
+    sentCalls++;
 
     log->debug("Task#{} sending call to {}", getTaskId(), node->toString(), request->getRemoteAddress().toString());
     // asyncify since we're under a lock here
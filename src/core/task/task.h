@@ -112,6 +112,20 @@ public:
         return finishTime;
     }
 
+    /**
+     * The number of the RPC requests sent by this task.
+     */
+    int getSentCalls() const {
+        return sentCalls;
+    }
+
+    /**
+     * The maximum number of the in-flight RPC requests of this task.
+     */
+    virtual int getConcurrency() const {
+        return Constants::MAX_CONCURRENT_TASK_REQUESTS;
+    }
+
     uint64_t age() const {
         return currentTimeMillis() - startTime;
     }
@@ -124,7 +138,12 @@ public:
 
 protected:
     bool canDoRequest() const {
-        return inFlight.size() < Constants::MAX_CONCURRENT_TASK_REQUESTS;
+        return inFlight.size() < static_cast<size_t>(getConcurrency());
+    }
+
+    // the in-flight requests which are not stalled
+    int getActiveCalls() const {
+        return static_cast<int>(inFlight.size()) - stalledCalls;
     }
 
     bool sendCall(Sp<NodeInfo> node, Sp<Message> request, std::function<void(Sp<RPCCall>&)> modifyCallBeforeSubmit);
@@ -133,6 +152,7 @@ protected:
     virtual void callResponsed(RPCCall* call, Sp<Message> response) {}
     virtual void callError(RPCCall* call) {}
     virtual void callTimeout(RPCCall* call) {}
+    virtual void callStalled(RPCCall* call) {}
 
     virtual void prepare() {}
     virtual void update() {}
@@ -169,6 +189,8 @@ private:
     uint64_t finishTime {};
 
     std::map<std::size_t, Sp<RPCCall>> inFlight {};
+    int sentCalls {0};
+    int stalledCalls {0};
     std::list<TaskListener> listeners {};
 
     int lock {0};
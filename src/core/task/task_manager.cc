@@ -23,73 +23,178 @@
 #include "utils/time.h"
 #include "task.h"
 #include "task_manager.h"
+#include "rpcserver.h"
+#include "dht.h"
 
 namespace elastos {
 namespace carrier {
 
-void TaskManager::add(Sp<Task> task, bool prior) {
+// The shares of the non-user classes, indexed by the priority
+static const int PRIORITY_WEIGHTS[] = { 0, 4, 2, 1 };
+
+void TaskManager::add(Sp<Task> task, Priority priority) {
     if (canceling)
         return;
 
-    std::unique_lock<std::mutex> lk(taskman_mtx);
+    {
+        std::unique_lock<std::mutex> lk(taskman_mtx);
 
-    if (task->getState() == Task::State::RUNNING) {
-        running.emplace_back(task);
-        return;
+        if (task->getState() == Task::State::RUNNING) {
+            running[task.get()] = { task, priority };
+            numRunning[static_cast<int>(priority)]++;
+            return;
+        }
+
+        if (!task->setState(Task::State::INITIAL, Task::State::QUEUED))
+            return;
+
+        queued[static_cast<int>(priority)].emplace_back(task);
     }
 
-    if (!task->setState(Task::State::INITIAL, Task::State::QUEUED))
+    if (!dht.isRunning())
         return;
 
-    if (prior)
-        queued.emplace_front(task);
+    if (dht.getServer().isRPCThread())
+        dequeue();
     else
-        queued.emplace_back(task);
+        dht.getServer().wakeup();
 }
 
-void TaskManager::dequeue() {
-    std::unique_lock<std::mutex> lk(taskman_mtx);
+bool TaskManager::canStart(Priority priority) const {
+    int total = running.size();
+    int user = numRunning[static_cast<int>(Priority::USER)];
 
-    while (true) {
-        if (!canStartTask() || queued.empty())
-            break;
+    if (priority == Priority::USER)
+        return total < Constants::MAX_ACTIVE_TASKS || user < Constants::USER_TASKS_RESERVED;
 
-        auto task = queued.front();
-        queued.pop_front();
+    return total < Constants::MAX_ACTIVE_TASKS &&
+            total - user < Constants::MAX_ACTIVE_TASKS - Constants::USER_TASKS_RESERVED;
+}
 
+Sp<Task> TaskManager::next() {
+    while (true) {
+        // The user tasks first, then the class with the least running tasks by weight
+        int selected = -1;
+        if (!queued[0].empty() && canStart(Priority::USER)) {
+            selected = 0;
+        } else {
+            for (int i = 1; i < NUM_PRIORITIES; i++) {
+                if (queued[i].empty() || !canStart(static_cast<Priority>(i)))
+                    continue;
+
+                if (selected < 0 || numRunning[i] * PRIORITY_WEIGHTS[selected] <
+                        numRunning[selected] * PRIORITY_WEIGHTS[i])
+                    selected = i;
+            }
+        }
+
+        if (selected < 0)
+            return nullptr;
+
+        auto task = queued[selected].front();
+        queued[selected].pop_front();
+
+        // canceled while it was queued
         if (task->isFinished())
             continue;
 
-        running.emplace_back(task);
+        running[task.get()] = { task, static_cast<Priority>(selected) };
+        numRunning[selected]++;
+        return task;
+    }
+}
+
+void TaskManager::dequeue() {
+    // Re-entered from a task started below, the loop will pick up the rest
+    if (dispatching || canceling)
+        return;
+
+    dispatching = true;
+
+    // canceled from the other threads
+    std::vector<Sp<Task>> canceled {};
+    {
+        std::unique_lock<std::mutex> lk(taskman_mtx);
+        canceled.swap(cancelRequests);
+    }
+    for (auto& task : canceled)
+        task->cancel();
+
+    while (true) {
+        Sp<Task> task;
+        {
+            std::unique_lock<std::mutex> lk(taskman_mtx);
+            task = next();
+        }
+
+        if (!task)
+            break;
 
         task->start();
     }
+    dispatching = false;
+}
+
+void TaskManager::cancel(const Sp<Task>& task) {
+    if (dht.getServer().isRPCThread()) {
+        task->cancel();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lk(taskman_mtx);
+        cancelRequests.push_back(task);
+    }
+
+    if (dht.isRunning())
+        dht.getServer().wakeup();
 }
 
 void TaskManager::cancelAll() {
-    std::unique_lock<std::mutex> lk(taskman_mtx);
-    canceling = true;
+    std::vector<Sp<Task>> tasks {};
 
-    auto it = running.begin();
-    while (it != running.end()) {
-        auto task = *it;
-        it++;
-        task->cancel();
+    {
+        std::unique_lock<std::mutex> lk(taskman_mtx);
+        canceling = true;
+
+        for (auto& [_, entry] : running)
+            tasks.push_back(entry.first);
+        for (auto& queue : queued) {
+            tasks.insert(tasks.end(), queue.begin(), queue.end());
+            queue.clear();
+        }
+
+        tasks.insert(tasks.end(), cancelRequests.begin(), cancelRequests.end());
+        cancelRequests.clear();
+
+        running.clear();
+        for (auto& n : numRunning)
+            n = 0;
     }
 
-    it = queued.begin();
-    while (it != queued.end()) {
-        auto task = *it;
-        it++;
+    for (auto& task : tasks)
         task->cancel();
-    }
 
     canceling = false;
 }
 
 void TaskManager::removeTask(Task* t) {
-    running.remove_if([t](Sp<Task> task){ return task.get() == t; });
-    queued.remove_if([t](Sp<Task> task){ return task.get() == t; });
+    // keep the task alive until the dispatching is done
+    Sp<Task> removed {};
+
+    {
+        std::unique_lock<std::mutex> lk(taskman_mtx);
+        auto it = running.find(t);
+        if (it == running.end())
+            return;
+
+        removed = std::move(it->second.first);
+        numRunning[static_cast<int>(it->second.second)]--;
+        running.erase(it);
+    }
+
+    // A slot is free, start the next queued task
+    dequeue();
 }
 
 }
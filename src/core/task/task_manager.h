@@ -23,8 +23,11 @@
 #pragma once
 
 #include <memory>
-#include <list>
+#include <deque>
+#include <vector>
+#include <unordered_map>
 #include <atomic>
+#include <mutex>
 
 #include "utils/log.h"
 #include "constants.h"
@@ -35,31 +38,80 @@ namespace carrier {
 class DHT;
 class Task;
 
+/**
+ * Schedules the tasks of a DHT on the RPC thread.
+ *
+ * The tasks are queued by priority class and started as soon as there is
+ * room: immediately on add() if called on the RPC thread, otherwise the RPC
+ * loop is woken up to dispatch them; and again whenever a task finishes.
+ *
+ * The user tasks can use the whole active-task budget and always have
+ * Constants::USER_TASKS_RESERVED slots of it, the other classes share the
+ * rest by weight.
+ */
 class TaskManager {
 public:
-    TaskManager(): canceling(false) {
+    enum class Priority {
+        USER = 0,       // user API lookups
+        ANNOUNCE,       // value and peer announcements
+        MAINTENANCE,    // bootstrap, bucket filling and random lookups
+        REFRESH,        // bucket pings
+    };
+
+    TaskManager(DHT& _dht): dht(_dht) {
         log = Logger::get("TaskManager");
     }
 
-    void add(Sp<Task> task, bool prior);
-
-    inline void add(Sp<Task> task) {
-        add(task, false);
-    }
+    /**
+     * Every task names its class, so an internal task never takes the slots
+     * reserved for the user lookups by accident.
+     */
+    void add(Sp<Task> task, Priority priority);
 
+    /**
+     * Start the queued tasks while there is room, should be called on the
+     * RPC thread.
+     */
     void dequeue();
 
-    inline bool canStartTask() {
-        return !canceling && (running.size() <= Constants::MAX_ACTIVE_TASKS);
-    }
+    /**
+     * Cancel a task from any thread. Off the RPC thread the cancellation is
+     * deferred to the next dispatch, so the task listeners always run on the
+     * RPC thread.
+     */
+    void cancel(const Sp<Task>& task);
 
     void cancelAll();
     void removeTask(Task* t);
 
+    int getNumberOfRunningTasks() const {
+        std::lock_guard<std::mutex> lk(taskman_mtx);
+        return running.size();
+    }
+
+    int getNumberOfQueuedTasks() const {
+        std::lock_guard<std::mutex> lk(taskman_mtx);
+        int total = 0;
+        for (const auto& queue : queued)
+            total += queue.size();
+        return total;
+    }
+
 private:
-    std::list<Sp<Task>> queued {};
-    std::list<Sp<Task>> running {};
-    bool canceling {false};
+    static constexpr int NUM_PRIORITIES = 4;
+
+    bool canStart(Priority priority) const;
+    Sp<Task> next();
+
+    DHT& dht;
+
+    std::deque<Sp<Task>> queued[NUM_PRIORITIES] {};
+    std::unordered_map<Task*, std::pair<Sp<Task>, Priority>> running {};
+    int numRunning[NUM_PRIORITIES] {};
+    std::vector<Sp<Task>> cancelRequests {};
+
+    std::atomic<bool> canceling {false};
+    bool dispatching {false};
 
     Sp<Logger> log;
 
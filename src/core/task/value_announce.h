@@ -36,14 +36,31 @@ class ValueAnnounce: public Task {
 public:
     ValueAnnounce(DHT* dht, const ClosestSet& closestSet, const Value& _value);
 
+    /**
+     * The number of the announce requests which got an error (e.g. the token
+     * expired) or timed out.
+     */
+    int getFailedCalls() const {
+        return failedCalls;
+    }
+
 protected:
     void update() override;
     bool isDone() const override {
         return todo.empty() && Task::isDone();
     }
 
+    void callError(RPCCall* call) override {
+        failedCalls++;
+    }
+
+    void callTimeout(RPCCall* call) override {
+        failedCalls++;
+    }
+
 private:
     std::list<Sp<CandidateNode>> todo {};
+    int failedCalls {0};
     Value value;
 };
 
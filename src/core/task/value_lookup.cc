@@ -53,7 +53,7 @@ void ValueLookup::update() {
 
         try {
             sendCall(candidate, request, [&](Sp<RPCCall> call) {
-                candidate->setSent();
+                markSent(candidate);
             });
         } catch (const std::exception& e) {
             log->error("Error on sending 'findValue' request: " + std::string(e.what()));
@@ -92,9 +92,11 @@ void ValueLookup::callResponsed(RPCCall* call, Sp<Message> message) {
         resultHandler(value, this);
     }
     else {
+        missed(call);
+
         auto nodes = response->getNodes(getDHT().getType());
         if (!nodes.empty())
-            addCandidates(nodes);
+            addCandidates(nodes, nextHops(call));
     }
 }
 
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <utility>
+
+#include "utils/time.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * A fixed-capacity LRU cache with hashed lookup and time-to-live.
+ *
+ * Both get() and put() refresh the recency and the expiration time of the
+ * entry, so the least recently used entry is always the first to expire.
+ * The expired entries are purged lazily from the LRU end, all operations
+ * are O(1) amortized.
+ *
+ * Not thread safe.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LRUCache {
+public:
+    LRUCache(size_t _capacity, uint64_t _ttl) : capacity(_capacity), ttl(_ttl) {}
+
+    Value* get(const Key& key) {
+        auto it = index.find(key);
+        if (it == index.end())
+            return nullptr;
+
+        auto now = currentTimeMillis();
+        if (it->second->expiration <= now) {
+            entries.erase(it->second);
+            index.erase(it);
+            return nullptr;
+        }
+
+        it->second->expiration = now + ttl;
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->value;
+    }
+
+    bool contains(const Key& key) const {
+        auto it = index.find(key);
+        return it != index.end() && it->second->expiration > currentTimeMillis();
+    }
+
+    void put(const Key& key, const Value& value) {
+        auto now = currentTimeMillis();
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->value = value;
+            it->second->expiration = now + ttl;
+            entries.splice(entries.begin(), entries, it->second);
+            return;
+        }
+
+        purge(now);
+        if (entries.size() >= capacity && !entries.empty()) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+
+        entries.push_front({key, value, now + ttl});
+        index[key] = entries.begin();
+    }
+
+    bool remove(const Key& key) {
+        auto it = index.find(key);
+        if (it == index.end())
+            return false;
+
+        entries.erase(it->second);
+        index.erase(it);
+        return true;
+    }
+
+    void clear() {
+        entries.clear();
+        index.clear();
+    }
+
+    size_t size() const noexcept {
+        return entries.size();
+    }
+
+    size_t getCapacity() const noexcept {
+        return capacity;
+    }
+
+    void purge() {
+        purge(currentTimeMillis());
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        uint64_t expiration;
+    };
+
+    void purge(uint64_t now) {
+        while (!entries.empty() && entries.back().expiration <= now) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    size_t capacity;
+    uint64_t ttl;
+
+    std::list<Entry> entries {};
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index {};
+};
+
+} // namespace carrier
+} // namespace elastos
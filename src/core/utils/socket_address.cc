@@ -435,5 +435,38 @@ bool SocketAddress::IpCompare::operator()(const SocketAddress& a, const SocketAd
                         (const uint8_t*)&b.ss + offset, len) < 0;
 }
 
+size_t SocketAddress::Hash::operator()(const SocketAddress& addr) const noexcept {
+    // FNV-1a over the family, port and the IP address
+    const uint8_t* data;
+    size_t len;
+    switch (addr.family()) {
+        case AF_INET:
+            data = (const uint8_t*)addr.inaddr4();
+            len = sizeof(in_addr);
+            break;
+        case AF_INET6:
+            data = (const uint8_t*)addr.inaddr6();
+            len = sizeof(in6_addr);
+            break;
+        default:
+            return 0;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&](uint8_t b) {
+        hash ^= b;
+        hash *= 1099511628211ULL;
+    };
+
+    mix(static_cast<uint8_t>(addr.family()));
+    in_port_t port = addr.port();
+    mix(static_cast<uint8_t>(port >> 8));
+    mix(static_cast<uint8_t>(port));
+    for (size_t i = 0; i < len; i++)
+        mix(data[i]);
+
+    return static_cast<size_t>(hash);
+}
+
 } // namespace carrier
 } // namespace elastos
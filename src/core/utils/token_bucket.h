@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "utils/time.h"
+
+namespace elastos {
+namespace carrier {
+
+/**
+ * Token bucket rate limiter, refilled at a fixed rate (tokens per second)
+ * up to its capacity.
+ *
+ * A request is let through as long as any token is left, even if it is
+ * larger than the tokens left or the capacity: the bucket goes into debt
+ * and the following requests wait until it is paid back. So a large
+ * request never starves, and the average rate never exceeds the configured
+ * rate whatever the sizes of the requests are.
+ *
+ * Not thread safe.
+ */
+class TokenBucket {
+public:
+    TokenBucket() = default;
+
+    TokenBucket(double _rate, double _capacity)
+        : rate(_rate), capacity(_capacity), tokens(_capacity) {}
+
+    bool tryTake(double n, uint64_t now = currentTimeMillis()) {
+        refill(now);
+
+        if (tokens <= 0)
+            return false;
+
+        tokens -= n;
+        return true;
+    }
+
+    double available(uint64_t now = currentTimeMillis()) {
+        refill(now);
+        return tokens;
+    }
+
+private:
+    void refill(uint64_t now) {
+        if (lastRefill != 0 && now > lastRefill)
+            tokens = std::min(capacity, tokens + (now - lastRefill) * rate / 1000);
+        lastRefill = std::max(lastRefill, now);
+    }
+
+    double rate {0};
+    double capacity {0};
+    double tokens {0};
+    uint64_t lastRefill {0};
+};
+
+} // namespace carrier
+} // namespace elastos
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <set>
+
+#include "utils/log.h"
+#include "constants.h"
+#include "write_behind_storage.h"
+
+namespace elastos {
+namespace carrier {
+
+WriteBehindStorage::WriteBehindStorage(Sp<DataStorage> reader, Sp<DataStorage> writer)
+        : reader(reader), writer(writer) {
+    log = Logger::get("Storage");
+    nextExpire = Clock::now();
+    thread = std::thread([this]() {
+        run();
+    });
+}
+
+WriteBehindStorage::~WriteBehindStorage() {
+    close();
+}
+
+Sp<Value> WriteBehindStorage::lookupValue(const Id& valueId) {
+    auto it = values.find(valueId);
+    if (it != values.end())
+        return it->second.value ? std::make_shared<Value>(*it->second.value) : nullptr;
+
+    return reader->getValue(valueId);
+}
+
+Sp<PeerInfo> WriteBehindStorage::lookupPeer(const Id& peerId, const Id& origin) {
+    auto it = peers.find({peerId, origin});
+    if (it != peers.end())
+        return it->second.peer ? std::make_shared<PeerInfo>(*it->second.peer) : nullptr;
+
+    return reader->getPeer(peerId, origin);
+}
+
+void WriteBehindStorage::waitForRoom(std::unique_lock<std::mutex>& lock) {
+    // only when the disk can not keep up, the queue and overlay should not grow without bound
+    committed.wait(lock, [&]() {
+        return queue.size() < (size_t)Constants::STORAGE_WRITE_QUEUE_LIMIT || !running;
+    });
+
+    if (!running)
+        throw std::runtime_error("The storage is closed.");
+}
+
+uint64_t WriteBehindStorage::enqueue(std::function<void(DataStorage&)> apply, std::function<void(uint64_t)> settle) {
+    auto seq = ++lastSeq;
+    queue.push_back({seq, std::move(apply), std::move(settle)});
+
+    auto depth = queue.size() + committing;
+    if (depth > stats.maxQueueDepth)
+        stats.maxQueueDepth = depth;
+
+    queued.notify_one();
+    return seq;
+}
+
+void WriteBehindStorage::settleValue(const Id& valueId, uint64_t seq) {
+    auto it = values.find(valueId);
+    if (it != values.end() && it->second.seq == seq)
+        values.erase(it);
+}
+
+void WriteBehindStorage::settlePeer(const PeerKey& key, uint64_t seq) {
+    auto it = peers.find(key);
+    if (it != peers.end() && it->second.seq == seq)
+        peers.erase(it);
+}
+
+Sp<Value> WriteBehindStorage::getValue(const Id& valueId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookupValue(valueId);
+}
+
+bool WriteBehindStorage::removeValue(const Id& valueId) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForRoom(lock);
+
+    bool existed = lookupValue(valueId) != nullptr;
+    auto seq = enqueue([valueId](DataStorage& storage) {
+        storage.removeValue(valueId);
+    }, [this, valueId](uint64_t seq) {
+        settleValue(valueId, seq);
+    });
+
+    values[valueId] = { nullptr, seq };
+    return existed;
+}
+
+Sp<Value> WriteBehindStorage::putValue(const Value& value, int expectedSeq, bool persistent, bool updateLastAnnounce) {
+    if (value.isMutable() && !value.isValid())
+        throw std::invalid_argument("Value signature validation failed");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForRoom(lock);
+
+    auto id = value.getId();
+    auto old = lookupValue(id);
+    checkReplace(old, value, expectedSeq);
+
+    // already checked against the pending writes, they are committed in order
+    auto seq = enqueue([value, persistent, updateLastAnnounce](DataStorage& storage) {
+        storage.putValue(value, -1, persistent, updateLastAnnounce);
+    }, [this, id](uint64_t seq) {
+        settleValue(id, seq);
+    });
+
+    values[id] = { std::make_shared<Value>(value), seq };
+    return old;
+}
+
+void WriteBehindStorage::updateValueLastAnnounce(const Id& valueId) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForRoom(lock);
+
+    enqueue([valueId](DataStorage& storage) {
+        storage.updateValueLastAnnounce(valueId);
+    });
+}
+
+std::vector<Id> WriteBehindStorage::scanValueIds(ScanCursor& cursor, size_t limit) {
+    flushBeforeScan(cursor);
+    return reader->scanValueIds(cursor, limit);
+}
+
+std::vector<Value> WriteBehindStorage::scanValues(ScanCursor& cursor, size_t limit) {
+    flushBeforeScan(cursor);
+    return reader->scanValues(cursor, limit);
+}
+
+std::vector<Value> WriteBehindStorage::scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    flushBeforeScan(cursor);
+    return reader->scanPersistentValues(lastAnnounceBefore, cursor, limit);
+}
+
+std::vector<PeerInfo> WriteBehindStorage::getPeer(const Id& peerId, int maxPeers) {
+    std::vector<PeerInfo> result {};
+    std::set<Id> pending {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = peers.lower_bound({peerId, Id::MIN_ID}); it != peers.end() && it->first.first == peerId; ++it) {
+        pending.insert(it->first.second);
+        if (it->second.peer)
+            result.push_back(*it->second.peer);
+    }
+
+    // the stored ones replaced or removed by the pending writes are skipped
+    int wanted = maxPeers > 0 ? maxPeers + pending.size() : maxPeers;
+    for (auto& peer : reader->getPeer(peerId, wanted)) {
+        if (pending.find(peer.getOrigin()) == pending.end())
+            result.push_back(std::move(peer));
+    }
+
+    if (maxPeers > 0 && result.size() > (size_t)maxPeers)
+        result.erase(result.begin() + maxPeers, result.end());
+
+    return result;
+}
+
+Sp<PeerInfo> WriteBehindStorage::getPeer(const Id& peerId, const Id& origin) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookupPeer(peerId, origin);
+}
+
+bool WriteBehindStorage::removePeer(const Id& peerId, const Id& origin) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForRoom(lock);
+
+    bool existed = lookupPeer(peerId, origin) != nullptr;
+    PeerKey key {peerId, origin};
+    auto seq = enqueue([peerId, origin](DataStorage& storage) {
+        storage.removePeer(peerId, origin);
+    }, [this, key](uint64_t seq) {
+        settlePeer(key, seq);
+    });
+
+    peers[key] = { nullptr, seq };
+    return existed;
+}
+
+void WriteBehindStorage::putPeer(const std::vector<PeerInfo>& found) {
+    if (found.empty())
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForRoom(lock);
+
+    auto seq = enqueue([found](DataStorage& storage) {
+        storage.putPeer(found);
+    }, [this, found](uint64_t seq) {
+        for (const auto& peer : found)
+            settlePeer({peer.getId(), peer.getOrigin()}, seq);
+    });
+
+    for (const auto& peer : found)
+        peers[{peer.getId(), peer.getOrigin()}] = { std::make_shared<PeerInfo>(peer), seq };
+}
+
+void WriteBehindStorage::putPeer(const PeerInfo& peer, bool persistent, bool updateLastAnnounce) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForRoom(lock);
+
+    PeerKey key {peer.getId(), peer.getOrigin()};
+    auto seq = enqueue([peer, persistent, updateLastAnnounce](DataStorage& storage) {
+        storage.putPeer(peer, persistent, updateLastAnnounce);
+    }, [this, key](uint64_t seq) {
+        settlePeer(key, seq);
+    });
+
+    peers[key] = { std::make_shared<PeerInfo>(peer), seq };
+}
+
+void WriteBehindStorage::updatePeerLastAnnounce(const Id& peerId, const Id& origin) {
+    std::unique_lock<std::mutex> lock(mutex);
+    waitForRoom(lock);
+
+    enqueue([peerId, origin](DataStorage& storage) {
+        storage.updatePeerLastAnnounce(peerId, origin);
+    });
+}
+
+std::vector<Id> WriteBehindStorage::scanPeerIds(ScanCursor& cursor, size_t limit) {
+    flushBeforeScan(cursor);
+    return reader->scanPeerIds(cursor, limit);
+}
+
+std::vector<PeerInfo> WriteBehindStorage::scanPeers(ScanCursor& cursor, size_t limit) {
+    flushBeforeScan(cursor);
+    return reader->scanPeers(cursor, limit);
+}
+
+std::vector<PeerInfo> WriteBehindStorage::scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) {
+    flushBeforeScan(cursor);
+    return reader->scanPersistentPeers(lastAnnounceBefore, cursor, limit);
+}
+
+PrefixStats WriteBehindStorage::getPrefixStats(const Prefix& prefix) {
+    flush();
+    return reader->getPrefixStats(prefix);
+}
+
+size_t WriteBehindStorage::expire(size_t maxEntries) {
+    std::lock_guard<std::mutex> lock(expiring);
+    auto removed = writer->expire(maxEntries);
+    if (removed > 0 && expireListener)
+        expireListener();
+
+    return removed;
+}
+
+void WriteBehindStorage::setExpireListener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(expiring);
+    expireListener = std::move(listener);
+}
+
+StorageStats WriteBehindStorage::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto result = stats;
+    result.queueDepth = queue.size() + committing;
+    return result;
+}
+
+void WriteBehindStorage::flushBeforeScan(const ScanCursor& cursor) {
+    // Only before the first page: the writes queued between the pages, such as
+    // the last announce updates of the records already returned, are not waited for
+    if (!cursor.started)
+        flush();
+}
+
+void WriteBehindStorage::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto seq = lastSeq;
+    committed.wait(lock, [&]() {
+        return committedSeq >= seq;
+    });
+}
+
+void WriteBehindStorage::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+
+    queued.notify_all();
+    committed.notify_all();
+    if (thread.joinable())
+        thread.join();
+
+    writer->close();
+    reader->close();
+}
+
+void WriteBehindStorage::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queued.wait_until(lock, nextExpire, [&]() {
+            return !queue.empty() || !running;
+        });
+
+        if (!queue.empty())
+            commit(lock);
+        else if (!running)
+            break;
+
+        // one chunk at a time, so the queued writes are not held up by a large expiration
+        if (running && Clock::now() >= nextExpire) {
+            lock.unlock();
+            size_t removed = 0;
+            try {
+                removed = expire(Constants::STORAGE_EXPIRE_CHUNK);
+            } catch (const std::exception& e) {
+                log->error("Expire the storage failed: {}", e.what());
+            }
+            lock.lock();
+
+            stats.expired += removed;
+            nextExpire = Clock::now();
+            if (removed == 0)
+                nextExpire += std::chrono::milliseconds(Constants::STORAGE_EXPIRE_INTERVAL);
+        }
+    }
+}
+
+void WriteBehindStorage::commit(std::unique_lock<std::mutex>& lock) {
+    size_t count = std::min(queue.size(), (size_t)Constants::STORAGE_WRITE_BATCH);
+    std::vector<Write> writes {};
+    writes.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        writes.push_back(std::move(queue.front()));
+        queue.pop_front();
+    }
+
+    committing = count;
+    lock.unlock();
+
+    auto started = Clock::now();
+    try {
+        writer->batch([&]() {
+            for (const auto& write : writes) {
+                try {
+                    write.apply(*writer);
+                } catch (const std::exception& e) {
+                    log->warn("Write the storage failed: {}", e.what());
+                }
+            }
+        });
+    } catch (const std::exception& e) {
+        log->error("Commit {} writes to the storage failed: {}", writes.size(), e.what());
+    }
+    uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count();
+
+    lock.lock();
+    // the failed writes are dropped too, the overlay only holds what is not committed yet
+    for (const auto& write : writes) {
+        if (write.settle)
+            write.settle(write.seq);
+    }
+
+    committedSeq = writes.back().seq;
+    committing = 0;
+
+    stats.commits++;
+    stats.writes += writes.size();
+    stats.commitLatency = latency;
+    stats.totalCommitLatency += latency;
+    if (latency > stats.maxCommitLatency)
+        stats.maxCommitLatency = latency;
+
+    committed.notify_all();
+}
+
+} /* namespace carrier */
+} /* namespace elastos */
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+
+#include "carrier/id.h"
+#include "carrier/value.h"
+#include "carrier/peer_info.h"
+#include "carrier/storage_stats.h"
+#include "data_storage.h"
+
+namespace elastos {
+namespace carrier {
+
+class Logger;
+
+/**
+ * Keeps the storage I/O off the calling thread.
+ *
+ * The writes are queued and visible at once through an in-memory overlay of
+ * the pending values and peers, a background thread commits them to the
+ * writer storage in batches: all the writes queued while a commit is in
+ * progress go into the next transaction. The thread also expires the old
+ * values and peers, a few at a time between the commits, and tells the
+ * expire listener when some were removed.
+ *
+ * The reads not answered by the overlay go to the reader storage, it should
+ * see the commits of the writer, e.g. another connection on the same WAL
+ * database. A scan flushes the queue before its first page, so it sees all
+ * the writes queued before it started.
+ *
+ * Thread safe.
+ */
+class WriteBehindStorage final : public DataStorage {
+public:
+    WriteBehindStorage(Sp<DataStorage> reader, Sp<DataStorage> writer);
+    ~WriteBehindStorage();
+
+    Sp<Value> getValue(const Id& valueId) override;
+    bool removeValue(const Id& valueId) override;
+    Sp<Value> putValue(const Value& value, int expectedSeq = -1, bool persistent = false, bool updateLastAnnounce = false) override;
+    using DataStorage::putValue;
+    void updateValueLastAnnounce(const Id& valueId) override;
+    std::vector<Id> scanValueIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanValues(ScanCursor& cursor, size_t limit) override;
+    std::vector<Value> scanPersistentValues(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+
+    std::vector<PeerInfo> getPeer(const Id& peerId, int maxPeers) override;
+    Sp<PeerInfo> getPeer(const Id& peerId, const Id& origin) override;
+    bool removePeer(const Id& peerId, const Id& origin) override;
+    void putPeer(const std::vector<PeerInfo>& peers) override;
+    void putPeer(const PeerInfo& peer, bool persistent = false, bool updateLastAnnounce = false) override;
+    void updatePeerLastAnnounce(const Id& peerId, const Id& origin) override;
+    std::vector<Id> scanPeerIds(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPeers(ScanCursor& cursor, size_t limit) override;
+    std::vector<PeerInfo> scanPersistentPeers(uint64_t lastAnnounceBefore, ScanCursor& cursor, size_t limit) override;
+    PrefixStats getPrefixStats(const Prefix& prefix) override;
+
+    size_t expire(size_t maxEntries) override;
+    StorageStats getStats() const override;
+
+    // waits until the writes queued so far are committed
+    void flush();
+
+    // called after an expire() removed some values or peers, e.g. to drop them from a cache above
+    void setExpireListener(std::function<void()> listener);
+
+    // commits the queued writes, then closes both storages
+    void close() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Write {
+        uint64_t seq;
+        std::function<void(DataStorage&)> apply;
+        // drops the overlay entries of the write, called under the mutex after the commit
+        std::function<void(uint64_t)> settle;
+    };
+
+    // nullptr for a removed value or peer
+    struct PendingValue {
+        Sp<Value> value;
+        uint64_t seq;
+    };
+
+    struct PendingPeer {
+        Sp<PeerInfo> peer;
+        uint64_t seq;
+    };
+
+    // the peers are keyed by the peer id and the origin, as getPeer() and removePeer() look them up
+    using PeerKey = std::pair<Id, Id>;
+
+    void flushBeforeScan(const ScanCursor& cursor);
+    Sp<Value> lookupValue(const Id& valueId);
+    Sp<PeerInfo> lookupPeer(const Id& peerId, const Id& origin);
+    void waitForRoom(std::unique_lock<std::mutex>& lock);
+    uint64_t enqueue(std::function<void(DataStorage&)> apply, std::function<void(uint64_t)> settle = nullptr);
+    void settleValue(const Id& valueId, uint64_t seq);
+    void settlePeer(const PeerKey& key, uint64_t seq);
+
+    void run();
+    void commit(std::unique_lock<std::mutex>& lock);
+
+    Sp<DataStorage> reader;
+    Sp<DataStorage> writer;
+
+    std::deque<Write> queue {};
+    std::map<Id, PendingValue> values {};
+    std::map<PeerKey, PendingPeer> peers {};
+
+    uint64_t lastSeq {0};
+    uint64_t committedSeq {0};
+    size_t committing {0};
+    Clock::time_point nextExpire {};
+
+    bool running {true};
+    std::thread thread {};
+    mutable std::mutex mutex {};
+    std::condition_variable queued {};
+    std::condition_variable committed {};
+
+    // one expiration at a time, the listener returns before the next one starts
+    std::mutex expiring {};
+    std::function<void()> expireListener {};
+
+    StorageStats stats {};
+    Sp<Logger> log {};
+};
+
+} /* namespace carrier */
+} /* namespace elastos */
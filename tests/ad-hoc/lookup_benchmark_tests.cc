@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// std
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <thread>
+
+// carrier
+#include <carrier.h>
+#include <utils.h>
+#include "lookup_benchmark_tests.h"
+
+using namespace std::chrono_literals;
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(LookupBenchmarkTester);
+
+#define NODE_COUNT          64
+#define LOOKUP_COUNT        256
+#define WIDE_BUCKET_SIZE    32
+
+void LookupBenchmarkTester::setUp() {
+    dataDir = Utils::getPwdStorage("lookup_benchmark_data");
+    Utils::removeStorage(dataDir);
+    nodes.clear();
+}
+
+LookupStats LookupBenchmarkTester::runLookups(const std::string& mode, uint16_t port, int wideBucketSize) {
+    auto builder = DefaultConfiguration::Builder {};
+    auto ipAddresses = Utils::getLocalIpAddresses();
+    builder.setIPv4Address(ipAddresses);
+    builder.setWideBucketSize(wideBucketSize);
+
+    Sp<NodeInfo> bootstrap {};
+    for (int i = 0; i < NODE_COUNT; i++) {
+        builder.setListeningPort(port++);
+        builder.setStoragePath(dataDir + Utils::PATH_SEP + mode + std::to_string(i));
+
+        auto node = std::make_shared<Node>(builder.build());
+        nodes.emplace_back(node);
+        node->start();
+
+        if (bootstrap)
+            node->bootstrap(*bootstrap);
+        else
+            bootstrap = std::make_shared<NodeInfo>(node->getId(), ipAddresses, port - 1);
+    }
+
+    // let the routing tables converge
+    std::cout << "-- " << mode << ": " << NODE_COUNT << " nodes started, waiting for the routing tables" << std::endl;
+    std::this_thread::sleep_for(30s);
+
+    LookupStats before {};
+    for (const auto& node : nodes)
+        before += node->getLookupStats();
+
+    for (int i = 0; i < LOOKUP_COUNT; i++) {
+        auto& origin = nodes[i % NODE_COUNT];
+        auto& target = nodes[(i * 7 + 1) % NODE_COUNT];
+        if (origin == target)
+            continue;
+
+        auto future = origin->findNode(target->getId());
+        future.get();
+    }
+
+    LookupStats after {};
+    for (const auto& node : nodes)
+        after += node->getLookupStats();
+
+    stopNodes();
+
+    LookupStats stats {};
+    stats.lookups = after.lookups - before.lookups;
+    stats.hops = after.hops - before.hops;
+    stats.requests = after.requests - before.requests;
+    stats.latency = after.latency - before.latency;
+    stats.concurrency = after.concurrency - before.concurrency;
+    return stats;
+}
+
+void LookupBenchmarkTester::testLookupBenchmark() {
+    auto normal = runLookups("normal", 43000, 0);
+    auto wide = runLookups("wide", 43200, WIDE_BUCKET_SIZE);
+
+    auto print = [](const std::string& mode, const LookupStats& stats) {
+        std::cout << std::left << std::setw(16) << mode
+                  << std::right << std::setw(10) << stats.lookups
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(12) << stats.averageHops()
+                  << std::setw(12) << stats.averageRequests()
+                  << std::setw(14) << stats.averageLatency()
+                  << std::setw(12) << stats.averageConcurrency() << std::endl;
+    };
+
+    std::cout << std::endl << "Lookup benchmark, " << NODE_COUNT << " local nodes:" << std::endl;
+    std::cout << std::left << std::setw(16) << "mode"
+              << std::right << std::setw(10) << "lookups"
+              << std::setw(12) << "avg hops"
+              << std::setw(12) << "avg RPCs"
+              << std::setw(14) << "avg ms"
+              << std::setw(12) << "avg alpha" << std::endl;
+    print("normal (k=8)", normal);
+    print("wide (k=" + std::to_string(WIDE_BUCKET_SIZE) + ")", wide);
+
+    CPPUNIT_ASSERT(normal.lookups > 0);
+    CPPUNIT_ASSERT(wide.lookups > 0);
+}
+
+void LookupBenchmarkTester::stopNodes() {
+    for (auto node : nodes) {
+        node->stop();
+    }
+    nodes.clear();
+}
+
+void LookupBenchmarkTester::tearDown() {
+    stopNodes();
+}
+}  // namespace test
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// std
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <chrono>
+
+#include <nlohmann/json.hpp>
+
+// carrier
+#include <carrier.h>
+#include <utils.h>
+#include "dht.h"
+#include "routing_table.h"
+#include "kbucket_entry.h"
+#include "utils/time.h"
+#include "routingtable_benchmark_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(RoutingTableBenchmarkTester);
+
+#define ENTRY_COUNT         10000
+#define WIDE_BUCKET_SIZE    64
+#define LOAD_ROUNDS         10
+
+void RoutingTableBenchmarkTester::setUp() {
+    dataDir = Utils::getPwdStorage("routingtable_benchmark_data");
+    Utils::removeStorage(dataDir);
+
+    auto builder = DefaultConfiguration::Builder {};
+    builder.setIPv4Address(Utils::getLocalIpAddresses());
+    builder.setListeningPort(43400);
+    builder.setStoragePath(dataDir);
+    builder.setWideBucketSize(WIDE_BUCKET_SIZE);
+
+    // never started, only the routing tables are used
+    node = std::make_shared<Node>(builder.build());
+}
+
+void RoutingTableBenchmarkTester::testLoadBenchmark() {
+    auto dht = std::make_shared<DHT>(DHT::Type::IPV4, *node, node->getConfig()->ipv4Address());
+    auto& rt = dht->getRoutingTable();
+
+    for (int i = 0; i < ENTRY_COUNT; i++) {
+        std::string addr = "10." + std::to_string(i / 62500) + "." +
+                std::to_string(i / 250 % 250) + "." + std::to_string(i % 250 + 1);
+        auto entry = std::make_shared<KBucketEntry>(NodeInfo {Id::random(), addr, 39001});
+        entry->signalResponse();
+        rt.put(entry);
+    }
+
+    auto binaryPath = dataDir + Utils::PATH_SEP + "dht4.cache";
+    rt.save(binaryPath);
+    rt.waitForPendingSave();
+
+    // the CBOR file written by the earlier versions
+    nlohmann::json entries = nlohmann::json::array();
+    for (const auto& bucket : rt.getBuckets()) {
+        for (const auto& entry : bucket->getEntries())
+            entries.push_back(entry->toJson());
+    }
+    nlohmann::json root = nlohmann::json::object();
+    root["timestamp"] = currentTimeMillis();
+    root["entries"] = entries;
+    auto cbor = nlohmann::json::to_cbor(root);
+
+    auto legacyPath = dataDir + Utils::PATH_SEP + "dht4.legacy";
+    std::ofstream os(legacyPath, std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char*>(cbor.data()), cbor.size());
+    os.close();
+
+    auto measure = [&](const std::string& path, int& loaded) {
+        double total = 0;
+        for (int i = 0; i < LOAD_ROUNDS; i++) {
+            auto other = std::make_shared<DHT>(DHT::Type::IPV4, *node, node->getConfig()->ipv4Address());
+            auto started = std::chrono::steady_clock::now();
+            other->getRoutingTable().load(path);
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+            loaded = other->getRoutingTable().getNumBucketEntries();
+        }
+        return total / LOAD_ROUNDS;
+    };
+
+    auto fileSize = [](const std::string& path) {
+        std::ifstream is(path, std::ios::binary | std::ios::ate);
+        return static_cast<size_t>(is.tellg());
+    };
+
+    int binaryLoaded = 0;
+    int legacyLoaded = 0;
+    auto binaryTime = measure(binaryPath, binaryLoaded);
+    auto legacyTime = measure(legacyPath, legacyLoaded);
+
+    std::cout << std::endl << "Routing table load benchmark, " << rt.getNumBucketEntries()
+              << " entries in " << rt.size() << " buckets:" << std::endl;
+    std::cout << std::left << std::setw(16) << "format"
+              << std::right << std::setw(12) << "bytes"
+              << std::setw(12) << "loaded"
+              << std::setw(14) << "avg ms" << std::endl;
+    std::cout << std::left << std::setw(16) << "binary"
+              << std::right << std::setw(12) << fileSize(binaryPath)
+              << std::setw(12) << binaryLoaded
+              << std::fixed << std::setprecision(2) << std::setw(14) << binaryTime << std::endl;
+    std::cout << std::left << std::setw(16) << "legacy CBOR"
+              << std::right << std::setw(12) << fileSize(legacyPath)
+              << std::setw(12) << legacyLoaded
+              << std::fixed << std::setprecision(2) << std::setw(14) << legacyTime << std::endl;
+
+    CPPUNIT_ASSERT(binaryLoaded > 0);
+    CPPUNIT_ASSERT(legacyLoaded > 0);
+}
+
+void RoutingTableBenchmarkTester::tearDown() {
+    node = nullptr;
+    Utils::removeStorage(dataDir);
+}
+}  // namespace test
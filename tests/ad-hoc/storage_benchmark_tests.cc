@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// std
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+// carrier
+#include <carrier.h>
+#include <utils.h>
+#include "sqlite_storage.h"
+#include "memory_storage.h"
+#include "log_storage.h"
+#include "storage_benchmark_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(StorageBenchmarkTester);
+
+#define OPERATION_COUNT     5000
+#define PEERS_PER_ID        10
+#define BENCHMARK_ROUNDS    3
+
+void StorageBenchmarkTester::setUp() {
+    path = Utils::getPwdStorage("storage_benchmark.db");
+    cleanup();
+}
+
+void StorageBenchmarkTester::tearDown() {
+    cleanup();
+}
+
+void StorageBenchmarkTester::cleanup() {
+    Utils::removeStorage(path);
+    Utils::removeStorage(path + "-wal");
+    Utils::removeStorage(path + "-shm");
+}
+
+void StorageBenchmarkTester::benchmark(const std::string& name, const std::function<Sp<DataStorage>()>& open) {
+    std::vector<Value> values {};
+    for (int i = 0; i < OPERATION_COUNT; i++)
+        values.push_back(Value::createValue(Utils::getRandomData(256)));
+
+    std::vector<PeerInfo> peers {};
+    std::vector<Signature::KeyPair> keypairs(OPERATION_COUNT / PEERS_PER_ID);
+    for (int i = 0; i < OPERATION_COUNT; i++)
+        peers.push_back(PeerInfo::create(keypairs[i % keypairs.size()], Id::random(), Id::random(), 8000));
+
+    const std::vector<std::string> ops { "putValue", "getValue", "putPeer", "getPeer" };
+    std::map<std::string, std::vector<uint64_t>> rates {};
+
+    for (int round = 0; round < BENCHMARK_ROUNDS; round++) {
+        cleanup();
+        auto storage = open();
+
+        auto measure = [&](const std::string& op, const std::function<void(int)>& run) {
+            auto started = std::chrono::steady_clock::now();
+            for (int i = 0; i < OPERATION_COUNT; i++)
+                run(i);
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - started).count();
+            rates[op].push_back((uint64_t)OPERATION_COUNT * 1000000 / std::max<int64_t>(elapsed, 1));
+        };
+
+        measure("putValue", [&](int i) { storage->putValue(values[i]); });
+        measure("getValue", [&](int i) { CPPUNIT_ASSERT(storage->getValue(values[i].getId())); });
+        measure("putPeer", [&](int i) { storage->putPeer(peers[i]); });
+        measure("getPeer", [&](int i) {
+            CPPUNIT_ASSERT(storage->getPeer(peers[i].getId(), 8).size() == 8);
+        });
+
+        storage->close();
+    }
+
+    std::cout << std::endl << name << ", " << OPERATION_COUNT << " ops each, median of "
+              << BENCHMARK_ROUNDS << " rounds:" << std::endl;
+    for (const auto& op : ops) {
+        auto& r = rates[op];
+        std::sort(r.begin(), r.end());
+        std::cout << "  " << std::left << std::setw(10) << op << std::right
+                  << std::setw(10) << r[r.size() / 2] << " ops/s" << std::endl;
+    }
+}
+
+void StorageBenchmarkTester::testSqliteStorage() {
+    benchmark("SqliteStorage", [&]() {
+        return SqliteStorage::open(path);
+    });
+}
+
+void StorageBenchmarkTester::testMemoryStorage() {
+    benchmark("MemoryStorage", [&]() {
+        return std::make_shared<MemoryStorage>(64 * 1024 * 1024);
+    });
+}
+
+void StorageBenchmarkTester::testLogStorage() {
+    benchmark("LogStorage", [&]() {
+        return std::make_shared<LogStorage>(path);
+    });
+}
+
+}  // namespace test
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <functional>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include <carrier.h>
+
+#include "data_storage.h"
+
+namespace test {
+
+class StorageBenchmarkTester : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(StorageBenchmarkTester);
+    CPPUNIT_TEST(testSqliteStorage);
+    CPPUNIT_TEST(testMemoryStorage);
+    CPPUNIT_TEST(testLogStorage);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+
+    void testSqliteStorage();
+    void testMemoryStorage();
+    void testLogStorage();
+
+private:
+    // Runs the operations on a fresh storage every round and prints the median rates
+    void benchmark(const std::string& name, const std::function<Sp<DataStorage>()>& open);
+    void cleanup();
+
+    std::string path {};
+};
+
+}  // namespace test
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <carrier.h>
+
+#include "utils/time.h"
+#include "announce_cache.h"
+#include "announce_cache_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(AnnounceCacheTests);
+
+static ClosestSet makeClosestSet(const Id& target, int size) {
+    ClosestSet closest(target, 8);
+    for (int i = 0; i < size; i++) {
+        auto cn = std::make_shared<CandidateNode>(NodeInfo(Id::random(), SocketAddress("192.168.1.1", 39001 + i)));
+        cn->setToken(1000 + i);
+        closest.add(cn);
+    }
+    return closest;
+}
+
+void AnnounceCacheTests::testPutAndGet() {
+    AnnounceCache cache(60 * 1000);
+
+    auto target = Id::random();
+    CPPUNIT_ASSERT(!cache.get(target));
+
+    auto closest = makeClosestSet(target, 4);
+    cache.put(target, closest, currentTimeMillis());
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+
+    auto cached = cache.get(target);
+    CPPUNIT_ASSERT(cached);
+    CPPUNIT_ASSERT_EQUAL(4, cached->size());
+    for (const auto& cn : closest.getEntries()) {
+        auto entry = cached->get(cn->getId());
+        CPPUNIT_ASSERT(entry != nullptr);
+        CPPUNIT_ASSERT_EQUAL(cn->getToken(), entry->getToken());
+    }
+
+    // other targets are not affected
+    CPPUNIT_ASSERT(!cache.get(Id::random()));
+
+    // the tokens already too old, or no nodes to announce to
+    auto other = Id::random();
+    cache.put(other, makeClosestSet(other, 4), currentTimeMillis() - 60 * 1000);
+    CPPUNIT_ASSERT(!cache.get(other));
+    cache.put(other, makeClosestSet(other, 0), currentTimeMillis());
+    CPPUNIT_ASSERT(!cache.get(other));
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+}
+
+void AnnounceCacheTests::testExpiration() {
+    AnnounceCache cache(500);
+
+    auto target = Id::random();
+    auto now = currentTimeMillis();
+    cache.put(target, makeClosestSet(target, 4), now, now);
+
+    // counted from the acquired time, not the put time
+    auto older = Id::random();
+    cache.put(older, makeClosestSet(older, 4), now - 300, now);
+
+    CPPUNIT_ASSERT(cache.get(target, now));
+    CPPUNIT_ASSERT(cache.get(older, now));
+
+    CPPUNIT_ASSERT(cache.get(target, now + 300));
+    CPPUNIT_ASSERT(cache.get(older, now + 199));
+    CPPUNIT_ASSERT(!cache.get(older, now + 200));
+
+    CPPUNIT_ASSERT(cache.get(target, now + 499));
+    CPPUNIT_ASSERT(!cache.get(target, now + 500));
+
+    // the expired entries are purged on put
+    auto fresh = Id::random();
+    cache.put(fresh, makeClosestSet(fresh, 4), now + 600, now + 600);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+}
+
+void AnnounceCacheTests::testRemove() {
+    AnnounceCache cache(60 * 1000);
+
+    auto target = Id::random();
+    cache.put(target, makeClosestSet(target, 4), currentTimeMillis());
+    CPPUNIT_ASSERT(cache.get(target));
+
+    // replaced by the later lookup
+    cache.put(target, makeClosestSet(target, 2), currentTimeMillis());
+    CPPUNIT_ASSERT_EQUAL(2, cache.get(target)->size());
+
+    cache.remove(target);
+    CPPUNIT_ASSERT(!cache.get(target));
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+
+    cache.put(target, makeClosestSet(target, 4), currentTimeMillis());
+    cache.clear();
+    CPPUNIT_ASSERT(!cache.get(target));
+}
+
+}  // namespace test
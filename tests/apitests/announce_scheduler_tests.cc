@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include <carrier.h>
+
+#include "utils/time.h"
+#include "announce_scheduler.h"
+#include "announce_scheduler_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(AnnounceSchedulerTests);
+
+using Kind = AnnounceScheduler::Kind;
+
+// Records the started announces, they complete when the test says so
+struct Announces {
+    std::vector<Id> started {};
+    std::vector<std::list<Sp<NodeInfo>>> seeds {};
+    std::vector<AnnounceScheduler::CompleteHandler> handlers {};
+
+    AnnounceScheduler::Announce make(const Id& target) {
+        return [=](const std::list<Sp<NodeInfo>>& s, AnnounceScheduler::CompleteHandler handler) {
+            started.push_back(target);
+            seeds.push_back(s);
+            handlers.push_back(handler);
+        };
+    }
+
+    // a copy, the completion may start another announce and grow the handlers
+    void complete(size_t i, const std::list<Sp<NodeInfo>>& closest = {}) {
+        auto handler = handlers[i];
+        handler(closest);
+    }
+};
+
+static std::list<Sp<NodeInfo>> makeNodes(int n) {
+    std::list<Sp<NodeInfo>> nodes {};
+    for (int i = 0; i < n; i++)
+        nodes.push_back(std::make_shared<NodeInfo>(Id::random(), SocketAddress("192.168.1.1", 39001 + i)));
+    return nodes;
+}
+
+void AnnounceSchedulerTests::testPacing() {
+    AnnounceScheduler scheduler(8);
+    Announces announces;
+
+    auto now = currentTimeMillis();
+    auto id1 = Id::random();
+    auto id2 = Id::random();
+    scheduler.add(Kind::VALUE, id1, now, announces.make(id1));
+    scheduler.add(Kind::PEER, id2, now + 300, announces.make(id2));
+
+    scheduler.dispatch();
+    CPPUNIT_ASSERT_EQUAL((size_t)1, announces.started.size());
+    CPPUNIT_ASSERT(announces.started[0] == id1);
+
+    auto stats = scheduler.getStats();
+    CPPUNIT_ASSERT_EQUAL((uint64_t)1, stats.pending);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)1, stats.inFlight);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.lag);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    scheduler.dispatch();
+    CPPUNIT_ASSERT_EQUAL((size_t)2, announces.started.size());
+    CPPUNIT_ASSERT(announces.started[1] == id2);
+
+    announces.complete(0);
+    announces.complete(1);
+    stats = scheduler.getStats();
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.pending);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.inFlight);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)2, stats.completed);
+}
+
+void AnnounceSchedulerTests::testMaxInFlight() {
+    AnnounceScheduler scheduler(2);
+    Announces announces;
+
+    auto due = currentTimeMillis() - 1000;
+    int completed = 0;
+    for (int i = 0; i < 5; i++) {
+        auto id = Id::random();
+        scheduler.add(Kind::VALUE, id, due, announces.make(id), [&]() { completed++; });
+    }
+
+    scheduler.dispatch();
+    CPPUNIT_ASSERT_EQUAL((size_t)2, announces.started.size());
+
+    // behind the schedule
+    auto stats = scheduler.getStats();
+    CPPUNIT_ASSERT_EQUAL((uint64_t)3, stats.pending);
+    CPPUNIT_ASSERT(stats.lag >= 1000);
+    CPPUNIT_ASSERT(stats.maxLag >= stats.lag);
+
+    // every completion starts the next one
+    announces.complete(0);
+    CPPUNIT_ASSERT_EQUAL((size_t)3, announces.started.size());
+    CPPUNIT_ASSERT_EQUAL(1, completed);
+
+    for (size_t i = 1; i < 5; i++)
+        announces.complete(i);
+
+    CPPUNIT_ASSERT_EQUAL((size_t)5, announces.started.size());
+    CPPUNIT_ASSERT_EQUAL(5, completed);
+    stats = scheduler.getStats();
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.pending);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.lag);
+
+    // started in the order of the targets for the same due time
+    for (size_t i = 1; i < announces.started.size(); i++)
+        CPPUNIT_ASSERT(announces.started[i - 1] < announces.started[i]);
+}
+
+void AnnounceSchedulerTests::testReplace() {
+    AnnounceScheduler scheduler(8);
+    Announces announces;
+    Announces replaced;
+
+    auto now = currentTimeMillis();
+    auto id = Id::random();
+    int completed = 0;
+    scheduler.add(Kind::PEER, id, now + 60000, announces.make(id), [&]() { completed++; });
+    scheduler.add(Kind::PEER, id, now, replaced.make(id), [&]() { completed++; });
+    // the same target of the other kind is a different announce
+    scheduler.add(Kind::VALUE, id, now + 60000, announces.make(id));
+    CPPUNIT_ASSERT_EQUAL((uint64_t)2, scheduler.getStats().pending);
+
+    scheduler.dispatch();
+    CPPUNIT_ASSERT(announces.started.empty());
+    CPPUNIT_ASSERT_EQUAL((size_t)1, replaced.started.size());
+
+    replaced.complete(0);
+    CPPUNIT_ASSERT_EQUAL(2, completed);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)1, scheduler.getStats().pending);
+}
+
+void AnnounceSchedulerTests::testSeeds() {
+    AnnounceScheduler scheduler(1);
+    Announces announces;
+
+    auto id1 = Id::random();
+    // shares the leading 16 bits with id1
+    auto bytes = id1.blob();
+    std::vector<uint8_t> data(bytes.ptr(), bytes.ptr() + bytes.size());
+    data[2] ^= 0x80;
+    data[31] ^= 0x01;
+    auto id2 = Id(data);
+    // and the far one
+    data[0] ^= 0x80;
+    auto id3 = Id(data);
+
+    auto due = currentTimeMillis() - 10;
+    scheduler.add(Kind::VALUE, id1, due, announces.make(id1));
+    scheduler.add(Kind::VALUE, id2, due + 1, announces.make(id2));
+    scheduler.add(Kind::VALUE, id3, due + 2, announces.make(id3));
+
+    scheduler.dispatch();
+    CPPUNIT_ASSERT_EQUAL((size_t)1, announces.started.size());
+    CPPUNIT_ASSERT(announces.seeds[0].empty());
+
+    auto closest = makeNodes(4);
+    announces.complete(0, closest);
+    CPPUNIT_ASSERT_EQUAL((size_t)2, announces.started.size());
+    CPPUNIT_ASSERT(announces.started[1] == id2);
+    CPPUNIT_ASSERT(announces.seeds[1] == closest);
+
+    announces.complete(1, makeNodes(4));
+    CPPUNIT_ASSERT_EQUAL((size_t)3, announces.started.size());
+    CPPUNIT_ASSERT(announces.started[2] == id3);
+    CPPUNIT_ASSERT(announces.seeds[2].empty());
+
+    announces.complete(2);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)1, scheduler.getStats().seeded);
+}
+
+void AnnounceSchedulerTests::testClear() {
+    AnnounceScheduler scheduler(8);
+    Announces announces;
+
+    int completed = 0;
+    for (int i = 0; i < 3; i++) {
+        auto id = Id::random();
+        scheduler.add(Kind::PEER, id, currentTimeMillis() + 60000, announces.make(id), [&]() { completed++; });
+    }
+
+    scheduler.clear();
+    CPPUNIT_ASSERT_EQUAL(3, completed);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, scheduler.getStats().pending);
+
+    scheduler.dispatch();
+    CPPUNIT_ASSERT(announces.started.empty());
+
+    // The in-flight announces are given up too
+    for (int i = 0; i < 2; i++) {
+        auto id = Id::random();
+        scheduler.add(Kind::VALUE, id, currentTimeMillis(), announces.make(id), [&]() { completed++; });
+    }
+    scheduler.dispatch();
+    CPPUNIT_ASSERT_EQUAL((size_t)2, announces.started.size());
+    CPPUNIT_ASSERT_EQUAL((uint64_t)2, scheduler.getStats().inFlight);
+
+    scheduler.clear();
+    CPPUNIT_ASSERT_EQUAL(5, completed);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, scheduler.getStats().inFlight);
+
+    // and their late completions are ignored
+    announces.complete(0);
+    CPPUNIT_ASSERT_EQUAL(5, completed);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, scheduler.getStats().inFlight);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, scheduler.getStats().completed);
+}
+
+void AnnounceSchedulerTests::testImmediateCompletion() {
+    AnnounceScheduler scheduler(1);
+
+    auto due = currentTimeMillis() - 1000;
+    int started = 0;
+    int depth = 0;
+    int maxDepth = 0;
+    for (int i = 0; i < 10000; i++) {
+        scheduler.add(Kind::VALUE, Id::random(), due,
+                [&](const std::list<Sp<NodeInfo>>&, AnnounceScheduler::CompleteHandler handler) {
+            started++;
+            maxDepth = std::max(maxDepth, ++depth);
+            // e.g. the record was removed already
+            handler({});
+            depth--;
+        });
+    }
+
+    // the next announces are started by the same dispatch, not nested in the completions
+    scheduler.dispatch();
+    CPPUNIT_ASSERT_EQUAL(10000, started);
+    CPPUNIT_ASSERT_EQUAL(1, maxDepth);
+
+    auto stats = scheduler.getStats();
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.pending);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.inFlight);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)10000, stats.completed);
+}
+
+}  // namespace test
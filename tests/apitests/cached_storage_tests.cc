@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2022 - 2023 trinity-tech.io
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#include <set>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <carrier.h>
+#include <sqlite3.h>
+
+#include "sqlite_storage.h"
+#include "write_behind_storage.h"
+#include "cached_storage.h"
+#include "utils.h"
+#include "cached_storage_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(CachedStorageTests);
+
+void CachedStorageTests::setUp() {
+    path = Utils::getPwdStorage("cached.db");
+}
+
+void CachedStorageTests::tearDown() {
+    Utils::removeStorage(path);
+    Utils::removeStorage(path + "-wal");
+    Utils::removeStorage(path + "-shm");
+}
+
+void CachedStorageTests::testValueHit() {
+    auto storage = std::make_shared<CachedStorage>(SqliteStorage::open(path), 256, 60000);
+
+    auto value = Value::createValue(Utils::getRandomData(256));
+    storage->putValue(value);
+
+    auto first = storage->getValue(value.getId());
+    auto second = storage->getValue(value.getId());
+    CPPUNIT_ASSERT(first);
+    CPPUNIT_ASSERT(*first == value);
+    // the same record, not a copy
+    CPPUNIT_ASSERT(first == second);
+
+    auto stats = storage->getStats();
+    CPPUNIT_ASSERT(stats.cacheMisses == 1);
+    CPPUNIT_ASSERT(stats.cacheHits == 1);
+
+    // the writes drop the cached record
+    std::string str = "Hello, world";
+    std::vector<uint8_t> data(str.cbegin(), str.cend());
+    auto signedValue = Value::createSignedValue(data);
+    storage->putValue(signedValue);
+    CPPUNIT_ASSERT(*storage->getValue(signedValue.getId()) == signedValue);
+
+    str = "Hello, world2";
+    std::vector<uint8_t> data2(str.cbegin(), str.cend());
+    auto updated = signedValue.update(data2);
+    storage->putValue(updated);
+    CPPUNIT_ASSERT(*storage->getValue(signedValue.getId()) == updated);
+
+    CPPUNIT_ASSERT(storage->removeValue(value.getId()));
+    CPPUNIT_ASSERT(storage->getValue(value.getId()) == nullptr);
+
+    storage->close();
+}
+
+void CachedStorageTests::testValueMiss() {
+    auto storage = std::make_shared<CachedStorage>(SqliteStorage::open(path), 256, 60000);
+
+    auto value = Value::createValue(Utils::getRandomData(256));
+    CPPUNIT_ASSERT(storage->getValue(value.getId()) == nullptr);
+    CPPUNIT_ASSERT(storage->getValue(value.getId()) == nullptr);
+
+    auto stats = storage->getStats();
+    CPPUNIT_ASSERT(stats.cacheMisses == 1);
+    CPPUNIT_ASSERT(stats.cacheHits == 1);
+
+    // the cached miss is dropped by the write
+    storage->putValue(value);
+    auto stored = storage->getValue(value.getId());
+    CPPUNIT_ASSERT(stored);
+    CPPUNIT_ASSERT(*stored == value);
+
+    storage->close();
+}
+
+void CachedStorageTests::testPeers() {
+    auto storage = std::make_shared<CachedStorage>(SqliteStorage::open(path), 256, 60000);
+
+    auto keypair = Signature::KeyPair::random();
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 16; i++)
+        peers.push_back(PeerInfo::create(keypair, Id::random(), Id::random(), 8000 + i));
+    storage->putPeer(peers);
+
+    auto peerId = peers[0].getId();
+    CPPUNIT_ASSERT(storage->getPeer(peerId, 0).size() == 16);
+
+    // a random pick of the cached list, without duplicates
+    auto picked = storage->getPeer(peerId, 8);
+    CPPUNIT_ASSERT(picked.size() == 8);
+    std::set<Id> origins {};
+    for (const auto& peer : picked)
+        origins.insert(peer.getOrigin());
+    CPPUNIT_ASSERT(origins.size() == 8);
+
+    auto peer = storage->getPeer(peerId, peers[5].getOrigin());
+    CPPUNIT_ASSERT(peer);
+    CPPUNIT_ASSERT(*peer == peers[5]);
+    CPPUNIT_ASSERT(storage->getPeer(peerId, Id::random()) == nullptr);
+
+    auto stats = storage->getStats();
+    CPPUNIT_ASSERT(stats.cacheMisses == 1);
+    CPPUNIT_ASSERT(stats.cacheHits == 3);
+
+    storage->putPeer(PeerInfo::create(keypair, Id::random(), Id::random(), 9000));
+    CPPUNIT_ASSERT(storage->getPeer(peerId, 0).size() == 17);
+
+    CPPUNIT_ASSERT(storage->removePeer(peerId, peers[5].getOrigin()));
+    CPPUNIT_ASSERT(storage->getPeer(peerId, 0).size() == 16);
+    CPPUNIT_ASSERT(storage->getPeer(peerId, peers[5].getOrigin()) == nullptr);
+
+    storage->close();
+}
+
+void CachedStorageTests::testExpiration() {
+    auto storage = std::make_shared<CachedStorage>(SqliteStorage::open(path), 256, 200);
+
+    auto value = Value::createValue(Utils::getRandomData(256));
+    storage->putValue(value);
+
+    // the reads do not keep the entry alive past the TTL
+    for (int i = 0; i < 6; i++) {
+        CPPUNIT_ASSERT(storage->getValue(value.getId()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+
+    auto stats = storage->getStats();
+    CPPUNIT_ASSERT(stats.cacheMisses == 2);
+    CPPUNIT_ASSERT(stats.cacheHits == 4);
+
+    storage->close();
+}
+
+void CachedStorageTests::testExpiredBelow() {
+    auto writeBehind = std::make_shared<WriteBehindStorage>(SqliteStorage::open(path), SqliteStorage::open(path));
+    auto storage = std::make_shared<CachedStorage>(writeBehind, 256, 60000);
+    writeBehind->setExpireListener([&]() {
+        storage->invalidateAll();
+    });
+
+    auto value = Value::createValue(Utils::getRandomData(256));
+    storage->putValue(value);
+    writeBehind->flush();
+
+    CPPUNIT_ASSERT(storage->getValue(value.getId()));
+    CPPUNIT_ASSERT(storage->getValue(value.getId()));
+
+    // age the record, as if it was stored long ago
+    sqlite3* db = nullptr;
+    CPPUNIT_ASSERT(sqlite3_open(path.c_str(), &db) == SQLITE_OK);
+    sqlite3_busy_timeout(db, 5000);
+    CPPUNIT_ASSERT(sqlite3_exec(db, "UPDATE valores SET timestamp = 0", nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(db);
+
+    // expired by the write-behind storage, below the cache
+    writeBehind->expire(16);
+    CPPUNIT_ASSERT(storage->getValue(value.getId()) == nullptr);
+
+    auto stats = storage->getStats();
+    CPPUNIT_ASSERT(stats.cacheMisses == 2);
+    CPPUNIT_ASSERT(stats.cacheHits == 1);
+
+    storage->close();
+}
+
+}  // namespace test
@@ -0,0 +1,260 @@
+/*
+* Copyright (c) 2022 - 2023 trinity-tech.io
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <carrier.h>
+
+#include "log_storage.h"
+#include "utils.h"
+#include "log_storage_tests.h"
+
+using namespace elastos::carrier;
+namespace fs = std::filesystem;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(LogStorageTests);
+
+// The files of an open storage, every write is flushed to the OS, so it is
+// what a crash of the process leaves behind
+static std::string crash(const std::string& path) {
+    auto copy = path + ".crashed";
+    fs::remove_all(copy);
+    fs::copy(path, copy, fs::copy_options::recursive);
+    return copy;
+}
+
+static fs::path lastSegment(const std::string& path) {
+    fs::path last {};
+    for (const auto& file : fs::directory_iterator(path)) {
+        if (last.empty() || file.path().filename() > last.filename())
+            last = file.path();
+    }
+    return last;
+}
+
+void LogStorageTests::setUp() {
+    path = Utils::getPwdStorage("log_storage");
+}
+
+void LogStorageTests::tearDown() {
+    Utils::removeStorage(path);
+    Utils::removeStorage(path + ".crashed");
+}
+
+void LogStorageTests::testRecovery() {
+    auto storage = std::make_shared<LogStorage>(path);
+
+    std::vector<Value> values {};
+    for (int i = 0; i < 64; i++) {
+        values.push_back(Value::createValue(Utils::getRandomData(128)));
+        storage->putValue(values.back(), i % 4 == 0);
+    }
+    storage->removeValue(values[1].getId());
+
+    auto signedValue = Value::createSignedValue(Utils::getRandomData(32));
+    storage->putValue(signedValue);
+    auto updated = signedValue.update(Utils::getRandomData(32));
+    storage->putValue(updated);
+
+    auto keypair = Signature::KeyPair::random();
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 16; i++)
+        peers.push_back(PeerInfo::create(keypair, Id::random(), Id::random(), 8000 + i));
+    storage->putPeer(peers);
+    storage->putPeer(peers[0], true);
+    storage->removePeer(peers[1].getId(), peers[1].getOrigin());
+
+    auto copy = crash(path);
+    storage->close();
+
+    auto recovered = std::make_shared<LogStorage>(copy);
+    for (int i = 0; i < 64; i++) {
+        auto value = recovered->getValue(values[i].getId());
+        if (i == 1) {
+            CPPUNIT_ASSERT(!value);
+        } else {
+            CPPUNIT_ASSERT(value);
+            CPPUNIT_ASSERT(*value == values[i]);
+        }
+    }
+
+    auto value = recovered->getValue(signedValue.getId());
+    CPPUNIT_ASSERT(value);
+    CPPUNIT_ASSERT(*value == updated);
+    CPPUNIT_ASSERT(recovered->getAllValues().size() == 64);
+    CPPUNIT_ASSERT(recovered->getPersistentValues(Utils::currentTimeMillis()).size() == 16);
+
+    CPPUNIT_ASSERT(recovered->getPeer(peers[0].getId(), 0).size() == 15);
+    CPPUNIT_ASSERT(!recovered->getPeer(peers[1].getId(), peers[1].getOrigin()));
+    auto peer = recovered->getPeer(peers[3].getId(), peers[3].getOrigin());
+    CPPUNIT_ASSERT(peer);
+    CPPUNIT_ASSERT(*peer == peers[3]);
+
+    auto persistent = recovered->getPersistentPeers(Utils::currentTimeMillis());
+    CPPUNIT_ASSERT(persistent.size() == 1);
+    CPPUNIT_ASSERT(persistent[0] == peers[0]);
+
+    recovered->close();
+}
+
+void LogStorageTests::testTornTail() {
+    auto storage = std::make_shared<LogStorage>(path);
+
+    std::vector<Value> values {};
+    for (int i = 0; i < 32; i++) {
+        values.push_back(Value::createValue(Utils::getRandomData(128)));
+        storage->putValue(values.back());
+    }
+
+    // the crash hit in the middle of the last append
+    auto copy = crash(path);
+    storage->close();
+    auto segment = lastSegment(copy);
+    fs::resize_file(segment, fs::file_size(segment) - 50);
+
+    auto recovered = std::make_shared<LogStorage>(copy);
+    CPPUNIT_ASSERT(recovered->getAllValues().size() == 31);
+    CPPUNIT_ASSERT(!recovered->getValue(values.back().getId()));
+    CPPUNIT_ASSERT(recovered->getValue(values.front().getId()));
+
+    // the torn tail is cut off, the appends go on after the last whole record
+    auto value = Value::createValue(Utils::getRandomData(128));
+    recovered->putValue(value);
+    recovered->close();
+
+    recovered = std::make_shared<LogStorage>(copy);
+    CPPUNIT_ASSERT(recovered->getAllValues().size() == 32);
+    auto stored = recovered->getValue(value.getId());
+    CPPUNIT_ASSERT(stored);
+    CPPUNIT_ASSERT(*stored == value);
+    recovered->close();
+}
+
+void LogStorageTests::testCorruptedRecord() {
+    auto storage = std::make_shared<LogStorage>(path);
+
+    std::vector<Value> values {};
+    for (int i = 0; i < 32; i++) {
+        values.push_back(Value::createValue(Utils::getRandomData(128)));
+        storage->putValue(values.back());
+    }
+    storage->close();
+
+    // flip a data byte of the last record, its checksum does not match
+    auto segment = lastSegment(path);
+    {
+        std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(-10, std::ios::end);
+        char c;
+        file.get(c);
+        file.seekp(-10, std::ios::end);
+        file.put(c ^ 0x5A);
+    }
+
+    storage = std::make_shared<LogStorage>(path);
+    CPPUNIT_ASSERT(storage->getAllValues().size() == 31);
+    CPPUNIT_ASSERT(!storage->getValue(values.back().getId()));
+    CPPUNIT_ASSERT(storage->getValue(values[30].getId()));
+    storage->close();
+}
+
+void LogStorageTests::testCompaction() {
+    // small segments, so the overwrites and removals leave many sealed ones behind
+    auto storage = std::make_shared<LogStorage>(path, 4096);
+
+    auto signedValue = Value::createSignedValue(Utils::getRandomData(64));
+    auto current = signedValue;
+    storage->putValue(current);
+
+    std::vector<Value> values {};
+    for (int i = 0; i < 256; i++) {
+        values.push_back(Value::createValue(Utils::getRandomData(128)));
+        storage->putValue(values.back());
+
+        current = current.update(Utils::getRandomData(64));
+        storage->putValue(current);
+    }
+
+    // the removals of the early values are in the later segments
+    for (int i = 0; i < 128; i++)
+        storage->removeValue(values[i].getId());
+
+    auto before = storage->getSegmentCount();
+    while (storage->compact());
+    auto after = storage->getSegmentCount();
+    CPPUNIT_ASSERT(after < before);
+
+    auto check = [&](Sp<LogStorage> storage) {
+        auto value = storage->getValue(current.getId());
+        CPPUNIT_ASSERT(value);
+        CPPUNIT_ASSERT(*value == current);
+
+        CPPUNIT_ASSERT(storage->getAllValues().size() == 129);
+        for (int i = 0; i < 256; i++)
+            CPPUNIT_ASSERT((storage->getValue(values[i].getId()) != nullptr) == (i >= 128));
+    };
+
+    check(storage);
+    storage->close();
+
+    // the removed values stay removed after the replay of the compacted log
+    storage = std::make_shared<LogStorage>(path, 4096);
+    CPPUNIT_ASSERT(storage->getSegmentCount() <= after + 1);
+    check(storage);
+    storage->close();
+}
+
+void LogStorageTests::testExpiredOverwrite() {
+    auto storage = std::make_shared<LogStorage>(path, 4096);
+
+    // the persistent peer and the values after it keep its segment from the compaction
+    auto peer = PeerInfo::create(Id::random(), 8000);
+    storage->putPeer(peer, true);
+    for (int i = 0; i < 40; i++)
+        storage->putValue(Value::createValue(Utils::getRandomData(128)), true);
+    for (int i = 0; i < 40; i++)
+        storage->putValue(Value::createValue(Utils::getRandomData(128)));
+
+    // overwritten by a non-persistent put in a later segment, which then expires
+    storage->putPeer(peer);
+    for (int i = 0; i < 40; i++)
+        storage->putValue(Value::createValue(Utils::getRandomData(128)));
+
+    CPPUNIT_ASSERT(storage->expire(1024, Utils::currentTimeMillis() + Constants::MAX_PEER_AGE + 1000) == 81);
+    CPPUNIT_ASSERT(!storage->getPeer(peer.getId(), peer.getOrigin()));
+
+    while (storage->compact());
+    storage->close();
+
+    // the compaction dropped the expired put, the older persistent one stays hidden
+    storage = std::make_shared<LogStorage>(path, 4096);
+    CPPUNIT_ASSERT(!storage->getPeer(peer.getId(), peer.getOrigin()));
+    CPPUNIT_ASSERT(storage->getPersistentPeers(Utils::currentTimeMillis()).empty());
+    CPPUNIT_ASSERT(storage->getPersistentValues(Utils::currentTimeMillis()).size() == 40);
+    storage->close();
+}
+
+}  // namespace test
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include <carrier.h>
+
+#include "lookup_cache.h"
+#include "lookup_cache_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(LookupCacheTests);
+
+void LookupCacheTests::testPositiveAndNegative() {
+    LookupCache cache(64 * 1024, 60 * 1000, 60 * 1000);
+
+    auto id = Id::random();
+    CPPUNIT_ASSERT(!cache.getNode(id));
+    CPPUNIT_ASSERT(!cache.getValue(id));
+    CPPUNIT_ASSERT(!cache.getPeer(id, 1));
+
+    // Negative results
+    cache.putNode(id, {});
+    cache.putValue(id, nullptr);
+    cache.putPeer(id, {});
+
+    auto nodes = cache.getNode(id);
+    CPPUNIT_ASSERT(nodes && nodes->empty());
+    auto value = cache.getValue(id);
+    CPPUNIT_ASSERT(value && *value == nullptr);
+    auto peers = cache.getPeer(id, 1);
+    CPPUNIT_ASSERT(peers && peers->empty());
+
+    // Positive results replace the negative ones
+    auto ni = std::make_shared<NodeInfo>(id, SocketAddress("192.168.1.1", 39001));
+    cache.putNode(id, {ni});
+    nodes = cache.getNode(id);
+    CPPUNIT_ASSERT(nodes && nodes->size() == 1);
+    CPPUNIT_ASSERT(*(*nodes)[0] == *ni);
+
+    auto v = std::make_shared<Value>(Value::createValue({0, 1, 2, 3}));
+    cache.putValue(v->getId(), v);
+    value = cache.getValue(v->getId());
+    CPPUNIT_ASSERT(value && *value != nullptr);
+    CPPUNIT_ASSERT((*value)->getData() == v->getData());
+
+    // but a negative result does not replace a positive one
+    cache.putValue(v->getId(), nullptr);
+    value = cache.getValue(v->getId());
+    CPPUNIT_ASSERT(value && *value != nullptr);
+
+    cache.removeValue(v->getId());
+    CPPUNIT_ASSERT(!cache.getValue(v->getId()));
+
+    CPPUNIT_ASSERT_EQUAL((uint64_t)6, cache.getHits());
+    CPPUNIT_ASSERT_EQUAL((uint64_t)4, cache.getMisses());
+}
+
+void LookupCacheTests::testExpiration() {
+    LookupCache cache(64 * 1024, 400, 100);
+
+    auto found = Id::random();
+    auto notFound = Id::random();
+    auto peer = PeerInfo::create(found, 42244);
+    cache.putPeer(found, {peer});
+    cache.putPeer(notFound, {});
+
+    CPPUNIT_ASSERT(cache.getPeer(found, 1));
+    CPPUNIT_ASSERT(cache.getPeer(notFound, 1));
+
+    // The negative results expire first, the gets do not extend the lifetime
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CPPUNIT_ASSERT(cache.getPeer(found, 1));
+    CPPUNIT_ASSERT(!cache.getPeer(notFound, 1));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CPPUNIT_ASSERT(!cache.getPeer(found, 1));
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.getBytes());
+}
+
+void LookupCacheTests::testSequenceNumber() {
+    LookupCache cache(64 * 1024, 60 * 1000, 60 * 1000);
+
+    auto v1 = Value::createSignedValue({0, 1, 2});
+    auto v2 = v1.update({3, 4, 5});
+    CPPUNIT_ASSERT(v2.getSequenceNumber() > v1.getSequenceNumber());
+
+    cache.putValue(v2.getId(), std::make_shared<Value>(v2));
+    // An outdated version does not replace the newer one
+    cache.putValue(v1.getId(), std::make_shared<Value>(v1));
+
+    auto value = cache.getValue(v1.getId());
+    CPPUNIT_ASSERT(value && *value != nullptr);
+    CPPUNIT_ASSERT_EQUAL(v2.getSequenceNumber(), (*value)->getSequenceNumber());
+
+    auto v3 = v2.update({6, 7, 8});
+    cache.putValue(v3.getId(), std::make_shared<Value>(v3));
+    value = cache.getValue(v1.getId());
+    CPPUNIT_ASSERT_EQUAL(v3.getSequenceNumber(), (*value)->getSequenceNumber());
+}
+
+void LookupCacheTests::testExpectedPeers() {
+    LookupCache cache(64 * 1024, 60 * 1000, 60 * 1000);
+
+    auto id = Id::random();
+    cache.putPeer(id, {PeerInfo::create(id, 42244), PeerInfo::create(id, 42245)});
+
+    CPPUNIT_ASSERT(cache.getPeer(id, 0));
+    CPPUNIT_ASSERT(cache.getPeer(id, 2));
+    // Not enough peers for the caller
+    CPPUNIT_ASSERT(!cache.getPeer(id, 3));
+
+    cache.removePeer(id);
+    CPPUNIT_ASSERT(!cache.getPeer(id, 0));
+}
+
+void LookupCacheTests::testLookupOption() {
+    LookupCache cache(64 * 1024, 60 * 1000, 60 * 1000);
+
+    auto id = Id::random();
+    auto ni = std::make_shared<NodeInfo>(id, SocketAddress("192.168.1.1", 39001));
+
+    // A local arbitrary result only answers the arbitrary lookups
+    cache.putNode(id, {ni}, LookupOption::ARBITRARY);
+    CPPUNIT_ASSERT(cache.getNode(id, LookupOption::ARBITRARY));
+    CPPUNIT_ASSERT(!cache.getNode(id, LookupOption::OPTIMISTIC));
+    CPPUNIT_ASSERT(!cache.getNode(id, LookupOption::CONSERVATIVE));
+
+    // A conservative result answers all of them
+    cache.putNode(id, {}, LookupOption::CONSERVATIVE);
+    CPPUNIT_ASSERT(cache.getNode(id, LookupOption::ARBITRARY));
+    CPPUNIT_ASSERT(cache.getNode(id, LookupOption::CONSERVATIVE));
+
+    // and is not replaced by a weaker one
+    cache.putNode(id, {ni}, LookupOption::ARBITRARY);
+    auto nodes = cache.getNode(id, LookupOption::CONSERVATIVE);
+    CPPUNIT_ASSERT(nodes && nodes->empty());
+
+    auto peerId = Id::random();
+    cache.putPeer(peerId, {PeerInfo::create(peerId, 42244)}, LookupOption::OPTIMISTIC);
+    CPPUNIT_ASSERT(cache.getPeer(peerId, 1, LookupOption::ARBITRARY));
+    CPPUNIT_ASSERT(cache.getPeer(peerId, 1, LookupOption::OPTIMISTIC));
+    CPPUNIT_ASSERT(!cache.getPeer(peerId, 1, LookupOption::CONSERVATIVE));
+
+    auto value = std::make_shared<Value>(Value::createValue({0, 1, 2, 3}));
+    cache.putValue(value->getId(), value, LookupOption::ARBITRARY);
+    CPPUNIT_ASSERT(!cache.getValue(value->getId(), LookupOption::OPTIMISTIC));
+    CPPUNIT_ASSERT(cache.getValue(value->getId(), LookupOption::ARBITRARY));
+}
+
+void LookupCacheTests::testMemoryBound() {
+    const size_t maxBytes = 16 * 1024;
+    LookupCache cache(maxBytes, 60 * 1000, 60 * 1000);
+
+    std::vector<Id> ids {};
+    for (int i = 0; i < 1000; i++) {
+        auto id = Id::random();
+        ids.push_back(id);
+        cache.putValue(id, std::make_shared<Value>(Value::createValue(std::vector<uint8_t>(256, i & 0xFF))));
+        CPPUNIT_ASSERT(cache.getBytes() <= maxBytes);
+    }
+
+    CPPUNIT_ASSERT(cache.size() > 0);
+    CPPUNIT_ASSERT(cache.size() < ids.size());
+
+    // The least recently used entries are evicted
+    CPPUNIT_ASSERT(!cache.getValue(ids.front()));
+    CPPUNIT_ASSERT(cache.getValue(ids.back()));
+
+    // A result larger than the budget is not cached
+    cache.putValue(ids.back(), std::make_shared<Value>(Value::createValue(std::vector<uint8_t>(maxBytes, 0))));
+    auto value = cache.getValue(ids.back());
+    CPPUNIT_ASSERT(value && (*value)->getData().size() == 256);
+
+    cache.clear();
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.getBytes());
+}
+
+}  // namespace test
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#include <carrier.h>
+
+#include "lookup_coalescer.h"
+#include "lookup_coalescer_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(LookupCoalescerTests);
+
+using PeerComplete = std::function<void(std::vector<PeerInfo>)>;
+
+static bool isReady(const std::future<std::vector<PeerInfo>>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void LookupCoalescerTests::testSingleFlight() {
+    LookupCoalescer coalescer {};
+    auto peer = PeerInfo::create(Id::random(), 42244);
+
+    int started = 0;
+    PeerComplete complete {};
+    auto lookup = [&](PeerComplete c) {
+        started++;
+        complete = c;
+    };
+
+    std::vector<std::future<std::vector<PeerInfo>>> futures {};
+    for (int i = 0; i < 10; i++)
+        futures.push_back(coalescer.findPeer(peer.getId(), 1, LookupOption::CONSERVATIVE, lookup));
+
+    // One lookup in flight serves all the callers
+    CPPUNIT_ASSERT_EQUAL(1, started);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)9, coalescer.getCoalesced());
+    for (const auto& future : futures)
+        CPPUNIT_ASSERT(!isReady(future));
+
+    complete({peer});
+    for (auto& future : futures) {
+        auto peers = future.get();
+        CPPUNIT_ASSERT_EQUAL((size_t)1, peers.size());
+        CPPUNIT_ASSERT(peers[0] == peer);
+    }
+
+    // Completed lookups are detached, the next call starts a fresh one
+    auto future = coalescer.findPeer(peer.getId(), 1, LookupOption::CONSERVATIVE, lookup);
+    CPPUNIT_ASSERT_EQUAL(2, started);
+    complete({});
+    CPPUNIT_ASSERT(future.get().empty());
+}
+
+void LookupCoalescerTests::testParameters() {
+    LookupCoalescer coalescer {};
+    auto target = Id::random();
+
+    std::vector<PeerComplete> completes {};
+    auto lookup = [&](PeerComplete c) {
+        completes.push_back(c);
+    };
+
+    auto f1 = coalescer.findPeer(target, 1, LookupOption::CONSERVATIVE, lookup);
+    auto f2 = coalescer.findPeer(target, 2, LookupOption::CONSERVATIVE, lookup);
+    auto f3 = coalescer.findPeer(target, 1, LookupOption::OPTIMISTIC, lookup);
+    auto f4 = coalescer.findPeer(Id::random(), 1, LookupOption::CONSERVATIVE, lookup);
+    auto f5 = coalescer.findPeer(target, 1, LookupOption::CONSERVATIVE, lookup);
+
+    // Only the identical lookups are coalesced
+    CPPUNIT_ASSERT_EQUAL((size_t)4, completes.size());
+    CPPUNIT_ASSERT_EQUAL((uint64_t)1, coalescer.getCoalesced());
+
+    completes[0]({});
+    CPPUNIT_ASSERT(isReady(f1));
+    CPPUNIT_ASSERT(isReady(f5));
+    CPPUNIT_ASSERT(!isReady(f2));
+    CPPUNIT_ASSERT(!isReady(f3));
+    CPPUNIT_ASSERT(!isReady(f4));
+}
+
+void LookupCoalescerTests::testCompleteOnce() {
+    LookupCoalescer coalescer {};
+    auto target = Id::random();
+
+    std::vector<std::function<void(Sp<Value>)>> completes {};
+    auto lookup = [&](std::function<void(Sp<Value>)> c) {
+        completes.push_back(c);
+    };
+
+    auto f1 = coalescer.findValue(target, LookupOption::OPTIMISTIC, lookup);
+    completes[0](nullptr);
+    CPPUNIT_ASSERT(f1.get() == nullptr);
+
+    // A late completion of the landed lookup does not touch the new one
+    auto f2 = coalescer.findValue(target, LookupOption::OPTIMISTIC, lookup);
+    CPPUNIT_ASSERT_EQUAL((size_t)2, completes.size());
+    completes[0](nullptr);
+    CPPUNIT_ASSERT(f2.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+
+    auto value = std::make_shared<Value>(Value::createValue({0, 1, 2}));
+    completes[1](value);
+    CPPUNIT_ASSERT(f2.get() == value);
+}
+
+void LookupCoalescerTests::testException() {
+    LookupCoalescer coalescer {};
+    auto target = Id::random();
+
+    auto future = coalescer.findPeer(target, 1, LookupOption::CONSERVATIVE, [](PeerComplete) {
+        throw std::runtime_error("lookup failed");
+    });
+    CPPUNIT_ASSERT_THROW(future.get(), std::runtime_error);
+
+    // Not left in flight
+    int started = 0;
+    future = coalescer.findPeer(target, 1, LookupOption::CONSERVATIVE, [&](PeerComplete c) {
+        started++;
+        c({});
+    });
+    CPPUNIT_ASSERT_EQUAL(1, started);
+    CPPUNIT_ASSERT(future.get().empty());
+}
+
+}  // namespace test
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <thread>
+#include <chrono>
+#include <string>
+
+#include <carrier.h>
+
+#include "utils/lru_cache.h"
+#include "lru_cache_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(LRUCacheTests);
+
+void LRUCacheTests::testPutAndGet() {
+    LRUCache<int, std::string> cache(16, 60 * 1000);
+
+    CPPUNIT_ASSERT(cache.get(1) == nullptr);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    CPPUNIT_ASSERT_EQUAL((size_t)2, cache.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("one"), *cache.get(1));
+    CPPUNIT_ASSERT_EQUAL(std::string("two"), *cache.get(2));
+
+    cache.put(1, "uno");
+    CPPUNIT_ASSERT_EQUAL((size_t)2, cache.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("uno"), *cache.get(1));
+
+    CPPUNIT_ASSERT(cache.remove(1));
+    CPPUNIT_ASSERT(!cache.remove(1));
+    CPPUNIT_ASSERT(cache.get(1) == nullptr);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+}
+
+void LRUCacheTests::testEviction() {
+    LRUCache<int, int> cache(8, 60 * 1000);
+
+    for (int i = 0; i < 8; i++)
+        cache.put(i, i);
+
+    // touch the oldest one, 1 becomes the least recently used
+    CPPUNIT_ASSERT(cache.get(0) != nullptr);
+
+    for (int i = 8; i < 12; i++)
+        cache.put(i, i);
+
+    CPPUNIT_ASSERT_EQUAL((size_t)8, cache.size());
+    CPPUNIT_ASSERT(cache.contains(0));
+    for (int i = 1; i < 5; i++)
+        CPPUNIT_ASSERT(!cache.contains(i));
+    for (int i = 5; i < 12; i++)
+        CPPUNIT_ASSERT(cache.contains(i));
+}
+
+void LRUCacheTests::testExpiration() {
+    LRUCache<int, int> cache(8, 200);
+
+    cache.put(1, 1);
+    cache.put(2, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    cache.put(2, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+
+    CPPUNIT_ASSERT(cache.get(1) == nullptr);
+    CPPUNIT_ASSERT(cache.get(2) != nullptr);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    cache.purge();
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+}
+
+void LRUCacheTests::testSocketAddressKey() {
+    LRUCache<SocketAddress, Id, SocketAddress::Hash> cache(1024, 60 * 1000);
+
+    auto id1 = Id::random();
+    auto id2 = Id::random();
+
+    cache.put(SocketAddress("192.168.1.1", 39001), id1);
+    cache.put(SocketAddress("192.168.1.1", 39002), id2);
+    cache.put(SocketAddress("2001:db8::1", 39001), id2);
+
+    CPPUNIT_ASSERT_EQUAL((size_t)3, cache.size());
+    CPPUNIT_ASSERT(*cache.get(SocketAddress("192.168.1.1", 39001)) == id1);
+    CPPUNIT_ASSERT(*cache.get(SocketAddress("192.168.1.1", 39002)) == id2);
+    CPPUNIT_ASSERT(*cache.get(SocketAddress("2001:db8::1", 39001)) == id2);
+    CPPUNIT_ASSERT(cache.get(SocketAddress("192.168.1.2", 39001)) == nullptr);
+
+    SocketAddress::Hash hash;
+    CPPUNIT_ASSERT_EQUAL(hash(SocketAddress("10.0.0.1", 80)), hash(SocketAddress("10.0.0.1", 80)));
+}
+
+}  // namespace test
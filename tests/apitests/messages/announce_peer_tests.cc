@@ -139,6 +139,54 @@ void AnnouncePeerTests::testAnnouncePeerRequest2() {
     CPPUNIT_ASSERT_EQUAL(peer, _msg->getPeer());
 }
 
+void AnnouncePeerTests::testCachedAnnouncePeerRequest() {
+    auto sender = Id::random();
+    int txid  = Utils::getRandomValue();
+    int token = Utils::getRandomValue();
+    int ttl = 60 * 1000;
+
+    // announced by another node, the signature covers its origin
+    auto peer = PeerInfo::create(Id::random(), Id::random(), 42244, "http://abc.pc2.net/");
+
+    auto msg = AnnouncePeerRequest();
+    msg.setId(sender);
+    msg.setTxid(txid);
+    msg.setToken(token);
+    msg.setVersion(VERSION);
+    msg.setCachedPeer(peer, ttl);
+
+    auto serialized = msg.serialize();
+    printMessage(msg, serialized);
+    CPPUNIT_ASSERT(serialized.size() <= msg.estimateSize());
+
+    auto parsed = Message::parse(serialized.data(), serialized.size());
+    parsed->setId(sender);
+    auto _msg = std::static_pointer_cast<AnnouncePeerRequest>(parsed);
+
+    CPPUNIT_ASSERT_EQUAL(Message::Method::ANNOUNCE_PEER, _msg->getMethod());
+    CPPUNIT_ASSERT_EQUAL(token,  _msg->getToken());
+    CPPUNIT_ASSERT(_msg->isCache());
+    CPPUNIT_ASSERT_EQUAL(ttl, _msg->getTTL());
+
+    auto cached = _msg->getPeer();
+    CPPUNIT_ASSERT_EQUAL(peer, cached);
+    CPPUNIT_ASSERT_EQUAL(peer.getNodeId(), cached.getNodeId());
+    CPPUNIT_ASSERT_EQUAL(peer.getOrigin(), cached.getOrigin());
+    CPPUNIT_ASSERT(cached.isValid());
+
+    // without a ttl the origin is not taken, the sender is the origin
+    msg.setCachedPeer(peer, 0);
+    serialized = msg.serialize();
+    parsed = Message::parse(serialized.data(), serialized.size());
+    parsed->setId(sender);
+    _msg = std::static_pointer_cast<AnnouncePeerRequest>(parsed);
+
+    CPPUNIT_ASSERT(!_msg->isCache());
+    CPPUNIT_ASSERT(_msg->hasOrigin());
+    CPPUNIT_ASSERT_EQUAL(sender, _msg->getPeer().getOrigin());
+    CPPUNIT_ASSERT(!_msg->getPeer().isValid());
+}
+
 void AnnouncePeerTests::testAnnouncePeerResponseSize() {
     auto msg = AnnouncePeerResponse(0xf7654321);
     msg.setId(Id::random());
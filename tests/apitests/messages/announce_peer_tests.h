@@ -34,6 +34,7 @@ class AnnouncePeerTests : public MessageTests, public CppUnit::TestFixture {
     CPPUNIT_TEST(testAnnouncePeerRequestSize2);
     CPPUNIT_TEST(testAnnouncePeerRequest);
     CPPUNIT_TEST(testAnnouncePeerRequest2);
+    CPPUNIT_TEST(testCachedAnnouncePeerRequest);
     CPPUNIT_TEST(testAnnouncePeerResponseSize);
     CPPUNIT_TEST(testAnnouncePeerResponse);
     CPPUNIT_TEST_SUITE_END();
@@ -46,6 +47,7 @@ public:
     void testAnnouncePeerRequestSize2();
     void testAnnouncePeerRequest();
     void testAnnouncePeerRequest2();
+    void testCachedAnnouncePeerRequest();
     void testAnnouncePeerResponseSize();
     void testAnnouncePeerResponse();
 };
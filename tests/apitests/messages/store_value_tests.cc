@@ -164,6 +164,37 @@ void StoreValueTests::testStoreSignedValueRequest() {
     CPPUNIT_ASSERT(value == _msg->getValue());
 }
 
+void StoreValueTests::testCachedStoreValueRequest() {
+    auto nodeId = Id::random();
+    int txid = Utils::getRandomInteger(62);
+    int token = Utils::getRandomValue();
+    int ttl = 30 * 60 * 1000;
+
+    auto value = Value::createSignedValue({0, 1, 2, 3});
+    auto msg = StoreValueRequest(value, token);
+    msg.setId(nodeId);
+    msg.setTxid(txid);
+    msg.setVersion(VERSION);
+    msg.setTTL(ttl);
+
+    auto serialized = msg.serialize();
+    printMessage(msg, serialized);
+    CPPUNIT_ASSERT(serialized.size() <= msg.estimateSize());
+
+    auto parsed = Message::parse(serialized.data(), serialized.size());
+    parsed->setId(nodeId);
+    auto _msg = std::static_pointer_cast<StoreValueRequest>(parsed);
+
+    CPPUNIT_ASSERT_EQUAL(Message::Method::STORE_VALUE, _msg->getMethod());
+    CPPUNIT_ASSERT_EQUAL(token, _msg->getToken());
+    CPPUNIT_ASSERT(_msg->isCache());
+    CPPUNIT_ASSERT_EQUAL(ttl, _msg->getTTL());
+
+    auto cached = _msg->getValue();
+    CPPUNIT_ASSERT(value == cached);
+    CPPUNIT_ASSERT(cached.isValid());
+}
+
 void StoreValueTests::testStoreEncryptedValueRequest() {
     auto nodeId = Id::random();
     int txid = Utils::getRandomInteger(62);
@@ -37,6 +37,7 @@ class StoreValueTests : public MessageTests, public CppUnit::TestFixture {
     CPPUNIT_TEST(testStoreValueRequest);
     CPPUNIT_TEST(testStoreSignedValueRequest);
     CPPUNIT_TEST(testStoreEncryptedValueRequest);
+    CPPUNIT_TEST(testCachedStoreValueRequest);
 
     CPPUNIT_TEST(testStoreValueResponseSize);
     CPPUNIT_TEST(testStoreValueResponse);
@@ -53,6 +54,7 @@ public:
     void testStoreValueRequest();
     void testStoreSignedValueRequest();
     void testStoreEncryptedValueRequest();
+    void testCachedStoreValueRequest();
 
     void testStoreValueResponseSize();
     void testStoreValueResponse();
@@ -36,11 +36,22 @@
 #include <iostream>
 #include <string>
 #include <cctype>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <vector>
+#include <functional>
 //#include <algorithm>
 
 // carrier
 #include <carrier.h>
 #include "utils.h"
+#include "dht.h"
+#include "data_storage.h"
+#include "memory_storage.h"
+#include "path_cache.h"
 #include "node_tests.h"
 
 using namespace elastos::carrier;
@@ -48,6 +59,17 @@ using namespace elastos::carrier;
 namespace test {
 CPPUNIT_TEST_SUITE_REGISTRATION(NodeTests);
 
+// Wait until the node knows the other one, the bootstrap runs in the background
+static bool waitForRouting(const Sp<Node>& node, const Id& other) {
+    auto dht = node->getDHT(DHT::Type::IPV4);
+    for (int i = 0; i < 100; i++) {
+        if (dht->getNode(other) != nullptr)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return false;
+}
+
 void NodeTests::setUp() {
     auto path1 = Utils::getPwdStorage("node1");
     auto path2 = Utils::getPwdStorage("node2");
@@ -92,6 +114,14 @@ void NodeTests::setUp() {
 }
 
 void NodeTests::tearDown() {
+    for (auto& node : extraNodes)
+        node->stop();
+    extraNodes.clear();
+
+    for (const auto& name : extraNames)
+        Utils::removeStorage(Utils::getPwdStorage(name));
+    extraNames.clear();
+
     if (node1)
         node1->stop();
     if (node2)
@@ -108,7 +138,31 @@ void NodeTests::tearDown() {
     Utils::removeStorage(path3);
 }
 
+Sp<Node> NodeTests::startNode(const std::string& name, int port,
+        const std::function<void(DefaultConfiguration::Builder&)>& configure) {
+    auto path = Utils::getPwdStorage(name);
+    Utils::removeStorage(path);
+    extraNames.push_back(name);
+
+    auto ipAddress = Utils::getLocalIpAddresses();
+    auto b = DefaultConfiguration::Builder {};
+    b.setIPv4Address(ipAddress);
+    b.setListeningPort(port);
+    b.setStoragePath(path);
+    configure(b);
+
+    auto node = std::make_shared<Node>(b.build());
+    node->start();
+    extraNodes.push_back(node);
+
+    node->bootstrap(NodeInfo {node1->getId(), ipAddress, node1->getPort()});
+    return node;
+}
+
 void NodeTests::testFindNode() {
+    // The lookups start right away, let the bootstrap of node2 reach node1 first
+    CPPUNIT_ASSERT(waitForRouting(node1, node2->getId()));
+
     auto remoteId = node2->getId();
     std::cout << "-----Find node-----" << std::endl;
     std::cout << "Trying to find Node " << remoteId.toString() << std::endl;
@@ -217,4 +271,349 @@ void NodeTests::testFindPeer() {
     }
 }
 
+void NodeTests::testReady() {
+    // Neither cached entries nor configured bootstrap nodes, ready at once
+    CPPUNIT_ASSERT(node1->isReady());
+    CPPUNIT_ASSERT(node2->isReady());
+
+    // wait for node2 to populate its routing table
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+
+    // restart node2, the cached routing table is verified by the warm start
+    node2->stop();
+    CPPUNIT_ASSERT(!node2->isReady());
+
+    struct ReadyListener : public NodeStatusListener {
+        std::atomic<bool> notified {false};
+        void ready() override {
+            notified = true;
+        }
+    } listener;
+
+    node2->addStatusListener(listener);
+    node2->start();
+    for (int i = 0; i < 100 && !listener.notified; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    node2->removeStatusListener(listener);
+
+    CPPUNIT_ASSERT(listener.notified);
+    CPPUNIT_ASSERT(node2->isReady());
+}
+
+void NodeTests::testLookupDispatch() {
+    auto path = Utils::getPwdStorage("node4");
+    Utils::removeStorage(path);
+
+    auto b4 = DefaultConfiguration::Builder {};
+    b4.setIPv4Address(Utils::getLocalIpAddresses());
+    b4.setListeningPort(32226);
+    b4.setStoragePath(path);
+
+    // An isolated node, the lookups complete as soon as they get started
+    auto node4 = std::make_shared<Node>(b4.build());
+    node4->start();
+
+    for (int i = 0; i < 5; i++) {
+        auto result = node4->findNode(Id::random()).get();
+        CPPUNIT_ASSERT(result.empty());
+    }
+
+    // A lookup added on the RPC thread is started in the same dispatch,
+    // instead of on the next update tick
+    auto dht = node4->getDHT(DHT::Type::IPV4);
+    std::mutex lock {};
+    std::vector<std::string> events {};
+    std::promise<void> done {};
+
+    auto record = [&](const std::string& event) {
+        std::lock_guard<std::mutex> guard(lock);
+        events.push_back(event);
+    };
+
+    dht->findNode(Id::random(), [&](Sp<NodeInfo>) {
+        record("first lookup");
+        dht->getServer().getScheduler().add([&]() {
+            record("next job");
+            done.set_value();
+        }, 0);
+        dht->findNode(Id::random(), [&](Sp<NodeInfo>) {
+            record("second lookup");
+        });
+    });
+
+    CPPUNIT_ASSERT(done.get_future().wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+    std::vector<std::string> expected { "first lookup", "second lookup", "next job" };
+    CPPUNIT_ASSERT(events == expected);
+    CPPUNIT_ASSERT_EQUAL(0, dht->getTaskManager().getNumberOfQueuedTasks());
+
+    node4->stop();
+    Utils::removeStorage(path);
+}
+
+void NodeTests::testStreamingFindPeer() {
+    CPPUNIT_ASSERT(waitForRouting(node3, node1->getId()));
+
+    auto peer = PeerInfo::create(node1->getId(), 42246);
+    node1->announcePeer(peer).get();
+
+    std::atomic<int> results {0};
+    std::atomic<int> completions {0};
+    Sp<PeerInfo> found {};
+
+    // Only the first peer is needed, stop the lookup with it
+    auto handle = node3->findPeer(peer.getId(), 0, LookupOption::CONSERVATIVE,
+        [&](const PeerInfo& pi) {
+            results++;
+            found = std::make_shared<PeerInfo>(pi);
+            return false;
+        }, [&]() {
+            completions++;
+        });
+
+    CPPUNIT_ASSERT(handle->waitFor(std::chrono::seconds(30)));
+    CPPUNIT_ASSERT(handle->isDone());
+    CPPUNIT_ASSERT(handle->isCanceled());
+    CPPUNIT_ASSERT_EQUAL(1, results.load());
+    CPPUNIT_ASSERT_EQUAL(1, completions.load());
+    CPPUNIT_ASSERT(found);
+    CPPUNIT_ASSERT(found->isValid());
+    CPPUNIT_ASSERT(found->getId() == peer.getId());
+    CPPUNIT_ASSERT_EQUAL(peer.getPort(), found->getPort());
+
+    // The discovered peer is stored, delivered locally the next time
+    results = 0;
+    handle = node3->findPeer(peer.getId(), 1, LookupOption::ARBITRARY, [&](const PeerInfo& pi) {
+        results++;
+        return true;
+    });
+    CPPUNIT_ASSERT(handle->isDone());
+    CPPUNIT_ASSERT(!handle->isCanceled());
+    CPPUNIT_ASSERT_EQUAL(1, results.load());
+}
+
+void NodeTests::testStreamingCancel() {
+    std::atomic<int> results {0};
+    std::atomic<int> completions {0};
+
+    auto handle = node2->findValue(Id::random(), LookupOption::CONSERVATIVE,
+        [&](Sp<Value> value) {
+            results++;
+            return true;
+        }, [&]() {
+            completions++;
+        });
+
+    // Canceled from the application thread
+    handle->cancel();
+    CPPUNIT_ASSERT(handle->isCanceled());
+    CPPUNIT_ASSERT(handle->waitFor(std::chrono::seconds(5)));
+    CPPUNIT_ASSERT_EQUAL(0, results.load());
+    CPPUNIT_ASSERT_EQUAL(1, completions.load());
+}
+
+void NodeTests::testLookupCache() {
+    auto node4 = startNode("node4", 32226, [](DefaultConfiguration::Builder& b) {
+        b.setLookupCache(64 * 1024);
+    });
+    CPPUNIT_ASSERT(waitForRouting(node4, node1->getId()));
+
+    auto peer = PeerInfo::create(node1->getId(), 42247);
+    node1->announcePeer(peer).get();
+
+    auto cached = node4->getLookupStats().cached;
+    auto peers = node4->findPeer(peer.getId(), 1).get();
+    CPPUNIT_ASSERT_EQUAL((size_t)1, peers.size());
+    CPPUNIT_ASSERT_EQUAL(cached, node4->getLookupStats().cached);
+
+    // The repeated lookup is a local hit
+    auto lookups = node4->getLookupStats().lookups;
+    auto again = node4->findPeer(peer.getId(), 1).get();
+    CPPUNIT_ASSERT_EQUAL((size_t)1, again.size());
+    CPPUNIT_ASSERT(again[0] == peers[0]);
+    CPPUNIT_ASSERT_EQUAL(cached + 1, node4->getLookupStats().cached);
+    CPPUNIT_ASSERT_EQUAL(lookups, node4->getLookupStats().lookups);
+
+    // So is a lookup that found nothing
+    auto unknown = Id::random();
+    CPPUNIT_ASSERT(node4->findValue(unknown).get() == nullptr);
+    CPPUNIT_ASSERT(node4->findValue(unknown).get() == nullptr);
+    CPPUNIT_ASSERT_EQUAL(cached + 2, node4->getLookupStats().cached);
+
+    // The arbitrary lookup answered from the routing table does not answer the conservative one
+    auto nodes = node4->findNode(node1->getId(), LookupOption::ARBITRARY).get();
+    CPPUNIT_ASSERT_EQUAL((size_t)1, nodes.size());
+    nodes = node4->findNode(node1->getId(), LookupOption::CONSERVATIVE).get();
+    CPPUNIT_ASSERT_EQUAL((size_t)1, nodes.size());
+    CPPUNIT_ASSERT_EQUAL(cached + 2, node4->getLookupStats().cached);
+
+    // but the conservative result answers the weaker ones
+    node4->findNode(node1->getId(), LookupOption::ARBITRARY).get();
+    CPPUNIT_ASSERT_EQUAL(cached + 3, node4->getLookupStats().cached);
+}
+
+void NodeTests::testBulkAnnounce() {
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 4; i++)
+        peers.push_back(PeerInfo::create(node1->getId(), 42250 + i));
+
+    std::vector<Value> values {};
+    for (uint8_t i = 0; i < 4; i++)
+        values.push_back(Value::createValue({i, 1, 2, 3}));
+
+    auto completed = node1->getAnnounceStats().completed;
+    auto future = node1->announcePeers(peers);
+    node1->storeValues(values).get();
+    future.get();
+
+    auto stats = node1->getAnnounceStats();
+    CPPUNIT_ASSERT_EQUAL(completed + 8, stats.completed);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.pending);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.inFlight);
+
+    for (const auto& peer : peers) {
+        auto found = node3->findPeer(peer.getId(), 1).get();
+        CPPUNIT_ASSERT_EQUAL((size_t)1, found.size());
+        CPPUNIT_ASSERT(found[0] == peer);
+    }
+
+    for (const auto& value : values) {
+        auto found = node2->findValue(value.getId()).get();
+        CPPUNIT_ASSERT(found);
+        CPPUNIT_ASSERT(found->getData() == value.getData());
+    }
+}
+
+void NodeTests::testCachedAnnounce() {
+    CPPUNIT_ASSERT(waitForRouting(node2, node1->getId()));
+
+    auto dht = node2->getDHT(DHT::Type::IPV4);
+    auto& cache = dht->getAnnounceCache();
+
+    auto store = [&](const Value& value) {
+        auto promise = std::make_shared<std::promise<std::list<Sp<NodeInfo>>>>();
+        dht->storeValue(value, [=](std::list<Sp<NodeInfo>> nodes) {
+            promise->set_value(nodes);
+        });
+        return promise->get_future().get();
+    };
+
+    // The successful announce caches its closest nodes and their tokens
+    auto value = Value::createValue({0, 1, 2, 3});
+    CPPUNIT_ASSERT(!store(value).empty());
+    auto cached = cache.get(value.getId());
+    CPPUNIT_ASSERT(cached);
+    CPPUNIT_ASSERT(cached->get(node1->getId()) != nullptr);
+
+    // The rejected token falls back to a new lookup, which refreshes the cache
+    const int staleToken = 0x5a5a5a5a;
+    auto updated = Value::createValue({4, 5, 6, 7});
+    auto stale = ClosestSet(updated.getId(), Constants::MAX_ENTRIES_PER_BUCKET);
+    auto cn = std::make_shared<CandidateNode>(NodeInfo {node1->getId(),
+            Utils::getLocalIpAddresses(), node1->getPort()});
+    cn->setToken(staleToken);
+    stale.add(cn);
+    cache.put(updated.getId(), stale, currentTimeMillis());
+
+    CPPUNIT_ASSERT(!store(updated).empty());
+    CPPUNIT_ASSERT(node1->getStorage()->getValue(updated.getId()) != nullptr);
+
+    cached = cache.get(updated.getId());
+    CPPUNIT_ASSERT(cached);
+    auto entry = cached->get(node1->getId());
+    CPPUNIT_ASSERT(entry != nullptr);
+    CPPUNIT_ASSERT(entry->getToken() != staleToken);
+}
+
+void NodeTests::testStopWhileAnnouncing() {
+    auto node4 = startNode("node4", 32226, [](DefaultConfiguration::Builder&) {});
+    CPPUNIT_ASSERT(waitForRouting(node4, node1->getId()));
+
+    std::vector<Value> values {};
+    for (uint8_t i = 0; i < 32; i++)
+        values.push_back(Value::createValue({i, 4, 5, 6}));
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 32; i++)
+        peers.push_back(PeerInfo::create(node4->getId(), 42260 + i));
+
+    auto storing = node4->storeValues(values);
+    auto announcing = node4->announcePeers(peers);
+    CPPUNIT_ASSERT(node4->getAnnounceStats().inFlight > 0);
+
+    // The stop gives up the in-flight announces, the callers are not left waiting
+    node4->stop();
+    CPPUNIT_ASSERT(storing.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+    CPPUNIT_ASSERT(announcing.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+
+    auto stats = node4->getAnnounceStats();
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.inFlight);
+    CPPUNIT_ASSERT_EQUAL((uint64_t)0, stats.pending);
+}
+
+void NodeTests::testMemoryStorage() {
+    auto node4 = startNode("node4", 32226, [](DefaultConfiguration::Builder& b) {
+        b.setMemoryStorage(16 * 1024 * 1024);
+    });
+    CPPUNIT_ASSERT(waitForRouting(node4, node1->getId()));
+
+    // The values and peers the node keeps live in its memory
+    auto value = Value::createValue({0, 1, 2, 3, 4});
+    node4->storeValue(value).get();
+    auto peer = PeerInfo::create(node4->getId(), 42248);
+    node4->announcePeer(peer).get();
+
+    CPPUNIT_ASSERT(std::dynamic_pointer_cast<MemoryStorage>(node4->getStorage()) != nullptr);
+    CPPUNIT_ASSERT(node4->getStorage()->getValue(value.getId()) != nullptr);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, node4->getStorage()->getPeer(peer.getId(), 8).size());
+
+    auto found = node2->findValue(value.getId()).get();
+    CPPUNIT_ASSERT(found != nullptr);
+    CPPUNIT_ASSERT(*found == value);
+}
+
+void NodeTests::testPathCache() {
+    // node3 may have bootstrapped before node2 joined, let it meet node2 through node1
+    CPPUNIT_ASSERT(waitForRouting(node3, node1->getId()));
+    CPPUNIT_ASSERT(waitForRouting(node1, node2->getId()));
+    node3->findNode(node2->getId(), LookupOption::CONSERVATIVE).get();
+    CPPUNIT_ASSERT(waitForRouting(node3, node2->getId()));
+
+    // Only node1 keeps them, node2 responds to the lookups without them
+    auto peer = PeerInfo::create(node1->getId(), 42249);
+    node1->getStorage()->putPeer(peer, false, false);
+    auto value = Value::createSignedValue({0, 1, 2, 3});
+    node1->getStorage()->putValue(value);
+
+    auto waitForCache = [](std::function<bool()> cached) {
+        for (int i = 0; i < 50; i++) {
+            if (cached())
+                return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return false;
+    };
+
+    // The lookup leaves a copy on the responder which missed it
+    auto peers = node3->findPeer(peer.getId(), 1, LookupOption::CONSERVATIVE).get();
+    CPPUNIT_ASSERT_EQUAL((size_t)1, peers.size());
+    CPPUNIT_ASSERT(waitForCache([&]() {
+        return !node2->getPathCache()->getPeer(peer.getId(), 8).empty();
+    }));
+
+    auto cachedPeers = node2->getPathCache()->getPeer(peer.getId(), 8);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cachedPeers.size());
+    CPPUNIT_ASSERT_EQUAL(peer, cachedPeers[0]);
+    CPPUNIT_ASSERT(cachedPeers[0].getOrigin() == node1->getId());
+    CPPUNIT_ASSERT(cachedPeers[0].isValid());
+    CPPUNIT_ASSERT(node2->getStorage()->getPeer(peer.getId(), 8).empty());
+
+    auto found = node3->findValue(value.getId(), LookupOption::CONSERVATIVE).get();
+    CPPUNIT_ASSERT(found != nullptr);
+    CPPUNIT_ASSERT(waitForCache([&]() {
+        return node2->getPathCache()->getValue(value.getId()) != nullptr;
+    }));
+
+    CPPUNIT_ASSERT(*node2->getPathCache()->getValue(value.getId()) == value);
+    CPPUNIT_ASSERT(node2->getStorage()->getValue(value.getId()) == nullptr);
+}
+
 }  // namespace test
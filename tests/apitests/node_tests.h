@@ -33,6 +33,20 @@ class NodeTests : public CppUnit::TestFixture {
     CPPUNIT_TEST(testFindNode);
     CPPUNIT_TEST(testFindValue);
     CPPUNIT_TEST(testFindPeer);
+    CPPUNIT_TEST(testReady);
+    CPPUNIT_TEST(testLookupDispatch);
+    CPPUNIT_TEST(testStreamingFindPeer);
+    CPPUNIT_TEST(testStreamingCancel);
+    CPPUNIT_TEST(testLookupCache);
+    CPPUNIT_TEST(testBulkAnnounce);
+    CPPUNIT_TEST(testCachedAnnounce);
+    CPPUNIT_TEST(testStopWhileAnnouncing);
+    CPPUNIT_TEST(testMemoryStorage);
+#ifdef CARRIER_DEVELOPMENT
+    // out of development mode the lookups take one node for each address,
+    // the nodes on this host could never leave a copy on each other
+    CPPUNIT_TEST(testPathCache);
+#endif
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -42,11 +56,27 @@ public:
     void testFindNode();
     void testFindValue();
     void testFindPeer();
+    void testReady();
+    void testLookupDispatch();
+    void testStreamingFindPeer();
+    void testStreamingCancel();
+    void testLookupCache();
+    void testBulkAnnounce();
+    void testCachedAnnounce();
+    void testStopWhileAnnouncing();
+    void testMemoryStorage();
+    void testPathCache();
 
 private:
+    // A node with its own configuration, bootstrapped from node1 and stopped by tearDown()
+    std::shared_ptr<Node> startNode(const std::string& name, int port,
+            const std::function<void(DefaultConfiguration::Builder&)>& configure);
+
     std::shared_ptr<Node> node1 {};
     std::shared_ptr<Node> node2 {};
     std::shared_ptr<Node> node3 {};
+    std::vector<std::string> extraNames {};
+    std::vector<std::shared_ptr<Node>> extraNodes {};
 };
 
 }  // namespace test
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <thread>
+#include <chrono>
+#include <vector>
+
+#include <carrier.h>
+
+#include "path_cache.h"
+#include "path_cache_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(PathCacheTests);
+
+void PathCacheTests::testValue() {
+    PathCache cache(64 * 1024);
+
+    auto value = Value::createValue({0, 1, 2, 3});
+    CPPUNIT_ASSERT(cache.getValue(value.getId()) == nullptr);
+
+    CPPUNIT_ASSERT(cache.putValue(value, 60 * 1000));
+    auto cached = cache.getValue(value.getId());
+    CPPUNIT_ASSERT(cached != nullptr);
+    CPPUNIT_ASSERT(*cached == value);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, cache.size());
+
+    // A copy without a lifetime is not cached
+    auto other = Value::createValue({4, 5, 6, 7});
+    cache.putValue(other, 0);
+    CPPUNIT_ASSERT(cache.getValue(other.getId()) == nullptr);
+
+    cache.removeValue(value.getId());
+    CPPUNIT_ASSERT(cache.getValue(value.getId()) == nullptr);
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.getBytes());
+    CPPUNIT_ASSERT_EQUAL((uint64_t)1, cache.getHits());
+}
+
+void PathCacheTests::testSequenceNumber() {
+    PathCache cache(64 * 1024);
+
+    auto v1 = Value::createSignedValue({0, 1, 2});
+    auto v2 = v1.update({3, 4, 5});
+
+    CPPUNIT_ASSERT(cache.putValue(v2, 60 * 1000));
+    // An outdated copy does not replace the newer one
+    CPPUNIT_ASSERT(!cache.putValue(v1, 60 * 1000));
+    CPPUNIT_ASSERT_EQUAL(v2.getSequenceNumber(), cache.getValue(v1.getId())->getSequenceNumber());
+
+    auto v3 = v2.update({6, 7, 8});
+    CPPUNIT_ASSERT(cache.putValue(v3, 60 * 1000));
+    CPPUNIT_ASSERT_EQUAL(v3.getSequenceNumber(), cache.getValue(v1.getId())->getSequenceNumber());
+}
+
+void PathCacheTests::testPeers() {
+    PathCache cache(64 * 1024);
+
+    auto keypair = Signature::KeyPair::random();
+    auto nodeId = Id::random();
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 4; i++)
+        peers.push_back(PeerInfo::create(keypair, nodeId, Id::random(), 42244 + i));
+
+    auto id = peers[0].getId();
+    CPPUNIT_ASSERT(cache.getPeer(id, 8).empty());
+
+    for (const auto& peer : peers)
+        cache.putPeer(peer, 60 * 1000);
+    // Another peer id does not show up
+    cache.putPeer(PeerInfo::create(nodeId, 42250), 60 * 1000);
+
+    // One copy for each origin
+    cache.putPeer(peers[0], 60 * 1000);
+    CPPUNIT_ASSERT_EQUAL((size_t)5, cache.size());
+
+    auto cached = cache.getPeer(id, 8);
+    CPPUNIT_ASSERT_EQUAL((size_t)4, cached.size());
+    for (const auto& peer : cached) {
+        CPPUNIT_ASSERT(peer.getId() == id);
+        CPPUNIT_ASSERT(peer.isValid());
+    }
+    CPPUNIT_ASSERT_EQUAL((size_t)2, cache.getPeer(id, 2).size());
+
+    cache.removePeer(id, peers[0].getOrigin());
+    CPPUNIT_ASSERT_EQUAL((size_t)3, cache.getPeer(id, 8).size());
+}
+
+void PathCacheTests::testExpiration() {
+    PathCache cache(64 * 1024);
+
+    auto near = Value::createValue({0, 1, 2});
+    auto far = Value::createValue({3, 4, 5});
+    auto peer = PeerInfo::create(Id::random(), 42244);
+    cache.putValue(near, 400);
+    cache.putValue(far, 100);
+    cache.putPeer(peer, 100);
+
+    // Each copy lives for its own TTL, the gets do not extend it
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CPPUNIT_ASSERT(cache.getValue(near.getId()) != nullptr);
+    CPPUNIT_ASSERT(cache.getValue(far.getId()) == nullptr);
+    CPPUNIT_ASSERT(cache.getPeer(peer.getId(), 8).empty());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CPPUNIT_ASSERT(cache.getValue(near.getId()) == nullptr);
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.getBytes());
+}
+
+void PathCacheTests::testMemoryBound() {
+    const size_t maxBytes = 16 * 1024;
+    PathCache cache(maxBytes);
+
+    std::vector<Id> ids {};
+    for (int i = 0; i < 1000; i++) {
+        std::vector<uint8_t> data(256, 0);
+        data[0] = i & 0xFF;
+        data[1] = (i >> 8) & 0xFF;
+        auto value = Value::createValue(data);
+        ids.push_back(value.getId());
+        cache.putValue(value, 60 * 1000);
+        CPPUNIT_ASSERT(cache.getBytes() <= maxBytes);
+    }
+
+    CPPUNIT_ASSERT(cache.size() > 0);
+    CPPUNIT_ASSERT(cache.size() < ids.size());
+
+    // The least recently used copies are evicted
+    CPPUNIT_ASSERT(cache.getValue(ids.front()) == nullptr);
+    CPPUNIT_ASSERT(cache.getValue(ids.back()) != nullptr);
+
+    cache.clear();
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.size());
+    CPPUNIT_ASSERT_EQUAL((size_t)0, cache.getBytes());
+}
+
+}  // namespace test
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+
+#include <nlohmann/json.hpp>
+
+#include <carrier.h>
+#include "utils.h"
+#include "dht.h"
+#include "routing_table.h"
+#include "kbucket_entry.h"
+#include "utils/time.h"
+#include "routing_table_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(RoutingTableTests);
+
+static Sp<KBucketEntry> createEntry(int i) {
+    std::string addr = "10.0." + std::to_string(i / 250 % 250) + "." + std::to_string(i % 250 + 1);
+    auto entry = std::make_shared<KBucketEntry>(NodeInfo {Id::random(), addr, 39001});
+    // only the verified entries are inserted to the full buckets
+    entry->signalResponse();
+    return entry;
+}
+
+static std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream is(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+static void assertEntryEquals(const KBucketEntry& expected, const KBucketEntry& actual) {
+    CPPUNIT_ASSERT(expected.getId() == actual.getId());
+    CPPUNIT_ASSERT(expected.getAddress() == actual.getAddress());
+    CPPUNIT_ASSERT_EQUAL(expected.getVersion(), actual.getVersion());
+    CPPUNIT_ASSERT_EQUAL(expected.isReachable(), actual.isReachable());
+    CPPUNIT_ASSERT_EQUAL(expected.getFailedRequests(), actual.getFailedRequests());
+    CPPUNIT_ASSERT_EQUAL(expected.getCreationTime(), actual.getCreationTime());
+    CPPUNIT_ASSERT_EQUAL(expected.getLastSeen(), actual.getLastSeen());
+    CPPUNIT_ASSERT_EQUAL(expected.getLastSend(), actual.getLastSend());
+}
+
+// the sum of the bucket entries matches the counter, every entry lives in its bucket
+static bool isConsistent(const RoutingTableSnapshot& snapshot) {
+    int num = 0;
+    for (const auto& bucket : snapshot.getBuckets()) {
+        for (const auto& entry : *bucket.entries) {
+            if (!bucket.prefix.isPrefixOf(entry.getId()))
+                return false;
+        }
+        num += bucket.entries->size();
+    }
+    return num == snapshot.getNumBucketEntries();
+}
+
+void RoutingTableTests::setUp() {
+    auto dir = Utils::getPwdStorage("routingtable");
+    Utils::removeStorage(dir);
+
+    auto b = DefaultConfiguration::Builder {};
+    b.setIPv4Address(Utils::getLocalIpAddresses());
+    b.setListeningPort(32230);
+    b.setStoragePath(dir);
+
+    // Never started, the routing table is only driven by the test thread
+    node = std::make_shared<Node>(b.build());
+    dht = std::make_shared<DHT>(DHT::Type::IPV4, *node, node->getConfig()->ipv4Address());
+    path = dir + Utils::PATH_SEP + "dht4.cache";
+}
+
+void RoutingTableTests::tearDown() {
+    dht = nullptr;
+    node = nullptr;
+    Utils::removeStorage(Utils::getPwdStorage("routingtable"));
+}
+
+void RoutingTableTests::testSnapshotConsistency() {
+    auto& rt = dht->getRoutingTable();
+
+    std::vector<Sp<KBucketEntry>> entries {};
+    for (int i = 0; i < 8; i++) {
+        entries.push_back(createEntry(i));
+        rt.put(entries.back());
+    }
+    rt.publish();
+
+    auto snapshot = rt.getSnapshot();
+    CPPUNIT_ASSERT_EQUAL(1, snapshot->size());
+    CPPUNIT_ASSERT_EQUAL(8, snapshot->getNumBucketEntries());
+
+    // Split the buckets and remove some of the old entries
+    for (int i = 8; i < 256; i++)
+        rt.put(createEntry(i));
+    for (int i = 0; i < 4; i++)
+        rt.remove(entries[i]->getId());
+    rt.publish();
+
+    // The snapshot taken before is not touched by the modifications
+    CPPUNIT_ASSERT_EQUAL(1, snapshot->size());
+    CPPUNIT_ASSERT_EQUAL(8, snapshot->getNumBucketEntries());
+    CPPUNIT_ASSERT(isConsistent(*snapshot));
+    for (const auto& entry : entries)
+        CPPUNIT_ASSERT(snapshot->getEntry(entry->getId()) != nullptr);
+
+    auto current = rt.getSnapshot();
+    CPPUNIT_ASSERT(current != snapshot);
+    CPPUNIT_ASSERT(current->size() > 1);
+    CPPUNIT_ASSERT_EQUAL(rt.getNumBucketEntries(), current->getNumBucketEntries());
+    CPPUNIT_ASSERT(isConsistent(*current));
+    for (int i = 0; i < 4; i++)
+        CPPUNIT_ASSERT(current->getEntry(entries[i]->getId()) == nullptr);
+}
+
+void RoutingTableTests::testConcurrentReaders() {
+    auto& rt = dht->getRoutingTable();
+
+    std::atomic<bool> done {false};
+    std::atomic<int> inconsistent {0};
+    std::atomic<int> reads {0};
+
+    std::vector<std::thread> readers {};
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                auto snapshot = rt.getSnapshot();
+                if (!isConsistent(*snapshot))
+                    inconsistent++;
+                reads++;
+            }
+        });
+    }
+
+    // The writer keeps splitting, refreshing and removing meanwhile
+    std::vector<Sp<KBucketEntry>> entries {};
+    for (int i = 0; i < 2000; i++) {
+        entries.push_back(createEntry(i));
+        rt.put(entries.back());
+        if (i % 3 == 0)
+            rt.remove(entries[i / 2]->getId());
+        if (i % 10 == 0)
+            rt.publish();
+    }
+    rt.publish();
+
+    while (reads < 100)
+        std::this_thread::yield();
+
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    CPPUNIT_ASSERT_EQUAL(0, inconsistent.load());
+    CPPUNIT_ASSERT_EQUAL(rt.getNumBucketEntries(), rt.getSnapshot()->getNumBucketEntries());
+}
+
+void RoutingTableTests::testPublishOnlyModified() {
+    auto& rt = dht->getRoutingTable();
+
+    std::vector<Sp<KBucketEntry>> entries {};
+    for (int i = 0; i < 256; i++) {
+        entries.push_back(createEntry(i));
+        rt.put(entries.back());
+    }
+    rt.publish();
+
+    // Nothing changed, the current snapshot is kept
+    auto snapshot = rt.getSnapshot();
+    rt.publish();
+    CPPUNIT_ASSERT(rt.getSnapshot() == snapshot);
+
+    // Refresh an entry: only its bucket gets a new copy of the entries
+    Sp<KBucketEntry> refreshed {};
+    for (const auto& entry : entries) {
+        if (snapshot->getEntry(entry->getId()) != nullptr) {
+            refreshed = entry;
+            break;
+        }
+    }
+    CPPUNIT_ASSERT(refreshed);
+
+    auto again = std::make_shared<KBucketEntry>(NodeInfo {refreshed->getId(), refreshed->getAddress()});
+    again->signalResponse();
+    rt.put(again);
+    rt.publish();
+
+    auto current = rt.getSnapshot();
+    CPPUNIT_ASSERT(current != snapshot);
+    CPPUNIT_ASSERT_EQUAL(snapshot->size(), current->size());
+
+    int changed = 0;
+    for (int i = 0; i < current->size(); i++) {
+        const auto& before = snapshot->getBuckets()[i];
+        const auto& after = current->getBuckets()[i];
+        if (before.entries == after.entries)
+            continue;
+
+        changed++;
+        CPPUNIT_ASSERT(after.prefix.isPrefixOf(refreshed->getId()));
+    }
+    CPPUNIT_ASSERT_EQUAL(1, changed);
+}
+
+void RoutingTableTests::testGetNodeFromSnapshot() {
+    auto& rt = dht->getRoutingTable();
+
+    auto entry = createEntry(0);
+    rt.put(entry);
+
+    // The readers only see the published modifications
+    CPPUNIT_ASSERT(dht->getNode(entry->getId()) == nullptr);
+    rt.publish();
+
+    auto found = dht->getNode(entry->getId());
+    CPPUNIT_ASSERT(found != nullptr);
+    CPPUNIT_ASSERT(found->getId() == entry->getId());
+    CPPUNIT_ASSERT(found->getAddress() == entry->getAddress());
+
+    rt.remove(entry->getId());
+    CPPUNIT_ASSERT(dht->getNode(entry->getId()) != nullptr);
+    rt.publish();
+    CPPUNIT_ASSERT(dht->getNode(entry->getId()) == nullptr);
+}
+
+void RoutingTableTests::fill(int count, int from) {
+    auto& rt = dht->getRoutingTable();
+    for (int i = from; i < from + count; i++) {
+        auto entry = createEntry(i);
+        entry->signalRequest();
+        if (i % 5 == 0)
+            entry->signalRequestTimeout();
+        rt.put(entry);
+    }
+    rt.publish();
+}
+
+// load the file into a fresh routing table, returns the number of entries loaded
+int RoutingTableTests::load(const std::string& file) {
+    auto other = std::make_shared<DHT>(DHT::Type::IPV4, *node, node->getConfig()->ipv4Address());
+    auto& rt = other->getRoutingTable();
+    rt.load(file);
+    rt.publish();
+
+    auto snapshot = rt.getSnapshot();
+    for (const auto& bucket : snapshot->getBuckets()) {
+        for (const auto& entry : *bucket.entries) {
+            auto expected = dht->getRoutingTable().getEntry(entry.getId());
+            CPPUNIT_ASSERT(expected != nullptr);
+            assertEntryEquals(*expected, entry);
+        }
+    }
+
+    return snapshot->getNumBucketEntries();
+}
+
+void RoutingTableTests::testBinaryRecord() {
+    uint8_t record[KBucketEntry::BINARY_RECORD_SIZE];
+
+    auto entry4 = std::make_shared<KBucketEntry>(Id::random(), SocketAddress("10.0.0.1", 39001), 3);
+    entry4->signalResponse();
+    entry4->signalRequest();
+    entry4->signalRequestTimeout();
+    entry4->toBinary(record);
+    assertEntryEquals(*entry4, *KBucketEntry::fromBinary(record));
+
+    auto entry6 = std::make_shared<KBucketEntry>(Id::random(), SocketAddress("2001:db8::1", 39002));
+    entry6->toBinary(record);
+    assertEntryEquals(*entry6, *KBucketEntry::fromBinary(record));
+}
+
+void RoutingTableTests::testPersistence() {
+    fill(8);
+
+    auto& rt = dht->getRoutingTable();
+    rt.save(path);
+    rt.waitForPendingSave();
+
+    // Every entry comes back with its state
+    CPPUNIT_ASSERT_EQUAL(8, load(path));
+
+    // The buckets are split again on loading, the entries may land in a
+    // different layout, so some of them might not fit any more
+    fill(248, 8);
+    rt.save(path);
+    rt.waitForPendingSave();
+
+    auto loaded = load(path);
+    CPPUNIT_ASSERT(loaded > rt.getNumBucketEntries() / 2);
+    CPPUNIT_ASSERT(loaded <= rt.getNumBucketEntries());
+
+    // An empty routing table is never saved over the previous file
+    auto saved = readFile(path);
+    auto other = std::make_shared<DHT>(DHT::Type::IPV4, *node, node->getConfig()->ipv4Address());
+    other->getRoutingTable().save(path);
+    other->getRoutingTable().waitForPendingSave();
+    CPPUNIT_ASSERT(readFile(path) == saved);
+}
+
+void RoutingTableTests::testChecksumMismatch() {
+    fill(64);
+
+    auto& rt = dht->getRoutingTable();
+    rt.save(path);
+    rt.waitForPendingSave();
+
+    auto data = readFile(path);
+    CPPUNIT_ASSERT(data.size() > KBucketEntry::BINARY_RECORD_SIZE);
+
+    // Flip a bit in the last record
+    data[data.size() - 10] ^= 0x01;
+    writeFile(path, data);
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+
+    // And in the header
+    data[data.size() - 10] ^= 0x01;
+    data[16] ^= 0x01;
+    writeFile(path, data);
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+}
+
+void RoutingTableTests::testTruncatedFile() {
+    fill(64);
+
+    auto& rt = dht->getRoutingTable();
+    rt.save(path);
+    rt.waitForPendingSave();
+
+    auto data = readFile(path);
+
+    // A partial record at the end
+    writeFile(path, std::vector<uint8_t>(data.begin(), data.end() - 10));
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+
+    // A missing record
+    writeFile(path, std::vector<uint8_t>(data.begin(), data.end() - KBucketEntry::BINARY_RECORD_SIZE));
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+
+    // Shorter than the header
+    writeFile(path, std::vector<uint8_t>(data.begin(), data.begin() + 20));
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+
+    // Only the magic
+    writeFile(path, std::vector<uint8_t>(data.begin(), data.begin() + 4));
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+
+    // An empty file
+    writeFile(path, {});
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+
+    // No file at all
+    std::remove(path.c_str());
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+}
+
+void RoutingTableTests::testLegacyFile() {
+    fill(8);
+
+    // The CBOR file written by the earlier versions
+    nlohmann::json entries = nlohmann::json::array();
+    for (const auto& bucket : dht->getRoutingTable().getBuckets()) {
+        for (const auto& entry : bucket->getEntries())
+            entries.push_back(entry->toJson());
+    }
+
+    nlohmann::json root = nlohmann::json::object();
+    root["timestamp"] = currentTimeMillis();
+    root["entries"] = entries;
+    writeFile(path, nlohmann::json::to_cbor(root));
+
+    CPPUNIT_ASSERT_EQUAL(8, load(path));
+
+    // A broken legacy file is ignored
+    auto data = nlohmann::json::to_cbor(root);
+    data.resize(data.size() / 2);
+    writeFile(path, data);
+    CPPUNIT_ASSERT_EQUAL(0, load(path));
+}
+
+}  // namespace test
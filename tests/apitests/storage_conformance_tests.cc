@@ -0,0 +1,450 @@
+/*
+* Copyright (c) 2022 - 2023 trinity-tech.io
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <carrier.h>
+
+#include "sqlite_storage.h"
+#include "memory_storage.h"
+#include "log_storage.h"
+#include "utils.h"
+#include "storage_conformance_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(SqliteStorageConformanceTests);
+CPPUNIT_TEST_SUITE_REGISTRATION(MemoryStorageConformanceTests);
+CPPUNIT_TEST_SUITE_REGISTRATION(LogStorageConformanceTests);
+
+static Value makeValue(const std::string& str) {
+    return Value::createValue(std::vector<uint8_t>(str.cbegin(), str.cend()));
+}
+
+void StorageConformanceTests::setUp() {
+    path = Utils::getPwdStorage("conformance.db");
+    storage = open();
+}
+
+void StorageConformanceTests::tearDown() {
+    storage->close();
+    storage.reset();
+
+    Utils::removeStorage(path);
+    Utils::removeStorage(path + "-wal");
+    Utils::removeStorage(path + "-shm");
+}
+
+void StorageConformanceTests::testValues() {
+    std::vector<Value> values {};
+    for (int i = 0; i < 128; i++) {
+        values.push_back(makeValue("value " + std::to_string(i)));
+        CPPUNIT_ASSERT(storage->putValue(values.back()) == nullptr);
+    }
+
+    for (const auto& value : values) {
+        auto stored = storage->getValue(value.getId());
+        CPPUNIT_ASSERT(stored);
+        CPPUNIT_ASSERT(*stored == value);
+    }
+
+    auto ids = storage->getAllValues();
+    CPPUNIT_ASSERT(ids.size() == 128);
+    for (size_t i = 1; i < ids.size(); i++)
+        CPPUNIT_ASSERT(ids[i - 1] < ids[i]);
+
+    // the same value again returns the stored one
+    auto old = storage->putValue(values[0]);
+    CPPUNIT_ASSERT(old);
+    CPPUNIT_ASSERT(*old == values[0]);
+
+    CPPUNIT_ASSERT(storage->removeValue(values[0].getId()));
+    CPPUNIT_ASSERT(!storage->removeValue(values[0].getId()));
+    CPPUNIT_ASSERT(storage->getValue(values[0].getId()) == nullptr);
+    CPPUNIT_ASSERT(storage->getAllValues().size() == 127);
+}
+
+void StorageConformanceTests::testUpdateSignedValue() {
+    std::string str = "Hello, world";
+    auto signedValue = Value::createSignedValue(std::vector<uint8_t>(str.cbegin(), str.cend()));
+    auto valueId = signedValue.getId();
+    storage->putValue(signedValue, 0);
+
+    // invalid sequence number, then CAS failure
+    CPPUNIT_ASSERT_THROW(storage->putValue(signedValue, 10), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(storage->putValue(signedValue, 9), std::invalid_argument);
+
+    str = "Hello, world2";
+    auto updated = signedValue.update(std::vector<uint8_t>(str.cbegin(), str.cend()));
+    auto old = storage->putValue(updated, 0);
+    CPPUNIT_ASSERT(old);
+    CPPUNIT_ASSERT(*old == signedValue);
+
+    // older sequence number
+    CPPUNIT_ASSERT_THROW(storage->putValue(signedValue), std::invalid_argument);
+
+    auto value = storage->getValue(valueId);
+    CPPUNIT_ASSERT(value);
+    CPPUNIT_ASSERT(*value == updated);
+    CPPUNIT_ASSERT(value->isValid());
+}
+
+void StorageConformanceTests::testPersistentValues() {
+    for (int i = 0; i < 64; i++)
+        storage->putValue(makeValue("value " + std::to_string(i)), i % 2 == 0);
+
+    auto values = storage->getPersistentValues(currentTimeMillis());
+    CPPUNIT_ASSERT(values.size() == 32);
+
+    auto ts = currentTimeMillis();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (const auto& value : values)
+        storage->updateValueLastAnnounce(value.getId());
+
+    CPPUNIT_ASSERT(storage->getPersistentValues(ts).empty());
+    CPPUNIT_ASSERT(storage->getPersistentValues(currentTimeMillis()).size() == 32);
+
+    // a stored value keeps its persistence
+    storage->putValue(values[0], -1, false, false);
+    CPPUNIT_ASSERT(storage->getPersistentValues(currentTimeMillis()).size() == 32);
+}
+
+void StorageConformanceTests::testPeers() {
+    auto keypair = Signature::KeyPair::random();
+    auto peerId = Id(keypair.publicKey());
+
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 16; i++)
+        peers.push_back(PeerInfo::create(keypair, Id::random(), Id::random(), 8000 + i));
+    storage->putPeer(peers);
+
+    for (int i = 0; i < 16; i++) {
+        auto peer = PeerInfo::create(keypair, Id::random(), Id::random(), 9000 + i, "alt:" + std::to_string(i));
+        storage->putPeer(peer);
+        peers.push_back(peer);
+    }
+
+    CPPUNIT_ASSERT(storage->getPeer(peerId, 0).size() == 32);
+    CPPUNIT_ASSERT(storage->getPeer(Id::random(), 0).empty());
+
+    for (const auto& peer : peers) {
+        auto stored = storage->getPeer(peerId, peer.getOrigin());
+        CPPUNIT_ASSERT(stored);
+        CPPUNIT_ASSERT(*stored == peer);
+    }
+
+    // the same node and origin replace the stored one
+    auto updated = PeerInfo::create(keypair, peers[3].getNodeId(), peers[3].getOrigin(), 10000);
+    storage->putPeer(updated);
+    CPPUNIT_ASSERT(storage->getPeer(peerId, 0).size() == 32);
+    CPPUNIT_ASSERT(storage->getPeer(peerId, updated.getOrigin())->getPort() == 10000);
+
+    CPPUNIT_ASSERT(storage->removePeer(peerId, peers[5].getOrigin()));
+    CPPUNIT_ASSERT(!storage->removePeer(peerId, peers[5].getOrigin()));
+    CPPUNIT_ASSERT(storage->getPeer(peerId, peers[5].getOrigin()) == nullptr);
+    CPPUNIT_ASSERT(storage->getPeer(peerId, 0).size() == 31);
+
+    auto ids = storage->getAllPeers();
+    CPPUNIT_ASSERT(ids.size() == 1);
+    CPPUNIT_ASSERT(ids[0] == peerId);
+}
+
+void StorageConformanceTests::testRandomPeers() {
+    auto keypair = Signature::KeyPair::random();
+    auto peerId = Id(keypair.publicKey());
+
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 64; i++)
+        peers.push_back(PeerInfo::create(keypair, Id::random(), Id::random(), 8000 + i));
+    storage->putPeer(peers);
+
+    std::set<Id> seen {};
+    for (int i = 0; i < 16; i++) {
+        auto picked = storage->getPeer(peerId, 8);
+        CPPUNIT_ASSERT(picked.size() == 8);
+
+        std::set<Id> origins {};
+        for (const auto& peer : picked)
+            origins.insert(peer.getOrigin());
+        CPPUNIT_ASSERT(origins.size() == 8);
+        seen.insert(origins.begin(), origins.end());
+    }
+
+    // 16 picks of 8 out of 64 cover much more than one pick
+    CPPUNIT_ASSERT(seen.size() > 16);
+}
+
+void StorageConformanceTests::testPersistentPeers() {
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 16; i++) {
+        auto peer = PeerInfo::create(Id::random(), 8000 + i);
+        storage->putPeer(peer, i % 2 == 0);
+        peers.push_back(peer);
+    }
+
+    auto persistent = storage->getPersistentPeers(currentTimeMillis());
+    CPPUNIT_ASSERT(persistent.size() == 8);
+
+    auto ts = currentTimeMillis();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (const auto& peer : persistent)
+        storage->updatePeerLastAnnounce(peer.getId(), peer.getOrigin());
+
+    CPPUNIT_ASSERT(storage->getPersistentPeers(ts).empty());
+    CPPUNIT_ASSERT(storage->getPersistentPeers(currentTimeMillis()).size() == 8);
+    CPPUNIT_ASSERT(storage->getAllPeers().size() == 16);
+}
+
+void StorageConformanceTests::testExpire() {
+    for (int i = 0; i < 32; i++) {
+        storage->putValue(makeValue("value " + std::to_string(i)));
+        storage->putPeer(PeerInfo::create(Id::random(), 8000 + i));
+    }
+
+    // nothing is old enough
+    CPPUNIT_ASSERT(storage->expire(8) == 0);
+    CPPUNIT_ASSERT(storage->getAllValues().size() == 32);
+    CPPUNIT_ASSERT(storage->getAllPeers().size() == 32);
+}
+
+void StorageConformanceTests::testScan() {
+    std::set<Id> valueIds {};
+    std::set<Id> persistentValueIds {};
+    for (int i = 0; i < 100; i++) {
+        auto value = makeValue("value " + std::to_string(i));
+        storage->putValue(value, -1, i % 2 == 0, false);
+        valueIds.insert(value.getId());
+        if (i % 2 == 0)
+            persistentValueIds.insert(value.getId());
+    }
+
+    // the pages come in the id order, the last one short
+    std::vector<Id> scanned {};
+    ScanCursor cursor {};
+    while (!cursor.done) {
+        auto page = storage->scanValueIds(cursor, 7);
+        CPPUNIT_ASSERT(page.size() <= 7);
+        scanned.insert(scanned.end(), page.begin(), page.end());
+    }
+    CPPUNIT_ASSERT(scanned == std::vector<Id>(valueIds.begin(), valueIds.end()));
+
+    // a record removed before its page is not returned, the others do not shift
+    cursor = {};
+    auto first = storage->scanValueIds(cursor, 10);
+    CPPUNIT_ASSERT(first.size() == 10 && !cursor.done);
+    CPPUNIT_ASSERT(storage->removeValue(*valueIds.rbegin()));
+    size_t rest = 0;
+    while (!cursor.done)
+        rest += storage->scanValueIds(cursor, 10).size();
+    CPPUNIT_ASSERT(first.size() + rest == 99);
+
+    std::vector<Id> persistent {};
+    cursor = {};
+    while (!cursor.done) {
+        for (const auto& value : storage->scanPersistentValues(currentTimeMillis(), cursor, 3))
+            persistent.push_back(value.getId());
+    }
+    CPPUNIT_ASSERT(persistent == std::vector<Id>(persistentValueIds.begin(), persistentValueIds.end()));
+
+    // the peers of an id may span the pages
+    using PeerKey = std::tuple<Id, Id, Id>;
+    std::set<Id> peerIds {};
+    std::set<PeerKey> persistentPeers {};
+    for (int i = 0; i < 3; i++) {
+        auto keypair = Signature::KeyPair::random();
+        for (int j = 0; j < 10; j++) {
+            auto peer = PeerInfo::create(keypair, Id::random(), Id::random(), 8000 + j);
+            storage->putPeer(peer, true);
+            peerIds.insert(peer.getId());
+            persistentPeers.insert({peer.getId(), peer.getNodeId(), peer.getOrigin()});
+        }
+    }
+    for (int i = 0; i < 5; i++) {
+        auto peer = PeerInfo::create(Id::random(), 9000 + i);
+        storage->putPeer(peer);
+        peerIds.insert(peer.getId());
+    }
+
+    scanned.clear();
+    cursor = {};
+    while (!cursor.done) {
+        auto page = storage->scanPeerIds(cursor, 2);
+        scanned.insert(scanned.end(), page.begin(), page.end());
+    }
+    CPPUNIT_ASSERT(scanned == std::vector<Id>(peerIds.begin(), peerIds.end()));
+
+    std::vector<PeerKey> keys {};
+    cursor = {};
+    while (!cursor.done) {
+        for (const auto& peer : storage->scanPersistentPeers(currentTimeMillis(), cursor, 4))
+            keys.push_back({peer.getId(), peer.getNodeId(), peer.getOrigin()});
+    }
+    CPPUNIT_ASSERT(keys == std::vector<PeerKey>(persistentPeers.begin(), persistentPeers.end()));
+}
+
+void StorageConformanceTests::testPrefix() {
+    std::vector<Value> values {};
+    for (int i = 0; i < 128; i++) {
+        values.push_back(makeValue("value " + std::to_string(i)));
+        storage->putValue(values.back());
+    }
+
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 32; i++) {
+        auto keypair = Signature::KeyPair::random();
+        for (int j = 0; j < 3; j++) {
+            peers.push_back(PeerInfo::create(keypair, Id::random(), Id::random(), 8000 + j));
+            storage->putPeer(peers.back());
+        }
+    }
+
+    // a prefix holding a few of the values, the pages may cross its end
+    Prefix prefix(values[0].getId(), 2);
+    std::set<Id> under {};
+    for (const auto& value : values) {
+        if (prefix.isPrefixOf(value.getId()))
+            under.insert(value.getId());
+    }
+
+    std::vector<Id> ids {};
+    ScanCursor cursor(prefix);
+    while (!cursor.done) {
+        for (const auto& value : storage->scanValues(cursor, 5))
+            ids.push_back(value.getId());
+    }
+    CPPUNIT_ASSERT(ids == std::vector<Id>(under.begin(), under.end()));
+
+    ids.clear();
+    cursor = ScanCursor(prefix);
+    while (!cursor.done) {
+        auto page = storage->scanValueIds(cursor, 5);
+        ids.insert(ids.end(), page.begin(), page.end());
+    }
+    CPPUNIT_ASSERT(ids == std::vector<Id>(under.begin(), under.end()));
+
+    prefix = Prefix(peers[0].getId(), 1);
+    size_t count = 0;
+    cursor = ScanCursor(prefix);
+    while (!cursor.done) {
+        for (const auto& peer : storage->scanPeers(cursor, 4)) {
+            CPPUNIT_ASSERT(prefix.isPrefixOf(peer.getId()));
+            count++;
+        }
+    }
+    CPPUNIT_ASSERT(count == (size_t)std::count_if(peers.begin(), peers.end(), [&](const PeerInfo& peer) {
+        return prefix.isPrefixOf(peer.getId());
+    }));
+
+    // the stats of the whole keyspace add up from the two halves
+    auto all = storage->getPrefixStats(Prefix());
+    CPPUNIT_ASSERT(all.values == 128 && all.peers == 96);
+    CPPUNIT_ASSERT(all.valueBytes > 128 * 32 && all.peerBytes > 96 * 32);
+
+    auto low = storage->getPrefixStats(Prefix().splitBranch(false));
+    auto high = storage->getPrefixStats(Prefix().splitBranch(true));
+    CPPUNIT_ASSERT(low.values + high.values == all.values);
+    CPPUNIT_ASSERT(low.valueBytes + high.valueBytes == all.valueBytes);
+    CPPUNIT_ASSERT(low.peers + high.peers == all.peers);
+    CPPUNIT_ASSERT(low.peerBytes + high.peerBytes == all.peerBytes);
+
+    prefix = Prefix(values[0].getId(), 2);
+    CPPUNIT_ASSERT(storage->getPrefixStats(prefix).values == under.size());
+}
+
+Sp<DataStorage> SqliteStorageConformanceTests::open() {
+    return SqliteStorage::open(path);
+}
+
+Sp<DataStorage> MemoryStorageConformanceTests::open() {
+    return std::make_shared<MemoryStorage>(64 * 1024 * 1024);
+}
+
+Sp<DataStorage> LogStorageConformanceTests::open() {
+    return std::make_shared<LogStorage>(path);
+}
+
+void MemoryStorageConformanceTests::testMemoryBound() {
+    const size_t maxBytes = 64 * 1024;
+    auto memory = std::make_shared<MemoryStorage>(maxBytes);
+
+    // the oldest ones are evicted to make room
+    Id last {};
+    for (int i = 0; i < 1024; i++) {
+        auto value = Value::createValue(Utils::getRandomData(256));
+        memory->putValue(value);
+        last = value.getId();
+        CPPUNIT_ASSERT(memory->getBytes() <= maxBytes);
+    }
+    CPPUNIT_ASSERT(memory->getValue(last));
+    CPPUNIT_ASSERT(memory->getAllValues().size() < 1024);
+
+    // but never the persistent ones
+    CPPUNIT_ASSERT_THROW({
+        for (int i = 0; i < 1024; i++)
+            memory->putValue(Value::createValue(Utils::getRandomData(256)), true);
+    }, std::runtime_error);
+    CPPUNIT_ASSERT(memory->getBytes() <= maxBytes);
+    CPPUNIT_ASSERT(memory->getPersistentValues(currentTimeMillis()).size() == memory->getAllValues().size());
+
+    memory->close();
+}
+
+void MemoryStorageConformanceTests::testRefresh() {
+    auto memory = std::make_shared<MemoryStorage>(64 * 1024);
+
+    auto value = Value::createValue(Utils::getRandomData(256));
+    auto peer = PeerInfo::create(Id::random(), 8000);
+    memory->putValue(value);
+    memory->putPeer(peer);
+    auto bytes = memory->getBytes();
+    CPPUNIT_ASSERT_EQUAL((size_t)2, memory->getDeadlines());
+
+    // a refresh moves the deadline, it does not add one
+    for (int i = 0; i < 1000; i++) {
+        memory->putValue(value);
+        memory->updateValueLastAnnounce(value.getId());
+        memory->putPeer(peer);
+        memory->updatePeerLastAnnounce(peer.getId(), peer.getOrigin());
+    }
+    CPPUNIT_ASSERT_EQUAL((size_t)2, memory->getDeadlines());
+    CPPUNIT_ASSERT_EQUAL(bytes, memory->getBytes());
+
+    // a peer put again as persistent gives up its deadline
+    memory->putPeer(peer, true);
+    CPPUNIT_ASSERT_EQUAL((size_t)1, memory->getDeadlines());
+
+    memory->removeValue(value.getId());
+    memory->removePeer(peer.getId(), peer.getOrigin());
+    CPPUNIT_ASSERT_EQUAL((size_t)0, memory->getDeadlines());
+    CPPUNIT_ASSERT_EQUAL((size_t)0, memory->getBytes());
+
+    memory->close();
+}
+
+}  // namespace test
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "data_storage.h"
+
+namespace test {
+
+/*
+ * The behavior every DataStorage backend shares. A backend runs them by a
+ * subclass that opens it.
+ */
+class StorageConformanceTests : public CppUnit::TestFixture {
+    CPPUNIT_TEST_SUITE(StorageConformanceTests);
+    CPPUNIT_TEST(testValues);
+    CPPUNIT_TEST(testUpdateSignedValue);
+    CPPUNIT_TEST(testPersistentValues);
+    CPPUNIT_TEST(testPeers);
+    CPPUNIT_TEST(testRandomPeers);
+    CPPUNIT_TEST(testPersistentPeers);
+    CPPUNIT_TEST(testExpire);
+    CPPUNIT_TEST(testScan);
+    CPPUNIT_TEST(testPrefix);
+    CPPUNIT_TEST_SUITE_END_ABSTRACT();
+
+ public:
+    void setUp();
+    void tearDown();
+
+    void testValues();
+    void testUpdateSignedValue();
+    void testPersistentValues();
+    void testPeers();
+    void testRandomPeers();
+    void testPersistentPeers();
+    void testExpire();
+    void testScan();
+    void testPrefix();
+
+protected:
+    virtual elastos::carrier::Sp<elastos::carrier::DataStorage> open() = 0;
+    virtual std::string name() = 0;
+
+    std::string path {};
+    elastos::carrier::Sp<elastos::carrier::DataStorage> storage {};
+};
+
+class SqliteStorageConformanceTests : public StorageConformanceTests {
+    CPPUNIT_TEST_SUB_SUITE(SqliteStorageConformanceTests, StorageConformanceTests);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    elastos::carrier::Sp<elastos::carrier::DataStorage> open() override;
+    std::string name() override {
+        return "SQLite";
+    }
+};
+
+class MemoryStorageConformanceTests : public StorageConformanceTests {
+    CPPUNIT_TEST_SUB_SUITE(MemoryStorageConformanceTests, StorageConformanceTests);
+    CPPUNIT_TEST(testMemoryBound);
+    CPPUNIT_TEST(testRefresh);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testMemoryBound();
+    void testRefresh();
+
+protected:
+    elastos::carrier::Sp<elastos::carrier::DataStorage> open() override;
+    std::string name() override {
+        return "memory";
+    }
+};
+
+class LogStorageConformanceTests : public StorageConformanceTests {
+    CPPUNIT_TEST_SUB_SUITE(LogStorageConformanceTests, StorageConformanceTests);
+    CPPUNIT_TEST_SUITE_END();
+
+protected:
+    elastos::carrier::Sp<elastos::carrier::DataStorage> open() override;
+    std::string name() override {
+        return "log";
+    }
+};
+
+}  // namespace test
@@ -0,0 +1,226 @@
+/*
+* Copyright (c) 2022 - 2023 trinity-tech.io
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#include <vector>
+#include <string>
+#include <carrier.h>
+
+#include "memory_storage.h"
+#include "storage_quota.h"
+#include "utils.h"
+#include "storage_quota_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(StorageQuotaTests);
+
+static const size_t KB = 1024;
+
+static Sp<DataStorage> openStorage() {
+    return std::make_shared<MemoryStorage>(64 * 1024 * 1024);
+}
+
+static Value makeValue() {
+    return Value::createValue(Utils::getRandomData(1000));
+}
+
+void StorageQuotaTests::testOriginQuota() {
+    auto storage = openStorage();
+    StorageQuota quota(storage, 1024 * KB, 16 * KB, 1024 * KB);
+
+    auto origin = Id::random();
+    SocketAddress address("10.0.1.5", "39001");
+
+    int stored = 0;
+    while (quota.putValue(origin, address, makeValue()))
+        stored++;
+
+    // about 16 of the 1 KB values, and nothing is stored over the quota
+    CPPUNIT_ASSERT(stored > 8 && stored < 16);
+    CPPUNIT_ASSERT(quota.getUsage(origin) <= 16 * KB);
+    CPPUNIT_ASSERT(storage->getAllValues().size() == (size_t)stored);
+    CPPUNIT_ASSERT(quota.getUsage().rejected == 1);
+
+    // the other origins are not affected
+    auto other = Id::random();
+    CPPUNIT_ASSERT(quota.putValue(other, SocketAddress("10.0.2.5", "39001"), makeValue()));
+    CPPUNIT_ASSERT(quota.putPeer(other, SocketAddress("10.0.2.5", "39001"), PeerInfo::create(other, 8000)));
+}
+
+void StorageQuotaTests::testPrefixQuota() {
+    auto storage = openStorage();
+    StorageQuota quota(storage, 1024 * KB, 16 * KB, 32 * KB);
+
+    // many node ids behind the same /24 share its quota
+    int stored = 0;
+    for (int i = 0; i < 64; i++) {
+        auto address = SocketAddress("192.168.7." + std::to_string(i + 1), "39001");
+        if (quota.putValue(Id::random(), address, makeValue()))
+            stored++;
+    }
+
+    CPPUNIT_ASSERT(stored > 16 && stored < 32);
+    CPPUNIT_ASSERT(quota.getUsage(SocketAddress("192.168.7.200", "39001")) <= 32 * KB);
+    CPPUNIT_ASSERT(quota.getUsage(SocketAddress("192.168.8.1", "39001")) == 0);
+    CPPUNIT_ASSERT(quota.putValue(Id::random(), SocketAddress("192.168.8.1", "39001"), makeValue()));
+}
+
+void StorageQuotaTests::testRestore() {
+    auto storage = openStorage();
+    StorageQuota quota(storage, 1024 * KB, 16 * KB, 1024 * KB);
+
+    auto origin = Id::random();
+    SocketAddress address("10.0.1.5", "39001");
+
+    // a store over the same record is charged once
+    auto value = makeValue();
+    for (int i = 0; i < 64; i++)
+        CPPUNIT_ASSERT(quota.putValue(origin, address, value));
+
+    auto usage = quota.getUsage(origin);
+    CPPUNIT_ASSERT(usage > 1000 && usage < 2 * KB);
+    CPPUNIT_ASSERT(quota.getUsage().records == 1);
+
+    // the last store owns it
+    auto other = Id::random();
+    CPPUNIT_ASSERT(quota.putValue(other, address, value));
+    CPPUNIT_ASSERT(quota.getUsage(origin) == 0);
+    CPPUNIT_ASSERT(quota.getUsage(other) == usage);
+}
+
+void StorageQuotaTests::testEviction() {
+    auto storage = openStorage();
+    StorageQuota quota(storage, 32 * KB, 1024 * KB, 1024 * KB);
+
+    std::vector<Value> values {};
+    for (int i = 0; i < 64; i++) {
+        values.push_back(makeValue());
+        CPPUNIT_ASSERT(quota.putValue(Id::random(), SocketAddress("10.0.1.5", "39001"), values.back()));
+        CPPUNIT_ASSERT(quota.getUsage().bytes <= 32 * KB);
+    }
+
+    auto usage = quota.getUsage();
+    CPPUNIT_ASSERT(usage.evicted > 0);
+    CPPUNIT_ASSERT(usage.records + usage.evicted == 64);
+    CPPUNIT_ASSERT(storage->getAllValues().size() == usage.records);
+
+    // the least recently stored ones are gone
+    CPPUNIT_ASSERT(!storage->getValue(values.front().getId()));
+    CPPUNIT_ASSERT(storage->getValue(values.back().getId()));
+
+    // a store refreshes the record, so it outlives the later ones
+    auto kept = values[usage.evicted];
+    CPPUNIT_ASSERT(quota.putValue(Id::random(), SocketAddress("10.0.1.5", "39001"), kept));
+    for (int i = 0; i < 8; i++)
+        CPPUNIT_ASSERT(quota.putValue(Id::random(), SocketAddress("10.0.1.5", "39001"), makeValue()));
+    CPPUNIT_ASSERT(storage->getValue(kept.getId()));
+}
+
+void StorageQuotaTests::testRelease() {
+    auto storage = openStorage();
+    StorageQuota quota(storage, 8 * KB, 1024 * KB, 1024 * KB);
+
+    auto origin = Id::random();
+    SocketAddress address("10.0.1.5", "39001");
+    auto peer = PeerInfo::create(Id::random(), 8000);
+    CPPUNIT_ASSERT(quota.putPeer(origin, address, peer));
+    CPPUNIT_ASSERT(quota.getUsage(origin) > 0);
+
+    // taken over by the local node, it is neither charged nor evicted any more
+    storage->putPeer(peer, true);
+    quota.ownPeer(peer.getId(), peer.getOrigin());
+    CPPUNIT_ASSERT(quota.getUsage(origin) == 0);
+
+    for (int i = 0; i < 16; i++)
+        quota.putValue(origin, address, makeValue());
+    CPPUNIT_ASSERT(quota.getUsage().evicted > 0);
+    CPPUNIT_ASSERT(storage->getPeer(peer.getId(), peer.getOrigin()));
+}
+
+void StorageQuotaTests::testLocalRecords() {
+    auto storage = openStorage();
+    StorageQuota quota(storage, 8 * KB, 1024 * KB, 1024 * KB);
+
+    auto value = makeValue();
+    storage->putValue(value, true);
+    quota.ownValue(value.getId());
+    auto peer = PeerInfo::create(Id::random(), 8000);
+    storage->putPeer(peer, true);
+    quota.ownPeer(peer.getId(), peer.getOrigin());
+
+    // stored again by another node, they are still not charged
+    auto origin = Id::random();
+    SocketAddress address("10.0.1.5", "39001");
+    CPPUNIT_ASSERT(quota.putValue(origin, address, value));
+    CPPUNIT_ASSERT(quota.putPeer(origin, address, peer));
+    CPPUNIT_ASSERT(quota.getUsage(origin) == 0);
+    CPPUNIT_ASSERT(quota.getUsage().records == 0);
+
+    // nor evicted, and the peer stays persistent
+    for (int i = 0; i < 16; i++)
+        quota.putValue(origin, address, makeValue());
+    CPPUNIT_ASSERT(quota.getUsage().evicted > 0);
+    CPPUNIT_ASSERT(storage->getValue(value.getId()));
+    CPPUNIT_ASSERT(storage->getPersistentValues(Utils::currentTimeMillis()).size() == 1);
+    CPPUNIT_ASSERT(storage->getPersistentPeers(Utils::currentTimeMillis()).size() == 1);
+
+    // removed by the local node, it is charged to the next node storing it
+    quota.releaseValue(value.getId());
+    storage->removeValue(value.getId());
+    CPPUNIT_ASSERT(quota.putValue(origin, address, value));
+    CPPUNIT_ASSERT(quota.getUsage(origin) > 0);
+}
+
+void StorageQuotaTests::testRecover() {
+    auto storage = openStorage();
+    auto local = makeValue();
+    storage->putValue(local, true);
+    auto peer = PeerInfo::create(Id::random(), 8000);
+    storage->putPeer(peer, true);
+
+    for (int i = 0; i < 16; i++)
+        storage->putValue(makeValue());
+
+    // the records of before the restart count towards the budget, but not the local ones
+    StorageQuota quota(storage, 8 * KB, 1024 * KB, 1024 * KB);
+    quota.recover();
+    auto usage = quota.getUsage();
+    CPPUNIT_ASSERT(usage.bytes <= 8 * KB);
+    CPPUNIT_ASSERT(usage.evicted > 0);
+    CPPUNIT_ASSERT(usage.records + usage.evicted == 16);
+    CPPUNIT_ASSERT(storage->getAllValues().size() == usage.records + 1);
+    CPPUNIT_ASSERT(storage->getValue(local.getId()));
+    CPPUNIT_ASSERT(storage->getPeer(peer.getId(), peer.getOrigin()));
+
+    // and go first to make room for the new ones
+    auto origin = Id::random();
+    SocketAddress address("10.0.1.5", "39001");
+    auto value = makeValue();
+    CPPUNIT_ASSERT(quota.putValue(origin, address, value));
+    CPPUNIT_ASSERT(storage->getValue(value.getId()));
+    CPPUNIT_ASSERT(quota.getUsage().evicted > usage.evicted);
+    CPPUNIT_ASSERT(storage->getValue(local.getId()));
+}
+
+}  // namespace test
@@ -20,9 +20,11 @@
  * SOFTWARE.
  */
 #include <iostream>
+#include <iomanip>
 #include <string>
 #include <list>
 #include <set>
+#include <chrono>
 
 #include "task/closest_candidates.h"
 #include "utils.h"
@@ -200,6 +202,121 @@ ClosestCandidatestsTests::testHeadAndTail() {
     CPPUNIT_ASSERT_EQUAL(result.back()->getId(), cc.tail());
 }
 
+static std::list<std::shared_ptr<NodeInfo>> makeNodes(int count) {
+    std::list<std::shared_ptr<NodeInfo>> nodes {};
+    for (int i = 0; i < count; i++) {
+        std::string addr = "10.0." + std::to_string(i / 250) + "." + std::to_string(i % 250 + 1);
+        nodes.push_back(std::make_shared<NodeInfo>(Id::random(), addr, 12345));
+    }
+    return nodes;
+}
+
+void
+ClosestCandidatestsTests::testNextAndRetry() {
+    auto target = Id::random();
+    auto cc = ClosestCandidates(target, 16);
+
+    auto nodes = makeNodes(8);
+    cc.add(nodes);
+
+    nodes.sort([&](const std::shared_ptr<NodeInfo> &node1, const std::shared_ptr<NodeInfo>& node2) {
+        return target.threeWayCompare(node1->getId(), node2->getId()) < 0;
+    });
+
+    // Candidates come out by distance, the in-flight ones are skipped
+    auto first = cc.next();
+    CPPUNIT_ASSERT_EQUAL(nodes.front()->getId(), first->getId());
+    cc.setSent(first);
+
+    auto second = cc.next();
+    CPPUNIT_ASSERT_EQUAL((*std::next(nodes.begin()))->getId(), second->getId());
+    cc.setSent(second);
+
+    // The timed out candidate goes after the never pinged ones
+    cc.clearSent(first);
+    auto third = cc.next();
+    CPPUNIT_ASSERT_EQUAL((*std::next(nodes.begin(), 2))->getId(), third->getId());
+
+    // Responded candidate is removed
+    cc.remove(second->getId());
+    CPPUNIT_ASSERT_EQUAL(7, cc.size());
+    CPPUNIT_ASSERT(cc.get(second->getId()) == nullptr);
+
+    // Drain all the never pinged candidates, the retry is the last one
+    Sp<CandidateNode> cn {};
+    int count = 0;
+    while ((cn = cc.next()) != nullptr && cn->getPinged() == 0) {
+        cc.setSent(cn);
+        count++;
+    }
+    CPPUNIT_ASSERT_EQUAL(6, count);
+    CPPUNIT_ASSERT_EQUAL(first->getId(), cn->getId());
+
+    // Unreachable candidate is not eligible anymore
+    cc.setSent(first);
+    cc.clearSent(first);
+    cc.setSent(first);
+    cc.clearSent(first);
+    CPPUNIT_ASSERT(first->isUnreachable());
+    CPPUNIT_ASSERT(cc.next() == nullptr);
+}
+
+void
+ClosestCandidatestsTests::testBenchmark() {
+    std::cout << std::endl;
+
+    for (int size : {8, 64, 1024}) {
+        auto target = Id::random();
+        auto nodes = makeNodes(size);
+        const int rounds = std::max(1, 16384 / size);
+
+        uint64_t ops = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int r = 0; r < rounds; r++) {
+            auto cc = ClosestCandidates(target, size);
+
+            // Feed the candidates as the lookup responses do: 8 nodes each
+            std::list<std::shared_ptr<NodeInfo>> batch {};
+            for (const auto& node : nodes) {
+                batch.push_back(node);
+                if (batch.size() == 8) {
+                    cc.add(batch);
+                    batch.clear();
+                    ops++;
+                }
+            }
+            if (!batch.empty()) {
+                cc.add(batch);
+                ops++;
+            }
+
+            CPPUNIT_ASSERT_EQUAL(size, cc.size());
+
+            // Drain: pick the next, send, then remove it on the response
+            Id last = target;
+            Sp<CandidateNode> cn {};
+            while ((cn = cc.next()) != nullptr) {
+                CPPUNIT_ASSERT(target.threeWayCompare(last, cn->getId()) <= 0);
+                last = cn->getId();
+
+                cc.setSent(cn);
+                cc.remove(cn->getId());
+                ops += 3;
+            }
+
+            CPPUNIT_ASSERT_EQUAL(0, cc.size());
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        std::cout << "ClosestCandidates " << std::setw(5) << size << " candidates: "
+                  << std::setw(8) << ops << " ops in " << std::setw(8) << elapsed << " us, "
+                  << std::fixed << std::setprecision(1)
+                  << (elapsed ? ops * 1000000.0 / elapsed : 0.0) << " ops/s" << std::endl;
+    }
+}
+
 void
 ClosestCandidatestsTests::tearDown() {
 }
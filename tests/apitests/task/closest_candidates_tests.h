@@ -30,6 +30,8 @@ class ClosestCandidatestsTests : public CppUnit::TestFixture {
     CPPUNIT_TEST_SUITE(ClosestCandidatestsTests);
     CPPUNIT_TEST(testAdd);
     CPPUNIT_TEST(testHeadAndTail);
+    CPPUNIT_TEST(testNextAndRetry);
+    CPPUNIT_TEST(testBenchmark);
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -38,5 +40,7 @@ public:
 
     void testAdd();
     void testHeadAndTail();
+    void testNextAndRetry();
+    void testBenchmark();
 };
 }
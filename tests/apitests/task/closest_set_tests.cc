@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <list>
+#include <map>
+
+#include "task/closest_set.h"
+#include "utils.h"
+#include "lookup_simulation.h"
+#include "closest_set_tests.h"
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(ClosestSetTests);
+
+/*
+ * The previous implementation, ordered by the raw node id instead of the
+ * distance to the target. Only kept here to compare the lookup convergence.
+ */
+class LegacyClosestSet {
+public:
+    LegacyClosestSet(const Id& _target, int _capacity)
+        : target(_target), capacity(_capacity) {}
+
+    bool reachedCapacity() const {
+        return closest.size() >= capacity;
+    }
+
+    bool contains(const Id& id) const {
+        return closest.find(id) != closest.end();
+    }
+
+    void add(const Sp<CandidateNode>& cn) {
+        closest[cn->getId()] = cn;
+        if (closest.size() > capacity) {
+            auto last = std::prev(closest.cend());
+            bool self = last->second == cn;
+            closest.erase(last);
+            if (self)
+                insertAttemptsSinceTailModification++;
+            else
+                insertAttemptsSinceTailModification = 0;
+        }
+    }
+
+    Id tail() const {
+        if (closest.empty())
+            return target.distance(Id::MAX_ID);
+        return (std::prev(closest.cend()))->first;
+    }
+
+    bool isEligible() const {
+        return reachedCapacity() && insertAttemptsSinceTailModification > capacity;
+    }
+
+private:
+    const Id& target;
+    int capacity;
+    std::map<Id, Sp<CandidateNode>> closest {};
+    int insertAttemptsSinceTailModification {0};
+};
+
+static Sp<CandidateNode> makeCandidate(int i) {
+    std::string addr = "192.168.1." + std::to_string(i + 1);
+    return std::make_shared<CandidateNode>(NodeInfo(Id::random(), addr, 12345));
+}
+
+static void sortByDistance(const Id& target, std::vector<Sp<CandidateNode>>& nodes) {
+    std::sort(nodes.begin(), nodes.end(), [&](const Sp<CandidateNode>& a, const Sp<CandidateNode>& b) {
+        return target.threeWayCompare(a->getId(), b->getId()) < 0;
+    });
+}
+
+void
+ClosestSetTests::setUp() {
+}
+
+void
+ClosestSetTests::testAdd() {
+    auto target = Id::random();
+    auto cs = ClosestSet(target, 8);
+
+    std::vector<Sp<CandidateNode>> nodes {};
+    for (int i = 0; i < 8; i++) {
+        auto cn = makeCandidate(i);
+        nodes.push_back(cn);
+        cs.add(cn);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(8, cs.size());
+    CPPUNIT_ASSERT(cs.reachedCapacity());
+
+    sortByDistance(target, nodes);
+    CPPUNIT_ASSERT_EQUAL(nodes.front()->getId(), cs.head());
+    CPPUNIT_ASSERT_EQUAL(nodes.back()->getId(), cs.tail());
+
+    int i = 0;
+    for (const auto& entry : cs.getEntries()) {
+        CPPUNIT_ASSERT(entry == nodes[i++]);
+        CPPUNIT_ASSERT(cs.contains(entry->getId()));
+        CPPUNIT_ASSERT(cs.get(entry->getId()) == entry);
+    }
+
+    // Re-adding the same node replaces the entry
+    auto replacement = std::make_shared<CandidateNode>(*nodes[3]);
+    cs.add(replacement);
+    CPPUNIT_ASSERT_EQUAL(8, cs.size());
+    CPPUNIT_ASSERT(cs.get(nodes[3]->getId()) == replacement);
+
+    cs.removeCandidate(nodes[0]->getId());
+    CPPUNIT_ASSERT_EQUAL(7, cs.size());
+    CPPUNIT_ASSERT(!cs.contains(nodes[0]->getId()));
+    CPPUNIT_ASSERT(cs.get(nodes[0]->getId()) == nullptr);
+    CPPUNIT_ASSERT_EQUAL(nodes[1]->getId(), cs.head());
+}
+
+void
+ClosestSetTests::testEviction() {
+    auto target = Id::random();
+    auto cs = ClosestSet(target, 8);
+
+    std::vector<Sp<CandidateNode>> nodes {};
+    for (int i = 0; i < 64; i++) {
+        auto cn = makeCandidate(i);
+        nodes.push_back(cn);
+        cs.add(cn);
+
+        CPPUNIT_ASSERT(cs.size() <= 8);
+    }
+
+    // Only the 8 closest nodes should be kept
+    sortByDistance(target, nodes);
+    CPPUNIT_ASSERT_EQUAL(8, cs.size());
+    CPPUNIT_ASSERT_EQUAL(nodes[0]->getId(), cs.head());
+    CPPUNIT_ASSERT_EQUAL(nodes[7]->getId(), cs.tail());
+
+    for (int i = 0; i < 64; i++)
+        CPPUNIT_ASSERT_EQUAL(i < 8, cs.contains(nodes[i]->getId()));
+}
+
+void
+ClosestSetTests::testEligible() {
+    auto target = Id::random();
+    auto cs = ClosestSet(target, 4);
+
+    std::vector<Sp<CandidateNode>> nodes {};
+    for (int i = 0; i < 16; i++)
+        nodes.push_back(makeCandidate(i));
+    sortByDistance(target, nodes);
+
+    for (int i = 0; i < 4; i++)
+        cs.add(nodes[i]);
+    CPPUNIT_ASSERT(!cs.isEligible());
+
+    // The tail stays the same after more than capacity farther inserts
+    for (int i = 4; i < 9; i++)
+        cs.add(nodes[i]);
+    CPPUNIT_ASSERT(cs.isEligible());
+    CPPUNIT_ASSERT_EQUAL(nodes[3]->getId(), cs.tail());
+}
+
+void
+ClosestSetTests::testLookupConvergence() {
+    const int networkSize = 1024;
+    const int lookups = 200;
+
+    SimulatedNetwork network(networkSize);
+
+    SimulatedLookup legacy {};
+    SimulatedLookup current {};
+
+    for (int i = 0; i < lookups; i++) {
+        int origin = Utils::getRandom(0, networkSize - 1);
+        auto target = Id::random();
+
+        auto r1 = simulateLookup<LegacyClosestSet>(network, origin, target);
+        auto r2 = simulateLookup<ClosestSet>(network, origin, target);
+
+        legacy.requests += r1.requests;
+        legacy.found += r1.found;
+        current.requests += r2.requests;
+        current.found += r2.found;
+    }
+
+    std::cout << std::endl << "Lookup convergence, " << networkSize << " nodes, "
+              << lookups << " lookups:" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+              << "  id ordered set:        " << std::setw(8) << (double)legacy.requests / lookups
+              << " RPCs/lookup, " << std::setw(6) << (double)legacy.found / lookups << "/8 closest found" << std::endl
+              << "  distance ordered set:  " << std::setw(8) << (double)current.requests / lookups
+              << " RPCs/lookup, " << std::setw(6) << (double)current.found / lookups << "/8 closest found" << std::endl;
+
+    // The lookup should find almost all the real closest nodes
+    CPPUNIT_ASSERT(current.found >= lookups * 7);
+}
+
+void
+ClosestSetTests::tearDown() {
+}
+}
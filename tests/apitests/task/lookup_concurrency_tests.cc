@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+#include "task/lookup_concurrency.h"
+#include "utils.h"
+#include "lookup_simulation.h"
+#include "lookup_concurrency_tests.h"
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(LookupConcurrencyTests);
+
+void
+LookupConcurrencyTests::setUp() {
+}
+
+void
+LookupConcurrencyTests::testWiden() {
+    LookupConcurrency concurrency(3, 8);
+    CPPUNIT_ASSERT_EQUAL(3, concurrency.get());
+
+    concurrency.stalled();
+    CPPUNIT_ASSERT_EQUAL(4, concurrency.get());
+
+    concurrency.timeout();
+    CPPUNIT_ASSERT_EQUAL(5, concurrency.get());
+
+    for (int i = 0; i < 10; i++)
+        concurrency.stalled();
+
+    CPPUNIT_ASSERT_EQUAL(8, concurrency.get());
+    CPPUNIT_ASSERT_EQUAL(8, concurrency.getPeak());
+}
+
+void
+LookupConcurrencyTests::testNarrow() {
+    LookupConcurrency concurrency(3, 8);
+
+    // the prompt responses never narrow below the lower bound
+    for (int i = 0; i < 10; i++)
+        concurrency.responded(true);
+    CPPUNIT_ASSERT_EQUAL(3, concurrency.get());
+
+    concurrency.stalled();
+    concurrency.stalled();
+    CPPUNIT_ASSERT_EQUAL(5, concurrency.get());
+
+    // a full window of prompt responses narrows by one
+    for (int i = 0; i < 4; i++)
+        concurrency.responded(true);
+    CPPUNIT_ASSERT_EQUAL(5, concurrency.get());
+    concurrency.responded(true);
+    CPPUNIT_ASSERT_EQUAL(4, concurrency.get());
+
+    // a late response restarts the window
+    for (int i = 0; i < 3; i++)
+        concurrency.responded(true);
+    concurrency.responded(false);
+    for (int i = 0; i < 3; i++)
+        concurrency.responded(true);
+    CPPUNIT_ASSERT_EQUAL(4, concurrency.get());
+    concurrency.responded(true);
+    CPPUNIT_ASSERT_EQUAL(3, concurrency.get());
+
+    CPPUNIT_ASSERT_EQUAL(5, concurrency.getPeak());
+}
+
+void
+LookupConcurrencyTests::testBounds() {
+    LookupConcurrency fixed(10, 10);
+    fixed.stalled();
+    fixed.responded(true);
+    CPPUNIT_ASSERT_EQUAL(10, fixed.get());
+
+    LookupConcurrency invalid(0, -1);
+    CPPUNIT_ASSERT_EQUAL(1, invalid.getMin());
+    CPPUNIT_ASSERT_EQUAL(1, invalid.getMax());
+    CPPUNIT_ASSERT_EQUAL(1, invalid.get());
+}
+
+void
+LookupConcurrencyTests::testLossyLookup() {
+    const int networkSize = 1024;
+    const int lookups = 200;
+
+    SimulatedNetwork network(networkSize);
+    std::mt19937 rng(std::random_device{}());
+
+    struct Result {
+        double requests;
+        double concurrency;
+        uint64_t p50;
+        uint64_t p99;
+    };
+
+    auto run = [&](double loss, bool adaptive) {
+        std::vector<uint64_t> latencies {};
+        int requests = 0;
+        int concurrency = 0;
+
+        for (int i = 0; i < lookups; i++) {
+            int origin = Utils::getRandom(0, networkSize - 1);
+            auto target = Id::random();
+
+            LookupConcurrency alpha = adaptive ?
+                    LookupConcurrency(Constants::MIN_CONCURRENT_LOOKUP_REQUESTS, Constants::MAX_CONCURRENT_LOOKUP_REQUESTS) :
+                    LookupConcurrency(Constants::MAX_CONCURRENT_TASK_REQUESTS, Constants::MAX_CONCURRENT_TASK_REQUESTS);
+
+            auto r = simulateTimedLookup(network, origin, target, alpha, !adaptive, loss, rng);
+            latencies.push_back(r.latency);
+            requests += r.requests;
+            concurrency += r.concurrency;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        return Result {
+            (double)requests / lookups,
+            (double)concurrency / lookups,
+            latencies[lookups / 2],
+            latencies[lookups * 99 / 100]
+        };
+    };
+
+    auto print = [](const std::string& name, const Result& r) {
+        std::cout << "  " << std::left << std::setw(24) << name << std::right
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(8) << r.requests << " RPCs/lookup, alpha "
+                  << std::setw(5) << r.concurrency << ", p50 "
+                  << std::setw(6) << r.p50 << "ms, p99 "
+                  << std::setw(6) << r.p99 << "ms" << std::endl;
+    };
+
+    auto healthyFixed = run(0.0, false);
+    auto healthyAdaptive = run(0.0, true);
+    auto lossyFixed = run(0.1, false);
+    auto lossyAdaptive = run(0.1, true);
+
+    std::cout << std::endl << "Lookup concurrency, " << networkSize << " nodes, "
+              << lookups << " lookups:" << std::endl;
+    print("healthy, fixed", healthyFixed);
+    print("healthy, adaptive", healthyAdaptive);
+    print("10% loss, fixed", lossyFixed);
+    print("10% loss, adaptive", lossyAdaptive);
+
+    // No more packets on a healthy network, and a lower tail latency on a lossy one
+    CPPUNIT_ASSERT(healthyAdaptive.requests <= healthyFixed.requests);
+    CPPUNIT_ASSERT(lossyAdaptive.p99 < lossyFixed.p99);
+}
+
+void
+LookupConcurrencyTests::tearDown() {
+}
+}
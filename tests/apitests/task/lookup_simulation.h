@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+#include <list>
+#include <map>
+#include <algorithm>
+#include <random>
+
+#include "carrier/id.h"
+#include "carrier/node_info.h"
+#include "task/closest_candidates.h"
+#include "task/closest_set.h"
+#include "task/lookup_concurrency.h"
+#include "constants.h"
+
+namespace test {
+
+using namespace elastos::carrier;
+
+/**
+ * An in-memory network for the lookup simulations: every node keeps a
+ * Kademlia style routing table (up to k random nodes per shared prefix
+ * length) and answers the find node requests with its k closest nodes.
+ */
+class SimulatedNetwork {
+public:
+    SimulatedNetwork(int size, int k = 8) : k(k) {
+        std::mt19937 rng(std::random_device{}());
+
+        for (int i = 0; i < size; i++) {
+            std::string addr = "10." + std::to_string(i / 62500) + "." +
+                    std::to_string(i / 250 % 250) + "." + std::to_string(i % 250 + 1);
+            auto node = std::make_shared<NodeInfo>(Id::random(), addr, 39001);
+            index[node->getId()] = i;
+            nodes.push_back(node);
+        }
+
+        std::vector<int> order(size);
+        for (int i = 0; i < size; i++)
+            order[i] = i;
+
+        tables.resize(size);
+        for (int i = 0; i < size; i++) {
+            std::shuffle(order.begin(), order.end(), rng);
+            std::vector<int> buckets(ID_BYTES * 8 + 1, 0);
+
+            for (int j : order) {
+                if (j == i)
+                    continue;
+
+                int b = sharedPrefixLength(nodes[i]->getId(), nodes[j]->getId());
+                if (buckets[b] < k) {
+                    buckets[b]++;
+                    tables[i].push_back(j);
+                }
+            }
+        }
+    }
+
+    int size() const {
+        return nodes.size();
+    }
+
+    const Sp<NodeInfo>& getNode(int i) const {
+        return nodes[i];
+    }
+
+    int indexOf(const Id& id) const {
+        auto it = index.find(id);
+        return it != index.end() ? it->second : -1;
+    }
+
+    /**
+     * The n closest nodes to the target in the routing table of the node i.
+     */
+    std::list<Sp<NodeInfo>> findNode(int i, const Id& target, int n) const {
+        auto table = tables[i];
+        return closest(table, target, n);
+    }
+
+    /**
+     * The real n closest nodes to the target in the whole network.
+     */
+    std::list<Sp<NodeInfo>> findClosest(const Id& target, int n) const {
+        std::vector<int> all(nodes.size());
+        for (int i = 0; i < all.size(); i++)
+            all[i] = i;
+        return closest(all, target, n);
+    }
+
+private:
+    static int sharedPrefixLength(const Id& a, const Id& b) {
+        for (int i = 0; i < ID_BYTES; i++) {
+            uint8_t x = a.data()[i] ^ b.data()[i];
+            if (x == 0)
+                continue;
+
+            int bits = i * 8;
+            while ((x & 0x80) == 0) {
+                x <<= 1;
+                bits++;
+            }
+            return bits;
+        }
+        return ID_BYTES * 8;
+    }
+
+    std::list<Sp<NodeInfo>> closest(std::vector<int>& candidates, const Id& target, int n) const {
+        n = std::min<int>(n, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(), [&](int a, int b) {
+            return target.threeWayCompare(nodes[a]->getId(), nodes[b]->getId()) < 0;
+        });
+
+        std::list<Sp<NodeInfo>> result {};
+        for (int i = 0; i < n; i++)
+            result.push_back(nodes[candidates[i]]);
+        return result;
+    }
+
+    int k;
+    std::vector<Sp<NodeInfo>> nodes {};
+    std::map<Id, int> index {};
+    std::vector<std::vector<int>> tables {};
+};
+
+struct SimulatedLookup {
+    int requests {0};       /* the find node requests sent */
+    int found {0};          /* how many of the real k closest nodes were found */
+};
+
+/**
+ * Run a node lookup from the origin node, with the same candidate selection
+ * and termination rules as the LookupTask. The in-flight requests are
+ * answered in rounds of alpha requests.
+ */
+template <typename ClosestSetType>
+SimulatedLookup simulateLookup(const SimulatedNetwork& network, int origin, const Id& target,
+        int k = 8, int alpha = 10) {
+    SimulatedLookup result {};
+
+    ClosestCandidates candidates(target, k * 3);
+    ClosestSetType closestSet(target, k);
+
+    candidates.add(network.findNode(origin, target, k * 2));
+
+    while (true) {
+        if (candidates.size() == 0 || (closestSet.isEligible() &&
+                target.threeWayCompare(closestSet.tail(), candidates.head()) <= 0))
+            break;
+
+        std::vector<Sp<CandidateNode>> inFlight {};
+        while (inFlight.size() < alpha) {
+            auto cn = candidates.next();
+            if (!cn)
+                break;
+
+            candidates.setSent(cn);
+            inFlight.push_back(cn);
+        }
+
+        if (inFlight.empty())
+            break;
+
+        for (const auto& cn : inFlight) {
+            result.requests++;
+
+            candidates.remove(cn->getId());
+            cn->setReplied();
+            closestSet.add(cn);
+
+            std::list<Sp<NodeInfo>> nodes {};
+            for (const auto& node : network.findNode(network.indexOf(cn->getId()), target, k)) {
+                if (node->getId() != network.getNode(origin)->getId() && !closestSet.contains(node->getId()))
+                    nodes.push_back(node);
+            }
+
+            if (!nodes.empty())
+                candidates.add(nodes);
+        }
+    }
+
+    for (const auto& node : network.findClosest(target, k)) {
+        if (closestSet.contains(node->getId()))
+            result.found++;
+    }
+
+    return result;
+}
+
+struct SimulatedTimedLookup {
+    int requests {0};       /* the find node requests sent */
+    uint64_t latency {0};   /* the simulated duration in milliseconds */
+    int concurrency {0};    /* the peak request concurrency */
+};
+
+/**
+ * Run a node lookup over a lossy network in simulated time. A request is
+ * answered after a random round trip time unless it got lost, the lost
+ * requests stall and time out like the RPC calls.
+ *
+ * The legacy lookup, as the LookupTask before the adaptive concurrency, keeps
+ * sending requests after the closest set converged and waits for all the
+ * in-flight requests, including the stalled ones, before it completes.
+ */
+inline SimulatedTimedLookup simulateTimedLookup(const SimulatedNetwork& network, int origin, const Id& target,
+        LookupConcurrency& concurrency, bool legacy, double loss, std::mt19937& rng, int k = 8) {
+    enum class Event { RESPONDED, STALLED, TIMEOUT };
+
+    SimulatedTimedLookup result {};
+
+    ClosestCandidates candidates(target, k * 3);
+    ClosestSet closestSet(target, k);
+
+    std::uniform_int_distribution<int> rtt(20, 200);
+    std::bernoulli_distribution lost(loss);
+    std::multimap<uint64_t, std::pair<Event, Sp<CandidateNode>>> events {};
+
+    int inFlight = 0;
+    int stalled = 0;
+    uint64_t now = 0;
+
+    auto isDone = [&]() {
+        int active = legacy ? inFlight : inFlight - stalled;
+        return active == 0 && (candidates.size() == 0 || (closestSet.isEligible() &&
+                target.threeWayCompare(closestSet.tail(),
+                        legacy ? candidates.head() : candidates.activeHead()) <= 0));
+    };
+
+    candidates.add(network.findNode(origin, target, k * 2));
+
+    while (!isDone()) {
+        while (inFlight < concurrency.get()) {
+            if (!legacy && closestSet.isEligible() &&
+                    target.threeWayCompare(closestSet.tail(), candidates.activeHead()) <= 0)
+                break;
+
+            auto cn = candidates.next();
+            if (!cn)
+                break;
+
+            candidates.setSent(cn);
+            inFlight++;
+            result.requests++;
+
+            if (lost(rng)) {
+                events.emplace(now + Constants::RPC_CALL_STALL_TIMEOUT, std::make_pair(Event::STALLED, cn));
+                events.emplace(now + Constants::RPC_CALL_TIMEOUT_MAX, std::make_pair(Event::TIMEOUT, cn));
+            } else {
+                events.emplace(now + rtt(rng), std::make_pair(Event::RESPONDED, cn));
+            }
+        }
+
+        if (events.empty())
+            break;
+
+        auto it = events.begin();
+        now = it->first;
+        auto [event, cn] = it->second;
+        events.erase(it);
+
+        switch (event) {
+        case Event::STALLED:
+            stalled++;
+            cn->setStalled();
+            concurrency.stalled();
+            break;
+
+        case Event::TIMEOUT:
+            stalled--;
+            inFlight--;
+            concurrency.timeout();
+            if (cn->isUnreachable())
+                candidates.remove(cn->getId());
+            else
+                candidates.clearSent(cn);
+            break;
+
+        case Event::RESPONDED: {
+            inFlight--;
+            concurrency.responded(true);
+
+            candidates.remove(cn->getId());
+            cn->setReplied();
+            closestSet.add(cn);
+
+            std::list<Sp<NodeInfo>> nodes {};
+            for (const auto& node : network.findNode(network.indexOf(cn->getId()), target, k)) {
+                if (node->getId() != network.getNode(origin)->getId() && !closestSet.contains(node->getId()))
+                    nodes.push_back(node);
+            }
+
+            if (!nodes.empty())
+                candidates.add(nodes);
+            break;
+        }
+        }
+    }
+
+    result.latency = now;
+    result.concurrency = concurrency.getPeak();
+    return result;
+}
+
+} // namespace test
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "utils/token_bucket.h"
+#include "token_bucket_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(TokenBucketTests);
+
+void TokenBucketTests::testTake() {
+    // 10 tokens per second, up to 100
+    TokenBucket bucket(10, 100);
+    uint64_t now = 1000000;
+
+    CPPUNIT_ASSERT(bucket.tryTake(60, now));
+    CPPUNIT_ASSERT(bucket.tryTake(40, now));
+    CPPUNIT_ASSERT(!bucket.tryTake(1, now));
+    CPPUNIT_ASSERT(!bucket.tryTake(0, now));
+    CPPUNIT_ASSERT_EQUAL(0.0, bucket.available(now));
+}
+
+void TokenBucketTests::testRefill() {
+    TokenBucket bucket(10, 100);
+    uint64_t now = 1000000;
+
+    CPPUNIT_ASSERT(bucket.tryTake(100, now));
+
+    // refilled at the configured rate
+    now += 2000;
+    CPPUNIT_ASSERT_EQUAL(20.0, bucket.available(now));
+    CPPUNIT_ASSERT(bucket.tryTake(20, now));
+    CPPUNIT_ASSERT(!bucket.tryTake(1, now));
+
+    // but never more than the capacity
+    now += 3600 * 1000;
+    CPPUNIT_ASSERT_EQUAL(100.0, bucket.available(now));
+
+    // the clock going backwards does not refill
+    CPPUNIT_ASSERT(bucket.tryTake(100, now));
+    CPPUNIT_ASSERT_EQUAL(0.0, bucket.available(now - 5000));
+    CPPUNIT_ASSERT_EQUAL(0.0, bucket.available(now));
+}
+
+void TokenBucketTests::testOversized() {
+    TokenBucket bucket(10, 100);
+    uint64_t now = 1000000;
+
+    // Larger than the tokens left and the capacity, still goes
+    CPPUNIT_ASSERT(bucket.tryTake(50, now));
+    CPPUNIT_ASSERT(bucket.tryTake(250, now));
+
+    // and the debt is paid back before anything else goes
+    CPPUNIT_ASSERT_EQUAL(-200.0, bucket.available(now));
+    now += 20000;
+    CPPUNIT_ASSERT(!bucket.tryTake(1, now));
+    now += 100;
+    CPPUNIT_ASSERT(bucket.tryTake(1, now));
+}
+
+void TokenBucketTests::testAverageRate() {
+    // One maintenance interval of budget, like the routing table
+    TokenBucket bucket(10, 10 * 240);
+    uint64_t start = 1000000;
+    uint64_t now = start;
+
+    // Mixed sizes every 4 minutes for a day, like the maintenance passes
+    // over the narrow and the wide buckets
+    double taken = 0;
+    int sizes[] = { 8, 256, 32, 3000, 64, 1200 };
+    while (now - start < 24 * 3600 * 1000) {
+        for (int size : sizes) {
+            if (bucket.tryTake(size, now))
+                taken += size;
+        }
+        now += 4 * 60 * 1000;
+    }
+
+    double seconds = (now - start) / 1000.0;
+    // the capacity and the largest request are the only overshoot allowed
+    CPPUNIT_ASSERT(taken <= seconds * 10 + 10 * 240 + 3000);
+    CPPUNIT_ASSERT(taken >= seconds * 10 * 0.8);
+}
+
+}  // namespace test
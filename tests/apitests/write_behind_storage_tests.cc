@@ -0,0 +1,205 @@
+/*
+* Copyright (c) 2022 - 2023 trinity-tech.io
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+
+#include <vector>
+#include <set>
+#include <string>
+#include <carrier.h>
+
+#include "sqlite_storage.h"
+#include "write_behind_storage.h"
+#include "utils.h"
+#include "write_behind_storage_tests.h"
+
+using namespace elastos::carrier;
+
+namespace test {
+CPPUNIT_TEST_SUITE_REGISTRATION(WriteBehindStorageTests);
+
+static Sp<WriteBehindStorage> open(const std::string& path) {
+    return std::make_shared<WriteBehindStorage>(SqliteStorage::open(path), SqliteStorage::open(path));
+}
+
+void WriteBehindStorageTests::setUp() {
+    path = Utils::getPwdStorage("writebehind.db");
+}
+
+void WriteBehindStorageTests::tearDown() {
+    Utils::removeStorage(path);
+    Utils::removeStorage(path + "-wal");
+    Utils::removeStorage(path + "-shm");
+}
+
+void WriteBehindStorageTests::testReadYourWrites() {
+    auto storage = open(path);
+
+    std::vector<Value> values {};
+    for (int i = 0; i < 256; i++) {
+        values.push_back(Value::createValue(Utils::getRandomData(256)));
+        storage->putValue(values.back());
+    }
+
+    auto keypair = Signature::KeyPair::random();
+    std::vector<PeerInfo> peers {};
+    for (int i = 0; i < 16; i++)
+        peers.push_back(PeerInfo::create(keypair, Id::random(), Id::random(), 8000 + i));
+    storage->putPeer(peers);
+
+    // visible before they are committed
+    for (const auto& value : values) {
+        auto stored = storage->getValue(value.getId());
+        CPPUNIT_ASSERT(stored);
+        CPPUNIT_ASSERT(*stored == value);
+    }
+
+    CPPUNIT_ASSERT(storage->getPeer(peers[0].getId(), 0).size() == 16);
+    CPPUNIT_ASSERT(storage->getPeer(peers[0].getId(), 8).size() == 8);
+    auto peer = storage->getPeer(peers[3].getId(), peers[3].getOrigin());
+    CPPUNIT_ASSERT(peer);
+    CPPUNIT_ASSERT(*peer == peers[3]);
+
+    storage->flush();
+    auto stats = storage->getStats();
+    CPPUNIT_ASSERT(stats.queueDepth == 0);
+    CPPUNIT_ASSERT(stats.writes == 257);
+    CPPUNIT_ASSERT(stats.commits >= 1 && stats.commits <= 257);
+    CPPUNIT_ASSERT(stats.maxQueueDepth >= 1);
+
+    // and still visible after
+    CPPUNIT_ASSERT(storage->getAllValues().size() == 256);
+    CPPUNIT_ASSERT(storage->getPeer(peers[0].getId(), 0).size() == 16);
+    for (const auto& value : values)
+        CPPUNIT_ASSERT(storage->getValue(value.getId()));
+
+    storage->close();
+}
+
+void WriteBehindStorageTests::testRemove() {
+    auto storage = open(path);
+
+    auto value = Value::createValue(Utils::getRandomData(256));
+    auto peer = PeerInfo::create(Id::random(), 8000);
+    storage->putValue(value);
+    storage->putPeer(peer);
+    storage->flush();
+
+    CPPUNIT_ASSERT(storage->removeValue(value.getId()));
+    CPPUNIT_ASSERT(storage->removePeer(peer.getId(), peer.getOrigin()));
+
+    // hidden before the removes are committed
+    CPPUNIT_ASSERT(storage->getValue(value.getId()) == nullptr);
+    CPPUNIT_ASSERT(storage->getPeer(peer.getId(), peer.getOrigin()) == nullptr);
+    CPPUNIT_ASSERT(storage->getPeer(peer.getId(), 8).empty());
+    CPPUNIT_ASSERT(!storage->removeValue(value.getId()));
+    CPPUNIT_ASSERT(!storage->removePeer(peer.getId(), peer.getOrigin()));
+
+    storage->flush();
+    CPPUNIT_ASSERT(storage->getValue(value.getId()) == nullptr);
+    CPPUNIT_ASSERT(storage->getAllValues().empty());
+    CPPUNIT_ASSERT(storage->getAllPeers().empty());
+
+    storage->close();
+}
+
+void WriteBehindStorageTests::testUpdateSignedValue() {
+    auto storage = open(path);
+
+    std::string str = "Hello, world";
+    std::vector<uint8_t> data1(str.cbegin(), str.cend());
+    auto signedValue = Value::createSignedValue(data1);
+    auto valueId = signedValue.getId();
+    storage->putValue(signedValue, 0);
+
+    // checked against the pending value
+    CPPUNIT_ASSERT_THROW(storage->putValue(signedValue, 10), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(storage->putValue(signedValue, 9), std::invalid_argument);
+
+    str = "Hello, world2";
+    std::vector<uint8_t> data2(str.cbegin(), str.cend());
+    auto updated = signedValue.update(data2);
+    auto old = storage->putValue(updated, 0);
+    CPPUNIT_ASSERT(old);
+    CPPUNIT_ASSERT(*old == signedValue);
+
+    // a stale update queued behind the newer one is refused
+    CPPUNIT_ASSERT_THROW(storage->putValue(signedValue), std::invalid_argument);
+
+    auto value = storage->getValue(valueId);
+    CPPUNIT_ASSERT(value);
+    CPPUNIT_ASSERT(*value == updated);
+
+    storage->flush();
+    value = storage->getValue(valueId);
+    CPPUNIT_ASSERT(value);
+    CPPUNIT_ASSERT(*value == updated);
+
+    storage->close();
+}
+
+void WriteBehindStorageTests::testCommitOnClose() {
+    auto storage = open(path);
+
+    for (int i = 0; i < 128; i++) {
+        auto value = Value::createValue(Utils::getRandomData(256));
+        storage->putValue(value, i % 2 == 0);
+    }
+    storage->close();
+
+    auto sqlite = SqliteStorage::open(path);
+    CPPUNIT_ASSERT(sqlite->getAllValues().size() == 128);
+    CPPUNIT_ASSERT(sqlite->getPersistentValues(currentTimeMillis()).size() == 64);
+    sqlite->close();
+}
+
+void WriteBehindStorageTests::testScanPages() {
+    auto storage = open(path);
+    // announced before, the updates below are not
+    auto before = currentTimeMillis() - 1;
+
+    std::set<Id> ids {};
+    for (int i = 0; i < 100; i++) {
+        auto value = Value::createValue(Utils::getRandomData(256));
+        storage->putValue(value, -1, true, false);
+        ids.insert(value.getId());
+    }
+
+    // The writes queued before the scan are seen, the announce updates queued
+    // between the pages do not move the cursor over the records
+    std::set<Id> scanned {};
+    ScanCursor cursor {};
+    while (!cursor.done) {
+        for (const auto& value : storage->scanPersistentValues(before, cursor, 16)) {
+            CPPUNIT_ASSERT(scanned.insert(value.getId()).second);
+            storage->updateValueLastAnnounce(value.getId());
+        }
+    }
+    CPPUNIT_ASSERT(scanned == ids);
+
+    storage->flush();
+    cursor = {};
+    CPPUNIT_ASSERT(storage->scanPersistentValues(before, cursor, 16).empty());
+
+    storage->close();
+}
+
+}  // namespace test
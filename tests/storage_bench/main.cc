@@ -0,0 +1,616 @@
+/*
+ * Copyright (c) 2022 - 2023 trinity-tech.io
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <array>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <signal.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+#include <CLI/CLI.hpp>
+#include <carrier.h>
+
+#include "constants.h"
+#include "data_storage.h"
+#include "sqlite_storage.h"
+#include "memory_storage.h"
+#include "log_storage.h"
+#include "write_behind_storage.h"
+#include "cached_storage.h"
+
+using namespace std;
+using namespace elastos::carrier;
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string backend {"sqlite"};
+    bool stack {false};
+    std::string dataDir {"storage_bench"};
+    bool reuse {false};
+    uint64_t keys {1000000};
+    uint64_t preload {0};
+    uint64_t ops {0};           // 0: until the duration is over
+    int duration {60};          // seconds
+    uint64_t rate {0};          // ops/s, 0: as fast as the storage goes
+    int interval {10};          // seconds
+    std::string mix {"putValue:30,getValue:40,putPeer:15,getPeer:10,announce:4,expire:1"};
+    int maxPeers {8};
+    int origins {4};
+    int valueSize {128};
+    uint64_t memory {1024 * 1024 * 1024};
+    uint64_t seed {0};
+};
+
+static Options options;
+static volatile sig_atomic_t stopped {0};
+
+enum Op {
+    PUT_VALUE, GET_VALUE, PUT_PEER, GET_PEER, ANNOUNCE, EXPIRE, NUM_OPS
+};
+
+static const std::array<const char*, NUM_OPS> OP_NAMES {
+    "putValue", "getValue", "putPeer", "getPeer", "announce", "expire"
+};
+
+/*
+ * Log-linear latency histogram in nanoseconds, 32 buckets for each power of
+ * two, so the percentiles are within about 3% of the recorded latencies.
+ */
+class Histogram {
+public:
+    void record(uint64_t ns) {
+        counts[indexOf(ns)]++;
+        total++;
+        sum += ns;
+        if (ns > max)
+            max = ns;
+    }
+
+    void merge(const Histogram& other) {
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        if (other.max > max)
+            max = other.max;
+    }
+
+    void reset() {
+        counts.fill(0);
+        total = sum = max = 0;
+    }
+
+    uint64_t count() const {
+        return total;
+    }
+
+    uint64_t maximum() const {
+        return max;
+    }
+
+    uint64_t mean() const {
+        return total ? sum / total : 0;
+    }
+
+    uint64_t percentile(double p) const {
+        if (total == 0)
+            return 0;
+
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * total);
+        if (rank >= total)
+            rank = total - 1;
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); i++) {
+            seen += counts[i];
+            if (seen > rank)
+                return std::min(upperOf(i), max);
+        }
+        return max;
+    }
+
+private:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+
+    static size_t indexOf(uint64_t v) {
+        if (v < SUB_BUCKETS)
+            return v;
+
+        int msb = 0;
+        for (uint64_t x = v; x > 1; x >>= 1)
+            msb++;
+
+        int shift = msb - SUB_BITS;
+        return ((shift + 1) << SUB_BITS) + ((v >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t upperOf(size_t index) {
+        if (index < SUB_BUCKETS)
+            return index;
+
+        int shift = static_cast<int>(index >> SUB_BITS) - 1;
+        uint64_t sub = index & (SUB_BUCKETS - 1);
+        return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+    }
+
+    std::array<uint64_t, 64 << SUB_BITS> counts {};
+    uint64_t total {0};
+    uint64_t sum {0};
+    uint64_t max {0};
+};
+
+static void signal_handler(int signum)
+{
+    stopped = 1;
+}
+
+static void parseArgs(int argc, char **argv)
+{
+    CLI::App app("Elastos Carrier storage benchmark", "carrier-bench-storage");
+    app.add_option("-b, --backend", options.backend, "the storage backend: sqlite, memory or log.")
+            ->check(CLI::IsMember({"sqlite", "memory", "log"}));
+    app.add_flag("-s, --stack", options.stack, "put the write-behind queue and the record cache on top of the backend, as the node does.");
+    app.add_option("-d, --data-dir", options.dataDir, "the directory of the storage files.");
+    app.add_flag("--reuse", options.reuse, "continue on the storage files left by a previous run.");
+    app.add_option("-k, --keys", options.keys, "number of the distinct value and peer keys.");
+    app.add_option("--preload", options.preload, "number of the values and peers put before the measured run.");
+    app.add_option("-n, --ops", options.ops, "number of the operations, 0 to run for the duration.");
+    app.add_option("-t, --duration", options.duration, "the duration (second) of the run.");
+    app.add_option("-r, --rate", options.rate, "the target operations per second, 0 for as fast as possible.");
+    app.add_option("-i, --interval", options.interval, "the interval time (second) of the progress reports.");
+    app.add_option("-m, --mix", options.mix, "the operation weights, putValue, getValue, putPeer, getPeer, announce and expire.");
+    app.add_option("-p, --max-peers", options.maxPeers, "the k of the getPeer(id, k) operations.");
+    app.add_option("-o, --origins", options.origins, "number of the origins announcing each peer id.");
+    app.add_option("-v, --value-size", options.valueSize, "the data size (byte) of the values.");
+    app.add_option("--memory", options.memory, "the size limit (byte) of the memory backend.");
+    app.add_option("--seed", options.seed, "the seed of the operation sequence.");
+
+    try {
+        app.parse(argc, argv);
+    } catch (const CLI::Error &e) {
+        int rc = app.exit(e);
+        std::exit(rc);
+    }
+}
+
+static std::array<double, NUM_OPS> parseMix(const std::string& mix)
+{
+    std::array<double, NUM_OPS> weights {};
+    std::stringstream ss(mix);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        auto pos = item.find(':');
+        if (pos == std::string::npos)
+            throw std::invalid_argument("Invalid mix item: " + item);
+
+        auto name = item.substr(0, pos);
+        auto it = std::find(OP_NAMES.begin(), OP_NAMES.end(), name);
+        if (it == OP_NAMES.end())
+            throw std::invalid_argument("Unknown operation: " + name);
+
+        auto weight = std::stod(item.substr(pos + 1));
+        if (weight < 0)
+            throw std::invalid_argument("Negative weight of " + name);
+
+        weights[it - OP_NAMES.begin()] = weight;
+    }
+
+    double sum = 0;
+    for (auto w : weights)
+        sum += w;
+    if (sum <= 0)
+        throw std::invalid_argument("The mix has no operations");
+
+    return weights;
+}
+
+static uint64_t splitmix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// The keys are derived from their index, so the run needs no key table
+static Id makeId(uint64_t kind, uint64_t index)
+{
+    std::array<uint8_t, Id::BYTES> bytes;
+    uint64_t state = (kind << 56) ^ index;
+    for (size_t i = 0; i < bytes.size(); i += sizeof(uint64_t)) {
+        auto x = splitmix64(state);
+        std::memcpy(bytes.data() + i, &x, sizeof(x));
+    }
+    return Id(Blob(bytes));
+}
+
+static Value makeValue(uint64_t index)
+{
+    std::vector<uint8_t> data(std::max(options.valueSize, 8));
+    uint64_t state = index;
+    for (size_t i = 0; i < data.size(); i += sizeof(uint64_t)) {
+        auto x = i == 0 ? index : splitmix64(state);
+        std::memcpy(data.data() + i, &x, std::min(sizeof(x), data.size() - i));
+    }
+    return Value::createValue(data);
+}
+
+static PeerInfo makePeer(uint64_t index)
+{
+    // the storage does not verify the peers, the signature is only the payload
+    static const std::array<uint8_t, Signature::BYTES> signature {};
+    auto peerId = makeId(1, index / options.origins);
+    auto origin = makeId(2, index % options.origins);
+    auto nodeId = makeId(3, index);
+    return PeerInfo::of(peerId.blob(), {}, nodeId.blob(), origin.blob(),
+            static_cast<uint16_t>(1024 + index % 60000), "", Blob(signature));
+}
+
+static uint64_t storageBytes()
+{
+    uint64_t bytes = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(options.dataDir, ec);
+            it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec)
+            break;
+        if (it->is_regular_file(ec))
+            bytes += it->file_size(ec);
+    }
+    return bytes;
+}
+
+static uint64_t residentBytes()
+{
+#if defined(__linux__) && defined(HAVE_UNISTD_H)
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    if (statm >> size >> resident)
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+static uint64_t peakResidentBytes()
+{
+#ifdef HAVE_SYS_RESOURCE_H
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+static std::string formatBytes(uint64_t bytes)
+{
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) << " MiB";
+    return ss.str();
+}
+
+static std::string formatLatency(uint64_t ns)
+{
+    std::stringstream ss;
+    if (ns < 1000)
+        ss << ns << "ns";
+    else if (ns < 1000000)
+        ss << std::fixed << std::setprecision(1) << ns / 1000.0 << "us";
+    else
+        ss << std::fixed << std::setprecision(1) << ns / 1000000.0 << "ms";
+    return ss.str();
+}
+
+static Sp<DataStorage> openStorage()
+{
+    if (options.backend == "memory")
+        return std::make_shared<MemoryStorage>(options.memory);
+
+    Sp<DataStorage> reader {};
+    Sp<DataStorage> writer {};
+    if (options.backend == "log") {
+        reader = writer = std::make_shared<LogStorage>(options.dataDir + "/node.log");
+    } else {
+        auto path = options.dataDir + "/node.db";
+        reader = SqliteStorage::open(path);
+        writer = options.stack ? SqliteStorage::open(path) : reader;
+    }
+
+    if (!options.stack)
+        return writer;
+
+    // the same stack as the node
+    auto writeBehind = std::make_shared<WriteBehindStorage>(reader, writer);
+    auto cached = std::make_shared<CachedStorage>(writeBehind, Constants::STORAGE_RECORD_CACHE_SIZE,
+            Constants::STORAGE_RECORD_CACHE_TTL);
+    std::weak_ptr<CachedStorage> weakCached = cached;
+    writeBehind->setExpireListener([weakCached]() {
+        if (auto cached = weakCached.lock())
+            cached->invalidateAll();
+    });
+    return cached;
+}
+
+static void prepareDataDir()
+{
+    std::error_code ec;
+    if (fs::exists(options.dataDir) && !fs::is_empty(options.dataDir, ec) && !options.reuse)
+        throw std::invalid_argument("The data directory " + options.dataDir
+                + " is not empty, remove it or run with --reuse.");
+
+    fs::create_directories(options.dataDir);
+}
+
+static void preload(DataStorage& storage)
+{
+    auto count = std::min(options.preload, options.keys);
+    if (count == 0)
+        return;
+
+    auto start = Clock::now();
+    for (uint64_t i = 0; i < count && !stopped; i++) {
+        storage.putValue(makeValue(i));
+        storage.putPeer(makePeer(i), false, false);
+    }
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "Preloaded " << count << " values and peers in " << std::fixed << std::setprecision(1)
+              << seconds << "s, storage " << formatBytes(storageBytes()) << std::endl;
+}
+
+static void report(double elapsed, double seconds, const std::array<Histogram, NUM_OPS>& histograms)
+{
+    uint64_t ops = 0;
+    for (const auto& h : histograms)
+        ops += h.count();
+
+    std::cout << "[" << std::setw(6) << static_cast<uint64_t>(elapsed) << "s] "
+              << static_cast<uint64_t>(seconds > 0 ? ops / seconds : 0) << " ops/s";
+    for (int op = 0; op < NUM_OPS; op++) {
+        const auto& h = histograms[op];
+        if (h.count() == 0)
+            continue;
+        std::cout << " | " << OP_NAMES[op] << " p50 " << formatLatency(h.percentile(50))
+                  << " p99 " << formatLatency(h.percentile(99))
+                  << " p999 " << formatLatency(h.percentile(99.9));
+    }
+    std::cout << " | files " << formatBytes(storageBytes())
+              << " | rss " << formatBytes(residentBytes()) << std::endl;
+}
+
+static void summary(double seconds, const std::array<Histogram, NUM_OPS>& histograms,
+        uint64_t startBytes, uint64_t hits, uint64_t misses, uint64_t rss, const StorageStats& stats)
+{
+    uint64_t ops = 0;
+    for (const auto& h : histograms)
+        ops += h.count();
+
+    std::cout << std::endl << std::left << std::setw(10) << "operation" << std::right
+              << std::setw(12) << "count" << std::setw(12) << "ops/s"
+              << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+              << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::endl;
+
+    for (int op = 0; op < NUM_OPS; op++) {
+        const auto& h = histograms[op];
+        if (h.count() == 0)
+            continue;
+        std::cout << std::left << std::setw(10) << OP_NAMES[op] << std::right
+                  << std::setw(12) << h.count()
+                  << std::setw(12) << static_cast<uint64_t>(h.count() / seconds)
+                  << std::setw(10) << formatLatency(h.mean())
+                  << std::setw(10) << formatLatency(h.percentile(50))
+                  << std::setw(10) << formatLatency(h.percentile(90))
+                  << std::setw(10) << formatLatency(h.percentile(99))
+                  << std::setw(10) << formatLatency(h.percentile(99.9))
+                  << std::setw(10) << formatLatency(h.maximum()) << std::endl;
+    }
+
+    auto endBytes = storageBytes();
+    std::cout << std::endl
+              << "Throughput: " << static_cast<uint64_t>(ops / seconds) << " ops/s, "
+              << ops << " operations in " << std::fixed << std::setprecision(1) << seconds << "s" << std::endl
+              << "Lookups: " << hits << " found, " << misses << " not found" << std::endl
+              << "Storage files: " << formatBytes(startBytes) << " -> " << formatBytes(endBytes)
+              << " (" << (endBytes >= startBytes ? "+" : "-")
+              << formatBytes(endBytes >= startBytes ? endBytes - startBytes : startBytes - endBytes) << ")" << std::endl
+              << "RSS: " << formatBytes(rss) << ", peak " << formatBytes(peakResidentBytes()) << std::endl;
+
+    if (options.stack)
+        std::cout << "Write-behind: " << stats.commits << " commits of " << stats.writes << " writes, max queue depth "
+                  << stats.maxQueueDepth << ", max commit " << stats.maxCommitLatency << "us" << std::endl
+                  << "Cache: " << stats.cacheHits << " hits, " << stats.cacheMisses << " misses" << std::endl;
+}
+
+/*
+ * The operations are issued open loop from one thread, the way the RPC thread
+ * drives the storage. With a target rate the latency is measured from the time
+ * the operation was due, so the stalls count against all the operations
+ * queued behind them instead of hiding them.
+ */
+static void run()
+{
+    auto weights = parseMix(options.mix);
+    if (options.keys == 0 || options.origins <= 0 || options.maxPeers <= 0 || options.interval <= 0)
+        throw std::invalid_argument("The keys, origins, max peers and interval should be positive");
+
+    prepareDataDir();
+    auto storage = openStorage();
+    preload(*storage);
+
+    std::mt19937_64 rng(options.seed);
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+    std::uniform_int_distribution<uint64_t> key(0, options.keys - 1);
+    std::uniform_int_distribution<uint64_t> peerKey(0, (options.keys - 1) / options.origins);
+
+    std::array<Histogram, NUM_OPS> total {};
+    std::array<Histogram, NUM_OPS> current {};
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    auto startBytes = storageBytes();
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(options.duration);
+    auto nextReport = start + std::chrono::seconds(options.interval);
+    auto lastReport = start;
+    std::chrono::nanoseconds period {options.rate > 0 ? 1000000000 / options.rate : 0};
+
+    for (uint64_t n = 0; !stopped; n++) {
+        if (options.ops > 0 ? n >= options.ops : Clock::now() >= end)
+            break;
+
+        auto op = static_cast<Op>(pick(rng));
+        auto k = op == GET_PEER ? peerKey(rng) : key(rng);
+
+        // build the records and ids before the clock starts, only the storage call is measured
+        std::optional<Value> value {};
+        std::optional<PeerInfo> peer {};
+        Id id {};
+        switch (op) {
+        case PUT_VALUE:
+            value = makeValue(k);
+            break;
+        case GET_VALUE:
+            id = makeValue(k).getId();
+            break;
+        case PUT_PEER:
+            peer = makePeer(k);
+            break;
+        case GET_PEER:
+            id = makeId(1, k);
+            break;
+        case ANNOUNCE:
+            id = (k & 1) ? makePeer(k).getId() : makeValue(k).getId();
+            break;
+        default:
+            break;
+        }
+
+        auto due = Clock::now();
+        if (period.count() > 0) {
+            due = start + period * n;
+            // the sleep overshoots by tens of microseconds, spin the rest of the way
+            std::this_thread::sleep_until(due - std::chrono::microseconds(200));
+            while (Clock::now() < due)
+                ;
+        }
+
+        switch (op) {
+        case PUT_VALUE:
+            storage->putValue(*value);
+            break;
+        case GET_VALUE:
+            storage->getValue(id) ? hits++ : misses++;
+            break;
+        case PUT_PEER:
+            storage->putPeer(*peer, false, false);
+            break;
+        case GET_PEER:
+            storage->getPeer(id, options.maxPeers).empty() ? misses++ : hits++;
+            break;
+        case ANNOUNCE:
+            if (k & 1)
+                storage->updatePeerLastAnnounce(id, makeId(2, k % options.origins));
+            else
+                storage->updateValueLastAnnounce(id);
+            break;
+        case EXPIRE:
+            storage->expire(Constants::STORAGE_EXPIRE_CHUNK);
+            break;
+        default:
+            break;
+        }
+
+        auto now = Clock::now();
+        auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count();
+        current[op].record(static_cast<uint64_t>(latency));
+
+        if (now >= nextReport) {
+            report(std::chrono::duration<double>(now - start).count(),
+                    std::chrono::duration<double>(now - lastReport).count(), current);
+            for (int i = 0; i < NUM_OPS; i++) {
+                total[i].merge(current[i]);
+                current[i].reset();
+            }
+            lastReport = now;
+            nextReport = now + std::chrono::seconds(options.interval);
+        }
+    }
+
+    for (int i = 0; i < NUM_OPS; i++)
+        total[i].merge(current[i]);
+
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    auto stats = storage->getStats();
+    auto rss = residentBytes();
+
+    // the write-behind queue is committed on close, it is part of the cost
+    auto closeStart = Clock::now();
+    storage->close();
+    auto closing = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - closeStart).count();
+
+    summary(seconds, total, startBytes, hits, misses, rss, stats);
+    std::cout << "Close: " << formatLatency(static_cast<uint64_t>(closing)) << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    parseArgs(argc, argv);
+
+    signal(SIGINT,  signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    try {
+        run();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}